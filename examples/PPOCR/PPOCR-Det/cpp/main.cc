@@ -89,10 +89,9 @@ int main(int argc, char** argv)
             results.box[i].right_bottom.x, results.box[i].right_bottom.y, results.box[i].left_bottom.x, results.box[i].left_bottom.y,
             results.box[i].score);
         //draw Quadrangle box
-        draw_line(&src_image, results.box[i].left_top.x, results.box[i].left_top.y, results.box[i].right_top.x, results.box[i].right_top.y, 255, 2);
-        draw_line(&src_image, results.box[i].right_top.x, results.box[i].right_top.y, results.box[i].right_bottom.x, results.box[i].right_bottom.y, 255, 2);
-        draw_line(&src_image, results.box[i].right_bottom.x, results.box[i].right_bottom.y, results.box[i].left_bottom.x, results.box[i].left_bottom.y, 255, 2);
-        draw_line(&src_image, results.box[i].left_bottom.x, results.box[i].left_bottom.y, results.box[i].left_top.x, results.box[i].left_top.y, 255, 2);
+        int points[8] = {results.box[i].left_top.x, results.box[i].left_top.y, results.box[i].right_top.x, results.box[i].right_top.y,
+                         results.box[i].right_bottom.x, results.box[i].right_bottom.y, results.box[i].left_bottom.x, results.box[i].left_bottom.y};
+        draw_polygon(&src_image, points, 4, 255, 2);
     }
     printf("    SAVE TO ./out.jpg\n");
     write_image("./out.jpg", &src_image);
@@ -21,18 +21,18 @@ int init_ppocr_det_model(const char* model_path, rknn_app_context_t* app_ctx)
 {
     int ret;
     int model_len = 0;
-    char* model;
+    char* model = NULL;
     rknn_context ctx = 0;
 
     // Load RKNN Model
-    model_len = read_data_from_file(model_path, &model);
+    model_len = load_model_mapped(model_path, &model, MODEL_MAP_SEQUENTIAL);
     if (model == NULL) {
         printf("load_model fail!\n");
         return -1;
     }
 
     ret = rknn_init(&ctx, model, model_len, 0, NULL);
-    free(model);
+    unload_model_mapped(model, model_len);
     if (ret < 0) {
         printf("rknn_init fail! ret=%d\n", ret);
         return -1;
@@ -3,6 +3,7 @@
 
 #include "rknn_api.h"
 #include "common.h"
+#include "buffer_pool.h"
 #include <string.h>
 
 #define MODEL_OUT_CHANNEL 6625
@@ -15,6 +16,7 @@ typedef struct {
     int model_channel;
     int model_width;
     int model_height;
+    buffer_pool_t* buffer_pool;     // per-frame input tensor, reset at each inference
 } rknn_app_context_t;
 
 typedef struct ppocr_rec_result
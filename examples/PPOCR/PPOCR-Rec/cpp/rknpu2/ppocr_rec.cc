@@ -20,18 +20,18 @@ int init_ppocr_rec_model(const char* model_path, rknn_app_context_t* app_ctx)
 {
     int ret;
     int model_len = 0;
-    char* model;
+    char* model = NULL;
     rknn_context ctx = 0;
 
     // Load RKNN Model
-    model_len = read_data_from_file(model_path, &model);
+    model_len = load_model_mapped(model_path, &model, MODEL_MAP_SEQUENTIAL);
     if (model == NULL) {
         printf("load_model fail!\n");
         return -1;
     }
 
     ret = rknn_init(&ctx, model, model_len, 0, NULL);
-    free(model);
+    unload_model_mapped(model, model_len);
     if (ret < 0) {
         printf("rknn_init fail! ret=%d\n", ret);
         return -1;
@@ -96,6 +96,12 @@ int init_ppocr_rec_model(const char* model_path, rknn_app_context_t* app_ctx)
     printf("model input height=%d, width=%d, channel=%d\n",
         app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
 
+    app_ctx->buffer_pool = buffer_pool_create();
+    if (app_ctx->buffer_pool == NULL) {
+        printf("buffer_pool_create fail!\n");
+        return -1;
+    }
+
     return 0;
 }
 
@@ -109,6 +115,10 @@ int release_ppocr_rec_model(rknn_app_context_t* app_ctx)
         free(app_ctx->output_attrs);
         app_ctx->output_attrs = NULL;
     }
+    if (app_ctx->buffer_pool != NULL) {
+        buffer_pool_destroy(app_ctx->buffer_pool);
+        app_ctx->buffer_pool = NULL;
+    }
     if (app_ctx->rknn_ctx != 0) {
         rknn_destroy(app_ctx->rknn_ctx);
         app_ctx->rknn_ctx = 0;
@@ -126,6 +136,9 @@ int inference_ppocr_rec_model(rknn_app_context_t* app_ctx, image_buffer_t* src_i
     memset(inputs, 0, sizeof(inputs));
     memset(outputs, 0, sizeof(outputs));
 
+    // 上一帧的缓冲全部归还，稳定后每帧不再申请堆内存
+    buffer_pool_reset(app_ctx->buffer_pool);
+
     // Pre Process
     float ratio = src_img->width / float(src_img->height);
     int resized_w;
@@ -137,12 +150,22 @@ int inference_ppocr_rec_model(rknn_app_context_t* app_ctx, image_buffer_t* src_i
         resized_w = std::ceil(imgH*ratio);
     }
 
+    // 缩放结果和输入张量都放在池化缓冲上，cv::Mat只做包装不再分配内存
+    unsigned char* resized_buf = (unsigned char*)buffer_pool_alloc(app_ctx->buffer_pool, imgH * resized_w * 3);
+    float* input_buf = (float*)buffer_pool_alloc(app_ctx->buffer_pool, imgH * imgW * 3 * sizeof(float));
+    if (resized_buf == NULL || input_buf == NULL) {
+        printf("buffer_pool_alloc fail!\n");
+        return -1;
+    }
     cv::Mat img_M = cv::Mat(src_img->height, src_img->width, CV_8UC3,(uint8_t*)src_img->virt_addr);
-    cv::resize(img_M, img_M, cv::Size(resized_w, imgH));
-    img_M.convertTo(img_M, CV_32FC3);
-    img_M = (img_M - 127.5)/127.5;
+    cv::Mat resized_M = cv::Mat(imgH, resized_w, CV_8UC3, resized_buf);
+    cv::resize(img_M, resized_M, cv::Size(resized_w, imgH));
+    // (x - 127.5) / 127.5，右侧补0
+    cv::Mat input_M = cv::Mat(imgH, imgW, CV_32FC3, input_buf);
+    cv::Mat input_roi = input_M(cv::Rect(0, 0, resized_w, imgH));
+    resized_M.convertTo(input_roi, CV_32FC3, 1 / 127.5, -1.0);
     if (resized_w < imgW) {
-        copyMakeBorder(img_M, img_M, 0, 0, 0, imgW- resized_w, cv::BORDER_CONSTANT, 0);
+        input_M(cv::Rect(resized_w, 0, imgW - resized_w, imgH)).setTo(cv::Scalar::all(0));
     }
 
     // Set Input Data
@@ -150,9 +173,7 @@ int inference_ppocr_rec_model(rknn_app_context_t* app_ctx, image_buffer_t* src_i
     inputs[0].type  = RKNN_TENSOR_FLOAT32;
     inputs[0].fmt   = RKNN_TENSOR_NHWC;
     inputs[0].size  = app_ctx->model_width * app_ctx->model_height * app_ctx->model_channel * sizeof(float);
-    // inputs[0].buf   = img.virt_addr;
-    inputs[0].buf = malloc(inputs[0].size);
-    memcpy(inputs[0].buf, img_M.data, inputs[0].size);
+    inputs[0].buf   = input_buf;
 
     ret = rknn_inputs_set(app_ctx->rknn_ctx, 1, inputs);
     if (ret < 0) {
@@ -184,9 +205,5 @@ int inference_ppocr_rec_model(rknn_app_context_t* app_ctx, image_buffer_t* src_i
     rknn_outputs_release(app_ctx->rknn_ctx, 1, outputs);
 
 out:
-    if (inputs[0].buf != NULL) {
-        free(inputs[0].buf);
-    }
-
     return ret;
 }
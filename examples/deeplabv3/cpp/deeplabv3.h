@@ -3,6 +3,7 @@
 
 #include "rknn_api.h"
 #include "common.h"
+#include "buffer_pool.h"
 
 
 
@@ -14,6 +15,7 @@ typedef struct {
     int model_channel;
     int model_width;
     int model_height;
+    buffer_pool_t* buffer_pool;     // per-frame buffers of rknpu1 path, reset at each inference
 } rknn_app_context_t;
 
 int init_deeplabv3_model(const char* model_path, rknn_app_context_t* app_ctx);
@@ -7,6 +7,7 @@
 #include "common.h"
 #include "file_utils.h"
 #include "image_utils.h"
+#include "image_drawing.h"
 #include <opencv2/opencv.hpp>
 
 #define NUM_LABEL 21
@@ -75,28 +76,23 @@ static void resize_by_opencv(float *input_image, int input_width, int input_heig
     memcpy(output_image, dst_image.data, target_width * target_height * NUM_LABEL * sizeof(float));
 }
 
-static void compose_img(uint8_t *res_buf, uint8_t *img_buf, int height, int width)
+static void compose_img(uint8_t *res_buf, image_buffer_t *img, int height, int width)
 {
-    // blending two images
-    // using 0 gamma, 0.5 a
-    const float alpha = 0.5f;
-    float beta = 1.0 - alpha;
-
-    for (int h = 0; h < height; ++h)
+    // blending two images, 0.5 opacity for all labels including background
+    unsigned int palette[NUM_LABEL];
+    for (int i = 0; i < (int)NUM_LABEL; i++)
     {
-        for (int w = 0; w < width; ++w)
-        {
-            unsigned char map_label = res_buf[h * width + w];
-
-            auto ori_pixel_r = img_buf[h * width * 3 + w * 3];
-            auto ori_pixel_g = img_buf[h * width * 3 + w * 3 + 1];
-            auto ori_pixel_b = img_buf[h * width * 3 + w * 3 + 2];
-
-            img_buf[h * width * 3 + w * 3] = FULL_COLOR_MAP[map_label][0] * alpha + ori_pixel_r * beta;
-            img_buf[h * width * 3 + w * 3 + 1] = FULL_COLOR_MAP[map_label][1] * alpha + ori_pixel_g * beta; // g
-            img_buf[h * width * 3 + w * 3 + 2] = FULL_COLOR_MAP[map_label][2] * alpha + ori_pixel_b * beta; // b
-        }
+        palette[i] = 0x80000000 | (FULL_COLOR_MAP[i][0] << 16) | (FULL_COLOR_MAP[i][1] << 8) | FULL_COLOR_MAP[i][2];
     }
+
+    // label map is scaled to image size
+    overlay_mask_t mask;
+    mask.labels = res_buf;
+    mask.width = width;
+    mask.height = height;
+    mask.palette = palette;
+    mask.num_colors = NUM_LABEL;
+    draw_overlay(img, &mask, NULL, 0, 0);
 }
 
 int init_deeplabv3_model(const char *model_path, rknn_app_context_t *app_ctx)
@@ -105,11 +101,11 @@ int init_deeplabv3_model(const char *model_path, rknn_app_context_t *app_ctx)
 
     int ret;
     int model_len = 0;
-    char *model;
+    char *model = NULL;
     rknn_context ctx = 0;
 
     // Load RKNN Model
-    model_len = read_data_from_file(model_path, &model);
+    model_len = load_model_mapped(model_path, &model, MODEL_MAP_SEQUENTIAL);
     if (model == NULL)
     {
         printf("load_model fail!\n");
@@ -117,7 +113,7 @@ int init_deeplabv3_model(const char *model_path, rknn_app_context_t *app_ctx)
     }
 
     ret = rknn_init(&ctx, model, model_len, 0);
-    free(model);
+    unload_model_mapped(model, model_len);
     if (ret < 0)
     {
         printf("rknn_init fail! ret=%d\n", ret);
@@ -191,6 +187,13 @@ int init_deeplabv3_model(const char *model_path, rknn_app_context_t *app_ctx)
     printf("model input height=%d, width=%d, channel=%d\n",
            app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
 
+    app_ctx->buffer_pool = buffer_pool_create();
+    if (app_ctx->buffer_pool == NULL)
+    {
+        printf("buffer_pool_create fail!\n");
+        return -1;
+    }
+
     return 0;
 }
 
@@ -206,6 +209,11 @@ int release_deeplabv3_model(rknn_app_context_t *app_ctx)
         free(app_ctx->output_attrs);
         app_ctx->output_attrs = NULL;
     }
+    if (app_ctx->buffer_pool != NULL)
+    {
+        buffer_pool_destroy(app_ctx->buffer_pool);
+        app_ctx->buffer_pool = NULL;
+    }
     if (app_ctx->rknn_ctx != 0)
     {
         rknn_destroy(app_ctx->rknn_ctx);
@@ -214,9 +222,10 @@ int release_deeplabv3_model(rknn_app_context_t *app_ctx)
     return 0;
 }
 
-static void post_process(float *input, uint8_t *output, int seg_width, int seg_height, int n_label, int out_width, int out_height)
+static void post_process(float *input, uint8_t *output, int seg_width, int seg_height, int n_label, int out_width, int out_height,
+                         buffer_pool_t *pool)
 {
-    float *mask = (float *)malloc(out_width * out_height * n_label * sizeof(float));
+    float *mask = (float *)buffer_pool_alloc(pool, out_width * out_height * n_label * sizeof(float));
     resize_by_opencv(input, seg_width, seg_height, mask, out_width, out_height);
 
     // Find the index of the maximum value along the last axis
@@ -234,7 +243,7 @@ static void post_process(float *input, uint8_t *output, int seg_width, int seg_h
         output[i] = max_index;
     }
 
-    free(mask);
+    buffer_pool_free(pool, mask);
 }
 
 int inference_deeplabv3_model(rknn_app_context_t *app_ctx, image_buffer_t *src_img)
@@ -248,14 +257,17 @@ int inference_deeplabv3_model(rknn_app_context_t *app_ctx, image_buffer_t *src_i
     memset(inputs, 0, sizeof(inputs));
     memset(outputs, 0, sizeof(outputs));
 
+    // 上一帧的缓冲全部归还，稳定后每帧不再申请堆内存
+    buffer_pool_reset(app_ctx->buffer_pool);
+
     // Pre Process
     img.width = app_ctx->model_width;
     img.height = app_ctx->model_height;
     img.format = IMAGE_FORMAT_RGB888;
     img.size = get_image_size(&img);
-    img.virt_addr = (unsigned char *)malloc(img.size);
-    uint8_t *seg_img = (uint8_t *)malloc(img.width * img.height * sizeof(uint8_t));
-    if (img.virt_addr == NULL)
+    img.virt_addr = (unsigned char *)buffer_pool_alloc(app_ctx->buffer_pool, img.size);
+    uint8_t *seg_img = (uint8_t *)buffer_pool_alloc(app_ctx->buffer_pool, img.width * img.height * sizeof(uint8_t));
+    if (img.virt_addr == NULL || seg_img == NULL)
     {
         printf("malloc buffer size:%d fail!\n", img.size);
         return -1;
@@ -302,20 +314,14 @@ int inference_deeplabv3_model(rknn_app_context_t *app_ctx, image_buffer_t *src_i
 
     // Post Process
     post_process((float *)outputs[0].buf, seg_img, app_ctx->output_attrs[0].dims[2], app_ctx->output_attrs[0].dims[1], app_ctx->output_attrs[0].dims[0],
-                 img.width, img.height);
+                 img.width, img.height, app_ctx->buffer_pool);
 
     // draw mask
-    compose_img(seg_img, src_img->virt_addr, src_img->height, src_img->width);
-    free(seg_img);
+    compose_img(seg_img, src_img, img.height, img.width);
 
     // Remeber to release rknn output
     rknn_outputs_release(app_ctx->rknn_ctx, 1, outputs);
 
 out:
-    if (img.virt_addr != NULL)
-    {
-        free(img.virt_addr);
-    }
-
     return ret;
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "common.h"
 #include "file_utils.h"
 #include "image_utils.h"
+#include "image_drawing.h"
 
 #include "gpu_compose_impl.h"
 #include "cl_kernels/kernel_upsampleSoftmax.h"
@@ -111,26 +112,23 @@ typedef struct {
 
 //blending two images
 //using 0 gamma, 0.5 a
-static void compose_img(uint8_t *res_buf, uint8_t *img_buf, int height, int width)
+static void compose_img(uint8_t *res_buf, image_buffer_t *img, int height, int width)
 {
-  const float alpha = 0.5f;
-  float beta = 1.0 - alpha;
-
-  for (int h = 0; h < height; ++h) {
-    for (int w = 0; w < width; ++w) {
-      unsigned char map_label = res_buf[h * width + w];
-      // printf("[%d][%d]: %d\n",h,w,pixel);
-
-      auto ori_pixel_r = img_buf[h * width * 3 + w * 3];
-      auto ori_pixel_g = img_buf[h * width * 3 + w * 3 + 1];
-      auto ori_pixel_b = img_buf[h * width * 3 + w * 3 + 2];
-     
-      img_buf[h * width * 3 + w * 3] = FULL_COLOR_MAP[map_label][0] * alpha + ori_pixel_r * beta; 
-      img_buf[h * width * 3 + w * 3 + 1] = FULL_COLOR_MAP[map_label][1] * alpha + ori_pixel_g * beta; //g 
-      img_buf[h * width * 3 + w * 3 + 2] = FULL_COLOR_MAP[map_label][2] * alpha + ori_pixel_b * beta; //b
-    
+    // 0.5 opacity for all labels including background
+    unsigned int palette[NUM_LABEL];
+    for (int i = 0; i < (int)NUM_LABEL; i++)
+    {
+        palette[i] = 0x80000000 | (FULL_COLOR_MAP[i][0] << 16) | (FULL_COLOR_MAP[i][1] << 8) | FULL_COLOR_MAP[i][2];
     }
-  }
+
+    // label map is scaled to image size
+    overlay_mask_t mask;
+    mask.labels = res_buf;
+    mask.width = width;
+    mask.height = height;
+    mask.palette = palette;
+    mask.num_colors = NUM_LABEL;
+    draw_overlay(img, &mask, NULL, 0, 0);
 }
 
 
@@ -200,21 +198,21 @@ int init_deeplabv3_model(const char* model_path, rknn_app_context_t* app_ctx)
     
     int ret;
     int model_len = 0;
-    char* model;
+    char* model = NULL;
     rknn_context ctx = 0;
 
     if (!Gpu_Impl)
         Gpu_Impl = make_shared<gpu_compose_impl>();     
 
     // Load RKNN Model
-    model_len = read_data_from_file(model_path, &model);
+    model_len = load_model_mapped(model_path, &model, MODEL_MAP_SEQUENTIAL);
     if (model == NULL) {
         printf("load_model fail!\n");
         return -1;
     }
 
     ret = rknn_init(&ctx, model, model_len, 0, NULL);
-    free(model);
+    unload_model_mapped(model, model_len);
     if (ret < 0) {
         printf("rknn_init fail! ret=%d\n", ret);
         return -1;
@@ -304,9 +302,7 @@ int inference_deeplabv3_model(rknn_app_context_t* app_ctx, image_buffer_t* src_i
     using namespace std;
 
     int ret;
-    image_buffer_t img;
 
-    memset(&img, 0, sizeof(image_buffer_t));
     //fetch model IO info according to NHWC layout !!!
     //OUT_SIZE is only for square output size 
     size_t OUT_SIZE=0;
@@ -324,62 +320,35 @@ int inference_deeplabv3_model(rknn_app_context_t* app_ctx, image_buffer_t* src_i
     }
 
     // Pre Process
-    img.width = app_ctx->model_width;
-    img.height = app_ctx->model_height;
-    img.format = IMAGE_FORMAT_RGB888;
-    img.size = get_image_size(&img);
-    img.virt_addr = (unsigned char*)malloc(img.size);
-    if (img.virt_addr == NULL) {
-        printf("malloc buffer size:%d fail!\n", img.size);
-        return -1;
-    }
+    // resize straight into input tensor memory, w_stride is handled while writing
+    const auto num_inputs = app_ctx->io_num.n_input;
+    rknn_tensor_mem *input_mems[app_ctx->io_num.n_input];
 
-    if (src_img->width != app_ctx->model_width || src_img->height != app_ctx->model_height) {
-        ret = convert_image(src_img, &img, NULL, NULL, 0);
-        if (ret < 0) {
-            printf("convert_image failc ret=%d\n", ret);
+    for (size_t i=0; i < num_inputs;i++) {
+        // uint8 NHWC memory sized from the native input attr, the queried attr keeps the model layout
+        rknn_tensor_attr input_mem_attr;
+        memset(&input_mem_attr, 0, sizeof(input_mem_attr));
+        input_mem_attr.index = i;
+        ret = rknn_query(app_ctx->rknn_ctx, RKNN_QUERY_NATIVE_INPUT_ATTR, &input_mem_attr, sizeof(input_mem_attr));
+        if (ret != RKNN_SUCC || input_mem_attr.fmt != RKNN_TENSOR_NHWC) {
+            printf("no support native input attr ret=%d fmt=%s\n", ret, get_format_string(input_mem_attr.fmt));
             return -1;
         }
-    }
-    else {
-        memcpy(img.virt_addr, src_img->virt_addr, MASK_SIZE*MASK_SIZE*3);
-    }
+        input_mem_attr.type = RKNN_TENSOR_UINT8;
 
+        input_mems[i] = rknn_create_mem(app_ctx->rknn_ctx, input_mem_attr.size_with_stride); 
 
-    const auto num_inputs = app_ctx->io_num.n_input;
-    rknn_tensor_mem *input_mems[app_ctx->io_num.n_input];
-
-    for (size_t i=0; i < num_inputs;i++) {
-        app_ctx->input_attrs[i].type = RKNN_TENSOR_UINT8;
-        app_ctx->input_attrs[i].fmt = RKNN_TENSOR_NHWC;
-
-        input_mems[i] = rknn_create_mem(app_ctx->rknn_ctx, app_ctx->input_attrs[i].size_with_stride); 
-
-        auto width  = app_ctx->input_attrs[i].dims[2];
-        auto stride = app_ctx->input_attrs[i].w_stride;
-
-        // Copy input data to input tensor memory
-        if (width == stride || app_ctx->input_attrs[i].fmt == RKNN_TENSOR_UNDEFINED) {
-            memcpy(input_mems[i]->virt_addr, img.virt_addr, MASK_SIZE*MASK_SIZE*3);
-        } else {
-            auto height  = app_ctx->input_attrs[i].dims[1];
-            auto channel = app_ctx->input_attrs[i].dims[3];
-        // copy from src to dst with stride
-            uint8_t* src_ptr = img.virt_addr;
-            uint8_t* dst_ptr = (uint8_t*)input_mems[i]->virt_addr;
-        // width-channel elements
-            auto src_wc_elems = width * channel * sizeof(uint8_t);
-            auto dst_wc_elems = stride * channel * sizeof(uint8_t);
-            for (int b = 0; b < app_ctx->input_attrs[i].dims[0]; b++) {
-                for (int h = 0; h < height; ++h) {
-                    memcpy(dst_ptr, src_ptr, src_wc_elems);
-                    src_ptr += src_wc_elems;
-                    dst_ptr += dst_wc_elems;
-                }
-            }
+        image_tensor_t input_tensor;
+        ret = image_tensor_from_rknn(&input_mem_attr, input_mems[i], &input_tensor);
+        if (ret == 0) {
+            ret = convert_image_to_tensor(src_img, &input_tensor, NULL, 0);
+        }
+        if (ret < 0) {
+            printf("convert_image_to_tensor fail ret=%d\n", ret);
+            return -1;
         }
 
-        ret = rknn_set_io_mem(app_ctx->rknn_ctx,  input_mems[i], &(app_ctx->input_attrs[i]));
+        ret = rknn_set_io_mem(app_ctx->rknn_ctx,  input_mems[i], &input_mem_attr);
         if (ret < 0) {
             printf("rknn_set_io_mem failed, ret=%d\n", ret);
             return -1;
@@ -444,7 +413,7 @@ int inference_deeplabv3_model(rknn_app_context_t* app_ctx, image_buffer_t* src_i
     Gpu_Impl->UpsampleSoftmax(UPSAMPLE_SOFTMAX_KERNEL_NAME, UP_SOFTMAX_IN0, nullptr,
                            UP_SOFTMAX_OUT0, nullptr, OUT_SIZE, OUT_SIZE, MASK_SIZE, MASK_SIZE, NUM_LABEL, scale_h_inv, scale_w_inv, SRC_STRIDE);
     
-    compose_img((unsigned char *)post_buf_mem[0]->virt_addr, src_img->virt_addr, MASK_SIZE, MASK_SIZE);
+    compose_img((unsigned char *)post_buf_mem[0]->virt_addr, src_img, MASK_SIZE, MASK_SIZE);
 
     //For debugging purpose
     //Dump_bin_to_file(out_result->img, "test_img_out.bin", MASK_SIZE*MASK_SIZE*3*sizeof(uint8_t));
@@ -462,9 +431,5 @@ int inference_deeplabv3_model(rknn_app_context_t* app_ctx, image_buffer_t* src_i
 
 
 out:
-    if (img.virt_addr != NULL) {
-        free(img.virt_addr);
-    }
-
     return ret;
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "rknn_demo_utils.h"
+#include "file_utils.h"
 
 static void dump_tensor_attr(rknn_tensor_attr *attr)
 {
@@ -20,59 +21,6 @@ static void dump_tensor_attr(rknn_tensor_attr *attr)
            get_qnt_type_string(attr->qnt_type), attr->zp, attr->scale);
 }
 
-static unsigned char *load_data(FILE *fp, size_t ofst, size_t sz)
-{
-    unsigned char *data;
-    int ret;
-
-    data = NULL;
-
-    if (NULL == fp)
-    {
-        return NULL;
-    }
-
-    ret = fseek(fp, ofst, SEEK_SET);
-    if (ret != 0)
-    {
-        printf("blob seek failure.\n");
-        return NULL;
-    }
-
-    data = (unsigned char *)malloc(sz);
-    if (data == NULL)
-    {
-        printf("buffer malloc failure.\n");
-        return NULL;
-    }
-    ret = fread(data, 1, sz, fp);
-    return data;
-}
-
-static unsigned char *load_model(const char *filename, int *model_size)
-{
-
-    FILE *fp;
-    unsigned char *data;
-
-    fp = fopen(filename, "rb");
-    if (NULL == fp)
-    {
-        printf("Open file %s failed.\n", filename);
-        return NULL;
-    }
-
-    fseek(fp, 0, SEEK_END);
-    int size = ftell(fp);
-
-    data = load_data(fp, 0, size);
-
-    fclose(fp);
-
-    *model_size = size;
-    return data;
-}
-
 int set_io_attrs(const char *model_name, MODEL_INFO *model_info)
 {
     int ret = 0;
@@ -229,11 +177,17 @@ int rkdemo_model_init(bool is_encoder, const char *model_path, MODEL_INFO *model
     }
 
     // load model data
-    unsigned char *model_data = load_model(model_path, &model_data_size);
+    char *model_data = NULL;
+    model_data_size = load_model_mapped(model_path, &model_data, MODEL_MAP_SEQUENTIAL);
+    if (model_data == NULL)
+    {
+        printf("[%s] load model failed!\n", model_name);
+        return -1;
+    }
 
     // init rknn context
     ret = rknn_init(&(model_info->ctx), (void *)model_data, model_data_size, 0);
-    free(model_data);
+    unload_model_mapped(model_data, model_data_size);
     if (ret < 0)
     {
         printf("[%s] init RKNN model failed! ret=%d\n", model_name, ret);
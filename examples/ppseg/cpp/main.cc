@@ -88,9 +88,5 @@ out:
         free(src_image.virt_addr);
     }
 
-    if (result_image.virt_addr != NULL) {
-        free(result_image.virt_addr);
-    }
-
     return 0;
 }
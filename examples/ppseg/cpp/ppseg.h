@@ -3,6 +3,7 @@
 
 #include "rknn_api.h"
 #include "common.h"
+#include "buffer_pool.h"
 #include <tuple>
 
 typedef struct {
@@ -13,12 +14,14 @@ typedef struct {
     int model_channel;
     int model_width;
     int model_height;
+    buffer_pool_t* buffer_pool;     // per-frame input and result images, reset at each inference
 } rknn_app_context_t;
 
 int init_ppseg_model(const char* model_path, rknn_app_context_t* app_ctx);
 
 int release_ppseg_model(rknn_app_context_t* app_ctx);
 
+// result_image memory belongs to app_ctx, valid until next inference or release
 int inference_ppseg_model(rknn_app_context_t* app_ctx, image_buffer_t* img, image_buffer_t*result_image);
 
 #endif //_RKNN_DEMO_ppseg_H_
\ No newline at end of file
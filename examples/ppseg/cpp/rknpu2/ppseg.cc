@@ -61,13 +61,15 @@ Color getColorById(int id) {
     return Color(0, 0, 0);
 }
 
-int draw_segment_image(float* result, image_buffer_t* result_img)
+int draw_segment_image(float* result, image_buffer_t* result_img, buffer_pool_t* pool)
 {
     int height = result_img->height;
     int width = result_img->width;
     int num_class = 19;
-    result_img->virt_addr = (unsigned char*)malloc(3*height*width);
-    memset(result_img->virt_addr, 0, 3*height*width);
+    result_img->virt_addr = (unsigned char*)buffer_pool_alloc(pool, 3*height*width);
+    if (result_img->virt_addr == NULL) {
+        return -1;
+    }
     // [1,class,height,width] -> [1,3,height,width]
     for (int batch = 0; batch < 1; batch++) {
         for (int y = 0; y < height; y++) {
@@ -96,18 +98,18 @@ int init_ppseg_model(const char* model_path, rknn_app_context_t* app_ctx)
 {
     int ret;
     int model_len = 0;
-    char* model;
+    char* model = NULL;
     rknn_context ctx = 0;
 
     // Load RKNN Model
-    model_len = read_data_from_file(model_path, &model);
+    model_len = load_model_mapped(model_path, &model, MODEL_MAP_SEQUENTIAL);
     if (model == NULL) {
         printf("load_model fail!\n");
         return -1;
     }
 
     ret = rknn_init(&ctx, model, model_len, 0, NULL);
-    free(model);
+    unload_model_mapped(model, model_len);
     if (ret < 0) {
         printf("rknn_init fail! ret=%d\n", ret);
         return -1;
@@ -172,6 +174,12 @@ int init_ppseg_model(const char* model_path, rknn_app_context_t* app_ctx)
     printf("model input height=%d, width=%d, channel=%d\n",
         app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
 
+    app_ctx->buffer_pool = buffer_pool_create();
+    if (app_ctx->buffer_pool == NULL) {
+        printf("buffer_pool_create fail!\n");
+        return -1;
+    }
+
     return 0;
 }
 
@@ -185,6 +193,10 @@ int release_ppseg_model(rknn_app_context_t* app_ctx)
         free(app_ctx->output_attrs);
         app_ctx->output_attrs = NULL;
     }
+    if (app_ctx->buffer_pool != NULL) {
+        buffer_pool_destroy(app_ctx->buffer_pool);
+        app_ctx->buffer_pool = NULL;
+    }
     if (app_ctx->rknn_ctx != 0) {
         rknn_destroy(app_ctx->rknn_ctx);
         app_ctx->rknn_ctx = 0;
@@ -203,12 +215,15 @@ int inference_ppseg_model(rknn_app_context_t* app_ctx, image_buffer_t* src_img,
     memset(inputs, 0, sizeof(inputs));
     memset(outputs, 0, sizeof(outputs));
 
+    // 上一帧的缓冲全部归还，稳定后每帧不再申请堆内存
+    buffer_pool_reset(app_ctx->buffer_pool);
+
     // Pre Process
     img.width = app_ctx->model_width;
     img.height = app_ctx->model_height;
     img.format = IMAGE_FORMAT_RGB888;
     img.size = get_image_size(&img);
-    img.virt_addr = (unsigned char*)malloc(img.size);
+    img.virt_addr = (unsigned char*)buffer_pool_alloc(app_ctx->buffer_pool, img.size);
     if (img.virt_addr == NULL) {
         printf("malloc buffer size:%d fail!\n", img.size);
         return -1;
@@ -256,14 +271,10 @@ int inference_ppseg_model(rknn_app_context_t* app_ctx, image_buffer_t* src_img,
 
     // Post Process
     // outputs -> take top1 pixel by pixel -> assign color
-    ret = draw_segment_image((float* )outputs[0].buf, result_img);
+    ret = draw_segment_image((float* )outputs[0].buf, result_img, app_ctx->buffer_pool);
     // Remeber to release rknn output
     rknn_outputs_release(app_ctx->rknn_ctx, 1, outputs);
 
 out:
-    if (img.virt_addr != NULL) {
-        free(img.virt_addr);
-    }
-
     return ret;
 }
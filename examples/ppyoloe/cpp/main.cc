@@ -71,7 +71,8 @@ int main(int argc, char **argv)
     }
 
     // 画框和概率
-    char text[256];
+    char text[OBJ_NUMB_MAX_SIZE][64];
+    overlay_box_t boxes[OBJ_NUMB_MAX_SIZE];
     for (int i = 0; i < od_results.count; i++)
     {
         object_detect_result *det_result = &(od_results.results[i]);
@@ -81,14 +82,17 @@ int main(int argc, char **argv)
                det_result->prop);
         int x1 = det_result->box.left;
         int y1 = det_result->box.top;
-        int x2 = det_result->box.right;
-        int y2 = det_result->box.bottom;
 
-        draw_rectangle(&src_image, x1, y1, x2 - x1, y2 - y1, COLOR_BLUE, 3);
-
-        sprintf(text, "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
-        draw_text(&src_image, text, x1, y1 - 20, COLOR_RED, 10);
+        sprintf(text[i], "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
+        boxes[i].box = det_result->box;
+        boxes[i].color = COLOR_BLUE;
+        boxes[i].thickness = 3;
+        boxes[i].text = text[i];
+        boxes[i].text_x = x1;
+        boxes[i].text_y = y1 - 20;
+        boxes[i].text_color = COLOR_RED;
     }
+    draw_overlay(&src_image, NULL, boxes, od_results.count, 10);
 
     write_image("out.png", &src_image);
 
@@ -18,6 +18,7 @@
 
 #include "rknn_api.h"
 #include "common.h"
+#include "detect_postprocess.hpp"
 
 typedef struct {
     rknn_context rknn_ctx;
@@ -28,6 +29,7 @@ typedef struct {
     int model_width;
     int model_height;
     bool is_quant;
+    detect_pp::detect_workspace_t* pp_workspace;   // postprocess scratch reused across frames
 } rknn_app_context_t;
 
 #include "postprocess.h"
@@ -35,11 +35,11 @@ int init_ppyoloe_model(const char *model_path, rknn_app_context_t *app_ctx)
 {
     int ret;
     int model_len = 0;
-    char *model;
+    char *model = NULL;
     rknn_context ctx = 0;
 
     // Load RKNN Model
-    model_len = read_data_from_file(model_path, &model);
+    model_len = load_model_mapped(model_path, &model, MODEL_MAP_SEQUENTIAL);
     if (model == NULL)
     {
         printf("load_model fail!\n");
@@ -47,7 +47,7 @@ int init_ppyoloe_model(const char *model_path, rknn_app_context_t *app_ctx)
     }
 
     ret = rknn_init(&ctx, model, model_len, 0, NULL);
-    free(model);
+    unload_model_mapped(model, model_len);
     if (ret < 0)
     {
         printf("rknn_init fail! ret=%d\n", ret);
@@ -132,6 +132,13 @@ int init_ppyoloe_model(const char *model_path, rknn_app_context_t *app_ctx)
     printf("model input height=%d, width=%d, channel=%d\n",
            app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
 
+    ret = init_post_process_workspace(app_ctx);
+    if (ret != 0)
+    {
+        printf("init_post_process_workspace fail! ret=%d\n", ret);
+        return -1;
+    }
+
     return 0;
 }
 
@@ -147,6 +154,7 @@ int release_ppyoloe_model(rknn_app_context_t *app_ctx)
         free(app_ctx->output_attrs);
         app_ctx->output_attrs = NULL;
     }
+    deinit_post_process_workspace(app_ctx);
     if (app_ctx->rknn_ctx != 0)
     {
         rknn_destroy(app_ctx->rknn_ctx);
@@ -36,7 +36,7 @@ int main(int argc, char **argv)
 {
     if (argc != 3)
     {
-        printf("%s <model_path> <image_path>\n", argv[0]);
+        printf("%s <model_path> <image_path | image_dir | image_list.txt>\n", argv[0]);
         return -1;
     }
 
@@ -47,6 +47,11 @@ int main(int argc, char **argv)
     rknn_app_context_t rknn_app_ctx;
     memset(&rknn_app_ctx, 0, sizeof(rknn_app_context_t));
 
+    image_source_t *source = NULL;
+    image_writer_t *writer = NULL;
+    image_frame_t frame;
+    memset(&frame, 0, sizeof(image_frame_t));
+
     init_post_process();
 
     ret = init_yolov5_model(model_path, &rknn_app_ctx);
@@ -56,60 +61,110 @@ int main(int argc, char **argv)
         goto out;
     }
 
-    image_buffer_t src_image;
-    memset(&src_image, 0, sizeof(image_buffer_t));
-    ret = read_image(image_path, &src_image);
-
-#if defined(RV1106_1103) 
-    //RV1106 rga requires that input and output bufs are memory allocated by dma
-    ret = dma_buf_alloc(RV1106_CMA_HEAP_PATH, src_image.size, &rknn_app_ctx.img_dma_buf.dma_buf_fd, 
-                       (void **) & (rknn_app_ctx.img_dma_buf.dma_buf_virt_addr));
-    memcpy(rknn_app_ctx.img_dma_buf.dma_buf_virt_addr, src_image.virt_addr, src_image.size);
-    dma_sync_cpu_to_device(rknn_app_ctx.img_dma_buf.dma_buf_fd);
-    free(src_image.virt_addr);
-    src_image.virt_addr = (unsigned char *)rknn_app_ctx.img_dma_buf.dma_buf_virt_addr;
-    src_image.fd = rknn_app_ctx.img_dma_buf.dma_buf_fd;
-    rknn_app_ctx.img_dma_buf.size = src_image.size;
-#endif
-
-    if (ret != 0)
+    // 后台线程提前解码下一张图像，与推理和后处理并行
+    source = image_source_open(image_path, 2, NULL);
+    if (source == NULL)
     {
-        printf("read image fail! ret=%d image_path=%s\n", ret, image_path);
+        printf("open image source fail! image_path=%s\n", image_path);
         goto out;
     }
 
-    object_detect_result_list od_results;
-
-    ret = inference_yolov5_model(&rknn_app_ctx, &src_image, &od_results);
-    if (ret != 0)
+    // 结果图在后台线程编码写文件，队列满时等待，每张结果图都会写出
+    writer = image_writer_create(4, IMAGE_WRITER_BLOCK, NULL);
+    if (writer == NULL)
     {
-        printf("init_yolov5_model fail! ret=%d\n", ret);
+        printf("create image writer fail!\n");
         goto out;
     }
 
-    // 画框和概率
-    char text[256];
-    for (int i = 0; i < od_results.count; i++)
+    while ((ret = image_source_next(source, &frame)) != 1)
     {
-        object_detect_result *det_result = &(od_results.results[i]);
-        printf("%s @ (%d %d %d %d) %.3f\n", coco_cls_to_name(det_result->cls_id),
-               det_result->box.left, det_result->box.top,
-               det_result->box.right, det_result->box.bottom,
-               det_result->prop);
-        int x1 = det_result->box.left;
-        int y1 = det_result->box.top;
-        int x2 = det_result->box.right;
-        int y2 = det_result->box.bottom;
-
-        draw_rectangle(&src_image, x1, y1, x2 - x1, y2 - y1, COLOR_BLUE, 3);
-
-        sprintf(text, "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
-        draw_text(&src_image, text, x1, y1 - 20, COLOR_RED, 10);
-    }
+        if (ret != 0)
+        {
+            printf("read image fail! image_path=%s\n", frame.path);
+            continue;
+        }
+        image_buffer_t src_image = frame.image;
+
+#if defined(RV1106_1103) 
+        //RV1106 rga requires that input and output bufs are memory allocated by dma
+        ret = dma_buf_alloc(RV1106_CMA_HEAP_PATH, src_image.size, &rknn_app_ctx.img_dma_buf.dma_buf_fd, 
+                           (void **) & (rknn_app_ctx.img_dma_buf.dma_buf_virt_addr));
+        memcpy(rknn_app_ctx.img_dma_buf.dma_buf_virt_addr, src_image.virt_addr, src_image.size);
+        dma_sync_cpu_to_device(rknn_app_ctx.img_dma_buf.dma_buf_fd);
+        src_image.virt_addr = (unsigned char *)rknn_app_ctx.img_dma_buf.dma_buf_virt_addr;
+        src_image.fd = rknn_app_ctx.img_dma_buf.dma_buf_fd;
+        rknn_app_ctx.img_dma_buf.size = src_image.size;
+#endif
 
-    write_image("out.png", &src_image);
+        object_detect_result_list od_results;
+
+        ret = inference_yolov5_model(&rknn_app_ctx, &src_image, &od_results);
+        if (ret != 0)
+        {
+            printf("inference_yolov5_model fail! ret=%d image_path=%s\n", ret, frame.path);
+        }
+        else
+        {
+            // 画框和概率
+            char text[OBJ_NUMB_MAX_SIZE][64];
+            overlay_box_t boxes[OBJ_NUMB_MAX_SIZE];
+            printf("%s:\n", frame.path);
+            for (int i = 0; i < od_results.count; i++)
+            {
+                object_detect_result *det_result = &(od_results.results[i]);
+                printf("%s @ (%d %d %d %d) %.3f\n", coco_cls_to_name(det_result->cls_id),
+                       det_result->box.left, det_result->box.top,
+                       det_result->box.right, det_result->box.bottom,
+                       det_result->prop);
+                int x1 = det_result->box.left;
+                int y1 = det_result->box.top;
+
+                sprintf(text[i], "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
+                boxes[i].box = det_result->box;
+                boxes[i].color = COLOR_BLUE;
+                boxes[i].thickness = 3;
+                boxes[i].text = text[i];
+                boxes[i].text_x = x1;
+                boxes[i].text_y = y1 - 20;
+                boxes[i].text_color = COLOR_RED;
+            }
+            draw_overlay(&src_image, NULL, boxes, od_results.count, 10);
+
+            // 单张图像保存为out.png，多张图像按序号保存
+            char out_path[64];
+            if (image_source_get_count(source) == 1)
+            {
+                sprintf(out_path, "out.png");
+            }
+            else
+            {
+                sprintf(out_path, "out_%04d.jpg", frame.index);
+            }
+            image_writer_submit(writer, out_path, &src_image, NULL, NULL);
+        }
+
+#if defined(RV1106_1103) 
+        dma_buf_free(rknn_app_ctx.img_dma_buf.size, &rknn_app_ctx.img_dma_buf.dma_buf_fd, 
+                rknn_app_ctx.img_dma_buf.dma_buf_virt_addr);
+#endif
+        image_source_release(source, &frame);
+    }
 
 out:
+    image_source_close(source);
+    if (writer != NULL)
+    {
+        printf("drop %d result images\n", image_writer_get_dropped(writer));
+    }
+    image_writer_destroy(writer);
+
+    // 稳定后每帧的后处理不再申请堆内存，last frame应为0
+    detect_pp::detect_workspace_stats_t pp_stats;
+    detect_pp::detect_workspace_get_stats(rknn_app_ctx.pp_workspace, &pp_stats);
+    printf("postprocess workspace %zu bytes, heap allocs %d (last frame %d)\n",
+           pp_stats.bytes_reserved, pp_stats.heap_allocs, pp_stats.frame_heap_allocs);
+
     deinit_post_process();
 
     ret = release_yolov5_model(&rknn_app_ctx);
@@ -118,15 +173,5 @@ out:
         printf("release_yolov5_model fail! ret=%d\n", ret);
     }
 
-    if (src_image.virt_addr != NULL)
-    {
-#if defined(RV1106_1103) 
-        dma_buf_free(rknn_app_ctx.img_dma_buf.size, &rknn_app_ctx.img_dma_buf.dma_buf_fd, 
-                rknn_app_ctx.img_dma_buf.dma_buf_virt_addr);
-#else
-        free(src_image.virt_addr);
-#endif
-    }
-
     return 0;
 }
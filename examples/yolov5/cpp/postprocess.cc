@@ -14,446 +14,48 @@
 
 #include "yolov5.h"
 
-#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
 
-#include <set>
-#include <vector>
+#include "detect_postprocess.hpp"
+
 #define LABEL_NALE_TXT_PATH "./model/coco_80_labels_list.txt"
 
+using namespace detect_pp;
+
 static char *labels[OBJ_CLASS_NUM];
 
 const int anchor[3][6] = {{10, 13, 16, 30, 33, 23},
                           {30, 61, 62, 45, 59, 119},
                           {116, 90, 156, 198, 373, 326}};
 
-inline static int clamp(float val, int min, int max) { return val > min ? (val < max ? val : max) : min; }
-
-static char *readLine(FILE *fp, char *buffer, int *len)
-{
-    int ch;
-    int i = 0;
-    size_t buff_len = 0;
-
-    buffer = (char *)malloc(buff_len + 1);
-    if (!buffer)
-        return NULL; // Out of memory
-
-    while ((ch = fgetc(fp)) != '\n' && ch != EOF)
-    {
-        buff_len++;
-        void *tmp = realloc(buffer, buff_len + 1);
-        if (tmp == NULL)
-        {
-            free(buffer);
-            return NULL; // Out of memory
-        }
-        buffer = (char *)tmp;
-
-        buffer[i] = (char)ch;
-        i++;
-    }
-    buffer[i] = '\0';
-
-    *len = buff_len;
-
-    // Detect end
-    if (ch == EOF && (i == 0 || ferror(fp)))
-    {
-        free(buffer);
-        return NULL;
-    }
-    return buffer;
-}
-
-static int readLines(const char *fileName, char *lines[], int max_line)
-{
-    FILE *file = fopen(fileName, "r");
-    char *s;
-    int i = 0;
-    int n = 0;
-
-    if (file == NULL)
-    {
-        printf("Open %s fail!\n", fileName);
-        return -1;
-    }
-
-    while ((s = readLine(file, s, &n)) != NULL)
-    {
-        lines[i++] = s;
-        if (i >= max_line)
-            break;
-    }
-    fclose(file);
-    return i;
-}
-
-static int loadLabelName(const char *locationFilename, char *label[])
-{
-    printf("load lable %s\n", locationFilename);
-    readLines(locationFilename, label, OBJ_CLASS_NUM);
-    return 0;
-}
-
-static float CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0, float xmin1, float ymin1, float xmax1,
-                              float ymax1)
-{
-    float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);
-    float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);
-    float i = w * h;
-    float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) + (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;
-    return u <= 0.f ? 0.f : (i / u);
-}
-
-static int nms(int validCount, std::vector<float> &outputLocations, std::vector<int> classIds, std::vector<int> &order,
-               int filterId, float threshold)
+// 输出tensor的grid大小，各平台的维度顺序不同
+static void get_grid_size(const rknn_tensor_attr *attr, int *grid_h, int *grid_w)
 {
-    for (int i = 0; i < validCount; ++i)
-    {
-        if (order[i] == -1 || classIds[i] != filterId)
-        {
-            continue;
-        }
-        int n = order[i];
-        for (int j = i + 1; j < validCount; ++j)
-        {
-            int m = order[j];
-            if (m == -1 || classIds[i] != filterId)
-            {
-                continue;
-            }
-            float xmin0 = outputLocations[n * 4 + 0];
-            float ymin0 = outputLocations[n * 4 + 1];
-            float xmax0 = outputLocations[n * 4 + 0] + outputLocations[n * 4 + 2];
-            float ymax0 = outputLocations[n * 4 + 1] + outputLocations[n * 4 + 3];
-
-            float xmin1 = outputLocations[m * 4 + 0];
-            float ymin1 = outputLocations[m * 4 + 1];
-            float xmax1 = outputLocations[m * 4 + 0] + outputLocations[m * 4 + 2];
-            float ymax1 = outputLocations[m * 4 + 1] + outputLocations[m * 4 + 3];
-
-            float iou = CalculateOverlap(xmin0, ymin0, xmax0, ymax0, xmin1, ymin1, xmax1, ymax1);
-
-            if (iou > threshold)
-            {
-                order[j] = -1;
-            }
-        }
-    }
-    return 0;
-}
-
-static int quick_sort_indice_inverse(std::vector<float> &input, int left, int right, std::vector<int> &indices)
-{
-    float key;
-    int key_index;
-    int low = left;
-    int high = right;
-    if (left < right)
-    {
-        key_index = indices[left];
-        key = input[left];
-        while (low < high)
-        {
-            while (low < high && input[high] <= key)
-            {
-                high--;
-            }
-            input[low] = input[high];
-            indices[low] = indices[high];
-            while (low < high && input[low] >= key)
-            {
-                low++;
-            }
-            input[high] = input[low];
-            indices[high] = indices[low];
-        }
-        input[low] = key;
-        indices[low] = key_index;
-        quick_sort_indice_inverse(input, left, low - 1, indices);
-        quick_sort_indice_inverse(input, low + 1, right, indices);
-    }
-    return low;
-}
-
-static float sigmoid(float x) { return 1.0 / (1.0 + expf(-x)); }
-
-static float unsigmoid(float y) { return -1.0 * logf((1.0 / y) - 1.0); }
-
-inline static int32_t __clip(float val, float min, float max)
-{
-    float f = val <= min ? min : (val >= max ? max : val);
-    return f;
-}
-
-static int8_t qnt_f32_to_affine(float f32, int32_t zp, float scale)
-{
-    float dst_val = (f32 / scale) + zp;
-    int8_t res = (int8_t)__clip(dst_val, -128, 127);
-    return res;
-}
-
-static uint8_t qnt_f32_to_affine_u8(float f32, int32_t zp, float scale)
-{
-    float dst_val = (f32 / scale) + zp;
-    uint8_t res = (uint8_t)__clip(dst_val, 0, 255);
-    return res;
-}
-
-static float deqnt_affine_to_f32(int8_t qnt, int32_t zp, float scale) { return ((float)qnt - (float)zp) * scale; }
-static float deqnt_affine_u8_to_f32(uint8_t qnt, int32_t zp, float scale) { return ((float)qnt - (float)zp) * scale; }
-
-static int process_u8(uint8_t *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-                      std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId, float threshold,
-                      int32_t zp, float scale)
-{
-    int validCount = 0;
-    int grid_len = grid_h * grid_w;
-    uint8_t thres_u8 = qnt_f32_to_affine_u8(threshold, zp, scale);
-    for (int a = 0; a < 3; a++)
-    {
-        for (int i = 0; i < grid_h; i++)
-        {
-            for (int j = 0; j < grid_w; j++)
-            {
-                uint8_t box_confidence = input[(PROP_BOX_SIZE * a + 4) * grid_len + i * grid_w + j];
-                if (box_confidence >= thres_u8)
-                {
-                    int offset = (PROP_BOX_SIZE * a) * grid_len + i * grid_w + j;
-                    uint8_t *in_ptr = input + offset;
-                    float box_x = (deqnt_affine_u8_to_f32(*in_ptr, zp, scale)) * 2.0 - 0.5;
-                    float box_y = (deqnt_affine_u8_to_f32(in_ptr[grid_len], zp, scale)) * 2.0 - 0.5;
-                    float box_w = (deqnt_affine_u8_to_f32(in_ptr[2 * grid_len], zp, scale)) * 2.0;
-                    float box_h = (deqnt_affine_u8_to_f32(in_ptr[3 * grid_len], zp, scale)) * 2.0;
-                    box_x = (box_x + j) * (float)stride;
-                    box_y = (box_y + i) * (float)stride;
-                    box_w = box_w * box_w * (float)anchor[a * 2];
-                    box_h = box_h * box_h * (float)anchor[a * 2 + 1];
-                    box_x -= (box_w / 2.0);
-                    box_y -= (box_h / 2.0);
-
-                    uint8_t maxClassProbs = in_ptr[5 * grid_len];
-                    int maxClassId = 0;
-                    for (int k = 1; k < OBJ_CLASS_NUM; ++k)
-                    {
-                        uint8_t prob = in_ptr[(5 + k) * grid_len];
-                        if (prob > maxClassProbs)
-                        {
-                            maxClassId = k;
-                            maxClassProbs = prob;
-                        }
-                    }
-                    if (maxClassProbs > thres_u8)
-                    {
-                        objProbs.push_back((deqnt_affine_u8_to_f32(maxClassProbs, zp, scale)) * (deqnt_affine_u8_to_f32(box_confidence, zp, scale)));
-                        classId.push_back(maxClassId);
-                        validCount++;
-                        boxes.push_back(box_x);
-                        boxes.push_back(box_y);
-                        boxes.push_back(box_w);
-                        boxes.push_back(box_h);
-                    }
-                }
-            }
-        }
-    }
-    return validCount;
-}
-
-static int process_i8(int8_t *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-                      std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId, float threshold,
-                      int32_t zp, float scale)
-{
-    int validCount = 0;
-    int grid_len = grid_h * grid_w;
-    int8_t thres_i8 = qnt_f32_to_affine(threshold, zp, scale);
-    for (int a = 0; a < 3; a++)
-    {
-        for (int i = 0; i < grid_h; i++)
-        {
-            for (int j = 0; j < grid_w; j++)
-            {
-                int8_t box_confidence = input[(PROP_BOX_SIZE * a + 4) * grid_len + i * grid_w + j];
-                if (box_confidence >= thres_i8)
-                {
-                    int offset = (PROP_BOX_SIZE * a) * grid_len + i * grid_w + j;
-                    int8_t *in_ptr = input + offset;
-                    float box_x = (deqnt_affine_to_f32(*in_ptr, zp, scale)) * 2.0 - 0.5;
-                    float box_y = (deqnt_affine_to_f32(in_ptr[grid_len], zp, scale)) * 2.0 - 0.5;
-                    float box_w = (deqnt_affine_to_f32(in_ptr[2 * grid_len], zp, scale)) * 2.0;
-                    float box_h = (deqnt_affine_to_f32(in_ptr[3 * grid_len], zp, scale)) * 2.0;
-                    box_x = (box_x + j) * (float)stride;
-                    box_y = (box_y + i) * (float)stride;
-                    box_w = box_w * box_w * (float)anchor[a * 2];
-                    box_h = box_h * box_h * (float)anchor[a * 2 + 1];
-                    box_x -= (box_w / 2.0);
-                    box_y -= (box_h / 2.0);
-
-                    int8_t maxClassProbs = in_ptr[5 * grid_len];
-                    int maxClassId = 0;
-                    for (int k = 1; k < OBJ_CLASS_NUM; ++k)
-                    {
-                        int8_t prob = in_ptr[(5 + k) * grid_len];
-                        if (prob > maxClassProbs)
-                        {
-                            maxClassId = k;
-                            maxClassProbs = prob;
-                        }
-                    }
-                    if (maxClassProbs > thres_i8)
-                    {
-                        objProbs.push_back((deqnt_affine_to_f32(maxClassProbs, zp, scale)) * (deqnt_affine_to_f32(box_confidence, zp, scale)));
-                        classId.push_back(maxClassId);
-                        validCount++;
-                        boxes.push_back(box_x);
-                        boxes.push_back(box_y);
-                        boxes.push_back(box_w);
-                        boxes.push_back(box_h);
-                    }
-                }
-            }
-        }
-    }
-    return validCount;
-}
-
-static int process_i8_rv1106(int8_t *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-                      std::vector<float> &boxes, std::vector<float> &boxScores, std::vector<int> &classId, float threshold,
-                      int32_t zp, float scale) {
-    int validCount = 0;
-    int8_t thres_i8 = qnt_f32_to_affine(threshold, zp, scale);
-
-    int anchor_per_branch = 3;
-    int align_c = PROP_BOX_SIZE * anchor_per_branch;
-
-    for (int h = 0; h < grid_h; h++) {
-        for (int w = 0; w < grid_w; w++) {
-            for (int a = 0; a < anchor_per_branch; a++) {
-                int hw_offset = h * grid_w * align_c + w * align_c + a * PROP_BOX_SIZE;
-                int8_t *hw_ptr = input + hw_offset;
-                int8_t box_confidence = hw_ptr[4];
-
-                if (box_confidence >= thres_i8) {
-                    int8_t maxClassProbs = hw_ptr[5];
-                    int maxClassId = 0;
-                    for (int k = 1; k < OBJ_CLASS_NUM; ++k) {
-                        int8_t prob = hw_ptr[5 + k];
-                        if (prob > maxClassProbs) {
-                            maxClassId = k;
-                            maxClassProbs = prob;
-                        }
-                    }
-
-                    float box_conf_f32 = deqnt_affine_to_f32(box_confidence, zp, scale);
-                    float class_prob_f32 = deqnt_affine_to_f32(maxClassProbs, zp, scale);
-                    float limit_score = box_conf_f32 * class_prob_f32;
-
-                    if (limit_score > threshold) {
-                        float box_x, box_y, box_w, box_h;
-
-                        box_x = deqnt_affine_to_f32(hw_ptr[0], zp, scale) * 2.0 - 0.5;
-                        box_y = deqnt_affine_to_f32(hw_ptr[1], zp, scale) * 2.0 - 0.5;
-                        box_w = deqnt_affine_to_f32(hw_ptr[2], zp, scale) * 2.0;
-                        box_h = deqnt_affine_to_f32(hw_ptr[3], zp, scale) * 2.0;
-                        box_w = box_w * box_w;
-                        box_h = box_h * box_h;
-
-
-                        box_x = (box_x + w) * (float)stride;
-                        box_y = (box_y + h) * (float)stride;
-                        box_w *= (float)anchor[a * 2];
-                        box_h *= (float)anchor[a * 2 + 1];
-
-                        box_x -= (box_w / 2.0);
-                        box_y -= (box_h / 2.0);
-
-                        boxes.push_back(box_x);
-                        boxes.push_back(box_y);
-                        boxes.push_back(box_w);
-                        boxes.push_back(box_h);
-                        boxScores.push_back(limit_score);
-                        classId.push_back(maxClassId);
-                        validCount++;
-                    }
-                }
-            }
-        }
-    }
-    return validCount;
-}
-
-static int process_fp32(float *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-                        std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId, float threshold)
-{
-    int validCount = 0;
-    int grid_len = grid_h * grid_w;
-
-    for (int a = 0; a < 3; a++)
-    {
-        for (int i = 0; i < grid_h; i++)
-        {
-            for (int j = 0; j < grid_w; j++)
-            {
-                float box_confidence = input[(PROP_BOX_SIZE * a + 4) * grid_len + i * grid_w + j];
-                if (box_confidence >= threshold)
-                {
-                    int offset = (PROP_BOX_SIZE * a) * grid_len + i * grid_w + j;
-                    float *in_ptr = input + offset;
-                    float box_x = *in_ptr * 2.0 - 0.5;
-                    float box_y = in_ptr[grid_len] * 2.0 - 0.5;
-                    float box_w = in_ptr[2 * grid_len] * 2.0;
-                    float box_h = in_ptr[3 * grid_len] * 2.0;
-                    box_x = (box_x + j) * (float)stride;
-                    box_y = (box_y + i) * (float)stride;
-                    box_w = box_w * box_w * (float)anchor[a * 2];
-                    box_h = box_h * box_h * (float)anchor[a * 2 + 1];
-                    box_x -= (box_w / 2.0);
-                    box_y -= (box_h / 2.0);
-
-                    float maxClassProbs = in_ptr[5 * grid_len];
-                    int maxClassId = 0;
-                    for (int k = 1; k < OBJ_CLASS_NUM; ++k)
-                    {
-                        float prob = in_ptr[(5 + k) * grid_len];
-                        if (prob > maxClassProbs)
-                        {
-                            maxClassId = k;
-                            maxClassProbs = prob;
-                        }
-                    }
-                    if (maxClassProbs > threshold)
-                    {
-                        objProbs.push_back(maxClassProbs * box_confidence);
-                        classId.push_back(maxClassId);
-                        validCount++;
-                        boxes.push_back(box_x);
-                        boxes.push_back(box_y);
-                        boxes.push_back(box_w);
-                        boxes.push_back(box_h);
-                    }
-                }
-            }
-        }
-    }
-    return validCount;
+#if defined(RV1106_1103)
+    // NHWC
+    *grid_h = attr->dims[1];
+    *grid_w = attr->dims[2];
+#elif defined(RKNPU1)
+    // NCHW reversed: WHCN
+    *grid_h = attr->dims[1];
+    *grid_w = attr->dims[0];
+#else
+    *grid_h = attr->dims[2];
+    *grid_w = attr->dims[3];
+#endif
 }
 
 int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter_box, float conf_threshold, float nms_threshold, object_detect_result_list *od_results)
 {
-#if defined(RV1106_1103) 
+#if defined(RV1106_1103)
     rknn_tensor_mem **_outputs = (rknn_tensor_mem **)outputs;
 #else
     rknn_output *_outputs = (rknn_output *)outputs;
 #endif
-    std::vector<float> filterBoxes;
-    std::vector<float> objProbs;
-    std::vector<int> classId;
-    int validCount = 0;
+    detect_workspace_t *ws = app_ctx->pp_workspace;
     int stride = 0;
     int grid_h = 0;
     int grid_w = 0;
@@ -461,105 +63,102 @@ int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter
     int model_in_h = app_ctx->model_height;
 
     memset(od_results, 0, sizeof(object_detect_result_list));
+    detect_workspace_begin_frame(ws);
 
     for (int i = 0; i < 3; i++)
     {
+        int32_t zp = app_ctx->output_attrs[i].zp;
+        float scale = app_ctx->output_attrs[i].scale;
 
-#if defined(RV1106_1103) 
-        grid_h = app_ctx->output_attrs[i].dims[1];
-        grid_w = app_ctx->output_attrs[i].dims[2];
+        get_grid_size(&app_ctx->output_attrs[i], &grid_h, &grid_w);
         stride = model_in_h / grid_h;
+
+#if defined(RV1106_1103)
         //RV1106 only support i8
         if (app_ctx->is_quant) {
-            validCount += process_i8_rv1106((int8_t *)(_outputs[i]->virt_addr), (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
-                                     classId, conf_threshold, app_ctx->output_attrs[i].zp, app_ctx->output_attrs[i].scale);
+            decode_objectness_head<int8_t, layout_nhwc, head_anchor>((int8_t *)_outputs[i]->virt_addr, zp, scale, detect_workspace_lut(ws, i), anchor[i], 3,
+                                                                     grid_h, grid_w, stride, OBJ_CLASS_NUM, conf_threshold, true, ws);
         }
 #elif defined(RKNPU1)
-        // NCHW reversed: WHCN
-        grid_h = app_ctx->output_attrs[i].dims[1];
-        grid_w = app_ctx->output_attrs[i].dims[0];
-        stride = model_in_h / grid_h;
         if (app_ctx->is_quant)
         {
-            validCount += process_u8((uint8_t *)_outputs[i].buf, (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
-                                     classId, conf_threshold, app_ctx->output_attrs[i].zp, app_ctx->output_attrs[i].scale);
+            decode_objectness_head<uint8_t, layout_nchw, head_anchor>((uint8_t *)_outputs[i].buf, zp, scale, detect_workspace_lut(ws, i), anchor[i], 3,
+                                                                      grid_h, grid_w, stride, OBJ_CLASS_NUM, conf_threshold, false, ws);
         }
         else
         {
-            validCount += process_fp32((float *)_outputs[i].buf, (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
-                                       classId, conf_threshold);
+            decode_objectness_head<float, layout_nchw, head_anchor>((float *)_outputs[i].buf, zp, scale, detect_workspace_lut(ws, i), anchor[i], 3,
+                                                                    grid_h, grid_w, stride, OBJ_CLASS_NUM, conf_threshold, false, ws);
         }
 #else
-        grid_h = app_ctx->output_attrs[i].dims[2];
-        grid_w = app_ctx->output_attrs[i].dims[3];
-        stride = model_in_h / grid_h;
         if (app_ctx->is_quant)
         {
-            validCount += process_i8((int8_t *)_outputs[i].buf, (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
-                                     classId, conf_threshold, app_ctx->output_attrs[i].zp, app_ctx->output_attrs[i].scale);
+            decode_objectness_head<int8_t, layout_nchw, head_anchor>((int8_t *)_outputs[i].buf, zp, scale, detect_workspace_lut(ws, i), anchor[i], 3,
+                                                                     grid_h, grid_w, stride, OBJ_CLASS_NUM, conf_threshold, false, ws);
         }
         else
         {
-            validCount += process_fp32((float *)_outputs[i].buf, (int *)anchor[i], grid_h, grid_w, model_in_h, model_in_w, stride, filterBoxes, objProbs,
-                                       classId, conf_threshold);
+            decode_objectness_head<float, layout_nchw, head_anchor>((float *)_outputs[i].buf, zp, scale, detect_workspace_lut(ws, i), anchor[i], 3,
+                                                                    grid_h, grid_w, stride, OBJ_CLASS_NUM, conf_threshold, false, ws);
         }
 #endif
     }
 
-    // no object detect
-    if (validCount <= 0)
+    int ret = finalize_detections(ws, nms_threshold, letter_box, model_in_w, model_in_h, od_results, PRE_NMS_TOP_K);
+    detect_workspace_end_frame(ws);
+    return ret;
+}
+
+int init_post_process_workspace(rknn_app_context_t *app_ctx)
+{
+    // 每个grid cell的每个anchor最多产生一个候选
+    int max_candidates = 0;
+    int max_grid_w = 0;
+    for (int i = 0; i < 3; i++)
     {
-        return 0;
+        int grid_h = 0;
+        int grid_w = 0;
+        get_grid_size(&app_ctx->output_attrs[i], &grid_h, &grid_w);
+        max_candidates += grid_h * grid_w * 3;
+        max_grid_w = grid_w > max_grid_w ? grid_w : max_grid_w;
     }
-    std::vector<int> indexArray;
-    for (int i = 0; i < validCount; ++i)
+    app_ctx->pp_workspace = detect_workspace_create(max_candidates, max_grid_w, OBJ_CLASS_NUM);
+    if (app_ctx->pp_workspace == NULL)
     {
-        indexArray.push_back(i);
+        printf("detect_workspace_create fail!\n");
+        return -1;
     }
-    quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
-
-    std::set<int> class_set(std::begin(classId), std::end(classId));
-
-    for (auto c : class_set)
+    if (app_ctx->is_quant)
     {
-        nms(validCount, filterBoxes, classId, indexArray, c, nms_threshold);
-    }
-
-    int last_count = 0;
-    od_results->count = 0;
-
-    /* box valid detect target */
-    for (int i = 0; i < validCount; ++i)
-    {
-        if (indexArray[i] == -1 || last_count >= OBJ_NUMB_MAX_SIZE)
+        // 量化输出的查找表只依赖zp/scale，加载时为每个输出建好
+#if defined(RKNPU1)
+        bool is_signed = false;
+#else
+        bool is_signed = true;
+#endif
+        for (int i = 0; i < app_ctx->io_num.n_output; i++)
         {
-            continue;
+            detect_workspace_build_lut(app_ctx->pp_workspace, i, app_ctx->output_attrs[i].zp, app_ctx->output_attrs[i].scale, is_signed);
         }
-        int n = indexArray[i];
-
-        float x1 = filterBoxes[n * 4 + 0] - letter_box->x_pad;
-        float y1 = filterBoxes[n * 4 + 1] - letter_box->y_pad;
-        float x2 = x1 + filterBoxes[n * 4 + 2];
-        float y2 = y1 + filterBoxes[n * 4 + 3];
-        int id = classId[n];
-        float obj_conf = objProbs[i];
-
-        od_results->results[last_count].box.left = (int)(clamp(x1, 0, model_in_w) / letter_box->scale);
-        od_results->results[last_count].box.top = (int)(clamp(y1, 0, model_in_h) / letter_box->scale);
-        od_results->results[last_count].box.right = (int)(clamp(x2, 0, model_in_w) / letter_box->scale);
-        od_results->results[last_count].box.bottom = (int)(clamp(y2, 0, model_in_h) / letter_box->scale);
-        od_results->results[last_count].prop = obj_conf;
-        od_results->results[last_count].cls_id = id;
-        last_count++;
     }
-    od_results->count = last_count;
+    if (detect_workspace_set_threads(app_ctx->pp_workspace, DECODE_THREADS, NULL, 0) != 0)
+    {
+        printf("detect_workspace_set_threads fail!\n");
+        return -1;
+    }
     return 0;
 }
 
+void deinit_post_process_workspace(rknn_app_context_t *app_ctx)
+{
+    detect_workspace_destroy(app_ctx->pp_workspace);
+    app_ctx->pp_workspace = NULL;
+}
+
 int init_post_process()
 {
     int ret = 0;
-    ret = loadLabelName(LABEL_NALE_TXT_PATH, labels);
+    ret = load_label_names(LABEL_NALE_TXT_PATH, labels, OBJ_CLASS_NUM);
     if (ret < 0)
     {
         printf("Load %s failed!\n", LABEL_NALE_TXT_PATH);
@@ -586,12 +185,5 @@ char *coco_cls_to_name(int cls_id)
 
 void deinit_post_process()
 {
-    for (int i = 0; i < OBJ_CLASS_NUM; i++)
-    {
-        if (labels[i] != nullptr)
-        {
-            free(labels[i]);
-            labels[i] = nullptr;
-        }
-    }
+    free_label_names(labels, OBJ_CLASS_NUM);
 }
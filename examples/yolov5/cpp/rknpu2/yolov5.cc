@@ -35,11 +35,11 @@ int init_yolov5_model(const char *model_path, rknn_app_context_t *app_ctx)
 {
     int ret;
     int model_len = 0;
-    char *model;
+    char *model = NULL;
     rknn_context ctx = 0;
 
     // Load RKNN Model
-    model_len = read_data_from_file(model_path, &model);
+    model_len = load_model_mapped(model_path, &model, MODEL_MAP_SEQUENTIAL);
     if (model == NULL)
     {
         printf("load_model fail!\n");
@@ -47,7 +47,7 @@ int init_yolov5_model(const char *model_path, rknn_app_context_t *app_ctx)
     }
 
     ret = rknn_init(&ctx, model, model_len, 0, NULL);
-    free(model);
+    unload_model_mapped(model, model_len);
     if (ret < 0)
     {
         printf("rknn_init fail! ret=%d\n", ret);
@@ -96,6 +96,55 @@ int init_yolov5_model(const char *model_path, rknn_app_context_t *app_ctx)
         dump_tensor_attr(&(output_attrs[i]));
     }
 
+    // model size comes from the queried attr, its fmt decides the dims order
+    if (input_attrs[0].fmt == RKNN_TENSOR_NCHW)
+    {
+        printf("model is NCHW input fmt\n");
+        app_ctx->model_channel = input_attrs[0].dims[1];
+        app_ctx->model_height = input_attrs[0].dims[2];
+        app_ctx->model_width = input_attrs[0].dims[3];
+    }
+    else
+    {
+        printf("model is NHWC input fmt\n");
+        app_ctx->model_height = input_attrs[0].dims[1];
+        app_ctx->model_width = input_attrs[0].dims[2];
+        app_ctx->model_channel = input_attrs[0].dims[3];
+    }
+    printf("model input height=%d, width=%d, channel=%d\n",
+           app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
+
+    // uint8 NHWC input, normalize and quantize are fused to npu
+    // preprocess write letterbox result into this memory directly
+    // dims, w_stride and size_with_stride of the memory come from the native input attr
+    rknn_tensor_attr *input_mem_attr = &app_ctx->input_mem_attr;
+    memset(input_mem_attr, 0, sizeof(rknn_tensor_attr));
+    input_mem_attr->index = 0;
+    ret = rknn_query(ctx, RKNN_QUERY_NATIVE_INPUT_ATTR, input_mem_attr, sizeof(rknn_tensor_attr));
+    if (ret != RKNN_SUCC)
+    {
+        printf("rknn_query native input attr fail! ret=%d\n", ret);
+        return -1;
+    }
+    if (input_mem_attr->fmt != RKNN_TENSOR_NHWC)
+    {
+        printf("no support native input fmt %s\n", get_format_string(input_mem_attr->fmt));
+        return -1;
+    }
+    input_mem_attr->type = RKNN_TENSOR_UINT8;
+    app_ctx->input_mems[0] = rknn_create_mem(ctx, input_mem_attr->size_with_stride);
+    if (app_ctx->input_mems[0] == NULL)
+    {
+        printf("rknn_create_mem fail!\n");
+        return -1;
+    }
+    ret = rknn_set_io_mem(ctx, app_ctx->input_mems[0], input_mem_attr);
+    if (ret < 0)
+    {
+        printf("input_mems rknn_set_io_mem fail! ret=%d\n", ret);
+        return -1;
+    }
+
     // Set to context
     app_ctx->rknn_ctx = ctx;
 
@@ -115,22 +164,12 @@ int init_yolov5_model(const char *model_path, rknn_app_context_t *app_ctx)
     app_ctx->output_attrs = (rknn_tensor_attr *)malloc(io_num.n_output * sizeof(rknn_tensor_attr));
     memcpy(app_ctx->output_attrs, output_attrs, io_num.n_output * sizeof(rknn_tensor_attr));
 
-    if (input_attrs[0].fmt == RKNN_TENSOR_NCHW)
+    ret = init_post_process_workspace(app_ctx);
+    if (ret != 0)
     {
-        printf("model is NCHW input fmt\n");
-        app_ctx->model_channel = input_attrs[0].dims[1];
-        app_ctx->model_height = input_attrs[0].dims[2];
-        app_ctx->model_width = input_attrs[0].dims[3];
-    }
-    else
-    {
-        printf("model is NHWC input fmt\n");
-        app_ctx->model_height = input_attrs[0].dims[1];
-        app_ctx->model_width = input_attrs[0].dims[2];
-        app_ctx->model_channel = input_attrs[0].dims[3];
+        printf("init_post_process_workspace fail! ret=%d\n", ret);
+        return -1;
     }
-    printf("model input height=%d, width=%d, channel=%d\n",
-           app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
 
     return 0;
 }
@@ -147,6 +186,12 @@ int release_yolov5_model(rknn_app_context_t *app_ctx)
         free(app_ctx->output_attrs);
         app_ctx->output_attrs = NULL;
     }
+    if (app_ctx->input_mems[0] != NULL)
+    {
+        rknn_destroy_mem(app_ctx->rknn_ctx, app_ctx->input_mems[0]);
+        app_ctx->input_mems[0] = NULL;
+    }
+    deinit_post_process_workspace(app_ctx);
     if (app_ctx->rknn_ctx != 0)
     {
         rknn_destroy(app_ctx->rknn_ctx);
@@ -158,9 +203,8 @@ int release_yolov5_model(rknn_app_context_t *app_ctx)
 int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img, object_detect_result_list *od_results)
 {
     int ret;
-    image_buffer_t dst_img;
+    image_tensor_t input_tensor;
     letterbox_t letter_box;
-    rknn_input inputs[app_ctx->io_num.n_input];
     rknn_output outputs[app_ctx->io_num.n_output];
     const float nms_threshold = NMS_THRESH;      // Default NMS threshold
     const float box_conf_threshold = BOX_THRESH; // Default box threshold
@@ -173,43 +217,21 @@ int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img, obj
 
     memset(od_results, 0x00, sizeof(*od_results));
     memset(&letter_box, 0, sizeof(letterbox_t));
-    memset(&dst_img, 0, sizeof(image_buffer_t));
-    memset(inputs, 0, sizeof(inputs));
     memset(outputs, 0, sizeof(outputs));
 
     // Pre Process
-    dst_img.width = app_ctx->model_width;
-    dst_img.height = app_ctx->model_height;
-    dst_img.format = IMAGE_FORMAT_RGB888;
-    dst_img.size = get_image_size(&dst_img);
-    dst_img.virt_addr = (unsigned char *)malloc(dst_img.size);
-    if (dst_img.virt_addr == NULL)
-    {
-        printf("malloc buffer size:%d fail!\n", dst_img.size);
-        return -1;
-    }
-
-    // letterbox
-    ret = convert_image_with_letterbox(img, &dst_img, &letter_box, bg_color);
-    if (ret < 0)
+    // letterbox straight into input tensor memory (with w_stride)
+    ret = image_tensor_from_rknn(&app_ctx->input_mem_attr, app_ctx->input_mems[0], &input_tensor);
+    if (ret == 0)
     {
-        printf("convert_image_with_letterbox fail! ret=%d\n", ret);
-        return -1;
+        ret = convert_image_to_tensor(img, &input_tensor, &letter_box, bg_color);
     }
-
-    // Set Input Data
-    inputs[0].index = 0;
-    inputs[0].type = RKNN_TENSOR_UINT8;
-    inputs[0].fmt = RKNN_TENSOR_NHWC;
-    inputs[0].size = app_ctx->model_width * app_ctx->model_height * app_ctx->model_channel;
-    inputs[0].buf = dst_img.virt_addr;
-
-    ret = rknn_inputs_set(app_ctx->rknn_ctx, app_ctx->io_num.n_input, inputs);
     if (ret < 0)
     {
-        printf("rknn_input_set fail! ret=%d\n", ret);
+        printf("convert_image_to_tensor fail! ret=%d\n", ret);
         return -1;
     }
+    rknn_mem_sync(app_ctx->rknn_ctx, app_ctx->input_mems[0], RKNN_MEMORY_SYNC_TO_DEVICE);
 
     // Run
     printf("rknn_run\n");
@@ -241,10 +263,5 @@ int inference_yolov5_model(rknn_app_context_t *app_ctx, image_buffer_t *img, obj
     rknn_outputs_release(app_ctx->rknn_ctx, app_ctx->io_num.n_output, outputs);
 
 out:
-    if (dst_img.virt_addr != NULL)
-    {
-        free(dst_img.virt_addr);
-    }
-
     return ret;
 }
\ No newline at end of file
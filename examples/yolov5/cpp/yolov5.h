@@ -18,6 +18,8 @@
 
 #include "rknn_api.h"
 #include "common.h"
+#include "detect_postprocess.hpp"
+#include "buffer_pool.h"
 #if defined(RV1106_1103) 
     typedef struct {
         char *dma_buf_virt_addr;
@@ -36,11 +38,17 @@ typedef struct {
     rknn_tensor_mem* input_mems[1];
     rknn_tensor_mem* output_mems[3];
     rknn_dma_buf img_dma_buf;
+#elif !defined(RKNPU1)
+    rknn_tensor_mem* input_mems[1];
+    rknn_tensor_attr input_mem_attr;    // uint8 NHWC attr of input_mems[0] given to rknn_set_io_mem
+#else
+    buffer_pool_t* buffer_pool;     // per-frame input image, reset at each inference
 #endif
     int model_channel;
     int model_width;
     int model_height;
     bool is_quant;
+    detect_pp::detect_workspace_t* pp_workspace;   // postprocess scratch reused across frames
 } rknn_app_context_t;
 
 #include "postprocess.h"
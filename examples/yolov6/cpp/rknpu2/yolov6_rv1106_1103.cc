@@ -149,6 +149,13 @@ int init_yolov6_model(const char *model_path, rknn_app_context_t *app_ctx)
     printf("model input height=%d, width=%d, channel=%d\n",
            app_ctx->model_height, app_ctx->model_width, app_ctx->model_channel);
 
+    ret = init_post_process_workspace(app_ctx);
+    if (ret != 0)
+    {
+        printf("init_post_process_workspace fail! ret=%d\n", ret);
+        return -1;
+    }
+
     return 0;
 }
 
@@ -174,6 +181,7 @@ int release_yolov6_model(rknn_app_context_t *app_ctx)
             rknn_destroy_mem(app_ctx->rknn_ctx, app_ctx->output_mems[i]);
         }
     }
+    deinit_post_process_workspace(app_ctx);
     if (app_ctx->rknn_ctx != 0)
     {
         rknn_destroy(app_ctx->rknn_ctx);
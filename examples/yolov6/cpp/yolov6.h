@@ -18,6 +18,7 @@
 
 #include "rknn_api.h"
 #include "common.h"
+#include "detect_postprocess.hpp"
 #if defined(RV1106_1103) 
     typedef struct {
         char *dma_buf_virt_addr;
@@ -40,6 +41,7 @@ typedef struct {
     int model_width;
     int model_height;
     bool is_quant;
+    detect_pp::detect_workspace_t* pp_workspace;   // postprocess scratch reused across frames
 } rknn_app_context_t;
 
 #include "postprocess.h"
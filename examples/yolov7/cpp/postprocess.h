@@ -12,6 +12,8 @@
 #define OBJ_CLASS_NUM 80
 #define NMS_THRESH 0.45
 #define BOX_THRESH 0.25
+#define PRE_NMS_TOP_K 1000    // max candidates sorted and passed to NMS, <= 0 for no limit
+#define DECODE_THREADS 1      // threads decoding branches and row bands in parallel, 1 for serial decode, 0: one per online core up to 4 (measure with detect_pp_bench first)
 #define PROP_BOX_SIZE (5 + OBJ_CLASS_NUM)
 
 // class rknn_app_context_t;
@@ -30,6 +32,8 @@ typedef struct {
 
 int init_post_process();
 void deinit_post_process();
+int init_post_process_workspace(rknn_app_context_t *app_ctx);
+void deinit_post_process_workspace(rknn_app_context_t *app_ctx);
 char *coco_cls_to_name(int cls_id);
 int post_process(rknn_app_context_t *app_ctx, void *outputs, letterbox_t *letter_box, float conf_threshold, float nms_threshold, object_detect_result_list *od_results);
 
@@ -169,10 +169,7 @@ int main(int argc, char **argv)
             }
             outTxtFile << std::endl;
 
-            draw_line(&src_image, points[0][0], points[0][1], points[1][0], points[1][1], COLOR_RED, 2);
-            draw_line(&src_image, points[3][0], points[3][1], points[2][0], points[2][1], COLOR_RED, 2);
-            draw_line(&src_image, points[0][0], points[0][1], points[3][0], points[3][1], COLOR_RED, 2);
-            draw_line(&src_image, points[2][0], points[2][1], points[1][0], points[1][1], COLOR_RED, 2);
+            draw_polygon(&src_image, &points[0][0], 4, COLOR_RED, 2);
 
             sprintf(text, "%s %.1f%%", objName.c_str(), objProb * 100);
             draw_text(&src_image, text, points[3][0], points[3][1] - 20, COLOR_RED, 10);
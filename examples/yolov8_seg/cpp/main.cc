@@ -94,33 +94,28 @@ int main(int argc, char **argv)
         goto out;
     }
 
-    // draw mask
+    // mask中的值为类别序号+1，0为背景不绘制
+    unsigned int palette[OBJ_CLASS_NUM + 1];
+    palette[0] = 0;
+    for (int i = 1; i <= OBJ_CLASS_NUM; i++)
+    {
+        const unsigned char *rgb = class_colors[i % N_CLASS_COLORS];
+        palette[i] = 0x80000000 | (rgb[0] << 16) | (rgb[1] << 8) | rgb[2]; // opacity 0.5
+    }
+    overlay_mask_t mask;
+    memset(&mask, 0, sizeof(overlay_mask_t));
     if (od_results.count >= 1)
     {
-        int width = src_image.width;
-        int height = src_image.height;
-        char *ori_img = (char *)src_image.virt_addr;
-        int cls_id = od_results.results[0].cls_id;
-        uint8_t *seg_mask = od_results.results_seg[0].seg_mask;
-        float alpha = 0.5f; // opacity
-        for (int j = 0; j < height; j++)
-        {
-            for (int k = 0; k < width; k++)
-            {
-                int pixel_offset = 3 * (j * width + k);
-                if (seg_mask[j * width + k] != 0)
-                {
-                    ori_img[pixel_offset + 0] = (unsigned char)clamp(class_colors[seg_mask[j * width + k] % N_CLASS_COLORS][0] * (1 - alpha) + ori_img[pixel_offset + 0] * alpha, 0, 255); // r
-                    ori_img[pixel_offset + 1] = (unsigned char)clamp(class_colors[seg_mask[j * width + k] % N_CLASS_COLORS][1] * (1 - alpha) + ori_img[pixel_offset + 1] * alpha, 0, 255); // g
-                    ori_img[pixel_offset + 2] = (unsigned char)clamp(class_colors[seg_mask[j * width + k] % N_CLASS_COLORS][2] * (1 - alpha) + ori_img[pixel_offset + 2] * alpha, 0, 255); // b
-                }
-            }
-        }
-        free(seg_mask);
+        mask.labels = od_results.results_seg[0].seg_mask;
+        mask.width = src_image.width;
+        mask.height = src_image.height;
+        mask.palette = palette;
+        mask.num_colors = OBJ_CLASS_NUM + 1;
     }
 
     // draw boxes
-    char text[256];
+    char text[OBJ_NUMB_MAX_SIZE][64];
+    overlay_box_t boxes[OBJ_NUMB_MAX_SIZE];
     for (int i = 0; i < od_results.count; i++)
     {
         object_detect_result *det_result = &(od_results.results[i]);
@@ -130,13 +125,17 @@ int main(int argc, char **argv)
                det_result->prop);
         int x1 = det_result->box.left;
         int y1 = det_result->box.top;
-        int x2 = det_result->box.right;
-        int y2 = det_result->box.bottom;
 
-        draw_rectangle(&src_image, x1, y1, x2 - x1, y2 - y1, COLOR_RED, 3);
-        sprintf(text, "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
-        draw_text(&src_image, text, x1, y1 - 16, COLOR_BLUE, 10);
+        sprintf(text[i], "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
+        boxes[i].box = det_result->box;
+        boxes[i].color = COLOR_RED;
+        boxes[i].thickness = 3;
+        boxes[i].text = text[i];
+        boxes[i].text_x = x1;
+        boxes[i].text_y = y1 - 16;
+        boxes[i].text_color = COLOR_BLUE;
     }
+    draw_overlay(&src_image, od_results.count >= 1 ? &mask : NULL, boxes, od_results.count, 10);
     write_image("out.png", &src_image);
 
 out:
@@ -22,8 +22,8 @@
 #include <sys/time.h>
 #include <opencv2/opencv.hpp>
 #include "easy_timer.h"
+#include "detect_postprocess.hpp"
 
-#include <set>
 #include <vector>
 #define LABEL_NALE_TXT_PATH "./model/coco_80_labels_list.txt"
 // #define USE_FP_RESIZE
@@ -102,87 +102,6 @@ static int loadLabelName(const char *locationFilename, char *label[])
     return 0;
 }
 
-static float CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0, float xmin1, float ymin1, float xmax1,
-                              float ymax1)
-{
-    float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);
-    float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);
-    float i = w * h;
-    float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) + (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;
-    return u <= 0.f ? 0.f : (i / u);
-}
-
-static int nms(int validCount, std::vector<float> &outputLocations, std::vector<int> classIds, std::vector<int> &order,
-               int filterId, float threshold)
-{
-    for (int i = 0; i < validCount; ++i)
-    {
-        if (order[i] == -1 || classIds[i] != filterId)
-        {
-            continue;
-        }
-        int n = order[i];
-        for (int j = i + 1; j < validCount; ++j)
-        {
-            int m = order[j];
-            if (m == -1 || classIds[i] != filterId)
-            {
-                continue;
-            }
-            float xmin0 = outputLocations[n * 4 + 0];
-            float ymin0 = outputLocations[n * 4 + 1];
-            float xmax0 = outputLocations[n * 4 + 0] + outputLocations[n * 4 + 2];
-            float ymax0 = outputLocations[n * 4 + 1] + outputLocations[n * 4 + 3];
-
-            float xmin1 = outputLocations[m * 4 + 0];
-            float ymin1 = outputLocations[m * 4 + 1];
-            float xmax1 = outputLocations[m * 4 + 0] + outputLocations[m * 4 + 2];
-            float ymax1 = outputLocations[m * 4 + 1] + outputLocations[m * 4 + 3];
-
-            float iou = CalculateOverlap(xmin0, ymin0, xmax0, ymax0, xmin1, ymin1, xmax1, ymax1);
-
-            if (iou > threshold)
-            {
-                order[j] = -1;
-            }
-        }
-    }
-    return 0;
-}
-
-static int quick_sort_indice_inverse(std::vector<float> &input, int left, int right, std::vector<int> &indices)
-{
-    float key;
-    int key_index;
-    int low = left;
-    int high = right;
-    if (left < right)
-    {
-        key_index = indices[left];
-        key = input[left];
-        while (low < high)
-        {
-            while (low < high && input[high] <= key)
-            {
-                high--;
-            }
-            input[low] = input[high];
-            indices[low] = indices[high];
-            while (low < high && input[low] >= key)
-            {
-                low++;
-            }
-            input[high] = input[low];
-            indices[high] = indices[low];
-        }
-        input[low] = key;
-        indices[low] = key_index;
-        quick_sort_indice_inverse(input, left, low - 1, indices);
-        quick_sort_indice_inverse(input, low + 1, right, indices);
-    }
-    return low;
-}
-
 void resize_by_opencv_fp(float *input_image, int input_width, int input_height, int boxes_num, float *output_image, int target_width, int target_height)
 {
     for (int b = 0; b < boxes_num; b++)
@@ -605,13 +524,15 @@ static int process_fp32(rknn_output *all_input, int input_id, int grid_h, int gr
 int post_process(rknn_app_context_t *app_ctx, rknn_output *outputs, letterbox_t *letter_box, float conf_threshold, float nms_threshold, object_detect_result_list *od_results)
 {
 
-    std::vector<float> filterBoxes;
-    std::vector<float> objProbs;
-    std::vector<int> classId;
+    // 候选、proto等缓存在工作区中跨帧复用
+    detect_pp::detect_workspace_t *ws = app_ctx->pp_workspace;
+    std::vector<float> &filterBoxes = ws->cand.boxes;
+    std::vector<float> &objProbs = ws->cand.probs;
+    std::vector<int> &classId = ws->cand.class_ids;
 
-    std::vector<float> filterSegments;
-    float proto[PROTO_CHANNEL * PROTO_HEIGHT * PROTO_WEIGHT];
-    std::vector<float> filterSegments_by_nms;
+    std::vector<float> &filterSegments = ws->mask_coeffs;
+    float *proto = ws->proto.data();
+    std::vector<float> &filterSegments_by_nms = ws->kept_mask_coeffs;
 
     int model_in_width = app_ctx->model_width;
     int model_in_height = app_ctx->model_height;
@@ -622,6 +543,7 @@ int post_process(rknn_app_context_t *app_ctx, rknn_output *outputs, letterbox_t
     int grid_w = 0;
 
     memset(od_results, 0, sizeof(object_detect_result_list));
+    detect_pp::detect_workspace_begin_frame(ws);
 
     int dfl_len = app_ctx->output_attrs[0].dims[2] / 4;
     int output_per_branch = app_ctx->io_num.n_output / 3; // default 3 branch
@@ -648,22 +570,13 @@ int post_process(rknn_app_context_t *app_ctx, rknn_output *outputs, letterbox_t
     // nms
     if (validCount <= 0)
     {
+        detect_pp::detect_workspace_end_frame(ws);
         return 0;
     }
-    std::vector<int> indexArray;
-    for (int i = 0; i < validCount; ++i)
-    {
-        indexArray.push_back(i);
-    }
+    std::vector<int> &indexArray = ws->order;
+    validCount = detect_pp::sort_candidates(objProbs, indexArray, PRE_NMS_TOP_K, ws->sorted_probs);
 
-    quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
-
-    std::set<int> class_set(std::begin(classId), std::end(classId));
-
-    for (auto c : class_set)
-    {
-        nms(validCount, filterBoxes, classId, indexArray, c, nms_threshold);
-    }
+    detect_pp::nms_sorted(validCount, filterBoxes, classId, indexArray, nms_threshold, detect_pp::DETECT_NMS_PER_CLASS, ws->nms);
 
     int last_count = 0;
     od_results->count = 0;
@@ -725,21 +638,21 @@ int post_process(rknn_app_context_t *app_ctx, rknn_output *outputs, letterbox_t
     int ROWS_A = boxes_num;
     int COLS_A = PROTO_CHANNEL;
     int COLS_B = PROTO_HEIGHT * PROTO_WEIGHT;
-    float *matmul_out = (float *)malloc(boxes_num * PROTO_HEIGHT * PROTO_WEIGHT * sizeof(float));
+    float *matmul_out = (float *)buffer_pool_alloc(app_ctx->buffer_pool, boxes_num * PROTO_HEIGHT * PROTO_WEIGHT * sizeof(float));
     matmul_by_cpu_fp(filterSegments_by_nms, proto, matmul_out, ROWS_A, COLS_A, COLS_B);
     timer.tok();
     timer.print_time("matmul_by_cpu_fp");
 
     timer.tik();
     // resize to (boxes_num, model_in_width, model_in_height)
-    float *seg_mask = (float *)malloc(boxes_num * model_in_height * model_in_width * sizeof(float));
+    float *seg_mask = (float *)buffer_pool_alloc(app_ctx->buffer_pool, boxes_num * model_in_height * model_in_width * sizeof(float));
     resize_by_opencv_fp(matmul_out, PROTO_WEIGHT, PROTO_HEIGHT, boxes_num, seg_mask, model_in_width, model_in_height);
     timer.tok();
     timer.print_time("resize_by_opencv_fp");
 
     timer.tik();
     // crop mask
-    uint8_t *all_mask_in_one = (uint8_t *)malloc(model_in_height * model_in_width * sizeof(uint8_t));
+    uint8_t *all_mask_in_one = (uint8_t *)buffer_pool_alloc(app_ctx->buffer_pool, model_in_height * model_in_width * sizeof(uint8_t));
     memset(all_mask_in_one, 0, model_in_height * model_in_width * sizeof(uint8_t));
     crop_mask_fp(seg_mask, all_mask_in_one, filterBoxes_by_nms, boxes_num, cls_id, model_in_height, model_in_width);
     timer.tok();
@@ -750,20 +663,20 @@ int post_process(rknn_app_context_t *app_ctx, rknn_output *outputs, letterbox_t
     int ROWS_A = boxes_num;
     int COLS_A = PROTO_CHANNEL;
     int COLS_B = PROTO_HEIGHT * PROTO_WEIGHT;
-    uint8_t *matmul_out = (uint8_t *)malloc(boxes_num * PROTO_HEIGHT * PROTO_WEIGHT * sizeof(uint8_t));
+    uint8_t *matmul_out = (uint8_t *)buffer_pool_alloc(app_ctx->buffer_pool, boxes_num * PROTO_HEIGHT * PROTO_WEIGHT * sizeof(uint8_t));
     matmul_by_cpu_uint8(filterSegments_by_nms, proto, matmul_out, ROWS_A, COLS_A, COLS_B);
     timer.tok();
     timer.print_time("matmul_by_cpu_uint8");
 
     timer.tik();
-    uint8_t *seg_mask = (uint8_t *)malloc(boxes_num * model_in_height * model_in_width * sizeof(uint8_t));
+    uint8_t *seg_mask = (uint8_t *)buffer_pool_alloc(app_ctx->buffer_pool, boxes_num * model_in_height * model_in_width * sizeof(uint8_t));
     resize_by_opencv_uint8(matmul_out, PROTO_WEIGHT, PROTO_HEIGHT, boxes_num, seg_mask, model_in_width, model_in_height);
     timer.tok();
     timer.print_time("resize_by_opencv_uint8");
 
     timer.tik();
     // crop mask
-    uint8_t *all_mask_in_one = (uint8_t *)malloc(model_in_height * model_in_width * sizeof(uint8_t));
+    uint8_t *all_mask_in_one = (uint8_t *)buffer_pool_alloc(app_ctx->buffer_pool, model_in_height * model_in_width * sizeof(uint8_t));
     memset(all_mask_in_one, 0, model_in_height * model_in_width * sizeof(uint8_t));
     crop_mask_uint8(seg_mask, all_mask_in_one, filterBoxes_by_nms, boxes_num, cls_id, model_in_height, model_in_width);
     timer.tok();
@@ -778,21 +691,50 @@ int post_process(rknn_app_context_t *app_ctx, rknn_output *outputs, letterbox_t
     int ori_in_width = app_ctx->input_image_width;
     int y_pad = letter_box->y_pad;
     int x_pad = letter_box->x_pad;
-    uint8_t *cropped_seg_mask = (uint8_t *)malloc(cropped_height * cropped_width * sizeof(uint8_t));
-    uint8_t *real_seg_mask = (uint8_t *)malloc(ori_in_height * ori_in_width * sizeof(uint8_t));
+    uint8_t *cropped_seg_mask = (uint8_t *)buffer_pool_alloc(app_ctx->buffer_pool, cropped_height * cropped_width * sizeof(uint8_t));
+    uint8_t *real_seg_mask = (uint8_t *)buffer_pool_alloc(app_ctx->buffer_pool, ori_in_height * ori_in_width * sizeof(uint8_t));
     seg_reverse(all_mask_in_one, cropped_seg_mask, real_seg_mask,
                 model_in_height, model_in_width, cropped_height, cropped_width, ori_in_height, ori_in_width, y_pad, x_pad);
     od_results->results_seg[0].seg_mask = real_seg_mask;
-    free(all_mask_in_one);
-    free(cropped_seg_mask);
-    free(seg_mask);
-    free(matmul_out);
+    buffer_pool_free(app_ctx->buffer_pool, all_mask_in_one);
+    buffer_pool_free(app_ctx->buffer_pool, cropped_seg_mask);
+    buffer_pool_free(app_ctx->buffer_pool, seg_mask);
+    buffer_pool_free(app_ctx->buffer_pool, matmul_out);
     timer.tok();
     timer.print_time("seg_reverse");
 
+    detect_pp::detect_workspace_end_frame(ws);
     return 0;
 }
 
+int init_post_process_workspace(rknn_app_context_t *app_ctx)
+{
+    // 每个grid cell最多产生一个候选
+    int max_candidates = 0;
+    // 每个分支4个输出(box, score, score_sum, seg)，最后一个是proto
+    for (int i = 0; i < 12; i += 4)
+    {
+        int grid_h = app_ctx->output_attrs[i].dims[1];
+        int grid_w = app_ctx->output_attrs[i].dims[0];
+        max_candidates += grid_h * grid_w;
+    }
+    app_ctx->pp_workspace = detect_pp::detect_workspace_create(max_candidates, 0, OBJ_CLASS_NUM);
+    if (app_ctx->pp_workspace == NULL)
+    {
+        printf("detect_workspace_create fail!\n");
+        return -1;
+    }
+    detect_pp::detect_workspace_reserve_masks(app_ctx->pp_workspace, max_candidates, PROTO_CHANNEL, OBJ_NUMB_MAX_SIZE,
+                                              PROTO_CHANNEL * PROTO_HEIGHT * PROTO_WEIGHT);
+    return 0;
+}
+
+void deinit_post_process_workspace(rknn_app_context_t *app_ctx)
+{
+    detect_pp::detect_workspace_destroy(app_ctx->pp_workspace);
+    app_ctx->pp_workspace = NULL;
+}
+
 int init_post_process()
 {
     int ret = 0;
@@ -18,6 +18,8 @@
 
 #include "rknn_api.h"
 #include "common.h"
+#include "detect_postprocess.hpp"
+#include "buffer_pool.h"
 
 typedef struct {
     rknn_context rknn_ctx;
@@ -30,6 +32,8 @@ typedef struct {
     int input_image_width;
     int input_image_height;
     bool is_quant;
+    buffer_pool_t* buffer_pool;     // per-frame input image and masks, reset at each inference
+    detect_pp::detect_workspace_t* pp_workspace;   // postprocess scratch reused across frames
 } rknn_app_context_t;
 
 #include "postprocess.h"
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "buffer_pool.h"
+
+// 每个2的幂区间分为4档，最大支持2^48字节
+#define SIZE_CLASS_MIN_SHIFT 6
+#define SIZE_CLASS_MAX_SHIFT 48
+#define SIZE_CLASS_STEPS 4
+#define NUM_SIZE_CLASSES (1 + (SIZE_CLASS_MAX_SHIFT - SIZE_CLASS_MIN_SHIFT) * SIZE_CLASS_STEPS)
+
+// 块头占一个对齐单位，用户指针紧跟其后，保证64字节对齐
+typedef struct block_header {
+    struct block_header* next_free;
+    struct block_header* next_all;
+    size_t size;
+    int size_class;
+    int in_use;
+} block_header_t;
+
+typedef char block_header_fits_align[sizeof(block_header_t) <= BUFFER_POOL_ALIGN ? 1 : -1];
+
+struct buffer_pool {
+    pthread_mutex_t lock;
+    block_header_t* free_lists[NUM_SIZE_CLASSES];
+    block_header_t* all_blocks;
+    buffer_pool_stats_t stats;
+};
+
+static block_header_t* get_header(void* ptr)
+{
+    return (block_header_t*)((unsigned char*)ptr - BUFFER_POOL_ALIGN);
+}
+
+static void* get_data(block_header_t* block)
+{
+    return (unsigned char*)block + BUFFER_POOL_ALIGN;
+}
+
+// 返回size所属档位及该档块大小，超出范围返回-1
+static int get_size_class(size_t size, size_t* class_size)
+{
+    if (size <= ((size_t)1 << SIZE_CLASS_MIN_SHIFT)) {
+        *class_size = (size_t)1 << SIZE_CLASS_MIN_SHIFT;
+        return 0;
+    }
+    int shift = 0;
+    size_t v = size - 1;
+    while (v >>= 1) {
+        shift++;
+    }
+    if (shift >= SIZE_CLASS_MAX_SHIFT) {
+        return -1;
+    }
+    size_t base = (size_t)1 << shift;
+    size_t step = base / SIZE_CLASS_STEPS;
+    size_t k = (size - base + step - 1) / step;
+    *class_size = base + k * step;
+    return 1 + (shift - SIZE_CLASS_MIN_SHIFT) * SIZE_CLASS_STEPS + (int)(k - 1);
+}
+
+buffer_pool_t* buffer_pool_create(void)
+{
+    buffer_pool_t* pool = (buffer_pool_t*)malloc(sizeof(buffer_pool_t));
+    if (pool == NULL) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(buffer_pool_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    return pool;
+}
+
+void buffer_pool_destroy(buffer_pool_t* pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    block_header_t* block = pool->all_blocks;
+    while (block != NULL) {
+        block_header_t* next = block->next_all;
+        free(block);
+        block = next;
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+void* buffer_pool_alloc(buffer_pool_t* pool, size_t size)
+{
+    void* ptr = NULL;
+    if (pool == NULL) {
+        if (posix_memalign(&ptr, BUFFER_POOL_ALIGN, size > 0 ? size : 1) != 0) {
+            return NULL;
+        }
+        return ptr;
+    }
+
+    size_t class_size;
+    int size_class = get_size_class(size, &class_size);
+    if (size_class < 0) {
+        printf("buffer_pool: size %zu too large\n", size);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    block_header_t* block = pool->free_lists[size_class];
+    if (block != NULL) {
+        pool->free_lists[size_class] = block->next_free;
+        pool->stats.pool_hits++;
+    } else {
+        if (posix_memalign(&ptr, BUFFER_POOL_ALIGN, BUFFER_POOL_ALIGN + class_size) != 0) {
+            pthread_mutex_unlock(&pool->lock);
+            printf("buffer_pool: alloc size %zu fail\n", class_size);
+            return NULL;
+        }
+        block = (block_header_t*)ptr;
+        block->size = class_size;
+        block->size_class = size_class;
+        block->next_all = pool->all_blocks;
+        pool->all_blocks = block;
+        pool->stats.heap_allocs++;
+        pool->stats.frame_heap_allocs++;
+        pool->stats.blocks++;
+        pool->stats.bytes_reserved += class_size;
+    }
+    block->next_free = NULL;
+    block->in_use = 1;
+    pool->stats.blocks_in_use++;
+    pool->stats.bytes_in_use += block->size;
+    if (pool->stats.bytes_in_use > pool->stats.peak_bytes_in_use) {
+        pool->stats.peak_bytes_in_use = pool->stats.bytes_in_use;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return get_data(block);
+}
+
+void* buffer_pool_calloc(buffer_pool_t* pool, size_t size)
+{
+    void* ptr = buffer_pool_alloc(pool, size);
+    if (ptr != NULL) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+static void release_block(buffer_pool_t* pool, block_header_t* block)
+{
+    block->in_use = 0;
+    block->next_free = pool->free_lists[block->size_class];
+    pool->free_lists[block->size_class] = block;
+    pool->stats.blocks_in_use--;
+    pool->stats.bytes_in_use -= block->size;
+}
+
+void buffer_pool_free(buffer_pool_t* pool, void* ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    if (pool == NULL) {
+        free(ptr);
+        return;
+    }
+    block_header_t* block = get_header(ptr);
+    pthread_mutex_lock(&pool->lock);
+    if (block->in_use) {
+        release_block(pool, block);
+    } else {
+        printf("buffer_pool: double free %p\n", ptr);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void buffer_pool_reset(buffer_pool_t* pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    for (block_header_t* block = pool->all_blocks; block != NULL; block = block->next_all) {
+        if (block->in_use) {
+            release_block(pool, block);
+        }
+    }
+    pool->stats.frame_heap_allocs = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void buffer_pool_get_stats(buffer_pool_t* pool, buffer_pool_stats_t* stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    if (pool == NULL) {
+        memset(stats, 0, sizeof(buffer_pool_stats_t));
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,103 @@
+#ifndef _RKNN_MODEL_ZOO_BUFFER_POOL_H_
+#define _RKNN_MODEL_ZOO_BUFFER_POOL_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Size class buffer pool for per-frame image and tensor buffers.
+ *
+ * Blocks are 64-byte aligned and rounded up to one of four size classes per
+ * power of two, so a block serves any later request of the same class. Freed
+ * blocks, and every block at buffer_pool_reset(), go back to the free list of
+ * their class and are never returned to the heap before buffer_pool_destroy().
+ * After the first frames the pool holds the working set and allocations stop
+ * touching the heap, which frame_heap_allocs of buffer_pool_stats_t shows.
+ */
+
+#define BUFFER_POOL_ALIGN 64
+
+/**
+ * @brief Pool counters
+ *
+ */
+typedef struct {
+    int heap_allocs;            // blocks allocated from heap since pool create
+    int frame_heap_allocs;      // blocks allocated from heap since last buffer_pool_reset()
+    int pool_hits;              // allocations served from free lists since pool create
+    int blocks;                 // blocks owned by pool
+    int blocks_in_use;          // blocks handed out and not freed
+    size_t bytes_reserved;      // bytes of all blocks
+    size_t bytes_in_use;        // bytes of blocks in use
+    size_t peak_bytes_in_use;   // max of bytes_in_use since pool create
+} buffer_pool_stats_t;
+
+typedef struct buffer_pool buffer_pool_t;
+
+/**
+ * @brief Create buffer pool
+ *
+ * @return buffer_pool_t* NULL: error, remember call buffer_pool_destroy() after used
+ */
+buffer_pool_t* buffer_pool_create(void);
+
+/**
+ * @brief Free all blocks and pool, pointers from the pool become invalid
+ *
+ * @param pool [in] Buffer pool
+ */
+void buffer_pool_destroy(buffer_pool_t* pool);
+
+/**
+ * @brief Get a 64-byte aligned buffer of at least size bytes (content undefined)
+ *
+ * If pool is NULL the buffer comes from heap, release it with buffer_pool_free(NULL, ptr).
+ *
+ * @param pool [in] Buffer pool
+ * @param size [in] Buffer size in bytes
+ * @return void* NULL: error
+ */
+void* buffer_pool_alloc(buffer_pool_t* pool, size_t size);
+
+/**
+ * @brief Same as buffer_pool_alloc() and fill the buffer with zero
+ *
+ * @param pool [in] Buffer pool
+ * @param size [in] Buffer size in bytes
+ * @return void* NULL: error
+ */
+void* buffer_pool_calloc(buffer_pool_t* pool, size_t size);
+
+/**
+ * @brief Return buffer to pool before the next reset
+ *
+ * @param pool [in] Buffer pool
+ * @param ptr [in] Buffer from buffer_pool_alloc(), NULL is ignored
+ */
+void buffer_pool_free(buffer_pool_t* pool, void* ptr);
+
+/**
+ * @brief Return all buffers to pool, call once at the beginning of each frame
+ *
+ * Buffers handed out before the reset must not be used anymore.
+ *
+ * @param pool [in] Buffer pool
+ */
+void buffer_pool_reset(buffer_pool_t* pool);
+
+/**
+ * @brief Get pool counters
+ *
+ * @param pool [in] Buffer pool
+ * @param stats [out] Counters
+ */
+void buffer_pool_get_stats(buffer_pool_t* pool, buffer_pool_stats_t* stats);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif // _RKNN_MODEL_ZOO_BUFFER_POOL_H_
@@ -20,8 +20,8 @@ typedef enum {
 typedef struct {
     int width;
     int height;
-    int width_stride;
-    int height_stride;
+    int width_stride;               // pixels per row (0: equal to width)
+    int height_stride;              // rows of Y plane before UV plane for YUV420SP (0: equal to height)
     image_format_t format;
     unsigned char* virt_addr;
     int size;
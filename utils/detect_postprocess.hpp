@@ -0,0 +1,1750 @@
+#ifndef _RKNN_MODEL_ZOO_DETECT_POSTPROCESS_HPP_
+#define _RKNN_MODEL_ZOO_DETECT_POSTPROCESS_HPP_
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#if !defined(DETECT_POSTPROCESS_DISABLE_SIMD)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DETECT_PP_USE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define DETECT_PP_USE_SSE2 1
+#endif
+#endif
+
+#include "common.h"
+#include "image_utils.h"
+#include "thread_pool.h"
+
+/*
+ * Header-only decode and NMS shared by the YOLO style detection demos.
+ *
+ * The decode loops are templates specialized at compile time on
+ *   - dtype:  int8_t / uint8_t (affine quantized), fp16_t, float
+ *   - layout: layout_nchw, layout_nhwc, layout_nc1hwc2<C2> (NPU native)
+ *   - head:   head_anchor (yolov5/v7), head_anchor_free (yolox) through
+ *             decode_objectness_head(), and the split box/score heads of
+ *             yolov6/yolov8/ppyoloe (DFL or plain ltrb) through decode_dfl_head()
+ * so every model gets a loop without per-element branches on type or layout.
+ * Candidates of all branches are collected in the detect_candidates_t of a
+ * detect_workspace_t, which the model keeps across frames so post_process does
+ * not allocate once the first frame has run. finalize_detections() keeps the
+ * top scored candidates (sort_candidates()), runs NMS for all classes in one
+ * pass (nms_sorted()) and maps boxes back through the letterbox into the
+ * demo's object_detect_result_list.
+ *
+ * On planar (NCHW) outputs the class argmax runs channel-major: the objectness
+ * or score-sum gate is evaluated for a whole grid row first, then the class
+ * planes are swept once over the span of passing cells with running max/argmax
+ * vectors (NEON or SSE2 for int8/uint8), instead of a strided gather of every
+ * class per cell. Define DETECT_POSTPROCESS_DISABLE_SIMD for the scalar kernel.
+ *
+ * For int8/uint8 outputs the workspace also holds a detect_lut_t per output
+ * tensor, built at init, so box dequantize and the exp of DFL softmax and yolox
+ * w/h are table lookups on the raw code.
+ *
+ * With detect_workspace_set_threads() the decode of all branches is split into
+ * row bands that run on a persistent thread pool, see there.
+ *
+ * Gating and box arithmetic follow the per-model code this replaces, so the
+ * candidates are the same as before for every dtype and layout.
+ */
+
+namespace detect_pp {
+
+#define DETECT_DFL_MAX_LEN 64
+#define DETECT_ARGMAX_NONE 255      // 通道优先argmax中未选中类别的标记，类别数需小于该值
+#define DETECT_BANDS_PER_THREAD 4   // 并行解码时每个线程平均分到的行带数
+#define DETECT_BAND_MIN_CELLS 256   // 行带的最少cell数，太小时任务调度开销超过解码
+#define DETECT_AUTO_MAX_THREADS 4   // num_threads为0时的线程数上限，其余核留给NPU运行时和前处理
+
+/**
+ * @brief Half precision element of output tensor (raw IEEE 754 binary16 bits)
+ *
+ */
+typedef struct {
+    uint16_t bits;
+} fp16_t;
+
+static inline float fp16_to_f32(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // 非规格化数，规格化后放入float
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static inline int32_t clip_to_int(float val, float min, float max)
+{
+    float f = val <= min ? min : (val >= max ? max : val);
+    return f;
+}
+
+/**
+ * @brief Element type traits
+ *
+ * value_t is the type scores are compared in: the raw quantized value for
+ * int8/uint8 so thresholds are quantized once per tensor, float otherwise.
+ */
+template <typename T>
+struct dtype_traits;
+
+template <>
+struct dtype_traits<int8_t> {
+    typedef int8_t value_t;
+    static inline value_t load(const int8_t* p) { return *p; }
+    static inline value_t quantize(float f, int32_t zp, float scale) { return (int8_t)clip_to_int((f / scale) + zp, -128, 127); }
+    static inline float dequantize(value_t q, int32_t zp, float scale) { return ((float)q - (float)zp) * scale; }
+    // 类别最大值的初始值，与原实现的 -zp 一致
+    static inline value_t score_floor(int32_t zp) { return (int8_t)(-zp); }
+    static const bool quantized = true;
+    static inline int lut_index(value_t q) { return (uint8_t)q; }
+};
+
+template <>
+struct dtype_traits<uint8_t> {
+    typedef uint8_t value_t;
+    static inline value_t load(const uint8_t* p) { return *p; }
+    static inline value_t quantize(float f, int32_t zp, float scale) { return (uint8_t)clip_to_int((f / scale) + zp, 0, 255); }
+    static inline float dequantize(value_t q, int32_t zp, float scale) { return ((float)q - (float)zp) * scale; }
+    static inline value_t score_floor(int32_t zp) { return (uint8_t)(-zp); }
+    static const bool quantized = true;
+    static inline int lut_index(value_t q) { return q; }
+};
+
+template <>
+struct dtype_traits<float> {
+    typedef float value_t;
+    static inline value_t load(const float* p) { return *p; }
+    static inline value_t quantize(float f, int32_t zp, float scale) { return f; }
+    static inline float dequantize(value_t v, int32_t zp, float scale) { return v; }
+    static inline value_t score_floor(int32_t zp) { return 0; }
+    static const bool quantized = false;
+    static inline int lut_index(value_t v) { return 0; }
+};
+
+template <>
+struct dtype_traits<fp16_t> {
+    typedef float value_t;
+    static inline value_t load(const fp16_t* p) { return fp16_to_f32(p->bits); }
+    static inline value_t quantize(float f, int32_t zp, float scale) { return f; }
+    static inline float dequantize(value_t v, int32_t zp, float scale) { return v; }
+    static inline value_t score_floor(int32_t zp) { return 0; }
+    static const bool quantized = false;
+    static inline int lut_index(value_t v) { return 0; }
+};
+
+/**
+ * @brief Lookup tables of one int8/uint8 output tensor, indexed by the raw byte of an element
+ *
+ * A quantized tensor holds one of 256 codes, so dequantize and exp are evaluated
+ * once per code when the model is loaded instead of once per element and frame.
+ * The entries use the same expressions as the float path, results do not change.
+ */
+typedef struct {
+    float dequant[256];
+    float exp[256];         // exp(dequant)，用于DFL softmax和yolox的w/h
+} detect_lut_t;
+
+/**
+ * @brief Fill lookup tables from the quantization parameters of a tensor
+ *
+ * @param lut [out] Lookup tables
+ * @param zp [in] Zero point of tensor
+ * @param scale [in] Scale of tensor
+ * @param is_signed [in] true: int8 tensor, false: uint8 tensor
+ */
+static inline void detect_lut_build(detect_lut_t* lut, int32_t zp, float scale, bool is_signed)
+{
+    for (int c = 0; c < 256; c++) {
+        float v = is_signed ? dtype_traits<int8_t>::dequantize((int8_t)c, zp, scale)
+                            : dtype_traits<uint8_t>::dequantize((uint8_t)c, zp, scale);
+        lut->dequant[c] = v;
+        lut->exp[c] = exp(v);
+    }
+}
+
+// 有查找表时查表，否则按量化参数计算，两者结果相同
+template <typename T>
+static inline float lut_dequantize(const detect_lut_t* lut, typename dtype_traits<T>::value_t q, int32_t zp, float scale)
+{
+    typedef dtype_traits<T> traits;
+    if (traits::quantized && lut != NULL) {
+        return lut->dequant[traits::lut_index(q)];
+    }
+    return traits::dequantize(q, zp, scale);
+}
+
+template <typename T>
+static inline float lut_exp(const detect_lut_t* lut, typename dtype_traits<T>::value_t q, int32_t zp, float scale)
+{
+    typedef dtype_traits<T> traits;
+    if (traits::quantized && lut != NULL) {
+        return lut->exp[traits::lut_index(q)];
+    }
+    return exp(traits::dequantize(q, zp, scale));
+}
+
+/**
+ * @brief [1, C, H, W], also RKNPU1 outputs whose dims are reported reversed (WHCN)
+ *
+ */
+struct layout_nchw {
+    static const bool planar = true;        // 每个通道是连续的H*W平面
+    static const bool anchor_major = true;  // 多anchor输出按anchor分块遍历，顺序访问内存
+    static inline int offset(int c, int p, int channels, int grid_len) { return c * grid_len + p; }
+};
+
+/**
+ * @brief [1, H, W, C], RV1106/RV1103 outputs
+ *
+ */
+struct layout_nhwc {
+    static const bool planar = false;
+    static const bool anchor_major = false;
+    static inline int offset(int c, int p, int channels, int grid_len) { return p * channels + c; }
+};
+
+/**
+ * @brief NPU native [1, C/C2, H, W, C2] output, read without converting to NCHW first
+ *
+ */
+template <int C2>
+struct layout_nc1hwc2 {
+    static const bool planar = false;
+    static const bool anchor_major = true;
+    static inline int offset(int c, int p, int channels, int grid_len) { return ((c / C2) * grid_len + p) * C2 + c % C2; }
+};
+
+/**
+ * @brief yolov5/yolov7 box: sigmoid already applied, (2t - 0.5 + grid) * stride, (2t)^2 * anchor
+ *
+ */
+struct head_anchor {
+    static const bool exp_wh = false;   // decode()的tw/th是否传入exp(tw)/exp(th)
+    static inline void decode(float tx, float ty, float tw, float th, int col, int row, int stride, const int* anchor, float* box)
+    {
+        float box_x = tx * 2.0 - 0.5;
+        float box_y = ty * 2.0 - 0.5;
+        float box_w = tw * 2.0;
+        float box_h = th * 2.0;
+        box_x = (box_x + col) * (float)stride;
+        box_y = (box_y + row) * (float)stride;
+        box_w = box_w * box_w * (float)anchor[0];
+        box_h = box_h * box_h * (float)anchor[1];
+        box_x -= (box_w / 2.0);
+        box_y -= (box_h / 2.0);
+        box[0] = box_x;
+        box[1] = box_y;
+        box[2] = box_w;
+        box[3] = box_h;
+    }
+};
+
+/**
+ * @brief yolox box: (t + grid) * stride, exp(t) * stride, exp(t) is passed in as ew/eh
+ *
+ */
+struct head_anchor_free {
+    static const bool exp_wh = true;
+    static inline void decode(float tx, float ty, float ew, float eh, int col, int row, int stride, const int* anchor, float* box)
+    {
+        float box_x = (tx + col) * (float)stride;
+        float box_y = (ty + row) * (float)stride;
+        float box_w = ew * stride;
+        float box_h = eh * stride;
+        box_x -= (box_w / 2.0);
+        box_y -= (box_h / 2.0);
+        box[0] = box_x;
+        box[1] = box_y;
+        box[2] = box_w;
+        box[3] = box_h;
+    }
+};
+
+/**
+ * @brief Candidates of all branches before NMS
+ *
+ */
+typedef struct {
+    std::vector<float> boxes;       // x, y, w, h in model input coordinates
+    std::vector<float> probs;
+    std::vector<int> class_ids;
+} detect_candidates_t;
+
+static inline void push_candidate(detect_candidates_t& cand, const float* box, float prob, int class_id)
+{
+    cand.boxes.push_back(box[0]);
+    cand.boxes.push_back(box[1]);
+    cand.boxes.push_back(box[2]);
+    cand.boxes.push_back(box[3]);
+    cand.probs.push_back(prob);
+    cand.class_ids.push_back(class_id);
+}
+
+/**
+ * @brief Sorted candidates as structure of arrays (x1/y1/x2/y2/area), one slot per candidate
+ *
+ * In DETECT_NMS_PER_CLASS mode the slots are grouped by class, score order kept inside a
+ * class, so every class is a contiguous range [bucket_start[k], bucket_start[k + 1]).
+ */
+struct nms_boxes_t {
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> x2;
+    std::vector<float> y2;
+    std::vector<float> area;
+    std::vector<int> rank;              // slot在排序后order中的位置
+    std::vector<int> bucket_start;
+    std::vector<int> bucket_fill;
+    std::vector<uint8_t> suppressed;
+};
+
+/**
+ * @brief Workspace counters
+ *
+ */
+typedef struct {
+    int heap_allocs;            // buffer reallocations since workspace create, including the initial reserve
+    int frame_heap_allocs;      // buffer reallocations in the last frame, 0 once capacities cover the model
+    size_t bytes_reserved;      // capacity of all buffers
+} detect_workspace_stats_t;
+
+/**
+ * @brief Scratch of one row band task in parallel decode
+ *
+ */
+struct detect_band_scratch_t {
+    detect_candidates_t cand;
+    std::vector<int> row_cols;
+    std::vector<float> row_max;
+    std::vector<uint8_t> row_ids;
+};
+
+struct detect_band_task_t;
+typedef void (*detect_band_fn)(const void* branch, const detect_band_task_t& task, detect_band_scratch_t* scratch);
+
+/**
+ * @brief Row band of a branch: anchors [anchor_begin, anchor_end) of rows [row_begin, row_end)
+ *
+ */
+struct detect_band_task_t {
+    detect_band_fn run;
+    int branch;
+    int anchor_begin;
+    int anchor_end;
+    int row_begin;
+    int row_end;
+};
+
+// 排队等待并行解码的分支参数(objectness_branch_t/dfl_branch_t)
+typedef struct {
+    double data[16];
+} detect_branch_args_t;
+
+/**
+ * @brief Per-model postprocess scratch kept across frames
+ *
+ * Created once from the model's grid sizes, so the candidate buffers already hold
+ * one candidate per grid cell and anchor, the most a frame can produce. Frames only
+ * clear() the buffers, capacity stays and steady-state frames do no heap allocation.
+ * Every reallocation is still counted, see detect_workspace_get_stats().
+ */
+struct detect_workspace_t {
+    detect_candidates_t cand;
+    std::vector<int> order;             // 按分数排序后的候选下标
+    std::vector<float> sorted_probs;
+    nms_boxes_t nms;
+    std::vector<int> row_cols;          // 通道优先argmax的行缓存
+    std::vector<float> row_max;         // 按value_t解释，value_t不超过4字节
+    std::vector<uint8_t> row_ids;
+    std::vector<float> mask_coeffs;     // 分割模型：每个候选的mask系数
+    std::vector<float> kept_mask_coeffs;
+    std::vector<float> proto;           // 分割模型：反量化后的proto
+    std::vector<detect_lut_t> luts;     // 按输出tensor下标的查找表，浮点模型为空
+    thread_pool_t* pool;                // 并行解码的线程池，NULL: 串行解码
+    int max_candidates;
+    int band_cells;                     // 并行解码时每个行带任务的目标cell数
+    std::vector<detect_branch_args_t> branches;     // 本帧排队的分支
+    std::vector<detect_band_task_t> tasks;
+    std::vector<detect_band_scratch_t> band_scratch;    // 每个任务一份，按任务顺序合并
+    std::vector<size_t> capacity;       // 上次统计时各缓存的容量
+    detect_workspace_stats_t stats;
+};
+
+// 依次取出工作区的所有缓存容量(字节)，返回个数
+static inline int workspace_capacities(const detect_workspace_t* ws, size_t* caps)
+{
+    const nms_boxes_t& b = ws->nms;
+    int n = 0;
+    caps[n++] = ws->cand.boxes.capacity() * sizeof(float);
+    caps[n++] = ws->cand.probs.capacity() * sizeof(float);
+    caps[n++] = ws->cand.class_ids.capacity() * sizeof(int);
+    caps[n++] = ws->order.capacity() * sizeof(int);
+    caps[n++] = ws->sorted_probs.capacity() * sizeof(float);
+    caps[n++] = b.x1.capacity() * sizeof(float);
+    caps[n++] = b.y1.capacity() * sizeof(float);
+    caps[n++] = b.x2.capacity() * sizeof(float);
+    caps[n++] = b.y2.capacity() * sizeof(float);
+    caps[n++] = b.area.capacity() * sizeof(float);
+    caps[n++] = b.rank.capacity() * sizeof(int);
+    caps[n++] = b.bucket_start.capacity() * sizeof(int);
+    caps[n++] = b.bucket_fill.capacity() * sizeof(int);
+    caps[n++] = b.suppressed.capacity();
+    caps[n++] = ws->row_cols.capacity() * sizeof(int);
+    caps[n++] = ws->row_max.capacity() * sizeof(float);
+    caps[n++] = ws->row_ids.capacity();
+    caps[n++] = ws->mask_coeffs.capacity() * sizeof(float);
+    caps[n++] = ws->kept_mask_coeffs.capacity() * sizeof(float);
+    caps[n++] = ws->proto.capacity() * sizeof(float);
+    caps[n++] = ws->luts.capacity() * sizeof(detect_lut_t);
+    caps[n++] = ws->branches.capacity() * sizeof(detect_branch_args_t);
+    caps[n++] = ws->tasks.capacity() * sizeof(detect_band_task_t);
+    // 行带缓存合计为一项，容量只增不减，合计变化即有缓存重新分配
+    size_t band_bytes = ws->band_scratch.capacity() * sizeof(detect_band_scratch_t);
+    for (size_t i = 0; i < ws->band_scratch.size(); i++) {
+        const detect_band_scratch_t& b = ws->band_scratch[i];
+        band_bytes += (b.cand.boxes.capacity() + b.cand.probs.capacity() + b.row_max.capacity()) * sizeof(float) +
+                      (b.cand.class_ids.capacity() + b.row_cols.capacity()) * sizeof(int) + b.row_ids.capacity();
+    }
+    caps[n++] = band_bytes;
+    return n;
+}
+
+#define DETECT_WORKSPACE_BUFFERS 24
+
+// 与上次统计比较容量，返回期间重新分配过的缓存个数
+static inline int workspace_count_growth(detect_workspace_t* ws)
+{
+    size_t caps[DETECT_WORKSPACE_BUFFERS];
+    int n = workspace_capacities(ws, caps);
+    int grown = 0;
+    size_t bytes = 0;
+    for (int i = 0; i < n; i++) {
+        grown += caps[i] != ws->capacity[i];
+        ws->capacity[i] = caps[i];
+        bytes += caps[i];
+    }
+    ws->stats.heap_allocs += grown;
+    ws->stats.bytes_reserved = bytes;
+    return grown;
+}
+
+/**
+ * @brief Create workspace with capacity for one model
+ *
+ * @param max_candidates [in] Grid cells x anchors summed over all branches
+ * @param max_grid_w [in] Widest grid row
+ * @param num_class [in] Number of classes
+ * @return detect_workspace_t* NULL: error, remember call detect_workspace_destroy() after used
+ */
+static inline detect_workspace_t* detect_workspace_create(int max_candidates, int max_grid_w, int num_class)
+{
+    detect_workspace_t* ws = new (std::nothrow) detect_workspace_t;
+    if (ws == NULL) {
+        return NULL;
+    }
+    memset(&ws->stats, 0, sizeof(ws->stats));
+    ws->pool = NULL;
+    ws->max_candidates = max_candidates;
+    ws->band_cells = max_candidates;
+    ws->capacity.assign(DETECT_WORKSPACE_BUFFERS, 0);
+    ws->cand.boxes.reserve(max_candidates * 4);
+    ws->cand.probs.reserve(max_candidates);
+    ws->cand.class_ids.reserve(max_candidates);
+    ws->order.reserve(max_candidates);
+    ws->sorted_probs.reserve(max_candidates);
+    ws->nms.x1.reserve(max_candidates);
+    ws->nms.y1.reserve(max_candidates);
+    ws->nms.x2.reserve(max_candidates);
+    ws->nms.y2.reserve(max_candidates);
+    ws->nms.area.reserve(max_candidates);
+    ws->nms.rank.reserve(max_candidates);
+    ws->nms.suppressed.reserve(max_candidates);
+    // 类别id可能为-1，多留一个桶
+    ws->nms.bucket_start.reserve(num_class + 2);
+    ws->nms.bucket_fill.reserve(num_class + 1);
+    ws->row_cols.reserve(max_grid_w);
+    ws->row_max.reserve(max_grid_w);
+    ws->row_ids.reserve(max_grid_w);
+    workspace_count_growth(ws);
+    return ws;
+}
+
+/**
+ * @brief Reserve the buffers of segmentation models
+ *
+ * @param ws [in] Workspace
+ * @param max_candidates [in] Same as detect_workspace_create()
+ * @param num_coeffs [in] Mask coefficients per candidate
+ * @param max_kept [in] Max results after NMS
+ * @param proto_size [in] Elements of the proto tensor
+ */
+static inline void detect_workspace_reserve_masks(detect_workspace_t* ws, int max_candidates, int num_coeffs, int max_kept, int proto_size)
+{
+    ws->mask_coeffs.reserve((size_t)max_candidates * num_coeffs);
+    ws->kept_mask_coeffs.reserve((size_t)max_kept * num_coeffs);
+    ws->proto.resize(proto_size);
+    workspace_count_growth(ws);
+}
+
+/**
+ * @brief Build the lookup tables of a quantized output tensor, call at init for each int8/uint8 output
+ *
+ * @param ws [in] Workspace
+ * @param tensor_index [in] Output tensor index
+ * @param zp [in] Zero point of tensor
+ * @param scale [in] Scale of tensor
+ * @param is_signed [in] true: int8 tensor, false: uint8 tensor
+ */
+static inline void detect_workspace_build_lut(detect_workspace_t* ws, int tensor_index, int32_t zp, float scale, bool is_signed)
+{
+    if ((int)ws->luts.size() <= tensor_index) {
+        ws->luts.resize(tensor_index + 1);
+    }
+    detect_lut_build(&ws->luts[tensor_index], zp, scale, is_signed);
+    workspace_count_growth(ws);
+}
+
+/**
+ * @brief Get the lookup tables of an output tensor
+ *
+ * @param ws [in] Workspace
+ * @param tensor_index [in] Output tensor index
+ * @return const detect_lut_t* NULL: not built, decode computes each value instead
+ */
+static inline const detect_lut_t* detect_workspace_lut(const detect_workspace_t* ws, int tensor_index)
+{
+    if (tensor_index < 0 || tensor_index >= (int)ws->luts.size()) {
+        return NULL;
+    }
+    return &ws->luts[tensor_index];
+}
+
+/**
+ * @brief Decode branches and row bands on a persistent thread pool, call at init after detect_workspace_create()
+ *
+ * With more than one thread decode_objectness_head() and decode_dfl_head() only queue
+ * the branch split into row bands, and finalize_detections() decodes all bands of the
+ * frame in one thread_pool_parallel_for(). Every band appends to its own candidate
+ * buffer and the buffers are merged in the serial visiting order, so candidates and
+ * results are the same as with serial decode.
+ *
+ * @param ws [in] Workspace
+ * @param num_threads [in] Total thread number including the calling thread, 0: one per core of core_ids
+ *                    (online core when NULL) up to DETECT_AUTO_MAX_THREADS, serial on a single core;
+ *                    1 or negative: serial decode
+ * @param core_ids [in] CPU core ids to bind threads (e.g. the big cores), NULL: no binding
+ * @param num_core_ids [in] Size of core_ids
+ * @return int 0: success; -1: error
+ */
+static inline int detect_workspace_set_threads(detect_workspace_t* ws, int num_threads, const int* core_ids, int num_core_ids)
+{
+    if (ws->pool != NULL) {
+        thread_pool_destroy(ws->pool);
+        ws->pool = NULL;
+    }
+    ws->band_cells = ws->max_candidates;
+    if (num_threads == 0) {
+        long num_cores = (core_ids != NULL && num_core_ids > 0) ? num_core_ids : sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = num_cores < DETECT_AUTO_MAX_THREADS ? (int)num_cores : DETECT_AUTO_MAX_THREADS;
+    }
+    if (num_threads <= 1) {
+        return 0;
+    }
+    ws->pool = thread_pool_create(num_threads, core_ids, num_core_ids);
+    if (ws->pool == NULL) {
+        printf("detect_workspace_set_threads: create thread pool fail\n");
+        return -1;
+    }
+    int band_cells = ws->max_candidates / (thread_pool_get_num_threads(ws->pool) * DETECT_BANDS_PER_THREAD);
+    ws->band_cells = band_cells > DETECT_BAND_MIN_CELLS ? band_cells : DETECT_BAND_MIN_CELLS;
+    return 0;
+}
+
+/**
+ * @brief Get decode thread number set by detect_workspace_set_threads()
+ *
+ * @param ws [in] Workspace
+ * @return int Total thread number, 1: serial decode
+ */
+static inline int detect_workspace_get_threads(const detect_workspace_t* ws)
+{
+    return ws->pool != NULL ? thread_pool_get_num_threads(ws->pool) : 1;
+}
+
+/**
+ * @brief Free workspace, NULL is ignored
+ *
+ * @param ws [in] Workspace
+ */
+static inline void detect_workspace_destroy(detect_workspace_t* ws)
+{
+    if (ws == NULL) {
+        return;
+    }
+    thread_pool_destroy(ws->pool);
+    delete ws;
+}
+
+/**
+ * @brief Clear candidates and scratch of the previous frame, call at the beginning of post_process
+ *
+ * @param ws [in] Workspace
+ */
+static inline void detect_workspace_begin_frame(detect_workspace_t* ws)
+{
+    workspace_count_growth(ws);
+    ws->stats.frame_heap_allocs = 0;
+    ws->cand.boxes.clear();
+    ws->cand.probs.clear();
+    ws->cand.class_ids.clear();
+    ws->order.clear();
+    ws->mask_coeffs.clear();
+    ws->kept_mask_coeffs.clear();
+    ws->branches.clear();
+    ws->tasks.clear();
+}
+
+/**
+ * @brief Count the reallocations of this frame, call at the end of post_process
+ *
+ * @param ws [in] Workspace
+ */
+static inline void detect_workspace_end_frame(detect_workspace_t* ws)
+{
+    ws->stats.frame_heap_allocs += workspace_count_growth(ws);
+}
+
+/**
+ * @brief Get workspace counters
+ *
+ * @param ws [in] Workspace
+ * @param stats [out] Counters
+ */
+static inline void detect_workspace_get_stats(const detect_workspace_t* ws, detect_workspace_stats_t* stats)
+{
+    if (ws == NULL) {
+        memset(stats, 0, sizeof(detect_workspace_stats_t));
+        return;
+    }
+    *stats = ws->stats;
+}
+
+template <typename T>
+static inline void argmax_class_planes_scalar(const T* planes, int class_step, int first_class, int num_planes, int width,
+                                              typename dtype_traits<T>::value_t* max_val, uint8_t* max_id)
+{
+    typedef dtype_traits<T> traits;
+    for (int k = 0; k < num_planes; k++) {
+        const T* src = planes + (size_t)k * class_step;
+        uint8_t cls = (uint8_t)(first_class + k);
+        for (int j = 0; j < width; j++) {
+            typename traits::value_t v = traits::load(src + j);
+            if (v > max_val[j]) {
+                max_val[j] = v;
+                max_id[j] = cls;
+            }
+        }
+    }
+}
+
+#if defined(DETECT_PP_USE_NEON)
+// 16个cell一组，类别在内层循环，最大值和类别保持在寄存器中
+static inline void argmax_block16(const int8_t* src, int class_step, int first_class, int num_planes, int8_t* max_val, uint8_t* max_id)
+{
+    int8x16_t m = vld1q_s8(max_val);
+    uint8x16_t id = vld1q_u8(max_id);
+    uint8x16_t cls = vdupq_n_u8((uint8_t)first_class);
+    for (int k = 0; k < num_planes; k++) {
+        int8x16_t s = vld1q_s8(src + (size_t)k * class_step);
+        uint8x16_t gt = vcgtq_s8(s, m);
+        m = vmaxq_s8(m, s);
+        id = vbslq_u8(gt, cls, id);
+        cls = vaddq_u8(cls, vdupq_n_u8(1));
+    }
+    vst1q_s8(max_val, m);
+    vst1q_u8(max_id, id);
+}
+
+static inline void argmax_block16(const uint8_t* src, int class_step, int first_class, int num_planes, uint8_t* max_val, uint8_t* max_id)
+{
+    uint8x16_t m = vld1q_u8(max_val);
+    uint8x16_t id = vld1q_u8(max_id);
+    uint8x16_t cls = vdupq_n_u8((uint8_t)first_class);
+    for (int k = 0; k < num_planes; k++) {
+        uint8x16_t s = vld1q_u8(src + (size_t)k * class_step);
+        uint8x16_t gt = vcgtq_u8(s, m);
+        m = vmaxq_u8(m, s);
+        id = vbslq_u8(gt, cls, id);
+        cls = vaddq_u8(cls, vdupq_n_u8(1));
+    }
+    vst1q_u8(max_val, m);
+    vst1q_u8(max_id, id);
+}
+#elif defined(DETECT_PP_USE_SSE2)
+// SSE2只有有符号字节比较，uint8先异或0x80转为有符号顺序
+static inline void argmax_block16_sse2(const unsigned char* src, int class_step, int first_class, int num_planes,
+                                       unsigned char* max_val, uint8_t* max_id, int bias)
+{
+    const __m128i vbias = _mm_set1_epi8((char)bias);
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i m = _mm_xor_si128(_mm_loadu_si128((const __m128i*)max_val), vbias);
+    __m128i id = _mm_loadu_si128((const __m128i*)max_id);
+    __m128i cls = _mm_set1_epi8((char)first_class);
+    for (int k = 0; k < num_planes; k++) {
+        __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + (size_t)k * class_step)), vbias);
+        __m128i gt = _mm_cmpgt_epi8(s, m);
+        m = _mm_or_si128(_mm_and_si128(gt, s), _mm_andnot_si128(gt, m));
+        id = _mm_or_si128(_mm_and_si128(gt, cls), _mm_andnot_si128(gt, id));
+        cls = _mm_add_epi8(cls, one);
+    }
+    _mm_storeu_si128((__m128i*)max_val, _mm_xor_si128(m, vbias));
+    _mm_storeu_si128((__m128i*)max_id, id);
+}
+
+static inline void argmax_block16(const int8_t* src, int class_step, int first_class, int num_planes, int8_t* max_val, uint8_t* max_id)
+{
+    argmax_block16_sse2((const unsigned char*)src, class_step, first_class, num_planes, (unsigned char*)max_val, max_id, 0);
+}
+
+static inline void argmax_block16(const uint8_t* src, int class_step, int first_class, int num_planes, uint8_t* max_val, uint8_t* max_id)
+{
+    argmax_block16_sse2(src, class_step, first_class, num_planes, max_val, max_id, 0x80);
+}
+#endif
+
+template <typename T>
+static inline void argmax_class_planes_8bit(const T* planes, int class_step, int first_class, int num_planes, int width,
+                                            T* max_val, uint8_t* max_id)
+{
+#if defined(DETECT_PP_USE_NEON) || defined(DETECT_PP_USE_SSE2)
+    if (width >= 16) {
+        // 最后一组与前一组重叠，重复比较不改变结果（严格大于才更新）
+        for (int j = 0; j < width; j += 16) {
+            int x = j + 16 <= width ? j : width - 16;
+            argmax_block16(planes + x, class_step, first_class, num_planes, max_val + x, max_id + x);
+        }
+        return;
+    }
+#endif
+    argmax_class_planes_scalar(planes, class_step, first_class, num_planes, width, max_val, max_id);
+}
+
+/**
+ * @brief Channel-major class argmax over consecutive cells of one grid row
+ *
+ * Class planes are class_step elements apart. A cell takes a class only if its
+ * score is strictly greater than the running max, so ties keep the lower class
+ * exactly like the per-cell loop.
+ *
+ * @param planes [in] First class plane at the first cell
+ * @param class_step [in] Elements between class planes (grid_h * grid_w)
+ * @param first_class [in] Class id of the first plane
+ * @param num_planes [in] Number of class planes
+ * @param width [in] Number of cells
+ * @param max_val [out] Running max per cell, initialized by caller
+ * @param max_id [out] Running class id per cell, initialized by caller
+ */
+template <typename T>
+static inline void argmax_class_planes(const T* planes, int class_step, int first_class, int num_planes, int width,
+                                       typename dtype_traits<T>::value_t* max_val, uint8_t* max_id)
+{
+    argmax_class_planes_scalar(planes, class_step, first_class, num_planes, width, max_val, max_id);
+}
+
+static inline void argmax_class_planes(const int8_t* planes, int class_step, int first_class, int num_planes, int width,
+                                       int8_t* max_val, uint8_t* max_id)
+{
+    argmax_class_planes_8bit(planes, class_step, first_class, num_planes, width, max_val, max_id);
+}
+
+static inline void argmax_class_planes(const uint8_t* planes, int class_step, int first_class, int num_planes, int width,
+                                       uint8_t* max_val, uint8_t* max_id)
+{
+    argmax_class_planes_8bit(planes, class_step, first_class, num_planes, width, max_val, max_id);
+}
+
+// 该类型的通道优先argmax是否有SIMD实现
+template <typename T>
+struct argmax_simd {
+    static const bool value = false;
+};
+#if defined(DETECT_PP_USE_NEON) || defined(DETECT_PP_USE_SSE2)
+template <>
+struct argmax_simd<int8_t> {
+    static const bool value = true;
+};
+template <>
+struct argmax_simd<uint8_t> {
+    static const bool value = true;
+};
+#endif
+
+// 取工作区中一行的cols/max_val/max_id缓存，容量在创建时按最宽的grid预留
+static inline int* row_buffers(detect_workspace_t* ws, int grid_w)
+{
+    ws->row_cols.resize(grid_w);
+    ws->row_max.resize(grid_w);
+    ws->row_ids.resize(grid_w);
+    return ws->row_cols.data();
+}
+
+// 把一行中通过门限的cell范围扩展到至少16个，便于整组SIMD处理
+static inline void widen_span(int grid_w, int* begin, int* end)
+{
+    if (*end - *begin < 16 && grid_w >= 16) {
+        *begin = *begin < grid_w - 16 ? *begin : grid_w - 16;
+        *end = *begin + 16;
+    }
+}
+
+// 行带任务的行缓存
+static inline int* band_row_buffers(detect_band_scratch_t* scratch, int grid_w)
+{
+    scratch->row_cols.resize(grid_w);
+    scratch->row_max.resize(grid_w);
+    scratch->row_ids.resize(grid_w);
+    return scratch->row_cols.data();
+}
+
+/**
+ * @brief Queue a branch for parallel decode, split into row bands in the serial visiting order
+ *
+ * Anchors are split into groups of anchors_per_task, the bands of a group follow each
+ * other and groups follow each other, as the serial loops visit them.
+ */
+template <typename Branch>
+static inline void queue_branch(detect_workspace_t* ws, const Branch& br, detect_band_fn run, int num_anchors,
+                                int anchors_per_task, int grid_h, int grid_w)
+{
+    ws->branches.resize(ws->branches.size() + 1);
+    new (ws->branches.back().data) Branch(br);
+    int branch = (int)ws->branches.size() - 1;
+
+    int row_cells = grid_w * anchors_per_task;
+    int band_rows = (ws->band_cells + row_cells - 1) / row_cells;
+    band_rows = band_rows > 0 ? band_rows : 1;
+    for (int a = 0; a < num_anchors; a += anchors_per_task) {
+        for (int row = 0; row < grid_h; row += band_rows) {
+            detect_band_task_t task;
+            task.run = run;
+            task.branch = branch;
+            task.anchor_begin = a;
+            task.anchor_end = a + anchors_per_task;
+            task.row_begin = row;
+            task.row_end = row + band_rows < grid_h ? row + band_rows : grid_h;
+            ws->tasks.push_back(task);
+        }
+    }
+}
+
+static inline void run_band_task(void* arg, int index)
+{
+    detect_workspace_t* ws = (detect_workspace_t*)arg;
+    const detect_band_task_t& task = ws->tasks[index];
+    detect_band_scratch_t* scratch = &ws->band_scratch[index];
+    scratch->cand.boxes.clear();
+    scratch->cand.probs.clear();
+    scratch->cand.class_ids.clear();
+    task.run(ws->branches[task.branch].data, task, scratch);
+}
+
+/**
+ * @brief Decode the queued row bands of the frame on the thread pool and append the candidates to ws->cand
+ *
+ * Called by finalize_detections(), nothing to do after serial decode.
+ *
+ * @param ws [in] Workspace
+ */
+static inline void detect_workspace_run_bands(detect_workspace_t* ws)
+{
+    int num_tasks = (int)ws->tasks.size();
+    if (num_tasks == 0) {
+        return;
+    }
+    if ((int)ws->band_scratch.size() < num_tasks) {
+        ws->band_scratch.resize(num_tasks);
+    }
+    thread_pool_parallel_for(ws->pool, num_tasks, run_band_task, ws);
+
+    // 按任务顺序合并，候选顺序与串行解码相同
+    detect_candidates_t& cand = ws->cand;
+    for (int i = 0; i < num_tasks; i++) {
+        const detect_candidates_t& part = ws->band_scratch[i].cand;
+        cand.boxes.insert(cand.boxes.end(), part.boxes.begin(), part.boxes.end());
+        cand.probs.insert(cand.probs.end(), part.probs.begin(), part.probs.end());
+        cand.class_ids.insert(cand.class_ids.end(), part.class_ids.begin(), part.class_ids.end());
+    }
+    ws->branches.clear();
+    ws->tasks.clear();
+}
+
+template <typename T>
+struct objectness_branch_t {
+    const T* input;
+    int32_t zp;
+    float scale;
+    const detect_lut_t* lut;
+    const int* anchors;
+    int grid_w;
+    int grid_len;
+    int channels;
+    int stride;
+    int num_class;
+    typename dtype_traits<T>::value_t thres_q;
+    float threshold;
+    bool gate_on_score;
+};
+
+template <typename T, typename Layout, typename Head>
+static inline int emit_objectness_cell(const objectness_branch_t<T>& br, int a, int row, int col,
+                                       typename dtype_traits<T>::value_t box_confidence,
+                                       typename dtype_traits<T>::value_t max_class_prob, int max_class_id,
+                                       detect_candidates_t& cand)
+{
+    typedef dtype_traits<T> traits;
+    typedef typename traits::value_t value_t;
+    int p = row * br.grid_w + col;
+    int c0 = a * (5 + br.num_class);
+
+    float score;
+    if (br.gate_on_score) {
+        score = lut_dequantize<T>(br.lut, box_confidence, br.zp, br.scale) * lut_dequantize<T>(br.lut, max_class_prob, br.zp, br.scale);
+        if (!(score > br.threshold)) {
+            return 0;
+        }
+    } else {
+        if (!(max_class_prob > br.thres_q)) {
+            return 0;
+        }
+        score = lut_dequantize<T>(br.lut, max_class_prob, br.zp, br.scale) * lut_dequantize<T>(br.lut, box_confidence, br.zp, br.scale);
+    }
+
+    const T* in = br.input;
+    value_t tw = traits::load(in + Layout::offset(c0 + 2, p, br.channels, br.grid_len));
+    value_t th = traits::load(in + Layout::offset(c0 + 3, p, br.channels, br.grid_len));
+    float box[4];
+    Head::decode(lut_dequantize<T>(br.lut, traits::load(in + Layout::offset(c0 + 0, p, br.channels, br.grid_len)), br.zp, br.scale),
+                 lut_dequantize<T>(br.lut, traits::load(in + Layout::offset(c0 + 1, p, br.channels, br.grid_len)), br.zp, br.scale),
+                 Head::exp_wh ? lut_exp<T>(br.lut, tw, br.zp, br.scale) : lut_dequantize<T>(br.lut, tw, br.zp, br.scale),
+                 Head::exp_wh ? lut_exp<T>(br.lut, th, br.zp, br.scale) : lut_dequantize<T>(br.lut, th, br.zp, br.scale),
+                 col, row, br.stride, br.anchors != NULL ? br.anchors + a * 2 : NULL, box);
+    push_candidate(cand, box, score, max_class_id);
+    return 1;
+}
+
+template <typename T, typename Layout, typename Head>
+static inline int decode_objectness_cell(const objectness_branch_t<T>& br, int a, int row, int col, detect_candidates_t& cand)
+{
+    typedef dtype_traits<T> traits;
+    typedef typename traits::value_t value_t;
+    int p = row * br.grid_w + col;
+    int c0 = a * (5 + br.num_class);
+    const T* in = br.input;
+
+    value_t box_confidence = traits::load(in + Layout::offset(c0 + 4, p, br.channels, br.grid_len));
+    if (!(box_confidence >= br.thres_q)) {
+        return 0;
+    }
+
+    value_t max_class_prob = traits::load(in + Layout::offset(c0 + 5, p, br.channels, br.grid_len));
+    int max_class_id = 0;
+    for (int k = 1; k < br.num_class; ++k) {
+        value_t prob = traits::load(in + Layout::offset(c0 + 5 + k, p, br.channels, br.grid_len));
+        if (prob > max_class_prob) {
+            max_class_id = k;
+            max_class_prob = prob;
+        }
+    }
+    return emit_objectness_cell<T, Layout, Head>(br, a, row, col, box_confidence, max_class_prob, max_class_id, cand);
+}
+
+// 平面布局的一行：先用objectness门限筛选cell，再对通过范围做通道优先的类别argmax
+template <typename T, typename Layout, typename Head>
+static inline int decode_objectness_row(const objectness_branch_t<T>& br, int a, int row, int* cols,
+                                        typename dtype_traits<T>::value_t* max_val, uint8_t* max_id,
+                                        detect_candidates_t& cand)
+{
+    typedef dtype_traits<T> traits;
+    int c0 = a * (5 + br.num_class);
+    const T* conf_row = br.input + Layout::offset(c0 + 4, row * br.grid_w, br.channels, br.grid_len);
+
+    int num_pass = 0;
+    for (int j = 0; j < br.grid_w; j++) {
+        if (traits::load(conf_row + j) >= br.thres_q) {
+            cols[num_pass++] = j;
+        }
+    }
+    if (num_pass == 0) {
+        return 0;
+    }
+
+    int begin = cols[0];
+    int end = cols[num_pass - 1] + 1;
+    widen_span(br.grid_w, &begin, &end);
+    const T* cls_rows = br.input + Layout::offset(c0 + 5, row * br.grid_w + begin, br.channels, br.grid_len);
+    for (int j = 0; j < end - begin; j++) {
+        max_val[j] = traits::load(cls_rows + j);
+        max_id[j] = 0;
+    }
+    argmax_class_planes(cls_rows + br.grid_len, br.grid_len, 1, br.num_class - 1, end - begin, max_val, max_id);
+
+    int valid_count = 0;
+    for (int n = 0; n < num_pass; n++) {
+        int j = cols[n];
+        valid_count += emit_objectness_cell<T, Layout, Head>(br, a, row, j, traits::load(conf_row + j),
+                                                             max_val[j - begin], max_id[j - begin], cand);
+    }
+    return valid_count;
+}
+
+// 有objectness门限时标量的通道优先扫描不如逐cell，只在有SIMD时使用
+template <typename T, typename Layout>
+static inline bool objectness_row_sweep(int num_class)
+{
+    return Layout::planar && argmax_simd<T>::value && num_class < DETECT_ARGMAX_NONE;
+}
+
+// 解码anchor [anchor_begin, anchor_end) 的行 [row_begin, row_end)，遍历顺序与整个分支相同
+template <typename T, typename Layout, typename Head>
+static inline int decode_objectness_band(const objectness_branch_t<T>& br, int anchor_begin, int anchor_end, int row_begin, int row_end,
+                                         int* cols, typename dtype_traits<T>::value_t* max_val, uint8_t* max_id,
+                                         detect_candidates_t& cand)
+{
+    int valid_count = 0;
+    if (objectness_row_sweep<T, Layout>(br.num_class)) {
+        for (int a = anchor_begin; a < anchor_end; a++) {
+            for (int i = row_begin; i < row_end; i++) {
+                valid_count += decode_objectness_row<T, Layout, Head>(br, a, i, cols, max_val, max_id, cand);
+            }
+        }
+    } else if (Layout::anchor_major) {
+        for (int a = anchor_begin; a < anchor_end; a++) {
+            for (int i = row_begin; i < row_end; i++) {
+                for (int j = 0; j < br.grid_w; j++) {
+                    valid_count += decode_objectness_cell<T, Layout, Head>(br, a, i, j, cand);
+                }
+            }
+        }
+    } else {
+        for (int i = row_begin; i < row_end; i++) {
+            for (int j = 0; j < br.grid_w; j++) {
+                for (int a = anchor_begin; a < anchor_end; a++) {
+                    valid_count += decode_objectness_cell<T, Layout, Head>(br, a, i, j, cand);
+                }
+            }
+        }
+    }
+    return valid_count;
+}
+
+template <typename T, typename Layout, typename Head>
+static inline void run_objectness_band(const void* branch, const detect_band_task_t& task, detect_band_scratch_t* scratch)
+{
+    typedef typename dtype_traits<T>::value_t value_t;
+    const objectness_branch_t<T>& br = *(const objectness_branch_t<T>*)branch;
+    int* cols = band_row_buffers(scratch, br.grid_w);
+    decode_objectness_band<T, Layout, Head>(br, task.anchor_begin, task.anchor_end, task.row_begin, task.row_end,
+                                            cols, (value_t*)scratch->row_max.data(), scratch->row_ids.data(), scratch->cand);
+}
+
+/**
+ * @brief Decode one branch of a head with objectness: [x, y, w, h, obj, cls...] per anchor
+ *
+ * A cell passes if obj >= threshold and, depending on gate_on_score, the best
+ * class prob > threshold (both compared quantized) or obj * prob > threshold.
+ *
+ * @param input [in] Branch output tensor
+ * @param zp [in] Zero point of tensor (ignored for float types)
+ * @param scale [in] Scale of tensor (ignored for float types)
+ * @param lut [in] Lookup tables of tensor, NULL: dequantize each value
+ * @param anchors [in] num_anchors (w, h) pairs of this branch, NULL for head_anchor_free
+ * @param num_anchors [in] Anchor number of this branch
+ * @param grid_h [in] Grid height
+ * @param grid_w [in] Grid width
+ * @param stride [in] Branch stride in model input pixels
+ * @param num_class [in] Class number
+ * @param threshold [in] Box threshold
+ * @param gate_on_score [in] false: gate class prob and obj separately; true: gate obj * prob
+ * @param ws [in] Workspace, candidates are appended to ws->cand
+ * @return int Number of candidates appended, 0 if queued for parallel decode (see detect_workspace_set_threads())
+ */
+template <typename T, typename Layout, typename Head>
+int decode_objectness_head(const T* input, int32_t zp, float scale, const detect_lut_t* lut, const int* anchors, int num_anchors,
+                           int grid_h, int grid_w, int stride, int num_class, float threshold, bool gate_on_score,
+                           detect_workspace_t* ws)
+{
+    typedef dtype_traits<T> traits;
+    typedef typename traits::value_t value_t;
+    objectness_branch_t<T> br;
+    br.input = input;
+    br.zp = zp;
+    br.scale = scale;
+    br.lut = lut;
+    br.anchors = anchors;
+    br.grid_w = grid_w;
+    br.grid_len = grid_h * grid_w;
+    br.channels = (5 + num_class) * num_anchors;
+    br.stride = stride;
+    br.num_class = num_class;
+    br.thres_q = traits::quantize(threshold, zp, scale);
+    br.threshold = threshold;
+    br.gate_on_score = gate_on_score;
+
+    // anchor优先遍历时每个anchor单独切行带，否则一个行带包含所有anchor
+    bool anchor_major = objectness_row_sweep<T, Layout>(num_class) || Layout::anchor_major;
+    if (ws->pool != NULL) {
+        queue_branch(ws, br, run_objectness_band<T, Layout, Head>, num_anchors, anchor_major ? 1 : num_anchors, grid_h, grid_w);
+        return 0;
+    }
+    int* cols = NULL;
+    if (objectness_row_sweep<T, Layout>(num_class)) {
+        cols = row_buffers(ws, grid_w);
+    }
+    return decode_objectness_band<T, Layout, Head>(br, 0, num_anchors, 0, grid_h, cols, (value_t*)ws->row_max.data(),
+                                                   ws->row_ids.data(), ws->cand);
+}
+
+/**
+ * @brief Distribution focal loss: expectation of softmax over dfl_len bins for each of 4 sides
+ *
+ */
+static inline void compute_dfl(const float* tensor, int dfl_len, float* box)
+{
+    for (int b = 0; b < 4; b++) {
+        float exp_t[DETECT_DFL_MAX_LEN];
+        float exp_sum = 0;
+        float acc_sum = 0;
+        for (int i = 0; i < dfl_len; i++) {
+            exp_t[i] = exp(tensor[i + b * dfl_len]);
+            exp_sum += exp_t[i];
+        }
+        for (int i = 0; i < dfl_len; i++) {
+            acc_sum += exp_t[i] / exp_sum * i;
+        }
+        box[b] = acc_sum;
+    }
+}
+
+template <typename T>
+struct dfl_branch_t {
+    const T* box_tensor;
+    int32_t box_zp;
+    float box_scale;
+    const detect_lut_t* box_lut;
+    const T* score_tensor;
+    int32_t score_zp;
+    float score_scale;
+    const T* score_sum_tensor;
+    int grid_w;
+    int grid_len;
+    int stride;
+    int dfl_len;
+    int num_class;
+    typename dtype_traits<T>::value_t score_thres;
+    typename dtype_traits<T>::value_t score_sum_thres;
+};
+
+// 分支参数需能放入detect_branch_args_t，value_t最大为float
+typedef char objectness_branch_fits[sizeof(objectness_branch_t<float>) <= sizeof(detect_branch_args_t) ? 1 : -1];
+typedef char dfl_branch_fits[sizeof(dfl_branch_t<float>) <= sizeof(detect_branch_args_t) ? 1 : -1];
+
+// 与compute_dfl()相同，exp直接取自查找表
+template <typename T, typename Layout>
+static inline void compute_dfl_lut(const dfl_branch_t<T>& br, int p, float* box)
+{
+    typedef dtype_traits<T> traits;
+    int box_channels = 4 * br.dfl_len;
+    const float* exp_lut = br.box_lut->exp;
+    for (int b = 0; b < 4; b++) {
+        float exp_t[DETECT_DFL_MAX_LEN];
+        float exp_sum = 0;
+        float acc_sum = 0;
+        for (int i = 0; i < br.dfl_len; i++) {
+            int c = b * br.dfl_len + i;
+            exp_t[i] = exp_lut[traits::lut_index(traits::load(br.box_tensor + Layout::offset(c, p, box_channels, br.grid_len)))];
+            exp_sum += exp_t[i];
+        }
+        for (int i = 0; i < br.dfl_len; i++) {
+            acc_sum += exp_t[i] / exp_sum * i;
+        }
+        box[b] = acc_sum;
+    }
+}
+
+template <typename T, typename Layout>
+static inline void emit_dfl_cell(const dfl_branch_t<T>& br, int row, int col, typename dtype_traits<T>::value_t max_score,
+                                 int max_class_id, detect_candidates_t& cand)
+{
+    typedef dtype_traits<T> traits;
+    int p = row * br.grid_w + col;
+    int box_channels = 4 * br.dfl_len;
+    float box[4];
+    if (br.dfl_len > 1 && traits::quantized && br.box_lut != NULL) {
+        compute_dfl_lut<T, Layout>(br, p, box);
+    } else if (br.dfl_len > 1) {
+        float before_dfl[4 * DETECT_DFL_MAX_LEN];
+        for (int k = 0; k < box_channels; k++) {
+            before_dfl[k] = traits::dequantize(traits::load(br.box_tensor + Layout::offset(k, p, box_channels, br.grid_len)), br.box_zp, br.box_scale);
+        }
+        compute_dfl(before_dfl, br.dfl_len, box);
+    } else {
+        for (int k = 0; k < 4; k++) {
+            box[k] = lut_dequantize<T>(br.box_lut, traits::load(br.box_tensor + Layout::offset(k, p, box_channels, br.grid_len)), br.box_zp, br.box_scale);
+        }
+    }
+
+    float x1, y1, x2, y2;
+    x1 = (-box[0] + col + 0.5) * br.stride;
+    y1 = (-box[1] + row + 0.5) * br.stride;
+    x2 = (box[2] + col + 0.5) * br.stride;
+    y2 = (box[3] + row + 0.5) * br.stride;
+    float xywh[4] = {x1, y1, x2 - x1, y2 - y1};
+    push_candidate(cand, xywh, traits::dequantize(max_score, br.score_zp, br.score_scale), max_class_id);
+}
+
+template <typename T, typename Layout>
+static inline int decode_dfl_cell(const dfl_branch_t<T>& br, int row, int col, detect_candidates_t& cand)
+{
+    typedef dtype_traits<T> traits;
+    typedef typename traits::value_t value_t;
+    int p = row * br.grid_w + col;
+
+    // 通过 score sum 起到快速过滤的作用
+    if (br.score_sum_tensor != NULL &&
+        traits::load(br.score_sum_tensor + Layout::offset(0, p, 1, br.grid_len)) < br.score_sum_thres) {
+        return 0;
+    }
+
+    value_t max_score = traits::score_floor(br.score_zp);
+    int max_class_id = -1;
+    for (int c = 0; c < br.num_class; c++) {
+        value_t score = traits::load(br.score_tensor + Layout::offset(c, p, br.num_class, br.grid_len));
+        if ((score > br.score_thres) && (score > max_score)) {
+            max_score = score;
+            max_class_id = c;
+        }
+    }
+    if (!(max_score > br.score_thres)) {
+        return 0;
+    }
+    emit_dfl_cell<T, Layout>(br, row, col, max_score, max_class_id, cand);
+    return 1;
+}
+
+// 平面布局的一行：score sum 筛选后对通过范围做通道优先的类别argmax
+// 逐cell实现只接受 > 门限且 > 当前最大值的分数，等价于以 max(门限, 初始值) 为起点的严格最大值
+template <typename T, typename Layout>
+static inline int decode_dfl_row(const dfl_branch_t<T>& br, int row, int* cols,
+                                 typename dtype_traits<T>::value_t* max_val, uint8_t* max_id,
+                                 detect_candidates_t& cand)
+{
+    typedef dtype_traits<T> traits;
+    typedef typename traits::value_t value_t;
+    int row_offset = row * br.grid_w;
+
+    int num_pass = 0;
+    if (br.score_sum_tensor != NULL) {
+        for (int j = 0; j < br.grid_w; j++) {
+            if (!(traits::load(br.score_sum_tensor + Layout::offset(0, row_offset + j, 1, br.grid_len)) < br.score_sum_thres)) {
+                cols[num_pass++] = j;
+            }
+        }
+        if (num_pass == 0) {
+            return 0;
+        }
+    } else {
+        for (int j = 0; j < br.grid_w; j++) {
+            cols[num_pass++] = j;
+        }
+    }
+
+    int begin = cols[0];
+    int end = cols[num_pass - 1] + 1;
+    widen_span(br.grid_w, &begin, &end);
+    value_t floor = traits::score_floor(br.score_zp);
+    value_t start = floor > br.score_thres ? floor : br.score_thres;
+    for (int j = 0; j < end - begin; j++) {
+        max_val[j] = start;
+        max_id[j] = DETECT_ARGMAX_NONE;
+    }
+    argmax_class_planes(br.score_tensor + Layout::offset(0, row_offset + begin, br.num_class, br.grid_len), br.grid_len,
+                        0, br.num_class, end - begin, max_val, max_id);
+
+    int valid_count = 0;
+    for (int n = 0; n < num_pass; n++) {
+        int j = cols[n];
+        uint8_t id = max_id[j - begin];
+        // 没有类别超过门限时，只有初始值本身大于门限才保留（与逐cell实现一致）
+        if (id == DETECT_ARGMAX_NONE && !(floor > br.score_thres)) {
+            continue;
+        }
+        emit_dfl_cell<T, Layout>(br, row, j, max_val[j - begin], id == DETECT_ARGMAX_NONE ? -1 : id, cand);
+        valid_count++;
+    }
+    return valid_count;
+}
+
+// 没有score_sum门限时每个cell都要求argmax，标量的通道优先扫描也更快
+template <typename T, typename Layout>
+static inline bool dfl_row_sweep(const dfl_branch_t<T>& br)
+{
+    return Layout::planar && (argmax_simd<T>::value || br.score_sum_tensor == NULL) && br.num_class < DETECT_ARGMAX_NONE;
+}
+
+template <typename T, typename Layout>
+static inline int decode_dfl_band(const dfl_branch_t<T>& br, int row_begin, int row_end, int* cols,
+                                  typename dtype_traits<T>::value_t* max_val, uint8_t* max_id, detect_candidates_t& cand)
+{
+    int valid_count = 0;
+    if (dfl_row_sweep<T, Layout>(br)) {
+        for (int i = row_begin; i < row_end; i++) {
+            valid_count += decode_dfl_row<T, Layout>(br, i, cols, max_val, max_id, cand);
+        }
+    } else {
+        for (int i = row_begin; i < row_end; i++) {
+            for (int j = 0; j < br.grid_w; j++) {
+                valid_count += decode_dfl_cell<T, Layout>(br, i, j, cand);
+            }
+        }
+    }
+    return valid_count;
+}
+
+template <typename T, typename Layout>
+static inline void run_dfl_band(const void* branch, const detect_band_task_t& task, detect_band_scratch_t* scratch)
+{
+    typedef typename dtype_traits<T>::value_t value_t;
+    const dfl_branch_t<T>& br = *(const dfl_branch_t<T>*)branch;
+    int* cols = band_row_buffers(scratch, br.grid_w);
+    decode_dfl_band<T, Layout>(br, task.row_begin, task.row_end, cols, (value_t*)scratch->row_max.data(),
+                               scratch->row_ids.data(), scratch->cand);
+}
+
+/**
+ * @brief Decode one branch of a split box/score head (yolov6, yolov8, ppyoloe)
+ *
+ * The box tensor has 4 * dfl_len channels (ltrb distances, DFL bins if dfl_len > 1),
+ * the score tensor num_class channels and the optional score sum tensor 1 channel.
+ *
+ * @param box_tensor [in] Box tensor
+ * @param box_zp [in] Zero point of box tensor
+ * @param box_scale [in] Scale of box tensor
+ * @param box_lut [in] Lookup tables of box tensor, NULL: dequantize and exp each value
+ * @param score_tensor [in] Class score tensor
+ * @param score_zp [in] Zero point of score tensor
+ * @param score_scale [in] Scale of score tensor
+ * @param score_sum_tensor [in] Score sum tensor for fast rejection, NULL: none
+ * @param score_sum_zp [in] Zero point of score sum tensor
+ * @param score_sum_scale [in] Scale of score sum tensor
+ * @param grid_h [in] Grid height
+ * @param grid_w [in] Grid width
+ * @param stride [in] Branch stride in model input pixels
+ * @param dfl_len [in] DFL bins per side, 1: plain distances
+ * @param num_class [in] Class number
+ * @param threshold [in] Box threshold
+ * @param ws [in] Workspace, candidates are appended to ws->cand
+ * @return int Number of candidates appended, 0 if queued for parallel decode (see detect_workspace_set_threads()), -1: error
+ */
+template <typename T, typename Layout>
+int decode_dfl_head(const T* box_tensor, int32_t box_zp, float box_scale, const detect_lut_t* box_lut,
+                    const T* score_tensor, int32_t score_zp, float score_scale,
+                    const T* score_sum_tensor, int32_t score_sum_zp, float score_sum_scale,
+                    int grid_h, int grid_w, int stride, int dfl_len, int num_class, float threshold,
+                    detect_workspace_t* ws)
+{
+    typedef dtype_traits<T> traits;
+    typedef typename traits::value_t value_t;
+    if (dfl_len < 1 || dfl_len > DETECT_DFL_MAX_LEN) {
+        printf("dfl_len %d not supported\n", dfl_len);
+        return -1;
+    }
+    dfl_branch_t<T> br;
+    br.box_tensor = box_tensor;
+    br.box_zp = box_zp;
+    br.box_scale = box_scale;
+    br.box_lut = box_lut;
+    br.score_tensor = score_tensor;
+    br.score_zp = score_zp;
+    br.score_scale = score_scale;
+    br.score_sum_tensor = score_sum_tensor;
+    br.grid_w = grid_w;
+    br.grid_len = grid_h * grid_w;
+    br.stride = stride;
+    br.dfl_len = dfl_len;
+    br.num_class = num_class;
+    br.score_thres = traits::quantize(threshold, score_zp, score_scale);
+    br.score_sum_thres = traits::quantize(threshold, score_sum_zp, score_sum_scale);
+
+    if (ws->pool != NULL) {
+        queue_branch(ws, br, run_dfl_band<T, Layout>, 1, 1, grid_h, grid_w);
+        return 0;
+    }
+    int* cols = NULL;
+    if (dfl_row_sweep<T, Layout>(br)) {
+        cols = row_buffers(ws, grid_w);
+    }
+    return decode_dfl_band<T, Layout>(br, 0, grid_h, cols, (value_t*)ws->row_max.data(), ws->row_ids.data(), ws->cand);
+}
+
+static inline int clamp(float val, int min, int max) { return val > min ? (val < max ? val : max) : min; }
+
+typedef enum {
+    DETECT_NMS_PER_CLASS = 0,   // 按类别计数排序分桶，每桶内部做NMS
+    DETECT_NMS_CLASS_OFFSET,    // 按类别平移坐标使不同类别不相交，整体做一次NMS
+} detect_nms_mode_t;
+
+// 一个box与[begin, end)中的box求IoU，超过阈值的标记为抑制，重复标记不影响结果
+static inline void nms_suppress_scalar(const nms_boxes_t& b, int i, int begin, int end, float threshold, uint8_t* suppressed)
+{
+    const float x1 = b.x1[i], y1 = b.y1[i], x2 = b.x2[i], y2 = b.y2[i], area = b.area[i];
+    for (int j = begin; j < end; j++) {
+        float w = fmaxf(0.f, fminf(x2, b.x2[j]) - fmaxf(x1, b.x1[j]) + 1.0f);
+        float h = fmaxf(0.f, fminf(y2, b.y2[j]) - fmaxf(y1, b.y1[j]) + 1.0f);
+        float inter = w * h;
+        float uni = area + b.area[j] - inter;
+        if (uni > 0.f && inter > threshold * uni) {
+            suppressed[j] = 1;
+        }
+    }
+}
+
+/**
+ * @brief IoU of box i against boxes [begin, end), set suppressed[j] when IoU > threshold
+ *
+ * Same arithmetic as nms_suppress_scalar() four boxes at a time with NEON or SSE2.
+ * IoU > threshold is tested as inter > threshold * union, without a division.
+ */
+static inline void nms_suppress_row(const nms_boxes_t& b, int i, int begin, int end, float threshold, uint8_t* suppressed)
+{
+#if defined(DETECT_PP_USE_NEON)
+    const float32x4_t x1 = vdupq_n_f32(b.x1[i]), y1 = vdupq_n_f32(b.y1[i]);
+    const float32x4_t x2 = vdupq_n_f32(b.x2[i]), y2 = vdupq_n_f32(b.y2[i]);
+    const float32x4_t area = vdupq_n_f32(b.area[i]), thres = vdupq_n_f32(threshold);
+    const float32x4_t zero = vdupq_n_f32(0.f), one = vdupq_n_f32(1.0f);
+    for (; begin + 4 <= end; begin += 4) {
+        float32x4_t w = vmaxq_f32(zero, vaddq_f32(vsubq_f32(vminq_f32(x2, vld1q_f32(&b.x2[begin])), vmaxq_f32(x1, vld1q_f32(&b.x1[begin]))), one));
+        float32x4_t h = vmaxq_f32(zero, vaddq_f32(vsubq_f32(vminq_f32(y2, vld1q_f32(&b.y2[begin])), vmaxq_f32(y1, vld1q_f32(&b.y1[begin]))), one));
+        float32x4_t inter = vmulq_f32(w, h);
+        float32x4_t uni = vsubq_f32(vaddq_f32(area, vld1q_f32(&b.area[begin])), inter);
+        uint32x4_t hit = vandq_u32(vcgtq_f32(uni, zero), vcgtq_f32(inter, vmulq_f32(thres, uni)));
+        suppressed[begin + 0] |= (uint8_t)(vgetq_lane_u32(hit, 0) & 1);
+        suppressed[begin + 1] |= (uint8_t)(vgetq_lane_u32(hit, 1) & 1);
+        suppressed[begin + 2] |= (uint8_t)(vgetq_lane_u32(hit, 2) & 1);
+        suppressed[begin + 3] |= (uint8_t)(vgetq_lane_u32(hit, 3) & 1);
+    }
+#elif defined(DETECT_PP_USE_SSE2)
+    const __m128 x1 = _mm_set1_ps(b.x1[i]), y1 = _mm_set1_ps(b.y1[i]);
+    const __m128 x2 = _mm_set1_ps(b.x2[i]), y2 = _mm_set1_ps(b.y2[i]);
+    const __m128 area = _mm_set1_ps(b.area[i]), thres = _mm_set1_ps(threshold);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    for (; begin + 4 <= end; begin += 4) {
+        __m128 w = _mm_max_ps(zero, _mm_add_ps(_mm_sub_ps(_mm_min_ps(x2, _mm_loadu_ps(&b.x2[begin])), _mm_max_ps(x1, _mm_loadu_ps(&b.x1[begin]))), one));
+        __m128 h = _mm_max_ps(zero, _mm_add_ps(_mm_sub_ps(_mm_min_ps(y2, _mm_loadu_ps(&b.y2[begin])), _mm_max_ps(y1, _mm_loadu_ps(&b.y1[begin]))), one));
+        __m128 inter = _mm_mul_ps(w, h);
+        __m128 uni = _mm_sub_ps(_mm_add_ps(area, _mm_loadu_ps(&b.area[begin])), inter);
+        int hit = _mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(uni, zero), _mm_cmpgt_ps(inter, _mm_mul_ps(thres, uni))));
+        suppressed[begin + 0] |= (uint8_t)(hit & 1);
+        suppressed[begin + 1] |= (uint8_t)((hit >> 1) & 1);
+        suppressed[begin + 2] |= (uint8_t)((hit >> 2) & 1);
+        suppressed[begin + 3] |= (uint8_t)((hit >> 3) & 1);
+    }
+#endif
+    nms_suppress_scalar(b, i, begin, end, threshold, suppressed);
+}
+
+/**
+ * @brief Greedy NMS over the score sorted candidates of all classes in one pass
+ *
+ * Boxes are gathered once into nms_boxes_t with their areas. DETECT_NMS_PER_CLASS
+ * groups them by class with one counting sort, so a box is only compared with the
+ * lower scored boxes of its own class: O(sum of n_c^2) instead of one O(n^2) walk
+ * per class. DETECT_NMS_CLASS_OFFSET shifts every class into its own disjoint
+ * region and runs one NMS over all boxes; the shift may change IoU by float
+ * rounding, so results can differ from DETECT_NMS_PER_CLASS only for IoU at the
+ * threshold.
+ *
+ * @param valid_count [in] Number of candidates
+ * @param boxes [in] Candidate boxes, x/y/w/h per candidate
+ * @param class_ids [in] Candidate class ids
+ * @param order [in/out] Candidate indices sorted by descending score, suppressed ones set to -1
+ * @param threshold [in] IoU threshold
+ * @param mode [in] DETECT_NMS_PER_CLASS or DETECT_NMS_CLASS_OFFSET
+ * @param b [in] Scratch, detect_workspace_t::nms
+ * @return int number of candidates kept
+ */
+static inline int nms_sorted(int valid_count, const std::vector<float>& boxes, const std::vector<int>& class_ids,
+                             std::vector<int>& order, float threshold, detect_nms_mode_t mode, nms_boxes_t& b)
+{
+    if (valid_count <= 0) {
+        return 0;
+    }
+    int min_id = class_ids[order[0]];
+    int max_id = min_id;
+    for (int r = 1; r < valid_count; r++) {
+        int c = class_ids[order[r]];
+        min_id = c < min_id ? c : min_id;
+        max_id = c > max_id ? c : max_id;
+    }
+    int num_buckets = max_id - min_id + 1;
+
+    b.x1.resize(valid_count);
+    b.y1.resize(valid_count);
+    b.x2.resize(valid_count);
+    b.y2.resize(valid_count);
+    b.area.resize(valid_count);
+    b.rank.resize(valid_count);
+    b.suppressed.assign(valid_count, 0);
+
+    if (mode == DETECT_NMS_PER_CLASS) {
+        // 计数排序：桶内保持分数降序
+        b.bucket_start.assign(num_buckets + 1, 0);
+        for (int r = 0; r < valid_count; r++) {
+            b.bucket_start[class_ids[order[r]] - min_id + 1]++;
+        }
+        for (int k = 0; k < num_buckets; k++) {
+            b.bucket_start[k + 1] += b.bucket_start[k];
+        }
+        b.bucket_fill.assign(b.bucket_start.begin(), b.bucket_start.end() - 1);
+        for (int r = 0; r < valid_count; r++) {
+            b.rank[b.bucket_fill[class_ids[order[r]] - min_id]++] = r;
+        }
+    } else {
+        num_buckets = 1;
+        b.bucket_start.assign(2, 0);
+        b.bucket_start[1] = valid_count;
+        for (int r = 0; r < valid_count; r++) {
+            b.rank[r] = r;
+        }
+    }
+
+    for (int s = 0; s < valid_count; s++) {
+        const float* box = &boxes[order[b.rank[s]] * 4];
+        b.x1[s] = box[0];
+        b.y1[s] = box[1];
+        b.x2[s] = box[0] + box[2];
+        b.y2[s] = box[1] + box[3];
+        b.area[s] = (b.x2[s] - b.x1[s] + 1.0f) * (b.y2[s] - b.y1[s] + 1.0f);
+    }
+
+    if (mode == DETECT_NMS_CLASS_OFFSET) {
+        // 平移量大于所有box的范围加1，保证不同类别的box交集为0
+        float lo = b.x1[0], hi = b.x2[0];
+        for (int s = 0; s < valid_count; s++) {
+            lo = fminf(lo, fminf(b.x1[s], b.y1[s]));
+            hi = fmaxf(hi, fmaxf(b.x2[s], b.y2[s]));
+        }
+        float span = hi - lo + 2.0f;
+        for (int s = 0; s < valid_count; s++) {
+            float offset = (class_ids[order[b.rank[s]]] - min_id) * span;
+            b.x1[s] += offset;
+            b.y1[s] += offset;
+            b.x2[s] += offset;
+            b.y2[s] += offset;
+        }
+    }
+
+    int keep = 0;
+    for (int k = 0; k < num_buckets; k++) {
+        int end = b.bucket_start[k + 1];
+        for (int s = b.bucket_start[k]; s < end; s++) {
+            if (b.suppressed[s]) {
+                order[b.rank[s]] = -1;
+                continue;
+            }
+            keep++;
+            nms_suppress_row(b, s, s + 1, end, threshold, b.suppressed.data());
+        }
+    }
+    return keep;
+}
+
+// 分数降序，分数相同时下标小的在前，保证部分选择与完整排序的结果一致
+struct score_greater {
+    const float* probs;
+    bool operator()(int a, int b) const { return probs[a] > probs[b] || (probs[a] == probs[b] && a < b); }
+};
+
+/**
+ * @brief Order candidates by descending score and keep at most top_k of them
+ *
+ * With more than top_k candidates std::nth_element selects the top_k in O(n)
+ * before std::sort (introsort, O(k log k) worst case) orders them, so crowded
+ * scenes with a low box threshold cannot make the later NMS unbounded.
+ * Equal scores are ordered by candidate index.
+ *
+ * @param probs [in/out] Candidate scores, on return probs[i] is the score of order[i]
+ * @param order [out] Indices of the kept candidates, highest score first
+ * @param top_k [in] Max number of candidates to keep, <= 0 keeps all
+ * @param sorted [in] Scratch, swapped with probs
+ * @return int number of candidates kept
+ */
+static inline int sort_candidates(std::vector<float>& probs, std::vector<int>& order, int top_k, std::vector<float>& sorted)
+{
+    int count = (int)probs.size();
+    order.resize(count);
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    score_greater greater = {probs.data()};
+    if (top_k > 0 && count > top_k) {
+        std::nth_element(order.begin(), order.begin() + top_k, order.end(), greater);
+        order.resize(top_k);
+        count = top_k;
+    }
+    std::sort(order.begin(), order.end(), greater);
+
+    sorted.resize(count);
+    for (int i = 0; i < count; i++) {
+        sorted[i] = probs[order[i]];
+    }
+    probs.swap(sorted);
+    return count;
+}
+
+/**
+ * @brief Keep the top scored candidates, run per-class NMS and write boxes mapped back through the letterbox
+ *
+ * ResultList is the demo's object_detect_result_list (count, results[] of box/prop/cls_id),
+ * at most its capacity of results is written. ws->cand.probs is reordered in place, see sort_candidates().
+ * Row bands queued for parallel decode are decoded first, see detect_workspace_run_bands().
+ *
+ * @param ws [in] Workspace holding the candidates of all branches
+ * @param nms_threshold [in] IoU threshold
+ * @param letter_box [in] Letterbox of model input
+ * @param model_in_w [in] Model input width
+ * @param model_in_h [in] Model input height
+ * @param od_results [out] Detection results
+ * @param pre_nms_top_k [in] Max candidates passed to NMS, <= 0 for no limit
+ * @param nms_mode [in] Per-class buckets (default) or class offset NMS, see nms_sorted()
+ * @return int 0: success
+ */
+template <typename ResultList>
+int finalize_detections(detect_workspace_t* ws, float nms_threshold, const letterbox_t* letter_box,
+                        int model_in_w, int model_in_h, ResultList* od_results, int pre_nms_top_k,
+                        detect_nms_mode_t nms_mode = DETECT_NMS_PER_CLASS)
+{
+    const int max_results = (int)(sizeof(od_results->results) / sizeof(od_results->results[0]));
+    detect_workspace_run_bands(ws);
+    detect_candidates_t& cand = ws->cand;
+    int valid_count = (int)cand.probs.size();
+    od_results->count = 0;
+    if (valid_count <= 0) {
+        return 0;
+    }
+
+    std::vector<int>& index_array = ws->order;
+    valid_count = sort_candidates(cand.probs, index_array, pre_nms_top_k, ws->sorted_probs);
+
+    nms_sorted(valid_count, cand.boxes, cand.class_ids, index_array, nms_threshold, nms_mode, ws->nms);
+
+    int last_count = 0;
+    for (int i = 0; i < valid_count; ++i) {
+        if (index_array[i] == -1 || last_count >= max_results) {
+            continue;
+        }
+        int n = index_array[i];
+
+        float x1 = cand.boxes[n * 4 + 0] - letter_box->x_pad;
+        float y1 = cand.boxes[n * 4 + 1] - letter_box->y_pad;
+        float x2 = x1 + cand.boxes[n * 4 + 2];
+        float y2 = y1 + cand.boxes[n * 4 + 3];
+
+        od_results->results[last_count].box.left = (int)(clamp(x1, 0, model_in_w) / letter_box->scale);
+        od_results->results[last_count].box.top = (int)(clamp(y1, 0, model_in_h) / letter_box->scale);
+        od_results->results[last_count].box.right = (int)(clamp(x2, 0, model_in_w) / letter_box->scale);
+        od_results->results[last_count].box.bottom = (int)(clamp(y2, 0, model_in_h) / letter_box->scale);
+        od_results->results[last_count].prop = cand.probs[i];
+        od_results->results[last_count].cls_id = cand.class_ids[n];
+        last_count++;
+    }
+    od_results->count = last_count;
+    return 0;
+}
+
+/**
+ * @brief Load one label per line
+ *
+ * @param path [in] Label file path
+ * @param labels [out] Label strings, remember call free_label_names() to release after used
+ * @param max_labels [in] Capacity of labels
+ * @return int -1: error; >= 0: label count
+ */
+static inline int load_label_names(const char* path, char* labels[], int max_labels)
+{
+    printf("load label %s\n", path);
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("Open %s fail!\n", path);
+        return -1;
+    }
+    int count = 0;
+    while (count < max_labels) {
+        std::vector<char> line;
+        int ch;
+        while ((ch = fgetc(fp)) != '\n' && ch != EOF) {
+            line.push_back((char)ch);
+        }
+        if (ch == EOF && (line.empty() || ferror(fp))) {
+            break;
+        }
+        char* label = (char*)malloc(line.size() + 1);
+        if (label == NULL) {
+            break;
+        }
+        memcpy(label, line.data(), line.size());
+        label[line.size()] = '\0';
+        labels[count++] = label;
+    }
+    fclose(fp);
+    return count;
+}
+
+/**
+ * @brief Free labels from load_label_names()
+ *
+ * @param labels [in] Label strings, set to NULL after free
+ * @param max_labels [in] Capacity of labels
+ */
+static inline void free_label_names(char* labels[], int max_labels)
+{
+    for (int i = 0; i < max_labels; i++) {
+        if (labels[i] != NULL) {
+            free(labels[i]);
+            labels[i] = NULL;
+        }
+    }
+}
+
+}  // namespace detect_pp
+
+#endif // _RKNN_MODEL_ZOO_DETECT_POSTPROCESS_HPP_
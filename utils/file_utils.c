@@ -1,6 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "file_utils.h"
 
 #define MAX_TEXT_LINE_LENGTH 1024
 
@@ -26,6 +32,49 @@ unsigned char* load_model(const char* filename, int* model_size)
     return model;
 }
 
+int load_model_mapped(const char *path, char **out_data, int flags)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("open %s fail!\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        printf("stat %s fail!\n", path);
+        close(fd);
+        return -1;
+    }
+    int map_flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+    if (flags & MODEL_MAP_POPULATE) {
+        map_flags |= MAP_POPULATE;
+    }
+#endif
+    // 只读私有映射，数据直接来自页缓存，不再额外复制一份到堆上
+    void *data = mmap(NULL, st.st_size, PROT_READ, map_flags, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("mmap %s fail!\n", path);
+        return -1;
+    }
+    if (flags & MODEL_MAP_SEQUENTIAL) {
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+    }
+    if (flags & MODEL_MAP_WILLNEED) {
+        madvise(data, st.st_size, MADV_WILLNEED);
+    }
+    *out_data = (char *)data;
+    return (int)st.st_size;
+}
+
+void unload_model_mapped(char *data, int size)
+{
+    if (data != NULL && size > 0) {
+        munmap(data, size);
+    }
+}
+
 int read_data_from_file(const char *path, char **out_data)
 {
     FILE *fp = fopen(path, "rb");
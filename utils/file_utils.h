@@ -14,6 +14,30 @@ extern "C" {
  */
 int read_data_from_file(const char *path, char **out_data);
 
+#define MODEL_MAP_POPULATE      0x1     // prefault all pages while mapping (MAP_POPULATE)
+#define MODEL_MAP_SEQUENTIAL    0x2     // madvise(MADV_SEQUENTIAL), model is read once from start to end
+#define MODEL_MAP_WILLNEED      0x4     // madvise(MADV_WILLNEED), start asynchronous read ahead
+
+/**
+ * @brief Map model file read-only into memory instead of reading it into a heap buffer
+ * 
+ * The mapping shares pages with the page cache, so the model is not held twice while rknn_init copies it.
+ * 
+ * @param path [in] File path
+ * @param out_data [out] Mapped data, remember call unload_model_mapped() to release after used
+ * @param flags [in] MODEL_MAP_* hints, 0: none
+ * @return int -1: error; > 0: Mapped data size
+ */
+int load_model_mapped(const char *path, char **out_data, int flags);
+
+/**
+ * @brief Unmap model file mapped by load_model_mapped()
+ * 
+ * @param data [in] Mapped data
+ * @param size [in] Mapped data size
+ */
+void unload_model_mapped(char *data, int size);
+
 /**
  * @brief Write data to file
  * 
@@ -2,6 +2,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+#if defined(__ARM_NEON) && !defined(IMAGE_UTILS_DISABLE_SIMD)
+#include <arm_neon.h>
+#endif
 
 #include "image_drawing.h"
 #include "font.h"
@@ -24,7 +29,7 @@ static unsigned int convert_color(unsigned int src_color, image_format_t dst_fmt
     switch (dst_fmt)
     {
     case IMAGE_FORMAT_GRAY8:
-        p_dst_color[0] = a;
+        p_dst_color[0] = 0.299 * r + 0.587 * g + 0.114 * b;
         break;
     case IMAGE_FORMAT_RGB888:
         p_dst_color[0] = r;
@@ -53,11 +58,33 @@ static unsigned int convert_color(unsigned int src_color, image_format_t dst_fmt
     return dst_color;
 }
 
-static void draw_rectangle_c1(unsigned char* pixels, int w, int h, int rx, int ry, int rw, int rh, unsigned int color,
+// 每行字节数，width_stride为0时按紧密排列
+static int get_row_stride(const image_buffer_t* image)
+{
+    int width_stride = image->width_stride > image->width ? image->width_stride : image->width;
+    switch (image->format)
+    {
+    case IMAGE_FORMAT_RGB888:
+        return width_stride * 3;
+    case IMAGE_FORMAT_RGBA8888:
+        return width_stride * 4;
+    default:
+        // GRAY8及yuv420sp的Y、UV平面
+        return width_stride;
+    }
+}
+
+// UV平面位于height_stride行Y平面之后
+static unsigned char* get_uv_plane(const image_buffer_t* image)
+{
+    int height_stride = image->height_stride > image->height ? image->height_stride : image->height;
+    return image->virt_addr + (size_t)get_row_stride(image) * height_stride;
+}
+
+static void draw_rectangle_c1(unsigned char* pixels, int w, int h, int stride, int rx, int ry, int rw, int rh, unsigned int color,
                               int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w;
 
     if (thickness == -1) {
         // filled
@@ -176,11 +203,10 @@ static void draw_rectangle_c1(unsigned char* pixels, int w, int h, int rx, int r
     }
 }
 
-static void draw_rectangle_c2(unsigned char* pixels, int w, int h, int rx, int ry, int rw, int rh, unsigned int color,
+static void draw_rectangle_c2(unsigned char* pixels, int w, int h, int stride, int rx, int ry, int rw, int rh, unsigned int color,
                               int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 2;
 
     if (thickness == -1) {
         // filled
@@ -304,11 +330,10 @@ static void draw_rectangle_c2(unsigned char* pixels, int w, int h, int rx, int r
     }
 }
 
-static void draw_rectangle_c3(unsigned char* pixels, int w, int h, int rx, int ry, int rw, int rh, unsigned int color,
+static void draw_rectangle_c3(unsigned char* pixels, int w, int h, int stride, int rx, int ry, int rw, int rh, unsigned int color,
                               int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 3;
 
     if (thickness == -1) {
         // filled
@@ -437,11 +462,10 @@ static void draw_rectangle_c3(unsigned char* pixels, int w, int h, int rx, int r
     }
 }
 
-static void draw_rectangle_c4(unsigned char* pixels, int w, int h, int rx, int ry, int rw, int rh, unsigned int color,
+static void draw_rectangle_c4(unsigned char* pixels, int w, int h, int stride, int rx, int ry, int rw, int rh, unsigned int color,
                               int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 4;
 
     if (thickness == -1) {
         // filled
@@ -575,7 +599,7 @@ static void draw_rectangle_c4(unsigned char* pixels, int w, int h, int rx, int r
     }
 }
 
-static void draw_rectangle_yuv420sp(unsigned char* yuv420sp, int w, int h, int rx, int ry, int rw, int rh,
+static void draw_rectangle_yuv420sp(unsigned char* Y, unsigned char* UV, int w, int h, int stride, int rx, int ry, int rw, int rh,
                                     unsigned int color, int thickness)
 {
     // assert w % 2 == 0
@@ -596,287 +620,287 @@ static void draw_rectangle_yuv420sp(unsigned char* yuv420sp, int w, int h, int r
     pen_color_uv[0] = pen_color[1];
     pen_color_uv[1] = pen_color[2];
 
-    unsigned char* Y = yuv420sp;
-    draw_rectangle_c1(Y, w, h, rx, ry, rw, rh, v_y, thickness);
+    draw_rectangle_c1(Y, w, h, stride, rx, ry, rw, rh, v_y, thickness);
 
-    unsigned char* UV = yuv420sp + w * h;
     int thickness_uv = thickness == -1 ? thickness : max(thickness / 2, 1);
-    draw_rectangle_c2(UV, w / 2, h / 2, rx / 2, ry / 2, rw / 2, rh / 2, v_uv, thickness_uv);
+    draw_rectangle_c2(UV, w / 2, h / 2, stride, rx / 2, ry / 2, rw / 2, rh / 2, v_uv, thickness_uv);
 }
 
-static inline int distance_lessequal(int x0, int y0, int x1, int y1, float r)
+// 连续填充count个像素
+static void fill_span(unsigned char* p, int count, int channel, const unsigned char* pen_color)
 {
-    int dx = x0 - x1;
-    int dy = y0 - y1;
-    int q = dx * dx + dy * dy;
-    return q <= r * r;
+    if (channel == 1) {
+        memset(p, pen_color[0], count);
+        return;
+    }
+    for (int k = 0; k < count; k++) {
+        for (int c = 0; c < channel; c++) {
+            p[k * channel + c] = pen_color[c];
+        }
+    }
 }
 
-static inline int distance_inrange(int x0, int y0, int x1, int y1, float r0, float r1)
+// 填充第y行[x0, x1)与图像的交集
+static void fill_row_clip(unsigned char* pixels, int w, int stride, int channel, int y, int x0, int x1,
+                          const unsigned char* pen_color)
 {
-    int dx = x0 - x1;
-    int dy = y0 - y1;
-    int q = dx * dx + dy * dy;
-    return q >= r0 * r0 && q < r1 * r1;
+    x0 = max(x0, 0);
+    x1 = min(x1, w);
+    if (x0 < x1) {
+        fill_span(pixels + (size_t)stride * y + x0 * channel, x1 - x0, channel, pen_color);
+    }
 }
 
-static void draw_circle_c1(unsigned char* pixels, int w, int h, int cx, int cy, int radius, unsigned int color,
-                           int thickness)
+static inline int ceil_to_int(float v)
 {
-    const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w;
-
-    if (thickness == -1) {
-        // filled
-        for (int y = cy - (radius - 1); y < cy + radius; y++) {
-            if (y < 0)
-                continue;
-
-            if (y >= h)
-                break;
-
-            unsigned char* p = pixels + stride * y;
+    return (int)ceilf(v);
+}
 
-            for (int x = cx - (radius - 1); x < cx + radius; x++) {
-                if (x < 0)
-                    continue;
+// 不超过sqrt(v)的最大整数，v < 0时返回-1
+static int isqrt(int v)
+{
+    if (v < 0) {
+        return -1;
+    }
+    int s = (int)sqrt((double)v);
+    while (s * s > v) {
+        s--;
+    }
+    while ((s + 1) * (s + 1) <= v) {
+        s++;
+    }
+    return s;
+}
 
-                if (x >= w)
-                    break;
+/*
+ * 扫描线多边形填充：在像素(x, y)处采样，按偶奇规则判断，边界左、上包含，右、下不包含，
+ * 因此轴对齐矩形(rx, ry)-(rx + rw, ry + rh)正好覆盖rw x rh个像素。
+ * 每行只求与各边的交点再整段填充，耗时与面积和行数成正比。
+ */
+static void fill_polygon_cn(unsigned char* pixels, int w, int h, int stride, int channel, const float* px,
+                            const float* py, int n, float* crossings, const unsigned char* pen_color)
+{
+    if (n < 3) {
+        return;
+    }
+    float y_min = py[0];
+    float y_max = py[0];
+    for (int i = 1; i < n; i++) {
+        y_min = min(y_min, py[i]);
+        y_max = max(y_max, py[i]);
+    }
 
-                // distance from cx cy
-                if (distance_lessequal(x, y, cx, cy, radius)) {
-                    p[x] = pen_color[0];
+    int y_begin = max(ceil_to_int(y_min), 0);
+    int y_end = min(ceil_to_int(y_max), h);
+    for (int y = y_begin; y < y_end; y++) {
+        int m = 0;
+        for (int i = 0; i < n; i++) {
+            int j = i + 1 < n ? i + 1 : 0;
+            float ya = py[i];
+            float yb = py[j];
+            if ((ya <= y && y < yb) || (yb <= y && y < ya)) {
+                float x = px[i] + (y - ya) * (px[j] - px[i]) / (yb - ya);
+                // 交点很少，插入排序
+                int k = m++;
+                while (k > 0 && crossings[k - 1] > x) {
+                    crossings[k] = crossings[k - 1];
+                    k--;
                 }
+                crossings[k] = x;
             }
         }
+        for (int k = 0; k + 1 < m; k += 2) {
+            fill_row_clip(pixels, w, stride, channel, y, ceil_to_int(crossings[k]), ceil_to_int(crossings[k + 1]),
+                          pen_color);
+        }
+    }
+}
 
+// 线段向两侧各扩展thickness / 2的四边形，square_cap为1时两端也各延长thickness / 2
+static void draw_segment_cn(unsigned char* pixels, int w, int h, int stride, int channel, float x0, float y0,
+                            float x1, float y1, float thickness, int square_cap, const unsigned char* pen_color)
+{
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float len = sqrtf(dx * dx + dy * dy);
+    float hw = thickness / 2.f;
+    if (hw <= 0) {
         return;
     }
+    if (len > 0) {
+        dx /= len;
+        dy /= len;
+    } else if (square_cap) {
+        dx = 1;
+        dy = 0;
+    } else {
+        return;
+    }
+    float ex = square_cap ? dx * hw : 0;
+    float ey = square_cap ? dy * hw : 0;
+    float nx = -dy * hw;
+    float ny = dx * hw;
+
+    float px[4] = {x0 - ex + nx, x1 + ex + nx, x1 + ex - nx, x0 - ex - nx};
+    float py[4] = {y0 - ey + ny, y1 + ey + ny, y1 + ey - ny, y0 - ey - ny};
+    float crossings[4];
+    fill_polygon_cn(pixels, w, h, stride, channel, px, py, 4, crossings, pen_color);
+}
 
-    const float t0 = thickness / 2.f;
-    const float t1 = thickness - t0;
-
-    for (int y = cy - (radius - 1) - t0; y < cy + radius + t1; y++) {
-        if (y < 0)
-            continue;
+static void draw_line_cn(unsigned char* pixels, int w, int h, int stride, int channel, int x0, int y0, int x1, int y1,
+                         unsigned int color, int thickness)
+{
+    const unsigned char* pen_color = (const unsigned char*)&color;
+    draw_segment_cn(pixels, w, h, stride, channel, x0, y0, x1, y1, thickness, 0, pen_color);
+}
 
-        if (y >= h)
-            break;
+static void draw_line_yuv420sp(unsigned char* Y, unsigned char* UV, int w, int h, int stride, int x0, int y0, int x1, int y1,
+                               unsigned int color, int thickness)
+{
+    // assert w % 2 == 0
+    // assert h % 2 == 0
+    // assert x0 % 2 == 0
+    // assert y0 % 2 == 0
+    // assert x1 % 2 == 0
+    // assert y1 % 2 == 0
+    // assert thickness % 2 == 0
 
-        unsigned char* p = pixels + stride * y;
+    const unsigned char* pen_color = (const unsigned char*)&color;
 
-        for (int x = cx - (radius - 1) - t0; x < cx + radius + t1; x++) {
-            if (x < 0)
-                continue;
+    unsigned int v_y;
+    unsigned int v_uv;
+    unsigned char* pen_color_y = (unsigned char*)&v_y;
+    unsigned char* pen_color_uv = (unsigned char*)&v_uv;
+    pen_color_y[0] = pen_color[0];
+    pen_color_uv[0] = pen_color[1];
+    pen_color_uv[1] = pen_color[2];
 
-            if (x >= w)
-                break;
+    draw_line_cn(Y, w, h, stride, 1, x0, y0, x1, y1, v_y, thickness);
 
-            // distance from cx cy
-            if (distance_inrange(x, y, cx, cy, radius - t0, radius + t1)) {
-                p[x] = pen_color[0];
-            }
-        }
-    }
+    int thickness_uv = thickness == -1 ? thickness : max(thickness / 2, 1);
+    draw_line_cn(UV, w / 2, h / 2, stride, 2, x0 / 2, y0 / 2, x1 / 2, y1 / 2, v_uv, thickness_uv);
 }
 
-static void draw_circle_c2(unsigned char* pixels, int w, int h, int cx, int cy, int radius, unsigned int color,
-                           int thickness)
+// points为x0 y0 x1 y1 ...，scale为坐标缩小倍数（yuv420sp的UV平面为2）
+static void draw_polygon_cn(unsigned char* pixels, int w, int h, int stride, int channel, const int* points,
+                            int num_points, int scale, unsigned int color, int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 2;
-
-    if (thickness == -1) {
-        // filled
-        for (int y = cy - (radius - 1); y < cy + radius; y++) {
-            if (y < 0)
-                continue;
+    if (num_points < 1) {
+        return;
+    }
 
-            if (y >= h)
+    if (thickness != -1) {
+        // 每条边画成两端延长的粗线段，相邻边在顶点处补齐成直角
+        for (int i = 0; i < num_points; i++) {
+            int j = i + 1 < num_points ? i + 1 : 0;
+            if (num_points == 2 && j == 0) {
                 break;
-
-            unsigned char* p = pixels + stride * y;
-
-            for (int x = cx - (radius - 1); x < cx + radius; x++) {
-                if (x < 0)
-                    continue;
-
-                if (x >= w)
-                    break;
-
-                // distance from cx cy
-                if (distance_lessequal(x, y, cx, cy, radius)) {
-                    p[x * 2 + 0] = pen_color[0];
-                    p[x * 2 + 1] = pen_color[1];
-                }
             }
+            draw_segment_cn(pixels, w, h, stride, channel, points[i * 2] / scale, points[i * 2 + 1] / scale,
+                            points[j * 2] / scale, points[j * 2 + 1] / scale, thickness, 1, pen_color);
         }
-
         return;
     }
 
-    const float t0 = thickness / 2.f;
-    const float t1 = thickness - t0;
-
-    for (int y = cy - radius - t0; y < cy + radius + t1; y++) {
-        if (y < 0)
-            continue;
-
-        if (y >= h)
-            break;
-
-        unsigned char* p = pixels + stride * y;
-
-        for (int x = cx - radius - t0; x < cx + radius + t1; x++) {
-            if (x < 0)
-                continue;
-
-            if (x >= w)
-                break;
-
-            // distance from cx cy
-            if (distance_inrange(x, y, cx, cy, radius - t0, radius + t1)) {
-                p[x * 2 + 0] = pen_color[0];
-                p[x * 2 + 1] = pen_color[1];
-            }
+    float stack_buf[3 * 16];
+    float* buf = stack_buf;
+    if (num_points > 16) {
+        buf = (float*)malloc(3 * num_points * sizeof(float));
+        if (buf == NULL) {
+            printf("draw_polygon: malloc fail\n");
+            return;
         }
     }
+    float* px = buf;
+    float* py = buf + num_points;
+    for (int i = 0; i < num_points; i++) {
+        px[i] = points[i * 2] / scale;
+        py[i] = points[i * 2 + 1] / scale;
+    }
+    fill_polygon_cn(pixels, w, h, stride, channel, px, py, num_points, buf + 2 * num_points, pen_color);
+    if (buf != stack_buf) {
+        free(buf);
+    }
 }
 
-static void draw_circle_c3(unsigned char* pixels, int w, int h, int cx, int cy, int radius, unsigned int color,
-                           int thickness)
+static void draw_polygon_yuv420sp(unsigned char* Y, unsigned char* UV, int w, int h, int stride, const int* points,
+                                  int num_points, unsigned int color, int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 3;
-
-    if (thickness == -1) {
-        // filled
-        for (int y = cy - (radius - 1); y < cy + radius; y++) {
-            if (y < 0)
-                continue;
-
-            if (y >= h)
-                break;
-
-            unsigned char* p = pixels + stride * y;
-
-            for (int x = cx - (radius - 1); x < cx + radius; x++) {
-                if (x < 0)
-                    continue;
-
-                if (x >= w)
-                    break;
-
-                // distance from cx cy
-                if (distance_lessequal(x, y, cx, cy, radius)) {
-                    p[x * 3 + 0] = pen_color[0];
-                    p[x * 3 + 1] = pen_color[1];
-                    p[x * 3 + 2] = pen_color[2];
-                }
-            }
-        }
-
-        return;
-    }
-
-    const float t0 = thickness / 2.f;
-    const float t1 = thickness - t0;
-
-    for (int y = cy - radius - t0; y < cy + radius + t1; y++) {
-        if (y < 0)
-            continue;
-
-        if (y >= h)
-            break;
-
-        unsigned char* p = pixels + stride * y;
 
-        for (int x = cx - radius - t0; x < cx + radius + t1; x++) {
-            if (x < 0)
-                continue;
+    unsigned int v_y;
+    unsigned int v_uv;
+    unsigned char* pen_color_y = (unsigned char*)&v_y;
+    unsigned char* pen_color_uv = (unsigned char*)&v_uv;
+    pen_color_y[0] = pen_color[0];
+    pen_color_uv[0] = pen_color[1];
+    pen_color_uv[1] = pen_color[2];
 
-            if (x >= w)
-                break;
+    draw_polygon_cn(Y, w, h, stride, 1, points, num_points, 1, v_y, thickness);
 
-            // distance from cx cy
-            if (distance_inrange(x, y, cx, cy, radius - t0, radius + t1)) {
-                p[x * 3 + 0] = pen_color[0];
-                p[x * 3 + 1] = pen_color[1];
-                p[x * 3 + 2] = pen_color[2];
-            }
-        }
-    }
+    int thickness_uv = thickness == -1 ? thickness : max(thickness / 2, 1);
+    draw_polygon_cn(UV, w / 2, h / 2, stride, 2, points, num_points, 2, v_uv, thickness_uv);
 }
 
-static void draw_circle_c4(unsigned char* pixels, int w, int h, int cx, int cy, int radius, unsigned int color,
-                           int thickness)
+/*
+ * 逐行求圆或圆环与该行相交的区间后整段填充，覆盖的像素与逐点判断
+ * dx * dx + dy * dy <= radius * radius（实心）或落在[radius - t0, radius + t1)内（圆环）相同。
+ */
+static void draw_circle_cn(unsigned char* pixels, int w, int h, int stride, int channel, int cx, int cy, int radius,
+                           unsigned int color, int thickness)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 4;
 
     if (thickness == -1) {
         // filled
-        for (int y = cy - (radius - 1); y < cy + radius; y++) {
-            if (y < 0)
-                continue;
-
-            if (y >= h)
-                break;
-
-            unsigned char* p = pixels + stride * y;
-
-            for (int x = cx - (radius - 1); x < cx + radius; x++) {
-                if (x < 0)
-                    continue;
-
-                if (x >= w)
-                    break;
-
-                // distance from cx cy
-                if (distance_lessequal(x, y, cx, cy, radius)) {
-                    p[x * 4 + 0] = pen_color[0];
-                    p[x * 4 + 1] = pen_color[1];
-                    p[x * 4 + 2] = pen_color[2];
-                    p[x * 4 + 3] = pen_color[3];
-                }
+        int y_begin = max(cy - (radius - 1), 0);
+        int y_end = min(cy + radius, h);
+        for (int y = y_begin; y < y_end; y++) {
+            int dy = y - cy;
+            int dx = min(isqrt(radius * radius - dy * dy), radius - 1);
+            if (dx >= 0) {
+                fill_row_clip(pixels, w, stride, channel, y, cx - dx, cx + dx + 1, pen_color);
             }
         }
-
         return;
     }
 
     const float t0 = thickness / 2.f;
     const float t1 = thickness - t0;
-
-    for (int y = cy - (radius - 1) - t0; y < cy + radius + t1; y++) {
-        if (y < 0)
+    const float r0 = radius - t0;
+    const float r1 = radius + t1;
+
+    // 满足q >= r0 * r0且q < r1 * r1的整数距离平方q为[q_min, q_end)
+    int q_min = max(ceil_to_int(r0 * r0), 0);
+    int q_end = ceil_to_int(r1 * r1);
+
+    // 与逐点判断时的遍历范围一致
+    int x_begin = cx - (radius - 1) - t0;
+    int x_end = ceil_to_int(cx + radius + t1);
+    int y_begin = cy - (radius - 1) - t0;
+    int y_end = ceil_to_int(cy + radius + t1);
+    y_begin = max(y_begin, 0);
+    y_end = min(y_end, h);
+    for (int y = y_begin; y < y_end; y++) {
+        int dy = y - cy;
+        int dx_outer = isqrt(q_end - 1 - dy * dy);
+        if (dx_outer < 0) {
             continue;
-
-        if (y >= h)
-            break;
-
-        unsigned char* p = pixels + stride * y;
-
-        for (int x = cx - (radius - 1) - t0; x < cx + radius + t1; x++) {
-            if (x < 0)
-                continue;
-
-            if (x >= w)
-                break;
-
-            // distance from cx cy
-            if (distance_inrange(x, y, cx, cy, radius - t0, radius + t1)) {
-                p[x * 4 + 0] = pen_color[0];
-                p[x * 4 + 1] = pen_color[1];
-                p[x * 4 + 2] = pen_color[2];
-                p[x * 4 + 3] = pen_color[3];
-            }
+        }
+        int dx_inner = isqrt(q_min - 1 - dy * dy);
+        int x0 = max(cx - dx_outer, x_begin);
+        int x1 = min(cx + dx_outer + 1, x_end);
+        if (dx_inner < 0) {
+            fill_row_clip(pixels, w, stride, channel, y, x0, x1, pen_color);
+        } else {
+            fill_row_clip(pixels, w, stride, channel, y, x0, min(cx - dx_inner, x1), pen_color);
+            fill_row_clip(pixels, w, stride, channel, y, max(cx + dx_inner + 1, x0), x1, pen_color);
         }
     }
 }
 
-static void draw_circle_yuv420sp(unsigned char* yuv420sp, int w, int h, int cx, int cy, int radius, unsigned int color,
+static void draw_circle_yuv420sp(unsigned char* Y, unsigned char* UV, int w, int h, int stride, int cx, int cy, int radius, unsigned int color,
                                  int thickness)
 {
     // assert w % 2 == 0
@@ -896,516 +920,332 @@ static void draw_circle_yuv420sp(unsigned char* yuv420sp, int w, int h, int cx,
     pen_color_uv[0] = pen_color[1];
     pen_color_uv[1] = pen_color[2];
 
-    unsigned char* Y = yuv420sp;
-    draw_circle_c1(Y, w, h, cx, cy, radius, v_y, thickness);
+    draw_circle_cn(Y, w, h, stride, 1, cx, cy, radius, v_y, thickness);
 
-    unsigned char* UV = yuv420sp + w * h;
     int thickness_uv = thickness == -1 ? thickness : max(thickness / 2, 1);
-    draw_circle_c2(UV, w / 2, h / 2, cx / 2, cy / 2, radius / 2, v_uv, thickness_uv);
+    draw_circle_cn(UV, w / 2, h / 2, stride, 2, cx / 2, cy / 2, radius / 2, v_uv, thickness_uv);
 }
 
-static inline int distance_lessthan(int x, int y, int x0, int y0, int x1, int y1, float t)
+static void get_text_drawing_size(const char* text, int fontpixelsize, int* w, int* h)
 {
-    int dx01 = x1 - x0;
-    int dy01 = y1 - y0;
-    int dx0 = x - x0;
-    int dy0 = y - y0;
-
-    float r = (float)(dx0 * dx01 + dy0 * dy01) / (dx01 * dx01 + dy01 * dy01);
-
-    if (r < 0 || r > 1)
-        return 0;
-
-    float px = x0 + dx01 * r;
-    float py = y0 + dy01 * r;
-    float dx = x - px;
-    float dy = y - py;
-    float p = dx * dx + dy * dy;
-    return p < t;
-}
+    *w = 0;
+    *h = 0;
 
-static void draw_line_c1(unsigned char* pixels, int w, int h, int x0, int y0, int x1, int y1, unsigned int color,
-                         int thickness)
-{
-    const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w;
+    const int n = strlen(text);
 
-    const float t0 = thickness / 2.f;
-    const float t1 = thickness - t0;
+    int line_w = 0;
+    for (int i = 0; i < n; i++) {
+        char ch = text[i];
 
-    int x_min = min(x0, x1);
-    int x_max = max(x0, x1);
-    int y_min = min(y0, y1);
-    int y_max = max(y0, y1);
+        if (ch == '\n') {
+            // newline
+            *w = max(*w, line_w);
+            *h += fontpixelsize * 2;
+            line_w = 0;
+        }
 
-    for (int y = y_min - t0; y < y_max + t1; y++) {
-        if (y < 0)
-            continue;
+        if (isprint(ch) != 0) {
+            line_w += fontpixelsize;
+        }
+    }
 
-        if (y >= h)
-            break;
+    *w = max(*w, line_w);
+    *h += fontpixelsize * 2;
+}
 
-        unsigned char* p = pixels + stride * y;
+static int resize_bilinear_c1(const unsigned char* src_pixels, int w, int h, unsigned char* dst_pixels, int w2, int h2)
+{
+    int A, B, C, D, x, y, index, gray;
+    float x_ratio = ((float)(w - 1)) / w2;
+    float y_ratio = ((float)(h - 1)) / h2;
+    float x_diff, y_diff, ya, yb;
+    int offset = 0;
+    for (int i = 0; i < h2; i++) {
+        for (int j = 0; j < w2; j++) {
+            x = (int)(x_ratio * j);
+            y = (int)(y_ratio * i);
+            x_diff = (x_ratio * j) - x;
+            y_diff = (y_ratio * i) - y;
+            index = y * w + x;
 
-        for (int x = x_min - t0; x < x_max + t1; x++) {
-            if (x < 0)
-                continue;
+            // range is 0 to 255 thus bitwise AND with 0xff
+            A = src_pixels[index] & 0xff;
+            B = src_pixels[index + 1] & 0xff;
+            C = src_pixels[index + w] & 0xff;
+            D = src_pixels[index + w + 1] & 0xff;
 
-            if (x >= w)
-                break;
+            // Y = A(1-w)(1-h) + B(w)(1-h) + C(h)(1-w) + Dwh
+            gray = (int)(A * (1 - x_diff) * (1 - y_diff) + B * (x_diff) * (1 - y_diff) + C * (y_diff) * (1 - x_diff) +
+                         D * (x_diff * y_diff));
 
-            // distance from line
-            if (distance_lessthan(x, y, x0, y0, x1, y1, t1)) {
-                p[x] = pen_color[0];
-            }
+            dst_pixels[offset++] = gray;
         }
     }
+    return 0;
 }
 
-static void draw_line_c2(unsigned char* pixels, int w, int h, int x0, int y0, int x1, int y1, unsigned int color,
-                         int thickness)
-{
-    const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 2;
-
-    const float t0 = thickness / 2.f;
-    const float t1 = thickness - t0;
+#define GLYPH_COUNT 95
+#define GLYPH_ATLAS_MAX_SIZES 16
 
-    int x_min = min(x0, x1);
-    int x_max = max(x0, x1);
-    int y_min = min(y0, y1);
-    int y_max = max(y0, y1);
+// 每种字号的全部可打印字符预先缩放好，字符i位于bitmap + i * size * size * 2
+typedef struct {
+    int size;
+    unsigned char* bitmap;
+} glyph_atlas_t;
 
-    for (int y = y_min - t0; y < y_max + t1; y++) {
-        if (y < 0)
-            continue;
+static glyph_atlas_t g_glyph_atlas[GLYPH_ATLAS_MAX_SIZES];
+static int g_num_glyph_atlas = 0;
+static pthread_mutex_t g_glyph_atlas_lock = PTHREAD_MUTEX_INITIALIZER;
 
-        if (y >= h)
-            break;
-
-        unsigned char* p = pixels + stride * y;
-
-        for (int x = x_min - t0; x < x_max + t1; x++) {
-            if (x < 0)
-                continue;
-
-            if (x >= w)
-                break;
-
-            // distance from line
-            if (distance_lessthan(x, y, x0, y0, x1, y1, t1)) {
-                p[x * 2 + 0] = pen_color[0];
-                p[x * 2 + 1] = pen_color[1];
-            }
-        }
+static unsigned char* create_glyph_bitmap(int fontpixelsize)
+{
+    int glyph_size = fontpixelsize * fontpixelsize * 2;
+    unsigned char* bitmap = (unsigned char*)malloc((size_t)GLYPH_COUNT * glyph_size);
+    if (bitmap == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        resize_bilinear_c1(mono_font_data[i], 20, 40, bitmap + (size_t)i * glyph_size, fontpixelsize, fontpixelsize * 2);
     }
+    return bitmap;
 }
 
-static void draw_line_c3(unsigned char* pixels, int w, int h, int x0, int y0, int x1, int y1, unsigned int color,
-                         int thickness)
+// 返回字号对应的字形表，缓存已满时临时生成，*owned为1时调用者负责释放
+static const unsigned char* acquire_glyph_atlas(int fontpixelsize, int* owned)
 {
-    const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 3;
-
-    const float t0 = thickness / 2.f;
-    const float t1 = thickness - t0;
-
-    int x_min = min(x0, x1);
-    int x_max = max(x0, x1);
-    int y_min = min(y0, y1);
-    int y_max = max(y0, y1);
-
-    for (int y = y_min - t0; y < y_max + t1; y++) {
-        if (y < 0)
-            continue;
-
-        if (y >= h)
-            break;
-
-        unsigned char* p = pixels + stride * y;
-
-        for (int x = x_min - t0; x < x_max + t1; x++) {
-            if (x < 0)
-                continue;
-
-            if (x >= w)
-                break;
-
-            // distance from line
-            if (distance_lessthan(x, y, x0, y0, x1, y1, t1)) {
-                p[x * 3 + 0] = pen_color[0];
-                p[x * 3 + 1] = pen_color[1];
-                p[x * 3 + 2] = pen_color[2];
-            }
+    *owned = 0;
+    pthread_mutex_lock(&g_glyph_atlas_lock);
+    for (int i = 0; i < g_num_glyph_atlas; i++) {
+        if (g_glyph_atlas[i].size == fontpixelsize) {
+            pthread_mutex_unlock(&g_glyph_atlas_lock);
+            return g_glyph_atlas[i].bitmap;
         }
     }
+    unsigned char* bitmap = create_glyph_bitmap(fontpixelsize);
+    if (bitmap != NULL && g_num_glyph_atlas < GLYPH_ATLAS_MAX_SIZES) {
+        g_glyph_atlas[g_num_glyph_atlas].size = fontpixelsize;
+        g_glyph_atlas[g_num_glyph_atlas].bitmap = bitmap;
+        g_num_glyph_atlas++;
+    } else {
+        *owned = 1;
+    }
+    pthread_mutex_unlock(&g_glyph_atlas_lock);
+    return bitmap;
 }
 
-static void draw_line_c4(unsigned char* pixels, int w, int h, int x0, int y0, int x1, int y1, unsigned int color,
-                         int thickness)
+// (p * (255 - a) + c * a) / 255，被除数不超过65025，可以用移位精确计算
+static inline unsigned char blend_alpha(unsigned char p, unsigned char c, unsigned char a)
 {
-    const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 4;
-
-    const float t0 = thickness / 2.f;
-    const float t1 = thickness - t0;
-
-    int x_min = min(x0, x1);
-    int x_max = max(x0, x1);
-    int y_min = min(y0, y1);
-    int y_max = max(y0, y1);
-
-    for (int y = y_min - t0; y < y_max + t1; y++) {
-        if (y < 0)
-            continue;
-
-        if (y >= h)
-            break;
-
-        unsigned char* p = pixels + stride * y;
-
-        for (int x = x_min - t0; x < x_max + t1; x++) {
-            if (x < 0)
-                continue;
-
-            if (x >= w)
-                break;
-
-            // distance from line
-            if (distance_lessthan(x, y, x0, y0, x1, y1, t1)) {
-                p[x * 4 + 0] = pen_color[0];
-                p[x * 4 + 1] = pen_color[1];
-                p[x * 4 + 2] = pen_color[2];
-                p[x * 4 + 3] = pen_color[3];
-            }
-        }
-    }
+    unsigned int v = p * (255 - a) + c * a;
+    return (unsigned char)((v + 1 + (v >> 8)) >> 8);
 }
 
-static void draw_line_yuv420sp(unsigned char* yuv420sp, int w, int h, int x0, int y0, int x1, int y1,
-                               unsigned int color, int thickness)
+#if defined(__ARM_NEON) && !defined(IMAGE_UTILS_DISABLE_SIMD)
+static inline uint8x8_t blend_alpha_u8x8(uint8x8_t p, uint8x8_t c, uint8x8_t a)
 {
-    // assert w % 2 == 0
-    // assert h % 2 == 0
-    // assert x0 % 2 == 0
-    // assert y0 % 2 == 0
-    // assert x1 % 2 == 0
-    // assert y1 % 2 == 0
-    // assert thickness % 2 == 0
-
-    const unsigned char* pen_color = (const unsigned char*)&color;
-
-    unsigned int v_y;
-    unsigned int v_uv;
-    unsigned char* pen_color_y = (unsigned char*)&v_y;
-    unsigned char* pen_color_uv = (unsigned char*)&v_uv;
-    pen_color_y[0] = pen_color[0];
-    pen_color_uv[0] = pen_color[1];
-    pen_color_uv[1] = pen_color[2];
-
-    unsigned char* Y = yuv420sp;
-    draw_line_c1(Y, w, h, x0, y0, x1, y1, v_y, thickness);
-
-    unsigned char* UV = yuv420sp + w * h;
-    int thickness_uv = thickness == -1 ? thickness : max(thickness / 2, 1);
-    draw_line_c2(UV, w / 2, h / 2, x0 / 2, y0 / 2, x1 / 2, y1 / 2, v_uv, thickness_uv);
+    uint16x8_t v = vmull_u8(p, vmvn_u8(a));
+    v = vmlal_u8(v, c, a);
+    v = vaddq_u16(v, vshrq_n_u16(v, 8));
+    v = vaddq_u16(v, vdupq_n_u16(1));
+    return vshrn_n_u16(v, 8);
 }
+#endif
 
-static void get_text_drawing_size(const char* text, int fontpixelsize, int* w, int* h)
+// 按alpha把画笔颜色混合到count个连续像素
+static void blend_span(unsigned char* p, const unsigned char* alpha, int count, int channel,
+                       const unsigned char* pen_color)
 {
-    *w = 0;
-    *h = 0;
-
-    const int n = strlen(text);
-
-    int line_w = 0;
-    for (int i = 0; i < n; i++) {
-        char ch = text[i];
-
-        if (ch == '\n') {
-            // newline
-            *w = max(*w, line_w);
-            *h += fontpixelsize * 2;
-            line_w = 0;
+    int k = 0;
+#if defined(__ARM_NEON) && !defined(IMAGE_UTILS_DISABLE_SIMD)
+    switch (channel) {
+    case 1: {
+        uint8x8_t c0 = vdup_n_u8(pen_color[0]);
+        for (; k + 8 <= count; k += 8) {
+            vst1_u8(p + k, blend_alpha_u8x8(vld1_u8(p + k), c0, vld1_u8(alpha + k)));
         }
-
-        if (isprint(ch) != 0) {
-            line_w += fontpixelsize;
+        break;
+    }
+    case 2: {
+        uint8x8_t c0 = vdup_n_u8(pen_color[0]);
+        uint8x8_t c1 = vdup_n_u8(pen_color[1]);
+        for (; k + 8 <= count; k += 8) {
+            uint8x8_t a = vld1_u8(alpha + k);
+            uint8x8x2_t v = vld2_u8(p + k * 2);
+            v.val[0] = blend_alpha_u8x8(v.val[0], c0, a);
+            v.val[1] = blend_alpha_u8x8(v.val[1], c1, a);
+            vst2_u8(p + k * 2, v);
         }
+        break;
     }
-
-    *w = max(*w, line_w);
-    *h += fontpixelsize * 2;
-}
-
-static int resize_bilinear_c1(const unsigned char* src_pixels, int w, int h, unsigned char* dst_pixels, int w2, int h2)
-{
-    int A, B, C, D, x, y, index, gray;
-    float x_ratio = ((float)(w - 1)) / w2;
-    float y_ratio = ((float)(h - 1)) / h2;
-    float x_diff, y_diff, ya, yb;
-    int offset = 0;
-    for (int i = 0; i < h2; i++) {
-        for (int j = 0; j < w2; j++) {
-            x = (int)(x_ratio * j);
-            y = (int)(y_ratio * i);
-            x_diff = (x_ratio * j) - x;
-            y_diff = (y_ratio * i) - y;
-            index = y * w + x;
-
-            // range is 0 to 255 thus bitwise AND with 0xff
-            A = src_pixels[index] & 0xff;
-            B = src_pixels[index + 1] & 0xff;
-            C = src_pixels[index + w] & 0xff;
-            D = src_pixels[index + w + 1] & 0xff;
-
-            // Y = A(1-w)(1-h) + B(w)(1-h) + C(h)(1-w) + Dwh
-            gray = (int)(A * (1 - x_diff) * (1 - y_diff) + B * (x_diff) * (1 - y_diff) + C * (y_diff) * (1 - x_diff) +
-                         D * (x_diff * y_diff));
-
-            dst_pixels[offset++] = gray;
+    case 3: {
+        uint8x8_t c0 = vdup_n_u8(pen_color[0]);
+        uint8x8_t c1 = vdup_n_u8(pen_color[1]);
+        uint8x8_t c2 = vdup_n_u8(pen_color[2]);
+        for (; k + 8 <= count; k += 8) {
+            uint8x8_t a = vld1_u8(alpha + k);
+            uint8x8x3_t v = vld3_u8(p + k * 3);
+            v.val[0] = blend_alpha_u8x8(v.val[0], c0, a);
+            v.val[1] = blend_alpha_u8x8(v.val[1], c1, a);
+            v.val[2] = blend_alpha_u8x8(v.val[2], c2, a);
+            vst3_u8(p + k * 3, v);
         }
+        break;
     }
-    return 0;
-}
-
-static void draw_text_c1(unsigned char* pixels, int w, int h, const char* text, int x, int y, int fontpixelsize,
-                         unsigned int color)
-{
-    const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w;
-
-    unsigned char* resized_font_bitmap = malloc(fontpixelsize * fontpixelsize * 2);
-
-    const int n = strlen(text);
-
-    int cursor_x = x;
-    int cursor_y = y;
-    for (int i = 0; i < n; i++) {
-        char ch = text[i];
-
-        if (ch == '\n') {
-            // newline
-            cursor_x = x;
-            cursor_y += fontpixelsize * 2;
+    case 4: {
+        uint8x8_t c0 = vdup_n_u8(pen_color[0]);
+        uint8x8_t c1 = vdup_n_u8(pen_color[1]);
+        uint8x8_t c2 = vdup_n_u8(pen_color[2]);
+        uint8x8_t c3 = vdup_n_u8(pen_color[3]);
+        for (; k + 8 <= count; k += 8) {
+            uint8x8_t a = vld1_u8(alpha + k);
+            uint8x8x4_t v = vld4_u8(p + k * 4);
+            v.val[0] = blend_alpha_u8x8(v.val[0], c0, a);
+            v.val[1] = blend_alpha_u8x8(v.val[1], c1, a);
+            v.val[2] = blend_alpha_u8x8(v.val[2], c2, a);
+            v.val[3] = blend_alpha_u8x8(v.val[3], c3, a);
+            vst4_u8(p + k * 4, v);
         }
-
-        if (isprint(ch) != 0) {
-            const unsigned char* font_bitmap = mono_font_data[ch - ' '];
-
-            // draw resized character
-            resize_bilinear_c1(font_bitmap, 20, 40, resized_font_bitmap, fontpixelsize, fontpixelsize * 2);
-
-            for (int j = cursor_y; j < cursor_y + fontpixelsize * 2; j++) {
-                if (j < 0)
-                    continue;
-
-                if (j >= h)
-                    break;
-
-                const unsigned char* palpha = resized_font_bitmap + (j - cursor_y) * fontpixelsize;
-                unsigned char* p = pixels + stride * j;
-
-                for (int k = cursor_x; k < cursor_x + fontpixelsize; k++) {
-                    if (k < 0)
-                        continue;
-
-                    if (k >= w)
-                        break;
-
-                    unsigned char alpha = palpha[k - cursor_x];
-
-                    p[k] = (p[k] * (255 - alpha) + pen_color[0] * alpha) / 255;
-                }
-            }
-
-            cursor_x += fontpixelsize;
+        break;
+    }
+    default:
+        break;
+    }
+#endif
+    for (; k < count; k++) {
+        unsigned char a = alpha[k];
+        for (int c = 0; c < channel; c++) {
+            p[k * channel + c] = blend_alpha(p[k * channel + c], pen_color[c], a);
         }
     }
-
-    free(resized_font_bitmap);
 }
 
-static void draw_text_c2(unsigned char* pixels, int w, int h, const char* text, int x, int y, int fontpixelsize,
-                         unsigned int color)
+// 按同一个alpha把画笔颜色混合到count个连续像素
+static void blend_span_const(unsigned char* p, unsigned char alpha, int count, int channel,
+                             const unsigned char* pen_color)
 {
-    const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 2;
-
-    unsigned char* resized_font_bitmap = malloc(fontpixelsize * fontpixelsize * 2);
-
-    const int n = strlen(text);
-
-    int cursor_x = x;
-    int cursor_y = y;
-    for (int i = 0; i < n; i++) {
-        char ch = text[i];
-
-        if (ch == '\n') {
-            // newline
-            cursor_x = x;
-            cursor_y += fontpixelsize * 2;
+    int k = 0;
+#if defined(__ARM_NEON) && !defined(IMAGE_UTILS_DISABLE_SIMD)
+    uint8x8_t a = vdup_n_u8(alpha);
+    switch (channel) {
+    case 1: {
+        uint8x8_t c0 = vdup_n_u8(pen_color[0]);
+        for (; k + 8 <= count; k += 8) {
+            vst1_u8(p + k, blend_alpha_u8x8(vld1_u8(p + k), c0, a));
         }
-
-        if (isprint(ch) != 0) {
-            int font_bitmap_index = ch - ' ';
-            const unsigned char* font_bitmap = mono_font_data[font_bitmap_index];
-
-            // draw resized character
-            resize_bilinear_c1(font_bitmap, 20, 40, resized_font_bitmap, fontpixelsize, fontpixelsize * 2);
-
-            for (int j = cursor_y; j < cursor_y + fontpixelsize * 2; j++) {
-                if (j < 0)
-                    continue;
-
-                if (j >= h)
-                    break;
-
-                const unsigned char* palpha = resized_font_bitmap + (j - cursor_y) * fontpixelsize;
-                unsigned char* p = pixels + stride * j;
-
-                for (int k = cursor_x; k < cursor_x + fontpixelsize; k++) {
-                    if (k < 0)
-                        continue;
-
-                    if (k >= w)
-                        break;
-
-                    unsigned char alpha = palpha[k - cursor_x];
-
-                    p[k * 2 + 0] = (p[k * 2 + 0] * (255 - alpha) + pen_color[0] * alpha) / 255;
-                    p[k * 2 + 1] = (p[k * 2 + 1] * (255 - alpha) + pen_color[1] * alpha) / 255;
-                }
-            }
-
-            cursor_x += fontpixelsize;
+        break;
+    }
+    case 2: {
+        uint8x8x2_t c = {{vdup_n_u8(pen_color[0]), vdup_n_u8(pen_color[1])}};
+        for (; k + 8 <= count; k += 8) {
+            uint8x8x2_t v = vld2_u8(p + k * 2);
+            v.val[0] = blend_alpha_u8x8(v.val[0], c.val[0], a);
+            v.val[1] = blend_alpha_u8x8(v.val[1], c.val[1], a);
+            vst2_u8(p + k * 2, v);
         }
+        break;
     }
-
-    free(resized_font_bitmap);
-}
-
-static void draw_text_c3(unsigned char* pixels, int w, int h, const char* text, int x, int y, int fontpixelsize,
-                         unsigned int color)
-{
-    const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 3;
-
-    unsigned char* resized_font_bitmap = malloc(fontpixelsize * fontpixelsize * 2);
-
-    const int n = strlen(text);
-
-    int cursor_x = x;
-    int cursor_y = y;
-    for (int i = 0; i < n; i++) {
-        char ch = text[i];
-
-        if (ch == '\n') {
-            // newline
-            cursor_x = x;
-            cursor_y += fontpixelsize * 2;
+    case 3: {
+        uint8x8x3_t c = {{vdup_n_u8(pen_color[0]), vdup_n_u8(pen_color[1]), vdup_n_u8(pen_color[2])}};
+        for (; k + 8 <= count; k += 8) {
+            uint8x8x3_t v = vld3_u8(p + k * 3);
+            v.val[0] = blend_alpha_u8x8(v.val[0], c.val[0], a);
+            v.val[1] = blend_alpha_u8x8(v.val[1], c.val[1], a);
+            v.val[2] = blend_alpha_u8x8(v.val[2], c.val[2], a);
+            vst3_u8(p + k * 3, v);
         }
-
-        if (isprint(ch) != 0) {
-            int font_bitmap_index = ch - ' ';
-            const unsigned char* font_bitmap = mono_font_data[font_bitmap_index];
-
-            // draw resized character
-            resize_bilinear_c1(font_bitmap, 20, 40, resized_font_bitmap, fontpixelsize, fontpixelsize * 2);
-
-            for (int j = cursor_y; j < cursor_y + fontpixelsize * 2; j++) {
-                if (j < 0)
-                    continue;
-
-                if (j >= h)
-                    break;
-
-                const unsigned char* palpha = resized_font_bitmap + (j - cursor_y) * fontpixelsize;
-                unsigned char* p = pixels + stride * j;
-
-                for (int k = cursor_x; k < cursor_x + fontpixelsize; k++) {
-                    if (k < 0)
-                        continue;
-
-                    if (k >= w)
-                        break;
-
-                    unsigned char alpha = palpha[k - cursor_x];
-
-                    p[k * 3 + 0] = (p[k * 3 + 0] * (255 - alpha) + pen_color[0] * alpha) / 255;
-                    p[k * 3 + 1] = (p[k * 3 + 1] * (255 - alpha) + pen_color[1] * alpha) / 255;
-                    p[k * 3 + 2] = (p[k * 3 + 2] * (255 - alpha) + pen_color[2] * alpha) / 255;
-                }
-            }
-
-            cursor_x += fontpixelsize;
+        break;
+    }
+    case 4: {
+        uint8x8x4_t c = {{vdup_n_u8(pen_color[0]), vdup_n_u8(pen_color[1]), vdup_n_u8(pen_color[2]),
+                          vdup_n_u8(pen_color[3])}};
+        for (; k + 8 <= count; k += 8) {
+            uint8x8x4_t v = vld4_u8(p + k * 4);
+            v.val[0] = blend_alpha_u8x8(v.val[0], c.val[0], a);
+            v.val[1] = blend_alpha_u8x8(v.val[1], c.val[1], a);
+            v.val[2] = blend_alpha_u8x8(v.val[2], c.val[2], a);
+            v.val[3] = blend_alpha_u8x8(v.val[3], c.val[3], a);
+            vst4_u8(p + k * 4, v);
         }
+        break;
+    }
+    default:
+        break;
+    }
+#endif
+    // 颜色项对整段相同，提前乘好；48字节是1~4通道的公倍数，按块展开便于编译器向量化
+    unsigned short pen_term[48];
+    for (int i = 0; i < 48; i++) {
+        pen_term[i] = pen_color[i % channel] * alpha;
+    }
+    const unsigned short inv_alpha = 255 - alpha;
+    unsigned char* q = p + k * channel;
+    int n = (count - k) * channel;
+    int i = 0;
+    for (; i + 48 <= n; i += 48) {
+        for (int j = 0; j < 48; j++) {
+            unsigned short v = q[i + j] * inv_alpha + pen_term[j];
+            q[i + j] = (unsigned char)((v + 1 + (v >> 8)) >> 8);
+        }
+    }
+    for (int j = 0; i < n; i++, j++) {
+        unsigned short v = q[i] * inv_alpha + pen_term[j];
+        q[i] = (unsigned char)((v + 1 + (v >> 8)) >> 8);
     }
-
-    free(resized_font_bitmap);
 }
 
-static void draw_text_c4(unsigned char* pixels, int w, int h, const char* text, int x, int y, int fontpixelsize,
-                         unsigned int color)
+static void draw_text_cn(unsigned char* pixels, int w, int h, int stride, int channel, const char* text, int x, int y,
+                         int fontpixelsize, unsigned int color)
 {
     const unsigned char* pen_color = (const unsigned char*)&color;
-    int stride = w * 4;
-
-    unsigned char* resized_font_bitmap = malloc(fontpixelsize * fontpixelsize * 2);
+    if (fontpixelsize <= 0) {
+        return;
+    }
+    int owned = 0;
+    const unsigned char* atlas = acquire_glyph_atlas(fontpixelsize, &owned);
+    if (atlas == NULL) {
+        printf("draw_text: create glyph atlas fail\n");
+        return;
+    }
+    int glyph_w = fontpixelsize;
+    int glyph_h = fontpixelsize * 2;
 
     const int n = strlen(text);
 
     int cursor_x = x;
     int cursor_y = y;
     for (int i = 0; i < n; i++) {
-        char ch = text[i];
+        unsigned char ch = (unsigned char)text[i];
 
         if (ch == '\n') {
             // newline
             cursor_x = x;
-            cursor_y += fontpixelsize * 2;
+            cursor_y += glyph_h;
         }
 
         if (isprint(ch) != 0) {
-            const unsigned char* font_bitmap = mono_font_data[ch - ' '];
-
-            // draw resized character
-            resize_bilinear_c1(font_bitmap, 20, 40, resized_font_bitmap, fontpixelsize, fontpixelsize * 2);
-
-            for (int j = cursor_y; j < cursor_y + fontpixelsize * 2; j++) {
-                if (j < 0)
-                    continue;
-
-                if (j >= h)
-                    break;
-
-                const unsigned char* palpha = resized_font_bitmap + (j - cursor_y) * fontpixelsize;
-                unsigned char* p = pixels + stride * j;
-
-                for (int k = cursor_x; k < cursor_x + fontpixelsize; k++) {
-                    if (k < 0)
-                        continue;
-
-                    if (k >= w)
-                        break;
-
-                    unsigned char alpha = palpha[k - cursor_x];
-
-                    p[k * 4 + 0] = (p[k * 4 + 0] * (255 - alpha) + pen_color[0] * alpha) / 255;
-                    p[k * 4 + 1] = (p[k * 4 + 1] * (255 - alpha) + pen_color[1] * alpha) / 255;
-                    p[k * 4 + 2] = (p[k * 4 + 2] * (255 - alpha) + pen_color[2] * alpha) / 255;
-                    p[k * 4 + 3] = (p[k * 4 + 3] * (255 - alpha) + pen_color[3] * alpha) / 255;
-                }
+            const unsigned char* glyph = atlas + (size_t)(ch - ' ') * glyph_w * glyph_h;
+
+            // 只混合字符落在图像内的部分
+            int k0 = max(cursor_x, 0);
+            int k1 = min(cursor_x + glyph_w, w);
+            int j0 = max(cursor_y, 0);
+            int j1 = min(cursor_y + glyph_h, h);
+            for (int j = j0; j < j1 && k0 < k1; j++) {
+                const unsigned char* palpha = glyph + (j - cursor_y) * glyph_w + (k0 - cursor_x);
+                unsigned char* p = pixels + (size_t)stride * j + k0 * channel;
+                blend_span(p, palpha, k1 - k0, channel, pen_color);
             }
 
-            cursor_x += fontpixelsize;
+            cursor_x += glyph_w;
         }
     }
 
-    free(resized_font_bitmap);
+    if (owned) {
+        free((void*)atlas);
+    }
 }
 
-static void draw_text_yuv420sp(unsigned char* yuv420sp, int w, int h, const char* text, int x, int y, int fontpixelsize,
+static void draw_text_yuv420sp(unsigned char* Y, unsigned char* UV, int w, int h, int stride, const char* text, int x, int y, int fontpixelsize,
                                unsigned int color)
 {
     // assert w % 2 == 0
@@ -1424,46 +1264,250 @@ static void draw_text_yuv420sp(unsigned char* yuv420sp, int w, int h, const char
     pen_color_uv[0] = pen_color[1];
     pen_color_uv[1] = pen_color[2];
 
-    unsigned char* Y = yuv420sp;
-    draw_text_c1(Y, w, h, text, x, y, fontpixelsize, v_y);
+    draw_text_cn(Y, w, h, stride, 1, text, x, y, fontpixelsize, v_y);
 
-    unsigned char* UV = yuv420sp + w * h;
-    draw_text_c2(UV, w / 2, h / 2, text, x / 2, y / 2, max(fontpixelsize / 2, 1), v_uv);
+    draw_text_cn(UV, w / 2, h / 2, stride, 2, text, x / 2, y / 2, max(fontpixelsize / 2, 1), v_uv);
 }
 
-static void draw_image_c1(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
+static void draw_image_c1(unsigned char* pixels, int w, int h, int stride, unsigned char* draw_img, int x, int y, int rw, int rh)
 {
     for (int i = 0; i < rh; i++) {
-        memcpy(pixels + (y + i) * w + x,  draw_img + i * rw,  rw);
+        memcpy(pixels + (y + i) * stride + x,  draw_img + i * rw,  rw);
     }
 }
 
-static void draw_image_c2(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
+static void draw_image_c2(unsigned char* pixels, int w, int h, int stride, unsigned char* draw_img, int x, int y, int rw, int rh)
 {
     for (int i = 0; i < rh; i++) {
-        memcpy(pixels + ((y + i) * w + x) * 2,  draw_img + i * rw * 2,  rw * 2);
+        memcpy(pixels + (y + i) * stride + x * 2,  draw_img + i * rw * 2,  rw * 2);
     }
 }
 
-static void draw_image_c3(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
+static void draw_image_c3(unsigned char* pixels, int w, int h, int stride, unsigned char* draw_img, int x, int y, int rw, int rh)
 {
     printf("draw_image_c3 pixels=%p wxh=%dx%d draw_img=%p pos=(%d %d) rwxrh=%dx%d\n", pixels, w, h, draw_img, x, y, rw, rh);
     for (int i = 0; i < rh; i++) {
-        memcpy(pixels + ((y + i) * w + x) * 3,  draw_img + i * rw * 3,  rw * 3);
+        memcpy(pixels + (y + i) * stride + x * 3,  draw_img + i * rw * 3,  rw * 3);
     }
 }
 
-static void draw_image_c4(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
+static void draw_image_c4(unsigned char* pixels, int w, int h, int stride, unsigned char* draw_img, int x, int y, int rw, int rh)
 {
     for (int i = 0; i < rh; i++) {
-        memcpy(pixels + ((y + i) * w + x) * 4,  draw_img + i * rw * 4,  rw * 4);
+        memcpy(pixels + (y + i) * stride + x * 4,  draw_img + i * rw * 4,  rw * 4);
+    }
+}
+
+static void draw_image_yuv420sp(unsigned char* Y, unsigned char* UV, int w, int h, int stride, unsigned char* draw_img,
+                                int x, int y, int rw, int rh)
+{
+    // draw_img为紧密排列的rw x rh yuv420sp图像
+    draw_image_c1(Y, w, h, stride, draw_img, x, y, rw, rh);
+    draw_image_c2(UV, w / 2, h / 2, stride, draw_img + rw * rh, x / 2, y / 2, rw / 2, rh / 2);
+}
+
+#define OVERLAY_BAND_ROWS 16
+
+// 一个平面上框和标签的几何信息，颜色已转换为图像格式
+typedef struct {
+    int rx;
+    int ry;
+    int rw;
+    int rh;
+    int thickness;
+    int tx;
+    int ty;
+    unsigned int color;
+    unsigned int text_color;
+    int text_y1;    // 标签的行[ty, text_y1)
+    int y0;         // 框和标签影响的行[y0, y1)
+    int y1;
+} overlay_item_t;
+
+// 逐行绘制的平面，yuv420sp的UV平面坐标、线宽和字号减半
+typedef struct {
+    unsigned char* pixels;
+    int w;
+    int h;
+    int stride;
+    int channel;
+    int scale;
+    int color_offset;   // 平面颜色在转换后颜色中的起始字节
+    int fontsize;
+    const unsigned char* atlas;
+    int atlas_owned;
+    overlay_item_t* items;
+} overlay_plane_t;
+
+typedef struct {
+    const overlay_mask_t* mask;
+    const overlay_box_t* boxes;
+    int num_boxes;
+    int image_w;
+    int image_h;
+    unsigned int* mask_colors;      // [num_colors] 转换后颜色
+    unsigned char* mask_alpha;      // [num_colors]
+    int* xmap;                      // [image_w] 图像列对应的mask列
+    int* band_items;                // [num_boxes] 当前行带内的框，保持原顺序
+} overlay_ctx_t;
+
+static void overlay_item_init(overlay_item_t* item, const overlay_box_t* box, const overlay_plane_t* plane,
+                              image_format_t format)
+{
+    const int s = plane->scale;
+    item->rx = box->box.left / s;
+    item->ry = box->box.top / s;
+    item->rw = (box->box.right - box->box.left) / s;
+    item->rh = (box->box.bottom - box->box.top) / s;
+    item->thickness = (s == 1 || box->thickness <= 0) ? box->thickness : max(box->thickness / s, 1);
+    item->tx = box->text_x / s;
+    item->ty = box->text_y / s;
+    item->color = convert_color(box->color, format);
+    item->text_color = convert_color(box->text_color, format);
+
+    int y0 = plane->h;
+    int y1 = 0;
+    item->text_y1 = item->ty;
+    if (item->thickness == -1) {
+        y0 = item->ry;
+        y1 = item->ry + item->rh;
+    } else if (item->thickness != 0) {
+        const int t0 = item->thickness / 2;
+        const int t1 = item->thickness - t0;
+        y0 = item->ry - t0;
+        y1 = item->ry + item->rh + t1;
+    }
+    if (box->text != NULL && plane->atlas != NULL) {
+        int lines = 1;
+        for (const char* c = box->text; *c != '\0'; c++) {
+            lines += *c == '\n';
+        }
+        item->text_y1 = item->ty + lines * plane->fontsize * 2;
+        y0 = min(y0, item->ty);
+        y1 = max(y1, item->text_y1);
+    }
+    item->y0 = max(y0, 0);
+    item->y1 = min(y1, plane->h);
+}
+
+static void overlay_mask_row(const overlay_ctx_t* ctx, const overlay_plane_t* plane, int y)
+{
+    const overlay_mask_t* mask = ctx->mask;
+    const int channel = plane->channel;
+    int my = (int)((long long)y * plane->scale * mask->height / ctx->image_h);
+    const unsigned char* labels = mask->labels + (size_t)my * mask->width;
+    unsigned char* row = plane->pixels + (size_t)plane->stride * y;
+
+    // 相同标签的连续像素一起混合，透明标签跳过
+    int x = 0;
+    while (x < plane->w) {
+        unsigned char label = labels[ctx->xmap[x * plane->scale]];
+        int x0 = x;
+        for (x++; x < plane->w && labels[ctx->xmap[x * plane->scale]] == label; x++) {
+        }
+        if (label >= mask->num_colors || ctx->mask_alpha[label] == 0) {
+            continue;
+        }
+        const unsigned char* pen_color = (const unsigned char*)&ctx->mask_colors[label] + plane->color_offset;
+        blend_span_const(row + x0 * channel, ctx->mask_alpha[label], x - x0, channel, pen_color);
+    }
+}
+
+static void overlay_fill_row(const overlay_plane_t* plane, unsigned char* row, int x0, int x1,
+                             const unsigned char* pen_color)
+{
+    x0 = max(x0, 0);
+    x1 = min(x1, plane->w);
+    if (x0 < x1) {
+        fill_span(row + x0 * plane->channel, x1 - x0, plane->channel, pen_color);
     }
 }
 
-static void draw_image_yuv420sp(unsigned char* pixels, int w, int h, unsigned char* draw_img, int x, int y, int rw, int rh)
+// 与draw_rectangle_cN相同的几何，只画第y行
+static void overlay_rect_row(const overlay_plane_t* plane, const overlay_item_t* item, int y)
 {
-    draw_image_c1(pixels, w, h, draw_img, x, y, rw, rh);
-    draw_image_c2(pixels, w, h / 2, draw_img + rw * rh, x, y/2, rw, rh/2);
+    const unsigned char* pen_color = (const unsigned char*)&item->color + plane->color_offset;
+    unsigned char* row = plane->pixels + (size_t)plane->stride * y;
+    const int rx = item->rx;
+    const int ry = item->ry;
+    const int rw = item->rw;
+    const int rh = item->rh;
+
+    if (item->thickness == -1) {
+        if (y >= ry && y < ry + rh) {
+            overlay_fill_row(plane, row, rx, rx + rw, pen_color);
+        }
+        return;
+    }
+
+    const int t0 = item->thickness / 2;
+    const int t1 = item->thickness - t0;
+    if ((y >= ry - t0 && y < ry + t1) || (y >= ry + rh - t0 && y < ry + rh + t1)) {
+        overlay_fill_row(plane, row, rx - t0, rx + rw + t1, pen_color);
+    }
+    if (y >= ry + t1 && y < ry + rh - t0) {
+        overlay_fill_row(plane, row, rx - t0, rx + t1, pen_color);
+        overlay_fill_row(plane, row, rx + rw - t0, rx + rw + t1, pen_color);
+    }
+}
+
+// 与draw_text_cn相同的排版，只画第y行
+static void overlay_text_row(const overlay_plane_t* plane, const overlay_item_t* item, const char* text, int y)
+{
+    const unsigned char* pen_color = (const unsigned char*)&item->text_color + plane->color_offset;
+    const int glyph_w = plane->fontsize;
+    const int glyph_h = plane->fontsize * 2;
+    unsigned char* row = plane->pixels + (size_t)plane->stride * y;
+
+    int cursor_x = item->tx;
+    int cursor_y = item->ty;
+    for (const char* c = text; *c != '\0' && cursor_y <= y; c++) {
+        unsigned char ch = (unsigned char)*c;
+
+        if (ch == '\n') {
+            cursor_x = item->tx;
+            cursor_y += glyph_h;
+        }
+
+        if (isprint(ch) != 0) {
+            int k0 = max(cursor_x, 0);
+            int k1 = min(cursor_x + glyph_w, plane->w);
+            if (y < cursor_y + glyph_h && k0 < k1) {
+                const unsigned char* glyph = plane->atlas + (size_t)(ch - ' ') * glyph_w * glyph_h;
+                const unsigned char* palpha = glyph + (y - cursor_y) * glyph_w + (k0 - cursor_x);
+                blend_span(row + k0 * plane->channel, palpha, k1 - k0, plane->channel, pen_color);
+            }
+            cursor_x += glyph_w;
+        }
+    }
+}
+
+static void overlay_plane_rows(const overlay_ctx_t* ctx, const overlay_plane_t* plane, int y_begin, int y_end)
+{
+    int num_items = 0;
+    for (int i = 0; i < ctx->num_boxes; i++) {
+        const overlay_item_t* item = &plane->items[i];
+        if (item->y0 < y_end && item->y1 > y_begin) {
+            ctx->band_items[num_items++] = i;
+        }
+    }
+
+    for (int y = y_begin; y < y_end; y++) {
+        if (ctx->mask != NULL) {
+            overlay_mask_row(ctx, plane, y);
+        }
+        for (int n = 0; n < num_items; n++) {
+            int i = ctx->band_items[n];
+            const overlay_item_t* item = &plane->items[i];
+            if (y < item->y0 || y >= item->y1) {
+                continue;
+            }
+            overlay_rect_row(plane, item, y);
+            if (y >= item->ty && y < item->text_y1) {
+                overlay_text_row(plane, item, ctx->boxes[i].text, y);
+            }
+        }
+    }
 }
 
 void draw_rectangle(image_buffer_t* image, int rx, int ry, int rw, int rh, unsigned int color,
@@ -1473,6 +1517,7 @@ void draw_rectangle(image_buffer_t* image, int rx, int ry, int rw, int rh, unsig
     unsigned char* pixels = image->virt_addr;
     int w = image->width;
     int h = image->height;
+    int stride = get_row_stride(image);
 
     unsigned int draw_color = convert_color(color, format);
     // printf("draw_color=%x\n", draw_color);
@@ -1481,15 +1526,18 @@ void draw_rectangle(image_buffer_t* image, int rx, int ry, int rw, int rh, unsig
     //     format, rx, ry, rw, rh, color, thickness);
     switch (format)
     {
+    case IMAGE_FORMAT_GRAY8:
+        draw_rectangle_c1(pixels, w, h, stride, rx, ry, rw, rh, draw_color, thickness);
+        break;
     case IMAGE_FORMAT_RGB888:
-        draw_rectangle_c3(pixels, w, h, rx, ry, rw, rh, draw_color, thickness);
+        draw_rectangle_c3(pixels, w, h, stride, rx, ry, rw, rh, draw_color, thickness);
         break;
     case IMAGE_FORMAT_RGBA8888:
-        draw_rectangle_c4(pixels, w, h, rx, ry, rw, rh, draw_color, thickness);
+        draw_rectangle_c4(pixels, w, h, stride, rx, ry, rw, rh, draw_color, thickness);
         break;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        draw_rectangle_yuv420sp(pixels, w, h, rx, ry, rw, rh, draw_color, thickness);
+        draw_rectangle_yuv420sp(pixels, get_uv_plane(image), w, h, stride, rx, ry, rw, rh, draw_color, thickness);
         break;
     default:
         printf("no support format %d", format);
@@ -1504,20 +1552,24 @@ void draw_line(image_buffer_t* image, int x0, int y0, int x1, int y1, unsigned i
     unsigned char* pixels = image->virt_addr;
     int w = image->width;
     int h = image->height;
+    int stride = get_row_stride(image);
 
     unsigned draw_color = convert_color(color, format);
 
     switch (format)
     {
+    case IMAGE_FORMAT_GRAY8:
+        draw_line_cn(pixels, w, h, stride, 1, x0, y0, x1, y1, draw_color, thickness);
+        break;
     case IMAGE_FORMAT_RGB888:
-        draw_line_c3(pixels, w, h, x0, y0, x1, y1, draw_color, thickness);
+        draw_line_cn(pixels, w, h, stride, 3, x0, y0, x1, y1, draw_color, thickness);
         break;
     case IMAGE_FORMAT_RGBA8888:
-        draw_line_c4(pixels, w, h, x0, y0, x1, y1, draw_color, thickness);
+        draw_line_cn(pixels, w, h, stride, 4, x0, y0, x1, y1, draw_color, thickness);
         break;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        draw_line_yuv420sp(pixels, w, h, x0, y0, x1, y1, draw_color, thickness);
+        draw_line_yuv420sp(pixels, get_uv_plane(image), w, h, stride, x0, y0, x1, y1, draw_color, thickness);
         break;
     default:
         printf("no support format %d", format);
@@ -1532,19 +1584,23 @@ void draw_text(image_buffer_t* image, const char* text, int x, int y, unsigned i
     unsigned char* pixels = image->virt_addr;
     int w = image->width;
     int h = image->height;
+    int stride = get_row_stride(image);
     unsigned draw_color = convert_color(color, format);
 
     switch (format)
     {
+    case IMAGE_FORMAT_GRAY8:
+        draw_text_cn(pixels, w, h, stride, 1, text, x, y, fontsize, draw_color);
+        break;
     case IMAGE_FORMAT_RGB888:
-        draw_text_c3(pixels, w, h, text, x, y, fontsize, draw_color);
+        draw_text_cn(pixels, w, h, stride, 3, text, x, y, fontsize, draw_color);
         break;
     case IMAGE_FORMAT_RGBA8888:
-        draw_text_c4(pixels, w, h, text, x, y, fontsize, draw_color);
+        draw_text_cn(pixels, w, h, stride, 4, text, x, y, fontsize, draw_color);
         break;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        draw_text_yuv420sp(pixels, w, h, text, x, y, fontsize, draw_color);
+        draw_text_yuv420sp(pixels, get_uv_plane(image), w, h, stride, text, x, y, fontsize, draw_color);
         break;
     default:
         printf("no support format %d", format);
@@ -1559,19 +1615,54 @@ void draw_circle(image_buffer_t* image, int cx, int cy, int radius, unsigned int
     unsigned char* pixels = image->virt_addr;
     int w = image->width;
     int h = image->height;
+    int stride = get_row_stride(image);
+    unsigned draw_color = convert_color(color, format);
+
+    switch (format)
+    {
+    case IMAGE_FORMAT_GRAY8:
+        draw_circle_cn(pixels, w, h, stride, 1, cx, cy, radius, draw_color, thickness);
+        break;
+    case IMAGE_FORMAT_RGB888:
+        draw_circle_cn(pixels, w, h, stride, 3, cx, cy, radius, draw_color, thickness);
+        break;
+    case IMAGE_FORMAT_RGBA8888:
+        draw_circle_cn(pixels, w, h, stride, 4, cx, cy, radius, draw_color, thickness);
+        break;
+    case IMAGE_FORMAT_YUV420SP_NV12:
+    case IMAGE_FORMAT_YUV420SP_NV21:
+        draw_circle_yuv420sp(pixels, get_uv_plane(image), w, h, stride, cx, cy, radius, draw_color, thickness);
+        break;
+    default:
+        printf("no support format %d", format);
+        break;
+    }
+}
+
+void draw_polygon(image_buffer_t* image, const int* points, int num_points, unsigned int color,
+                  int thickness)
+{
+    image_format_t format = image->format;
+    unsigned char* pixels = image->virt_addr;
+    int w = image->width;
+    int h = image->height;
+    int stride = get_row_stride(image);
     unsigned draw_color = convert_color(color, format);
 
     switch (format)
     {
+    case IMAGE_FORMAT_GRAY8:
+        draw_polygon_cn(pixels, w, h, stride, 1, points, num_points, 1, draw_color, thickness);
+        break;
     case IMAGE_FORMAT_RGB888:
-        draw_circle_c3(pixels, w, h, cx, cy, radius, draw_color, thickness);
+        draw_polygon_cn(pixels, w, h, stride, 3, points, num_points, 1, draw_color, thickness);
         break;
     case IMAGE_FORMAT_RGBA8888:
-        draw_circle_c4(pixels, w, h, cx, cy, radius, draw_color, thickness);
+        draw_polygon_cn(pixels, w, h, stride, 4, points, num_points, 1, draw_color, thickness);
         break;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        draw_circle_yuv420sp(pixels, w, h, cx, cy, radius, draw_color, thickness);
+        draw_polygon_yuv420sp(pixels, get_uv_plane(image), w, h, stride, points, num_points, draw_color, thickness);
         break;
     default:
         printf("no support format %d", format);
@@ -1585,21 +1676,159 @@ void draw_image(image_buffer_t* image, unsigned char* draw_img, int x, int y, in
     unsigned char* pixels = image->virt_addr;
     int w = image->width;
     int h = image->height;
+    int stride = get_row_stride(image);
 
     switch (format)
     {
+    case IMAGE_FORMAT_GRAY8:
+        draw_image_c1(pixels, w, h, stride, draw_img, x, y, rw, rh);
+        break;
     case IMAGE_FORMAT_RGB888:
-        draw_image_c3(pixels, w, h, draw_img, x, y, rw, rh);
+        draw_image_c3(pixels, w, h, stride, draw_img, x, y, rw, rh);
         break;
     case IMAGE_FORMAT_RGBA8888:
-        draw_image_c4(pixels, w, h, draw_img, x, y, rw, rh);
+        draw_image_c4(pixels, w, h, stride, draw_img, x, y, rw, rh);
         break;
     case IMAGE_FORMAT_YUV420SP_NV12:
     case IMAGE_FORMAT_YUV420SP_NV21:
-        draw_image_yuv420sp(pixels, w, h, draw_img, x, y, rw, rh);
+        draw_image_yuv420sp(pixels, get_uv_plane(image), w, h, stride, draw_img, x, y, rw, rh);
         break;
     default:
         printf("no support format %d", format);
         break;
     }
 }
+
+int draw_overlay(image_buffer_t* image, const overlay_mask_t* mask, const overlay_box_t* boxes, int num_boxes,
+                 int fontsize)
+{
+    if (image == NULL || image->virt_addr == NULL || num_boxes < 0 || (num_boxes > 0 && boxes == NULL)) {
+        printf("draw_overlay: invalid param\n");
+        return -1;
+    }
+    if (mask != NULL && (mask->labels == NULL || mask->palette == NULL || mask->num_colors <= 0 ||
+                         mask->width <= 0 || mask->height <= 0)) {
+        printf("draw_overlay: invalid mask\n");
+        return -1;
+    }
+
+    image_format_t format = image->format;
+    int w = image->width;
+    int h = image->height;
+    int stride = get_row_stride(image);
+
+    overlay_plane_t planes[2];
+    int num_planes = 1;
+    memset(planes, 0, sizeof(planes));
+    planes[0].pixels = image->virt_addr;
+    planes[0].w = w;
+    planes[0].h = h;
+    planes[0].stride = stride;
+    planes[0].scale = 1;
+    planes[0].fontsize = fontsize;
+    switch (format)
+    {
+    case IMAGE_FORMAT_GRAY8:
+        planes[0].channel = 1;
+        break;
+    case IMAGE_FORMAT_RGB888:
+        planes[0].channel = 3;
+        break;
+    case IMAGE_FORMAT_RGBA8888:
+        planes[0].channel = 4;
+        break;
+    case IMAGE_FORMAT_YUV420SP_NV12:
+    case IMAGE_FORMAT_YUV420SP_NV21:
+        planes[0].channel = 1;
+        planes[1].pixels = get_uv_plane(image);
+        planes[1].w = w / 2;
+        planes[1].h = h / 2;
+        planes[1].stride = stride;
+        planes[1].channel = 2;
+        planes[1].scale = 2;
+        planes[1].color_offset = 1;
+        planes[1].fontsize = max(fontsize / 2, 1);
+        num_planes = 2;
+        break;
+    default:
+        printf("no support format %d", format);
+        return -1;
+    }
+
+    int ret = -1;
+    overlay_ctx_t ctx;
+    memset(&ctx, 0, sizeof(overlay_ctx_t));
+    ctx.mask = mask;
+    ctx.boxes = boxes;
+    ctx.num_boxes = num_boxes;
+    ctx.image_w = w;
+    ctx.image_h = h;
+
+    int has_text = 0;
+    for (int i = 0; i < num_boxes; i++) {
+        has_text |= boxes[i].text != NULL;
+    }
+    for (int p = 0; p < num_planes; p++) {
+        if (has_text && fontsize > 0) {
+            planes[p].atlas = acquire_glyph_atlas(planes[p].fontsize, &planes[p].atlas_owned);
+            if (planes[p].atlas == NULL) {
+                printf("draw_overlay: create glyph atlas fail\n");
+                goto out;
+            }
+        }
+        planes[p].items = (overlay_item_t*)malloc(max(num_boxes, 1) * sizeof(overlay_item_t));
+        if (planes[p].items == NULL) {
+            goto out;
+        }
+        for (int i = 0; i < num_boxes; i++) {
+            overlay_item_init(&planes[p].items[i], &boxes[i], &planes[p], format);
+        }
+    }
+    ctx.band_items = (int*)malloc(max(num_boxes, 1) * sizeof(int));
+    if (ctx.band_items == NULL) {
+        goto out;
+    }
+
+    if (mask != NULL) {
+        ctx.mask_colors = (unsigned int*)malloc(mask->num_colors * sizeof(unsigned int));
+        ctx.mask_alpha = (unsigned char*)malloc(mask->num_colors);
+        ctx.xmap = (int*)malloc(max(w, 1) * sizeof(int));
+        if (ctx.mask_colors == NULL || ctx.mask_alpha == NULL || ctx.xmap == NULL) {
+            goto out;
+        }
+        for (int i = 0; i < mask->num_colors; i++) {
+            ctx.mask_colors[i] = convert_color(mask->palette[i], format);
+            ctx.mask_alpha[i] = (unsigned char)(mask->palette[i] >> 24);
+        }
+        for (int x = 0; x < w; x++) {
+            ctx.xmap[x] = (int)((long long)x * mask->width / w);
+        }
+    }
+
+    // 按行带从上到下处理，行带内先画mask，再按列表顺序画框和标签
+    for (int band_y = 0; band_y < h; band_y += OVERLAY_BAND_ROWS) {
+        int band_end = min(band_y + OVERLAY_BAND_ROWS, h);
+        for (int p = 0; p < num_planes; p++) {
+            int y_begin = band_y / planes[p].scale;
+            int y_end = min(band_end / planes[p].scale, planes[p].h);
+            overlay_plane_rows(&ctx, &planes[p], y_begin, y_end);
+        }
+    }
+    ret = 0;
+
+out:
+    if (ret != 0) {
+        printf("draw_overlay: fail\n");
+    }
+    for (int p = 0; p < num_planes; p++) {
+        if (planes[p].atlas_owned) {
+            free((void*)planes[p].atlas);
+        }
+        free(planes[p].items);
+    }
+    free(ctx.band_items);
+    free(ctx.mask_colors);
+    free(ctx.mask_alpha);
+    free(ctx.xmap);
+    return ret;
+}
@@ -16,6 +16,32 @@ extern "C" {
 #define COLOR_BLACK     0xFF000000
 #define COLOR_WHITE     0xFFFFFFFF
 
+/**
+ * @brief Box and label of overlay
+ * 
+ */
+typedef struct {
+    image_rect_t box;           // box left, top, right, bottom
+    unsigned int color;         // box line color
+    int thickness;              // box line thickness, -1: filled, 0: no box
+    const char* text;           // label text (only support ASCII char), NULL: no label
+    int text_x;                 // label position x
+    int text_y;                 // label position y
+    unsigned int text_color;    // label color
+} overlay_box_t;
+
+/**
+ * @brief Label mask of overlay, scaled to image size by nearest sampling
+ * 
+ */
+typedef struct {
+    const unsigned char* labels;    // [height][width] label of each pixel
+    int width;                      // mask width
+    int height;                     // mask height
+    const unsigned int* palette;    // [num_colors] color of each label, alpha is blending opacity
+    int num_colors;                 // palette size, labels >= num_colors are not drawn
+} overlay_mask_t;
+
 /**
  * @brief Draw rectangle
  * 
@@ -47,6 +73,8 @@ void draw_line(image_buffer_t* image, int x0, int y0, int x1, int y1, unsigned i
 /**
  * @brief Draw text (only support ASCII char)
  * 
+ * Glyphs are scaled once per font size and cached, later calls only blend them.
+ * 
  * @param image [in] Image buffer
  * @param text [in] Text
  * @param x [in] Text position x
@@ -70,6 +98,21 @@ void draw_text(image_buffer_t* image, const char* text, int x, int y, unsigned i
 void draw_circle(image_buffer_t* image, int cx, int cy, int radius, unsigned int color,
                  int thickness);
 
+/**
+ * @brief Draw polygon, such as rotated box
+ * 
+ * Pixel (x, y) is filled if it is inside the polygon, so points are pixel coordinates.
+ * Outline edges are lines of the given thickness extended by thickness / 2 at both ends.
+ * 
+ * @param image [in] Image buffer
+ * @param points [in] Polygon vertices x0, y0, x1, y1, ...
+ * @param num_points [in] Number of vertices
+ * @param color [in] Polygon color
+ * @param thickness [in] Outline thickness, -1: filled
+ */
+void draw_polygon(image_buffer_t* image, const int* points, int num_points, unsigned int color,
+                  int thickness);
+
 /**
  * @brief Draw image
  * 
@@ -82,6 +125,23 @@ void draw_circle(image_buffer_t* image, int cx, int cy, int radius, unsigned int
  */
 void draw_image(image_buffer_t* image, unsigned char* draw_img, int x, int y, int rw, int rh);
 
+/**
+ * @brief Draw mask, boxes and labels in one pass over image rows
+ * 
+ * The mask is blended first, then box i and label i in list order, so the result
+ * of boxes and labels is the same as calling draw_rectangle() and draw_text() for
+ * each of them.
+ * 
+ * @param image [in] Image buffer
+ * @param mask [in] Label mask, NULL: no mask
+ * @param boxes [in] Boxes and labels
+ * @param num_boxes [in] Number of boxes
+ * @param fontsize [in] Label fontsize
+ * @return int 0: success; -1: error
+ */
+int draw_overlay(image_buffer_t* image, const overlay_mask_t* mask, const overlay_box_t* boxes, int num_boxes,
+                 int fontsize);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -0,0 +1,445 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if !defined(IMAGE_UTILS_DISABLE_SIMD)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BILINEAR_USE_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define BILINEAR_USE_AVX2 1
+#define BILINEAR_USE_SSE2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BILINEAR_USE_SSE2 1
+#endif
+#endif
+
+#include "image_resize.h"
+
+int bilinear_table_init(bilinear_table_t* table, int src_channel, int dst_channel, int src_width, int src_height,
+                        float crop_x, float crop_y, float crop_width, float crop_height, int dst_width, int dst_height)
+{
+    if (table == NULL || src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0 ||
+        dst_channel <= 0 || dst_channel > src_channel || dst_channel > 4) {
+        return -1;
+    }
+    memset(table, 0, sizeof(bilinear_table_t));
+    table->src_channel = src_channel;
+    table->dst_channel = dst_channel;
+    table->dst_width = dst_width;
+    table->dst_height = dst_height;
+    table->xofs = (int*)malloc(dst_width * 2 * sizeof(int));
+    table->ialpha = (short*)malloc(dst_width * 2 * sizeof(short));
+    table->yofs = (int*)malloc(dst_height * 2 * sizeof(int));
+    table->ibeta = (short*)malloc(dst_height * 2 * sizeof(short));
+    if (table->xofs == NULL || table->ialpha == NULL || table->yofs == NULL || table->ibeta == NULL) {
+        printf("bilinear_table_init: malloc fail\n");
+        bilinear_table_release(table);
+        return -1;
+    }
+
+    // 目标像素左上角对齐映射回源图，边缘处钳位到最后一个像素
+    // 坐标用double的乘除再加，乘积无舍入，编译器合并为FMA时各平台的表也相同
+    for (int dx = 0; dx < dst_width; dx++) {
+        double pos_x = crop_x + (double)dx * crop_width / dst_width;
+        int sx = (int)floor(pos_x);
+        float fx = (float)(pos_x - sx);
+        if (sx < 0) {
+            sx = 0;
+            fx = 0.f;
+        }
+        if (sx >= src_width - 1) {
+            sx = src_width - 1;
+            fx = 0.f;
+        }
+        int sx1 = sx + 1 < src_width ? sx + 1 : sx;
+        short a1 = (short)(fx * BILINEAR_COEF_SCALE + 0.5f);
+        table->xofs[dx * 2] = sx * src_channel;
+        table->xofs[dx * 2 + 1] = sx1 * src_channel;
+        table->ialpha[dx * 2] = BILINEAR_COEF_SCALE - a1;
+        table->ialpha[dx * 2 + 1] = a1;
+    }
+
+    for (int dy = 0; dy < dst_height; dy++) {
+        double pos_y = crop_y + (double)dy * crop_height / dst_height;
+        int sy = (int)floor(pos_y);
+        float fy = (float)(pos_y - sy);
+        if (sy < 0) {
+            sy = 0;
+            fy = 0.f;
+        }
+        if (sy >= src_height - 1) {
+            sy = src_height - 1;
+            fy = 0.f;
+        }
+        int sy1 = sy + 1 < src_height ? sy + 1 : sy;
+        short b1 = (short)(fy * BILINEAR_COEF_SCALE + 0.5f);
+        table->yofs[dy * 2] = sy;
+        table->yofs[dy * 2 + 1] = sy1;
+        table->ibeta[dy * 2] = BILINEAR_COEF_SCALE - b1;
+        table->ibeta[dy * 2 + 1] = b1;
+    }
+    return 0;
+}
+
+void bilinear_table_release(bilinear_table_t* table)
+{
+    if (table == NULL) {
+        return;
+    }
+    free(table->xofs);
+    free(table->ialpha);
+    free(table->yofs);
+    free(table->ibeta);
+    table->xofs = NULL;
+    table->ialpha = NULL;
+    table->yofs = NULL;
+    table->ibeta = NULL;
+}
+
+void bilinear_hresize_row(const bilinear_table_t* table, const unsigned char* src_row, short* dst_row)
+{
+    const int* xofs = table->xofs;
+    const short* ialpha = table->ialpha;
+    int width = table->dst_width;
+
+    // 中间结果保留7位小数: (S0 * a0 + S1 * a1) >> 4
+    switch (table->dst_channel) {
+    case 1:
+        for (int dx = 0; dx < width; dx++) {
+            const unsigned char* S0 = src_row + xofs[dx * 2];
+            const unsigned char* S1 = src_row + xofs[dx * 2 + 1];
+            int a0 = ialpha[dx * 2];
+            int a1 = ialpha[dx * 2 + 1];
+            dst_row[dx] = (short)((S0[0] * a0 + S1[0] * a1) >> 4);
+        }
+        break;
+    case 2:
+        for (int dx = 0; dx < width; dx++) {
+            const unsigned char* S0 = src_row + xofs[dx * 2];
+            const unsigned char* S1 = src_row + xofs[dx * 2 + 1];
+            int a0 = ialpha[dx * 2];
+            int a1 = ialpha[dx * 2 + 1];
+            short* D = dst_row + dx * 2;
+            D[0] = (short)((S0[0] * a0 + S1[0] * a1) >> 4);
+            D[1] = (short)((S0[1] * a0 + S1[1] * a1) >> 4);
+        }
+        break;
+    case 3:
+        for (int dx = 0; dx < width; dx++) {
+            const unsigned char* S0 = src_row + xofs[dx * 2];
+            const unsigned char* S1 = src_row + xofs[dx * 2 + 1];
+            int a0 = ialpha[dx * 2];
+            int a1 = ialpha[dx * 2 + 1];
+            short* D = dst_row + dx * 3;
+            D[0] = (short)((S0[0] * a0 + S1[0] * a1) >> 4);
+            D[1] = (short)((S0[1] * a0 + S1[1] * a1) >> 4);
+            D[2] = (short)((S0[2] * a0 + S1[2] * a1) >> 4);
+        }
+        break;
+    case 4:
+        for (int dx = 0; dx < width; dx++) {
+            const unsigned char* S0 = src_row + xofs[dx * 2];
+            const unsigned char* S1 = src_row + xofs[dx * 2 + 1];
+            int a0 = ialpha[dx * 2];
+            int a1 = ialpha[dx * 2 + 1];
+            short* D = dst_row + dx * 4;
+            D[0] = (short)((S0[0] * a0 + S1[0] * a1) >> 4);
+            D[1] = (short)((S0[1] * a0 + S1[1] * a1) >> 4);
+            D[2] = (short)((S0[2] * a0 + S1[2] * a1) >> 4);
+            D[3] = (short)((S0[3] * a0 + S1[3] * a1) >> 4);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void bilinear_vresize_row(const short* row0, const short* row1, short b0, short b1, unsigned char* dst, int count)
+{
+    int i = 0;
+
+#if defined(BILINEAR_USE_NEON)
+    int16x4_t _b0 = vdup_n_s16(b0);
+    int16x4_t _b1 = vdup_n_s16(b1);
+    for (; i + 15 < count; i += 16) {
+        int16x8_t _r00 = vld1q_s16(row0 + i);
+        int16x8_t _r01 = vld1q_s16(row0 + i + 8);
+        int16x8_t _r10 = vld1q_s16(row1 + i);
+        int16x8_t _r11 = vld1q_s16(row1 + i + 8);
+
+        int16x8_t _acc0 = vcombine_s16(vshrn_n_s32(vmull_s16(vget_low_s16(_r00), _b0), 16),
+                                       vshrn_n_s32(vmull_s16(vget_high_s16(_r00), _b0), 16));
+        int16x8_t _acc1 = vcombine_s16(vshrn_n_s32(vmull_s16(vget_low_s16(_r01), _b0), 16),
+                                       vshrn_n_s32(vmull_s16(vget_high_s16(_r01), _b0), 16));
+        _acc0 = vaddq_s16(_acc0, vcombine_s16(vshrn_n_s32(vmull_s16(vget_low_s16(_r10), _b1), 16),
+                                              vshrn_n_s32(vmull_s16(vget_high_s16(_r10), _b1), 16)));
+        _acc1 = vaddq_s16(_acc1, vcombine_s16(vshrn_n_s32(vmull_s16(vget_low_s16(_r11), _b1), 16),
+                                              vshrn_n_s32(vmull_s16(vget_high_s16(_r11), _b1), 16)));
+
+        // (acc + 2) >> 2
+        uint8x8_t _d0 = vqmovun_s16(vrshrq_n_s16(_acc0, 2));
+        uint8x8_t _d1 = vqmovun_s16(vrshrq_n_s16(_acc1, 2));
+        vst1q_u8(dst + i, vcombine_u8(_d0, _d1));
+    }
+#endif // BILINEAR_USE_NEON
+
+#if defined(BILINEAR_USE_AVX2)
+    {
+        __m256i _b0 = _mm256_set1_epi16(b0);
+        __m256i _b1 = _mm256_set1_epi16(b1);
+        __m256i _two = _mm256_set1_epi16(2);
+        for (; i + 31 < count; i += 32) {
+            __m256i _r00 = _mm256_loadu_si256((const __m256i*)(row0 + i));
+            __m256i _r01 = _mm256_loadu_si256((const __m256i*)(row0 + i + 16));
+            __m256i _r10 = _mm256_loadu_si256((const __m256i*)(row1 + i));
+            __m256i _r11 = _mm256_loadu_si256((const __m256i*)(row1 + i + 16));
+
+            __m256i _acc0 = _mm256_add_epi16(_mm256_mulhi_epi16(_r00, _b0), _mm256_mulhi_epi16(_r10, _b1));
+            __m256i _acc1 = _mm256_add_epi16(_mm256_mulhi_epi16(_r01, _b0), _mm256_mulhi_epi16(_r11, _b1));
+            _acc0 = _mm256_srai_epi16(_mm256_add_epi16(_acc0, _two), 2);
+            _acc1 = _mm256_srai_epi16(_mm256_add_epi16(_acc1, _two), 2);
+
+            // packus works per 128bit lane, restore element order
+            __m256i _d = _mm256_permute4x64_epi64(_mm256_packus_epi16(_acc0, _acc1), 0xD8);
+            _mm256_storeu_si256((__m256i*)(dst + i), _d);
+        }
+    }
+#endif // BILINEAR_USE_AVX2
+
+#if defined(BILINEAR_USE_SSE2)
+    {
+        __m128i _b0 = _mm_set1_epi16(b0);
+        __m128i _b1 = _mm_set1_epi16(b1);
+        __m128i _two = _mm_set1_epi16(2);
+        for (; i + 15 < count; i += 16) {
+            __m128i _r00 = _mm_loadu_si128((const __m128i*)(row0 + i));
+            __m128i _r01 = _mm_loadu_si128((const __m128i*)(row0 + i + 8));
+            __m128i _r10 = _mm_loadu_si128((const __m128i*)(row1 + i));
+            __m128i _r11 = _mm_loadu_si128((const __m128i*)(row1 + i + 8));
+
+            __m128i _acc0 = _mm_add_epi16(_mm_mulhi_epi16(_r00, _b0), _mm_mulhi_epi16(_r10, _b1));
+            __m128i _acc1 = _mm_add_epi16(_mm_mulhi_epi16(_r01, _b0), _mm_mulhi_epi16(_r11, _b1));
+            _acc0 = _mm_srai_epi16(_mm_add_epi16(_acc0, _two), 2);
+            _acc1 = _mm_srai_epi16(_mm_add_epi16(_acc1, _two), 2);
+
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(_acc0, _acc1));
+        }
+    }
+#endif // BILINEAR_USE_SSE2
+
+    // scalar reference, also handles the tail of SIMD loops
+    for (; i < count; i++) {
+        int v = (((b0 * row0[i]) >> 16) + ((b1 * row1[i]) >> 16) + 2) >> 2;
+        dst[i] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+}
+
+typedef struct {
+    short* rows0;
+    short* rows1;
+    int sy0;
+    int sy1;
+} bilinear_row_cache_t;
+
+static int bilinear_row_cache_init(bilinear_row_cache_t* cache, short* buf, int count)
+{
+    cache->rows0 = buf;
+    cache->rows1 = buf + count;
+    cache->sy0 = -1;
+    cache->sy1 = -1;
+    return 0;
+}
+
+// 相邻目标行大多复用同一对源行，只对新出现的源行做水平插值
+static void bilinear_fetch_rows(const bilinear_table_t* table, bilinear_row_cache_t* cache,
+                                const unsigned char* src, int src_stride, int dy)
+{
+    int sy0 = table->yofs[dy * 2];
+    int sy1 = table->yofs[dy * 2 + 1];
+
+    if (sy0 != cache->sy0) {
+        if (sy0 == cache->sy1) {
+            short* tmp = cache->rows0;
+            cache->rows0 = cache->rows1;
+            cache->rows1 = tmp;
+            cache->sy1 = cache->sy0;
+        } else {
+            bilinear_hresize_row(table, src + (size_t)sy0 * src_stride, cache->rows0);
+        }
+        cache->sy0 = sy0;
+    }
+    if (sy1 != cache->sy1) {
+        bilinear_hresize_row(table, src + (size_t)sy1 * src_stride, cache->rows1);
+        cache->sy1 = sy1;
+    }
+}
+
+int bilinear_resize_rows(const bilinear_table_t* table, const unsigned char* src, int src_stride,
+                         unsigned char* dst, int dst_stride, int dy_begin, int dy_end)
+{
+    if (table == NULL || src == NULL || dst == NULL) {
+        return -1;
+    }
+    if (dy_begin < 0) {
+        dy_begin = 0;
+    }
+    if (dy_end > table->dst_height) {
+        dy_end = table->dst_height;
+    }
+    if (dy_begin >= dy_end) {
+        return 0;
+    }
+
+    int count = table->dst_width * table->dst_channel;
+    short* buf = (short*)malloc(count * 2 * sizeof(short));
+    if (buf == NULL) {
+        printf("bilinear_resize_rows: malloc size %d fail\n", (int)(count * 2 * sizeof(short)));
+        return -1;
+    }
+    bilinear_row_cache_t cache;
+    bilinear_row_cache_init(&cache, buf, count);
+
+    for (int dy = dy_begin; dy < dy_end; dy++) {
+        bilinear_fetch_rows(table, &cache, src, src_stride, dy);
+        bilinear_vresize_row(cache.rows0, cache.rows1, table->ibeta[dy * 2], table->ibeta[dy * 2 + 1],
+                             dst + (size_t)(dy - dy_begin) * dst_stride, count);
+    }
+
+    free(buf);
+    return 0;
+}
+
+static inline unsigned char clamp_u8(int v)
+{
+    return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// BT.601 limited range, Q6 coefficients:
+// R = 1.164(Y-16) + 1.596(V-128)
+// G = 1.164(Y-16) - 0.391(U-128) - 0.813(V-128)
+// B = 1.164(Y-16) + 2.018(U-128)
+void yuv420sp_to_rgb_row(const unsigned char* y, const unsigned char* uv, int v_first, unsigned char* rgb, int width)
+{
+    int i = 0;
+    int u_idx = v_first ? 1 : 0;
+    int v_idx = v_first ? 0 : 1;
+
+#if defined(BILINEAR_USE_NEON)
+    int16x8_t _c16 = vdupq_n_s16(16);
+    int16x8_t _c128 = vdupq_n_s16(128);
+    for (; i + 7 < width; i += 8) {
+        int16x8_t _y = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + i)));
+        uint8x8x2_t _uv = vld2_u8(uv + i * 2);
+        int16x8_t _u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(_uv.val[u_idx])), _c128);
+        int16x8_t _v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(_uv.val[v_idx])), _c128);
+        int16x8_t _yy = vmulq_n_s16(vsubq_s16(_y, _c16), 74);
+
+        int16x8_t _r = vqaddq_s16(_yy, vmulq_n_s16(_v, 102));
+        int16x8_t _g = vqsubq_s16(vqsubq_s16(_yy, vmulq_n_s16(_u, 25)), vmulq_n_s16(_v, 52));
+        int16x8_t _b = vqaddq_s16(_yy, vmulq_n_s16(_u, 129));
+
+        uint8x8x3_t _rgb;
+        _rgb.val[0] = vqrshrun_n_s16(_r, 6);
+        _rgb.val[1] = vqrshrun_n_s16(_g, 6);
+        _rgb.val[2] = vqrshrun_n_s16(_b, 6);
+        vst3_u8(rgb + i * 3, _rgb);
+    }
+#elif defined(BILINEAR_USE_SSE2)
+    {
+        __m128i _zero = _mm_setzero_si128();
+        __m128i _c16 = _mm_set1_epi16(16);
+        __m128i _c128 = _mm_set1_epi16(128);
+        __m128i _c32 = _mm_set1_epi16(32);
+        __m128i _mask = _mm_set1_epi16(0x00FF);
+        unsigned char tmp[3][16];
+        for (; i + 7 < width; i += 8) {
+            __m128i _y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(y + i)), _zero);
+            __m128i _uv = _mm_loadu_si128((const __m128i*)(uv + i * 2));
+            __m128i _lo = _mm_sub_epi16(_mm_and_si128(_uv, _mask), _c128);
+            __m128i _hi = _mm_sub_epi16(_mm_srli_epi16(_uv, 8), _c128);
+            __m128i _u = v_first ? _hi : _lo;
+            __m128i _v = v_first ? _lo : _hi;
+            __m128i _yy = _mm_mullo_epi16(_mm_sub_epi16(_y, _c16), _mm_set1_epi16(74));
+
+            __m128i _r = _mm_adds_epi16(_yy, _mm_mullo_epi16(_v, _mm_set1_epi16(102)));
+            __m128i _g = _mm_subs_epi16(_mm_subs_epi16(_yy, _mm_mullo_epi16(_u, _mm_set1_epi16(25))),
+                                        _mm_mullo_epi16(_v, _mm_set1_epi16(52)));
+            __m128i _b = _mm_adds_epi16(_yy, _mm_mullo_epi16(_u, _mm_set1_epi16(129)));
+
+            // (x + 32) >> 6 without overflow near INT16_MAX: saturated values clamp to 255 anyway
+            _r = _mm_srai_epi16(_mm_adds_epi16(_r, _c32), 6);
+            _g = _mm_srai_epi16(_mm_adds_epi16(_g, _c32), 6);
+            _b = _mm_srai_epi16(_mm_adds_epi16(_b, _c32), 6);
+
+            _mm_storel_epi64((__m128i*)tmp[0], _mm_packus_epi16(_r, _r));
+            _mm_storel_epi64((__m128i*)tmp[1], _mm_packus_epi16(_g, _g));
+            _mm_storel_epi64((__m128i*)tmp[2], _mm_packus_epi16(_b, _b));
+            unsigned char* p = rgb + i * 3;
+            for (int k = 0; k < 8; k++) {
+                p[k * 3 + 0] = tmp[0][k];
+                p[k * 3 + 1] = tmp[1][k];
+                p[k * 3 + 2] = tmp[2][k];
+            }
+        }
+    }
+#endif
+
+    for (; i < width; i++) {
+        int yy = (y[i] - 16) * 74;
+        int u = uv[i * 2 + u_idx] - 128;
+        int v = uv[i * 2 + v_idx] - 128;
+        rgb[i * 3 + 0] = clamp_u8((yy + 102 * v + 32) >> 6);
+        rgb[i * 3 + 1] = clamp_u8((yy - 25 * u - 52 * v + 32) >> 6);
+        rgb[i * 3 + 2] = clamp_u8((yy + 129 * u + 32) >> 6);
+    }
+}
+
+int bilinear_resize_yuv420sp_to_rgb_rows(const bilinear_table_t* y_table, const bilinear_table_t* uv_table,
+                                         const unsigned char* src_y, int y_stride,
+                                         const unsigned char* src_uv, int uv_stride, int v_first,
+                                         unsigned char* dst, int dst_stride, int dy_begin, int dy_end)
+{
+    if (y_table == NULL || uv_table == NULL || src_y == NULL || src_uv == NULL || dst == NULL) {
+        return -1;
+    }
+    if (dy_begin < 0) {
+        dy_begin = 0;
+    }
+    if (dy_end > y_table->dst_height) {
+        dy_end = y_table->dst_height;
+    }
+    if (dy_begin >= dy_end) {
+        return 0;
+    }
+
+    int width = y_table->dst_width;
+    // Y行缓存 + UV行缓存 + 插值后的一行Y和UV
+    short* buf = (short*)malloc((width * 2 + width * 4) * sizeof(short) + width * 3);
+    if (buf == NULL) {
+        printf("bilinear_resize_yuv420sp_to_rgb_rows: malloc fail\n");
+        return -1;
+    }
+    bilinear_row_cache_t y_cache;
+    bilinear_row_cache_t uv_cache;
+    bilinear_row_cache_init(&y_cache, buf, width);
+    bilinear_row_cache_init(&uv_cache, buf + width * 2, width * 2);
+    unsigned char* y_row = (unsigned char*)(buf + width * 6);
+    unsigned char* uv_row = y_row + width;
+
+    for (int dy = dy_begin; dy < dy_end; dy++) {
+        bilinear_fetch_rows(y_table, &y_cache, src_y, y_stride, dy);
+        bilinear_vresize_row(y_cache.rows0, y_cache.rows1, y_table->ibeta[dy * 2], y_table->ibeta[dy * 2 + 1],
+                             y_row, width);
+        bilinear_fetch_rows(uv_table, &uv_cache, src_uv, uv_stride, dy);
+        bilinear_vresize_row(uv_cache.rows0, uv_cache.rows1, uv_table->ibeta[dy * 2], uv_table->ibeta[dy * 2 + 1],
+                             uv_row, width * 2);
+        yuv420sp_to_rgb_row(y_row, uv_row, v_first, dst + (size_t)(dy - dy_begin) * dst_stride, width);
+    }
+
+    free(buf);
+    return 0;
+}
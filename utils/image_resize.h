@@ -0,0 +1,136 @@
+#ifndef _RKNN_MODEL_ZOO_IMAGE_RESIZE_H_
+#define _RKNN_MODEL_ZOO_IMAGE_RESIZE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Separable fixed-point bilinear resize used by the CPU path of image_utils.
+ *
+ * Horizontal weights are Q11, the intermediate rows are int16 with 7 fraction
+ * bits and the vertical pass uses Q11 weights with a (x * w) >> 16 multiply, so
+ * the scalar, NEON and SSE/AVX2 kernels produce bit-identical output.
+ * Define IMAGE_UTILS_DISABLE_SIMD to force the scalar reference kernels.
+ *
+ * Cross format paths (RGBA8888 -> RGB888, YUV420SP -> RGB888) convert while
+ * resizing, so the source is read only once.
+ */
+
+#define BILINEAR_COEF_BITS 11
+#define BILINEAR_COEF_SCALE (1 << BILINEAR_COEF_BITS)
+
+/**
+ * @brief Precomputed source indices and weights of one resize
+ *
+ */
+typedef struct {
+    int src_channel;    // bytes per pixel of source plane
+    int dst_channel;    // bytes per pixel written to target plane
+    int dst_width;      // target box width
+    int dst_height;     // target box height
+    int* xofs;          // [dst_width * 2] byte offsets of left/right source pixel in a row
+    short* ialpha;      // [dst_width * 2] Q11 horizontal weights
+    int* yofs;          // [dst_height * 2] top/bottom source row index
+    short* ibeta;       // [dst_height * 2] Q11 vertical weights
+} bilinear_table_t;
+
+/**
+ * @brief Build resize tables
+ *
+ * @param table [out] Tables, remember call bilinear_table_release() after used
+ * @param src_channel [in] Bytes per pixel of source plane
+ * @param dst_channel [in] Bytes per pixel of target plane (<= src_channel)
+ * @param src_width [in] Source plane width, sampling is clamped to it
+ * @param src_height [in] Source plane height, sampling is clamped to it
+ * @param crop_x [in] Crop rectangle on source plane (may be fractional for subsampled planes)
+ * @param crop_y [in] Crop rectangle on source plane
+ * @param crop_width [in] Crop rectangle on source plane
+ * @param crop_height [in] Crop rectangle on source plane
+ * @param dst_width [in] Target box width
+ * @param dst_height [in] Target box height
+ * @return int 0: success; -1: error
+ */
+int bilinear_table_init(bilinear_table_t* table, int src_channel, int dst_channel, int src_width, int src_height,
+                        float crop_x, float crop_y, float crop_width, float crop_height, int dst_width, int dst_height);
+
+/**
+ * @brief Release resize tables
+ *
+ * @param table [in] Tables
+ */
+void bilinear_table_release(bilinear_table_t* table);
+
+/**
+ * @brief Resize rows [dy_begin, dy_end) of target box
+ *
+ * @param table [in] Resize tables
+ * @param src [in] Source plane (row 0, column 0)
+ * @param src_stride [in] Source row stride in bytes
+ * @param dst [out] First pixel of row dy_begin in target box
+ * @param dst_stride [in] Target row stride in bytes
+ * @param dy_begin [in] First target row of box
+ * @param dy_end [in] End target row of box (exclusive)
+ * @return int 0: success; -1: error
+ */
+int bilinear_resize_rows(const bilinear_table_t* table, const unsigned char* src, int src_stride,
+                         unsigned char* dst, int dst_stride, int dy_begin, int dy_end);
+
+/**
+ * @brief Horizontal pass of one source row into int16 intermediate row
+ *
+ * @param table [in] Resize tables
+ * @param src_row [in] Source row
+ * @param dst_row [out] Intermediate row of dst_width * dst_channel elements
+ */
+void bilinear_hresize_row(const bilinear_table_t* table, const unsigned char* src_row, short* dst_row);
+
+/**
+ * @brief Vertical pass of two intermediate rows into one target row
+ *
+ * @param row0 [in] Intermediate top row
+ * @param row1 [in] Intermediate bottom row
+ * @param b0 [in] Q11 weight of top row
+ * @param b1 [in] Q11 weight of bottom row
+ * @param dst [out] Target row
+ * @param count [in] Element count (width * channel)
+ */
+void bilinear_vresize_row(const short* row0, const short* row1, short b0, short b1, unsigned char* dst, int count);
+
+/**
+ * @brief Convert one row of YUV420SP (chroma already at luma resolution) to RGB888
+ *
+ * @param y [in] Luma row
+ * @param uv [in] Interleaved chroma row, 2 bytes per pixel
+ * @param v_first [in] 0: NV12 (UV order); 1: NV21 (VU order)
+ * @param rgb [out] RGB888 row
+ * @param width [in] Pixel count
+ */
+void yuv420sp_to_rgb_row(const unsigned char* y, const unsigned char* uv, int v_first, unsigned char* rgb, int width);
+
+/**
+ * @brief Resize YUV420SP and convert to RGB888 in one pass, rows [dy_begin, dy_end) of target box
+ *
+ * @param y_table [in] Luma tables (1 -> 1 channel, target box size)
+ * @param uv_table [in] Chroma tables (2 -> 2 channel on half size plane, target box size)
+ * @param src_y [in] Source luma plane
+ * @param y_stride [in] Source luma row stride in bytes
+ * @param src_uv [in] Source chroma plane
+ * @param uv_stride [in] Source chroma row stride in bytes
+ * @param v_first [in] 0: NV12; 1: NV21
+ * @param dst [out] First pixel of row dy_begin in target box of RGB888 image
+ * @param dst_stride [in] Target row stride in bytes
+ * @param dy_begin [in] First target row of box
+ * @param dy_end [in] End target row of box (exclusive)
+ * @return int 0: success; -1: error
+ */
+int bilinear_resize_yuv420sp_to_rgb_rows(const bilinear_table_t* y_table, const bilinear_table_t* uv_table,
+                                         const unsigned char* src_y, int y_stride,
+                                         const unsigned char* src_uv, int uv_stride, int v_first,
+                                         unsigned char* dst, int dst_stride, int dy_begin, int dy_end);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif // _RKNN_MODEL_ZOO_IMAGE_RESIZE_H_
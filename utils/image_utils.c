@@ -2,6 +2,11 @@
 #include <stdlib.h>
 #include <dirent.h>
 #include <math.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
 #include "im2d.h"
@@ -19,6 +24,8 @@
 #include "turbojpeg.h"
 
 #include "image_utils.h"
+#include "image_resize.h"
+#include "thread_pool.h"
 #include "file_utils.h"
 
 static const char* filter_image_names[] = {
@@ -39,113 +46,681 @@ static const char* colorspaceName[TJ_NUMCS] = {"RGB", "YCbCr", "GRAY", "CMYK", "
 static int image_file_filter(const struct dirent *entry)
 {
     const char ** filter;
+    const char* ext = strrchr(entry->d_name, '.');
+    if (ext == NULL) {
+        return 0;
+    }
 
     for (filter = filter_image_names; *filter; ++filter) {
-        if(strstr(entry->d_name, *filter) != NULL) {
+        if(strcmp(ext + 1, *filter) == 0) {
             return 1;
         }
     }
     return 0;
 }
 
-static int read_image_jpeg(const char* path, image_buffer_t* image)
-{
-    FILE* jpegFile = NULL;
-    unsigned long jpegSize;
-    int flags = 0;
-    int width, height;
-    int origin_width, origin_height;
-    unsigned char* imgBuf = NULL;
-    unsigned char* jpegBuf = NULL;
-    unsigned long size;
-    unsigned short orientation = 1;
-    struct timeval tv1, tv2;
+static int get_format_channel(image_format_t fmt) {
+    switch (fmt) {
+    case IMAGE_FORMAT_GRAY8:
+    case IMAGE_FORMAT_YUV420SP_NV12:
+    case IMAGE_FORMAT_YUV420SP_NV21:
+        return 1;
+    case IMAGE_FORMAT_RGB888:
+        return 3;
+    case IMAGE_FORMAT_RGBA8888:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static int is_yuv420sp(image_format_t fmt) {
+    return fmt == IMAGE_FORMAT_YUV420SP_NV12 || fmt == IMAGE_FORMAT_YUV420SP_NV21;
+}
+
+// width_stride/height_stride为0(或小于宽高)时按紧密排列处理
+static int get_width_stride(const image_buffer_t* image) {
+    return image->width_stride > image->width ? image->width_stride : image->width;
+}
+
+static int get_height_stride(const image_buffer_t* image) {
+    return image->height_stride > image->height ? image->height_stride : image->height;
+}
+
+// 每行字节数，yuv420sp的Y平面和UV平面相同
+static int get_row_bytes(const image_buffer_t* image) {
+    return get_width_stride(image) * get_format_channel(image->format);
+}
+
+static unsigned char* get_uv_plane(const image_buffer_t* image) {
+    return image->virt_addr + (size_t)get_width_stride(image) * get_height_stride(image);
+}
 
-    if ((jpegFile = fopen(path, "rb")) == NULL) {
-        printf("open input file failure\n");
+static int read_jpeg_file(const char* path, unsigned char** jpeg_buf, size_t* capacity, unsigned long* jpeg_size)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("open input file %s failure\n", path);
+        return -1;
+    }
+    long size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0) {
+        size = ftell(fp);
     }
-    if (fseek(jpegFile, 0, SEEK_END) < 0 || (size = ftell(jpegFile)) < 0 || fseek(jpegFile, 0, SEEK_SET) < 0) {
+    if (size <= 0 || fseek(fp, 0, SEEK_SET) != 0) {
         printf("determining input file size failure\n");
+        fclose(fp);
+        return -1;
+    }
+    // 缓冲区只增长不缩小，批量读取时不再重复分配
+    if (*jpeg_buf == NULL || *capacity < (size_t)size) {
+        unsigned char* buf = (unsigned char*)realloc(*jpeg_buf, size);
+        if (buf == NULL) {
+            printf("allocating JPEG buffer failure\n");
+            fclose(fp);
+            return -1;
+        }
+        *jpeg_buf = buf;
+        *capacity = size;
+    }
+    if (fread(*jpeg_buf, size, 1, fp) < 1) {
+        printf("reading input file failure\n");
+        fclose(fp);
+        return -1;
     }
-    if (size == 0) {
-        printf("determining input file size, Input file contains no data\n");
+    fclose(fp);
+    *jpeg_size = (unsigned long)size;
+    return 0;
+}
+
+// 选择不小于需要尺寸的最小缩放系数，只使用1/2、1/4、1/8，保证解码坐标到原图坐标的映射为整数偏移
+static tjscalingfactor get_jpeg_scaling_factor(int width, int height, const image_read_option_t* option)
+{
+    tjscalingfactor best = {1, 1};
+    if (option == NULL || option->target_width <= 0 || option->target_height <= 0) {
+        return best;
     }
-    jpegSize = (unsigned long)size;
-    if ((jpegBuf = (unsigned char*)malloc(jpegSize * sizeof(unsigned char))) == NULL) {
-        printf("allocating JPEG buffer\n");
+    int need_w = option->target_width;
+    int need_h = option->target_height;
+    if (option->keep_ratio) {
+        float scale_w = (float)option->target_width / width;
+        float scale_h = (float)option->target_height / height;
+        float scale = scale_w < scale_h ? scale_w : scale_h;
+        need_w = (int)ceilf(width * scale);
+        need_h = (int)ceilf(height * scale);
     }
-    if (fread(jpegBuf, jpegSize, 1, jpegFile) < 1) {
-        printf("reading input file");
+    int num_factors = 0;
+    tjscalingfactor* factors = tjGetScalingFactors(&num_factors);
+    for (int i = 0; factors != NULL && i < num_factors; i++) {
+        tjscalingfactor f = factors[i];
+        if (f.num != 1 || f.denom < best.denom) {
+            continue;
+        }
+        if (TJSCALED(width, f) >= need_w && TJSCALED(height, f) >= need_h) {
+            best = f;
+        }
     }
-    fclose(jpegFile);
-    jpegFile = NULL;
+    return best;
+}
 
-    tjhandle handle = NULL;
-    int subsample, colorspace;
-    int padding = 1;
-    int ret = 0;
+/**
+ * Geometry of one JPEG decode, computed from header and options before any buffer is allocated
+ */
+typedef struct {
+    int subsample;
+    int roi_x;
+    int roi_y;
+    int roi_w;
+    int roi_h;
+    int crop;               // lossless crop to (crop_x, crop_y, decode_w, decode_h) before decode
+    int crop_x;
+    int crop_y;
+    int decode_w;
+    int decode_h;
+    tjscalingfactor factor;
+    int scaled_w;
+    int scaled_h;
+    int to_nv12;
+    int trim_x;             // decoded pixels dropped on the left/top of output
+    int trim_y;
+    int out_w;
+    int out_h;
+    int out_size;           // bytes of output buffer needed while decoding
+    size_t scratch_size;    // bytes of temporary buffer needed while decoding
+} jpeg_decode_info_t;
+
+static int get_jpeg_decode_info(tjhandle handle, const unsigned char* jpeg_buf, unsigned long jpeg_size,
+                                const image_read_option_t* option, jpeg_decode_info_t* info)
+{
+    int width, height, subsample, colorspace;
+    memset(info, 0, sizeof(jpeg_decode_info_t));
+    if (tjDecompressHeader3(handle, jpeg_buf, jpeg_size, &width, &height, &subsample, &colorspace) < 0) {
+        printf("header file error, errorStr:%s, errorCode:%d\n", tjGetErrorStr2(handle), tjGetErrorCode(handle));
+        return -1;
+    }
+    if (subsample < 0 || subsample >= TJ_NUMSAMP || colorspace < 0 || colorspace >= TJ_NUMCS) {
+        printf("not support subsampling %d colorspace %d\n", subsample, colorspace);
+        return -1;
+    }
+    printf("input image: %d x %d, subsampling: %s, colorspace: %s\n",
+            width, height, subsampName[subsample], colorspaceName[colorspace]);
+    info->subsample = subsample;
+
+    info->roi_w = width;
+    info->roi_h = height;
+    if (option != NULL && option->roi != NULL) {
+        info->roi_x = option->roi->left > 0 ? option->roi->left : 0;
+        info->roi_y = option->roi->top > 0 ? option->roi->top : 0;
+        info->roi_w = (option->roi->right < width ? option->roi->right + 1 : width) - info->roi_x;
+        info->roi_h = (option->roi->bottom < height ? option->roi->bottom + 1 : height) - info->roi_y;
+        if (info->roi_w <= 0 || info->roi_h <= 0) {
+            printf("invalid roi (%d %d %d %d) for image %dx%d\n", option->roi->left, option->roi->top,
+                option->roi->right, option->roi->bottom, width, height);
+            return -1;
+        }
+    }
 
-    handle = tjInitDecompress();
-    ret = tjDecompressHeader3(handle, jpegBuf, size, &origin_width, &origin_height, &subsample, &colorspace);
-    if (ret < 0) {
-        printf("header file error, errorStr:%s, errorCode:%d\n", tjGetErrorStr(), tjGetErrorCode(handle));
+    // 无损裁剪要求左上角对齐到MCU，解码后再去掉多出的部分
+    info->decode_w = width;
+    info->decode_h = height;
+    if (info->roi_w != width || info->roi_h != height) {
+        info->crop = 1;
+        info->crop_x = info->roi_x / tjMCUWidth[subsample] * tjMCUWidth[subsample];
+        info->crop_y = info->roi_y / tjMCUHeight[subsample] * tjMCUHeight[subsample];
+        info->decode_w = info->roi_x + info->roi_w - info->crop_x;
+        info->decode_h = info->roi_y + info->roi_h - info->crop_y;
+    }
+
+    info->factor = get_jpeg_scaling_factor(info->roi_w, info->roi_h, option);
+    info->scaled_w = TJSCALED(info->decode_w, info->factor);
+    info->scaled_h = TJSCALED(info->decode_h, info->factor);
+
+    // NV12输出要求偏移和尺寸为偶数
+    info->to_nv12 = (option != NULL && option->to_nv12);
+    info->trim_x = (info->roi_x - info->crop_x) * info->factor.num / info->factor.denom;
+    info->trim_y = (info->roi_y - info->crop_y) * info->factor.num / info->factor.denom;
+    if (info->to_nv12) {
+        info->trim_x &= ~1;
+        info->trim_y &= ~1;
+    }
+    info->out_w = info->scaled_w - info->trim_x;
+    info->out_h = info->scaled_h - info->trim_y;
+    if (info->to_nv12) {
+        info->out_w &= ~1;
+        info->out_h &= ~1;
+        if (info->out_w <= 0 || info->out_h <= 0) {
+            printf("decode nv12 invalid size %dx%d\n", info->out_w, info->out_h);
+            return -1;
+        }
+        // 平面宽高按MCU补齐，可能大于图像尺寸
+        int yw = tjPlaneWidth(0, info->scaled_w, subsample);
+        int yh = tjPlaneHeight(0, info->scaled_h, subsample);
+        size_t chroma_size = 0;
+        if (subsample != TJSAMP_GRAY) {
+            chroma_size = (size_t)tjPlaneWidth(1, info->scaled_w, subsample) *
+                tjPlaneHeight(1, info->scaled_h, subsample) * 2;
+        }
+        int direct_y = (info->trim_x == 0 && info->trim_y == 0 && info->out_w == yw && info->out_h == yh);
+        info->out_size = info->out_w * info->out_h * 3 / 2;
+        info->scratch_size = (size_t)info->out_w * sizeof(int) + chroma_size + (direct_y ? 0 : (size_t)yw * yh);
+    } else {
+        // 先按缩放后的完整尺寸解码，再原地去掉多余部分
+        info->out_size = info->scaled_w * info->scaled_h * 3;
+    }
+    return 0;
+}
+
+static int decode_jpeg_to_rgb(tjhandle handle, const unsigned char* jpeg_buf, unsigned long jpeg_size,
+                              const jpeg_decode_info_t* info, unsigned char* out_buf)
+{
+    int ret = tjDecompress2(handle, jpeg_buf, jpeg_size, out_buf, info->scaled_w, 0, info->scaled_h, TJPF_RGB, 0);
+    // 错误码为0时，表示警告，错误码为-1时表示错误
+    if (ret < 0 && tjGetErrorCode(handle) != TJERR_WARNING) {
+        printf("error : decompress failed, errorStr:%s, errorCode:%d\n", tjGetErrorStr2(handle), tjGetErrorCode(handle));
         return -1;
     }
+    // 行只向前移动所以可以原地裁剪
+    if (info->trim_x > 0 || info->trim_y > 0) {
+        for (int y = 0; y < info->out_h; y++) {
+            memmove(out_buf + y * info->out_w * 3,
+                out_buf + ((y + info->trim_y) * info->scaled_w + info->trim_x) * 3, info->out_w * 3);
+        }
+    }
+    return 0;
+}
 
-    // 对图像做裁剪16对齐，利于后续rga操作
-    int crop_width = origin_width / 16 * 16;
-    int crop_height = origin_height / 16 * 16;
+/*
+ * 解码为平面YUV再交织成NV12: 无裁剪且平面尺寸与输出一致时Y直接解码到输出并原地转换范围，
+ * UV按输出的2x2亮度块对应的源色度取平均，兼容4:2:0以外的采样方式
+ */
+static int decode_jpeg_to_nv12(tjhandle handle, const unsigned char* jpeg_buf, unsigned long jpeg_size,
+                               const jpeg_decode_info_t* info, unsigned char* out_buf, unsigned char* scratch)
+{
+    int out_w = info->out_w;
+    int out_h = info->out_h;
+    int gray = (info->subsample == TJSAMP_GRAY);
+    int yw = tjPlaneWidth(0, info->scaled_w, info->subsample);
+    int yh = tjPlaneHeight(0, info->scaled_h, info->subsample);
+    int cw = gray ? 0 : tjPlaneWidth(1, info->scaled_w, info->subsample);
+    int ch = gray ? 0 : tjPlaneHeight(1, info->scaled_h, info->subsample);
+    int direct_y = (info->trim_x == 0 && info->trim_y == 0 && out_w == yw && out_h == yh);
+
+    int* xofs = (int*)scratch;
+    unsigned char* chroma = scratch + (size_t)out_w * sizeof(int);
+    unsigned char* planes[3];
+    int strides[3];
+    planes[0] = direct_y ? out_buf : chroma + (size_t)cw * ch * 2;
+    planes[1] = gray ? NULL : chroma;
+    planes[2] = gray ? NULL : chroma + (size_t)cw * ch;
+    strides[0] = yw;
+    strides[1] = cw;
+    strides[2] = cw;
+    int ret = tjDecompressToYUVPlanes(handle, jpeg_buf, jpeg_size, planes, info->scaled_w, strides, info->scaled_h, 0);
+    if (ret < 0 && tjGetErrorCode(handle) != TJERR_WARNING) {
+        printf("error : decompress to yuv failed, errorStr:%s, errorCode:%d\n", tjGetErrorStr2(handle),
+               tjGetErrorCode(handle));
+        return -1;
+    }
 
-    printf("origin size=%dx%d crop size=%dx%d\n", origin_width, origin_height, crop_width, crop_height);
+    // JPEG为全范围YCbCr，转换到与RGA及convert_image一致的BT.601有限范围
+    unsigned char y_lut[256];
+    unsigned char c_lut[256];
+    for (int i = 0; i < 256; i++) {
+        y_lut[i] = (unsigned char)(16 + (i * 219 + 127) / 255);
+        c_lut[i] = (unsigned char)(128 + ((i - 128) * 224 + (i >= 128 ? 127 : -127)) / 255);
+    }
+    for (int y = 0; y < out_h; y++) {
+        const unsigned char* src_row = planes[0] + (size_t)(y + info->trim_y) * yw + info->trim_x;
+        unsigned char* dst_row = out_buf + y * out_w;
+        for (int x = 0; x < out_w; x++) {
+            dst_row[x] = y_lut[src_row[x]];
+        }
+    }
 
-    // gettimeofday(&tv1, NULL);
-    ret = tjDecompressHeader3(handle, jpegBuf, size, &width, &height, &subsample, &colorspace);
-    if (ret < 0) {
-        printf("header file error, errorStr:%s, errorCode:%d\n", tjGetErrorStr(), tjGetErrorCode(handle));
+    unsigned char* uv = out_buf + out_w * out_h;
+    int uv_w = out_w / 2;
+    int uv_h = out_h / 2;
+    if (gray) {
+        memset(uv, 128, uv_w * uv_h * 2);
+        return 0;
+    }
+    for (int x = 0; x < uv_w; x++) {
+        int lx = info->trim_x + x * 2;
+        xofs[x * 2] = lx * cw / yw;
+        xofs[x * 2 + 1] = (lx + 1) * cw / yw;
+    }
+    for (int y = 0; y < uv_h; y++) {
+        int ly = info->trim_y + y * 2;
+        const unsigned char* u0 = planes[1] + (size_t)(ly * ch / yh) * cw;
+        const unsigned char* u1 = planes[1] + (size_t)((ly + 1) * ch / yh) * cw;
+        const unsigned char* v0 = u0 + (size_t)cw * ch;
+        const unsigned char* v1 = u1 + (size_t)cw * ch;
+        unsigned char* row = uv + y * uv_w * 2;
+        for (int x = 0; x < uv_w; x++) {
+            int x0 = xofs[x * 2];
+            int x1 = xofs[x * 2 + 1];
+            row[x * 2] = c_lut[(u0[x0] + u0[x1] + u1[x0] + u1[x1] + 2) >> 2];
+            row[x * 2 + 1] = c_lut[(v0[x0] + v0[x1] + v1[x0] + v1[x1] + 2) >> 2];
+        }
+    }
+    return 0;
+}
+
+/*
+ * 按info解码到out_buf(至少info->out_size字节)，scratch至少info->scratch_size字节，
+ * 需要裁剪时handle必须由tjInitTransform创建
+ */
+static int decode_jpeg_with_info(tjhandle handle, const unsigned char* jpeg_buf, unsigned long jpeg_size,
+                                 const jpeg_decode_info_t* info, unsigned char* out_buf, unsigned char* scratch,
+                                 image_buffer_t* image, letterbox_t* letterbox)
+{
+    unsigned char* crop_buf = NULL;
+    if (info->crop) {
+        tjtransform transform;
+        memset(&transform, 0, sizeof(tjtransform));
+        transform.r.x = info->crop_x;
+        transform.r.y = info->crop_y;
+        transform.r.w = info->decode_w;
+        transform.r.h = info->decode_h;
+        transform.op = TJXOP_NONE;
+        transform.options = TJXOPT_CROP;
+        unsigned long crop_size = 0;
+        if (tjTransform(handle, jpeg_buf, jpeg_size, 1, &crop_buf, &crop_size, &transform, 0) < 0) {
+            printf("crop jpeg fail, errorStr:%s\n", tjGetErrorStr2(handle));
+            if (crop_buf != NULL) {
+                tjFree(crop_buf);
+            }
+            return -1;
+        }
+        jpeg_buf = crop_buf;
+        jpeg_size = crop_size;
+    }
+    int ret;
+    if (info->to_nv12) {
+        ret = decode_jpeg_to_nv12(handle, jpeg_buf, jpeg_size, info, out_buf, scratch);
+    } else {
+        ret = decode_jpeg_to_rgb(handle, jpeg_buf, jpeg_size, info, out_buf);
+    }
+    if (crop_buf != NULL) {
+        tjFree(crop_buf);
+    }
+    if (ret != 0) {
         return -1;
     }
-    printf("input image: %d x %d, subsampling: %s, colorspace: %s, orientation: %d\n", 
-            width, height, subsampName[subsample], colorspaceName[colorspace], orientation);
-    int sw_out_size = width * height * 3;
-    unsigned char* sw_out_buf = image->virt_addr;
-    if (sw_out_buf == NULL) {
-        sw_out_buf = (unsigned char*)malloc(sw_out_size * sizeof(unsigned char));
+
+    image->width = info->out_w;
+    image->height = info->out_h;
+    image->width_stride = info->out_w;
+    image->height_stride = info->out_h;
+    image->virt_addr = out_buf;
+    if (info->to_nv12) {
+        image->format = IMAGE_FORMAT_YUV420SP_NV12;
+        image->size = info->out_w * info->out_h * 3 / 2;
+    } else {
+        image->format = IMAGE_FORMAT_RGB888;
+        image->size = info->out_w * info->out_h * 3;
     }
-    if (sw_out_buf == NULL) {
-        printf("sw_out_buf is NULL\n");
-        goto out;
+    if (letterbox != NULL) {
+        // 原图坐标 = (x - x_pad) / scale，MCU尺寸是缩放分母的倍数，偏移为整数
+        letterbox->scale = (float)info->factor.num / info->factor.denom;
+        letterbox->x_pad = -(info->crop_x * info->factor.num / info->factor.denom + info->trim_x);
+        letterbox->y_pad = -(info->crop_y * info->factor.num / info->factor.denom + info->trim_y);
     }
+    return 0;
+}
 
-    flags |= 0;
+// 单次解码: 输出写入image->virt_addr(由调用者保证大小)或新分配的内存
+static int decode_jpeg_with_option(tjhandle handle, const unsigned char* jpeg_buf, unsigned long jpeg_size,
+                                   const image_read_option_t* option, image_buffer_t* image, letterbox_t* letterbox)
+{
+    jpeg_decode_info_t info;
+    if (get_jpeg_decode_info(handle, jpeg_buf, jpeg_size, option, &info) != 0) {
+        return -1;
+    }
+    unsigned char* out_buf = image->virt_addr;
+    if (out_buf == NULL) {
+        out_buf = (unsigned char*)malloc(info.out_size);
+    }
+    unsigned char* scratch = NULL;
+    if (info.scratch_size > 0) {
+        scratch = (unsigned char*)malloc(info.scratch_size);
+    }
+    int ret = -1;
+    if (out_buf == NULL || (info.scratch_size > 0 && scratch == NULL)) {
+        printf("malloc size %d error\n", info.out_size);
+    } else {
+        ret = decode_jpeg_with_info(handle, jpeg_buf, jpeg_size, &info, out_buf, scratch, image, letterbox);
+    }
+    free(scratch);
+    if (ret != 0 && out_buf != image->virt_addr) {
+        free(out_buf);
+    }
+    return ret;
+}
 
-    // 错误码为0时，表示警告，错误码为-1时表示错误
-    int pixelFormat = TJPF_RGB;
-    ret = tjDecompress2(handle, jpegBuf, size, sw_out_buf, width, 0, height, pixelFormat, flags);
-    // ret = tjDecompressToYUV2(handle, jpeg_buf, size, dst_buf, *width, padding, *height, flags);
-    if ((0 != tjGetErrorCode(handle)) && (ret < 0)) {
-        printf("error : decompress to yuv failed, errorStr:%s, errorCode:%d\n", tjGetErrorStr(),
-               tjGetErrorCode(handle));
-        goto out;
+static int read_image_jpeg_with_option(const char* path, image_buffer_t* image, const image_read_option_t* option,
+                                       letterbox_t* letterbox)
+{
+    unsigned char* jpeg_buf = NULL;
+    size_t capacity = 0;
+    unsigned long jpeg_size = 0;
+    if (read_jpeg_file(path, &jpeg_buf, &capacity, &jpeg_size) != 0) {
+        free(jpeg_buf);
+        return -1;
     }
-    if ((0 == tjGetErrorCode(handle)) && (ret < 0)) {
-        printf("warning : errorStr:%s, errorCode:%d\n", tjGetErrorStr(), tjGetErrorCode(handle));
+    // 变换句柄同时支持解码和无损裁剪
+    int need_crop = (option != NULL && option->roi != NULL);
+    tjhandle handle = need_crop ? tjInitTransform() : tjInitDecompress();
+    if (handle == NULL) {
+        printf("init jpeg handle fail: %s\n", tjGetErrorStr2(NULL));
+        free(jpeg_buf);
+        return -1;
     }
+    int ret = decode_jpeg_with_option(handle, jpeg_buf, jpeg_size, option, image, letterbox);
     tjDestroy(handle);
-    // gettimeofday(&tv2, NULL);
-    // printf("decode time %ld ms\n", (tv2.tv_sec-tv1.tv_sec)*1000 + (tv2.tv_usec-tv1.tv_usec)/1000);
-
-    image->width = width;
-    image->height = height;
-    image->format = IMAGE_FORMAT_RGB888;
-    image->virt_addr = sw_out_buf;
-    image->size = sw_out_size;
-out:
-    if (jpegBuf) {
-        free(jpegBuf);
+    free(jpeg_buf);
+    return ret;
+}
+
+static int read_image_jpeg(const char* path, image_buffer_t* image)
+{
+    return read_image_jpeg_with_option(path, image, NULL, NULL);
+}
+
+typedef char raw_image_header_size_check[sizeof(raw_image_header_t) == 64 ? 1 : -1];
+
+struct raw_image_reader {
+    unsigned char* data;
+    size_t size;
+    raw_image_header_t header;
+    int count;
+};
+
+struct raw_image_writer {
+    FILE* fp;
+    raw_image_header_t header;
+};
+
+static size_t align_up(size_t size, size_t align)
+{
+    return (size + align - 1) / align * align;
+}
+
+static void fill_raw_image_header(raw_image_header_t* header, const image_buffer_t* image)
+{
+    memset(header, 0, sizeof(raw_image_header_t));
+    memcpy(header->magic, RAW_IMAGE_MAGIC, sizeof(header->magic));
+    header->version = RAW_IMAGE_VERSION;
+    header->header_size = sizeof(raw_image_header_t);
+    header->data_offset = RAW_IMAGE_ALIGN;
+    header->width = image->width;
+    header->height = image->height;
+    header->width_stride = get_width_stride(image);
+    header->height_stride = get_height_stride(image);
+    header->format = image->format;
+    header->frame_size = get_image_size((image_buffer_t*)image);
+    header->frame_pitch = align_up(header->frame_size, RAW_IMAGE_ALIGN);
+}
+
+static void set_raw_image_geometry(const raw_image_header_t* header, image_buffer_t* image)
+{
+    image->width = header->width;
+    image->height = header->height;
+    image->width_stride = header->width_stride;
+    image->height_stride = header->height_stride;
+    image->format = (image_format_t)header->format;
+}
+
+// 校验头部，返回文件中完整帧的数量，不是容器返回-1
+static int check_raw_image_header(const raw_image_header_t* header, size_t file_size)
+{
+    if (memcmp(header->magic, RAW_IMAGE_MAGIC, sizeof(header->magic)) != 0) {
+        return -1;
+    }
+    if (header->version != RAW_IMAGE_VERSION || header->header_size < sizeof(raw_image_header_t) ||
+        header->data_offset < header->header_size || header->data_offset % RAW_IMAGE_ALIGN != 0 ||
+        header->frame_pitch < header->frame_size || header->frame_pitch % RAW_IMAGE_ALIGN != 0) {
+        printf("raw image: bad header\n");
+        return -1;
+    }
+    image_buffer_t image;
+    memset(&image, 0, sizeof(image_buffer_t));
+    set_raw_image_geometry(header, &image);
+    if (image.width <= 0 || image.height <= 0 || header->frame_size == 0 ||
+        get_image_size(&image) != (int)header->frame_size) {
+        printf("raw image: bad geometry %dx%d fmt=%d\n", header->width, header->height, header->format);
+        return -1;
+    }
+    if (file_size < header->data_offset + header->frame_size) {
+        return 0;
+    }
+    // 录制未正常结束时frame_count为0，按文件长度计算
+    size_t count = (file_size - header->data_offset - header->frame_size) / header->frame_pitch + 1;
+    if (header->frame_count > 0 && header->frame_count < count) {
+        count = header->frame_count;
+    }
+    return (int)count;
+}
+
+raw_image_reader_t* raw_image_reader_open(const char* path, int flags)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("open %s fail!\n", path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(raw_image_header_t)) {
+        printf("raw image: %s too small\n", path);
+        close(fd);
+        return NULL;
+    }
+    int map_flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+    if (flags & RAW_IMAGE_MAP_POPULATE) {
+        map_flags |= MAP_POPULATE;
+    }
+#endif
+    // 私有映射，写入时才复制页面，帧可以直接作为输入或在其上画框
+    void* data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, map_flags, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("mmap %s fail!\n", path);
+        return NULL;
+    }
+    raw_image_reader_t* reader = (raw_image_reader_t*)malloc(sizeof(raw_image_reader_t));
+    if (reader == NULL) {
+        munmap(data, st.st_size);
+        return NULL;
+    }
+    reader->data = (unsigned char*)data;
+    reader->size = st.st_size;
+    memcpy(&reader->header, data, sizeof(raw_image_header_t));
+    reader->count = check_raw_image_header(&reader->header, reader->size);
+    if (reader->count < 0) {
+        printf("raw image: %s is not a raw container\n", path);
+        raw_image_reader_close(reader);
+        return NULL;
+    }
+    if (flags & RAW_IMAGE_MAP_SEQUENTIAL) {
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+    }
+    return reader;
+}
+
+int raw_image_reader_get_count(raw_image_reader_t* reader)
+{
+    return reader != NULL ? reader->count : 0;
+}
+
+int raw_image_reader_get_frame(raw_image_reader_t* reader, int index, image_buffer_t* image)
+{
+    if (reader == NULL || image == NULL || index < 0 || index >= reader->count) {
+        return -1;
+    }
+    memset(image, 0, sizeof(image_buffer_t));
+    set_raw_image_geometry(&reader->header, image);
+    image->virt_addr = reader->data + reader->header.data_offset + (size_t)index * reader->header.frame_pitch;
+    image->size = (int)reader->header.frame_size;
+    return 0;
+}
+
+void raw_image_reader_close(raw_image_reader_t* reader)
+{
+    if (reader == NULL) {
+        return;
+    }
+    munmap(reader->data, reader->size);
+    free(reader);
+}
+
+raw_image_writer_t* raw_image_writer_open(const char* path)
+{
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) {
+        printf("open error: %s\n", path);
+        return NULL;
+    }
+    raw_image_writer_t* writer = (raw_image_writer_t*)malloc(sizeof(raw_image_writer_t));
+    if (writer == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    memset(writer, 0, sizeof(raw_image_writer_t));
+    writer->fp = fp;
+    return writer;
+}
+
+static int write_zeros(FILE* fp, size_t size)
+{
+    static const unsigned char zeros[RAW_IMAGE_ALIGN] = {0};
+    while (size > 0) {
+        size_t n = size < sizeof(zeros) ? size : sizeof(zeros);
+        if (fwrite(zeros, 1, n, fp) != n) {
+            return -1;
+        }
+        size -= n;
+    }
+    return 0;
+}
+
+int raw_image_writer_append(raw_image_writer_t* writer, const image_buffer_t* image)
+{
+    if (writer == NULL || image == NULL || image->virt_addr == NULL) {
+        return -1;
+    }
+    raw_image_header_t header;
+    fill_raw_image_header(&header, image);
+    if (header.frame_size == 0) {
+        printf("raw image: format %d not support\n", image->format);
+        return -1;
+    }
+    if (writer->header.frame_size == 0) {
+        // 第一帧确定几何信息，帧数在关闭时回写
+        writer->header = header;
+        if (fwrite(&header, 1, sizeof(header), writer->fp) != sizeof(header) ||
+            write_zeros(writer->fp, header.data_offset - sizeof(header)) != 0) {
+            printf("raw image: write header fail\n");
+            return -1;
+        }
+    } else if (header.width != writer->header.width || header.height != writer->header.height ||
+               header.width_stride != writer->header.width_stride ||
+               header.height_stride != writer->header.height_stride || header.format != writer->header.format) {
+        printf("raw image: frame %dx%d stride %dx%d fmt=%d differs from container %dx%d stride %dx%d fmt=%d\n",
+            header.width, header.height, header.width_stride, header.height_stride, header.format,
+            writer->header.width, writer->header.height, writer->header.width_stride,
+            writer->header.height_stride, writer->header.format);
+        return -1;
+    }
+    if (fwrite(image->virt_addr, 1, header.frame_size, writer->fp) != header.frame_size ||
+        write_zeros(writer->fp, header.frame_pitch - header.frame_size) != 0) {
+        printf("raw image: write frame fail\n");
+        return -1;
     }
+    writer->header.frame_count++;
     return 0;
 }
 
+int raw_image_writer_close(raw_image_writer_t* writer)
+{
+    if (writer == NULL) {
+        return -1;
+    }
+    int ret = 0;
+    if (writer->header.frame_count > 0) {
+        if (fseek(writer->fp, 0, SEEK_SET) != 0 ||
+            fwrite(&writer->header, 1, sizeof(raw_image_header_t), writer->fp) != sizeof(raw_image_header_t)) {
+            printf("raw image: write frame count fail\n");
+            ret = -1;
+        }
+    }
+    if (fclose(writer->fp) != 0) {
+        ret = -1;
+    }
+    free(writer);
+    return ret;
+}
+
 static int read_image_raw(const char* path, image_buffer_t* image)
 {
     FILE *fp = fopen(path, "rb");
@@ -153,60 +728,130 @@ static int read_image_raw(const char* path, image_buffer_t* image)
         printf("fopen %s fail!\n", path);
         return -1;
     }
+    raw_image_header_t header;
+    int is_container = fread(&header, 1, sizeof(header), fp) == sizeof(header) &&
+        memcmp(header.magic, RAW_IMAGE_MAGIC, sizeof(header.magic)) == 0;
     fseek(fp, 0, SEEK_END);
-    int file_size = ftell(fp);
-    unsigned char *data = image->virt_addr;
-    if (image->virt_addr == NULL) {
-        data = (unsigned char *)malloc(file_size+1);
+    long file_size = ftell(fp);
+    long data_size = file_size;
+    long data_offset = 0;
+    if (is_container) {
+        if (check_raw_image_header(&header, file_size) <= 0) {
+            printf("raw image: %s has no frame\n", path);
+            fclose(fp);
+            return -1;
+        }
+        set_raw_image_geometry(&header, image);
+        data_size = header.frame_size;
+        data_offset = header.data_offset;
     }
-    data[file_size] = 0;
-    fseek(fp, 0, SEEK_SET);
-    if(file_size != fread(data, 1, file_size, fp)) {
-        printf("fread %s fail!\n", path);
-        free(data);
+    unsigned char *data = image->virt_addr;
+    if (data != NULL && image->size > 0 && image->size < data_size) {
+        printf("read %s: buffer size %d < %ld\n", path, image->size, data_size);
+        fclose(fp);
         return -1;
     }
-    if(fp) {
+    if (data == NULL) {
+        data = (unsigned char *)malloc(data_size);
+        if (data == NULL) {
+            printf("malloc size %ld error\n", data_size);
+            fclose(fp);
+            return -1;
+        }
+    }
+    fseek(fp, data_offset, SEEK_SET);
+    if(data_size != (long)fread(data, 1, data_size, fp)) {
+        printf("fread %s fail!\n", path);
+        if (data != image->virt_addr) {
+            free(data);
+        }
         fclose(fp);
+        return -1;
     }
+    fclose(fp);
     if (image->virt_addr == NULL) {
         image->virt_addr = data;
-        image->size = file_size;
+        image->size = data_size;
     }
 
     return 0;
 }
 
-static int write_image_jpeg(const char* path, int quality, const image_buffer_t* image)
+static int get_tj_subsamp(image_write_subsamp_t subsamp)
 {
-    int ret;
-    int jpegSubsamp = TJSAMP_422;
-    unsigned char* jpegBuf = NULL;
-    unsigned long jpegSize = 0;
-    int flags = 0;
-
-    const unsigned char* data = image->virt_addr;
-    int width = image->width;
-    int height = image->height;
-    int pixelFormat = TJPF_RGB;
-
-	tjhandle handle = tjInitCompress();
+    switch (subsamp) {
+    case IMAGE_WRITE_SUBSAMP_444:
+        return TJSAMP_444;
+    case IMAGE_WRITE_SUBSAMP_420:
+        return TJSAMP_420;
+    case IMAGE_WRITE_SUBSAMP_422:
+    default:
+        return TJSAMP_422;
+    }
+}
 
-    if (image->format == IMAGE_FORMAT_RGB888) {
-        ret = tjCompress2(handle, data, width, 0, height, pixelFormat, &jpegBuf, &jpegSize, jpegSubsamp, quality, flags);
-    } else {
+/*
+ * handle为NULL时临时创建压缩句柄，jpeg_buf/jpeg_capacity不为NULL时复用输出缓冲
+ */
+static int write_image_jpeg(tjhandle handle, unsigned char** jpeg_buf, unsigned long* jpeg_capacity,
+                            const char* path, const image_write_option_t* option, const image_buffer_t* image)
+{
+    int quality = (option != NULL && option->jpeg_quality > 0) ? option->jpeg_quality : 95;
+    int jpegSubsamp = get_tj_subsamp(option != NULL ? option->jpeg_subsamp : IMAGE_WRITE_SUBSAMP_DEFAULT);
+    int pixelFormat;
+    switch (image->format) {
+    case IMAGE_FORMAT_RGB888:
+        pixelFormat = TJPF_RGB;
+        break;
+    case IMAGE_FORMAT_RGBA8888:
+        pixelFormat = TJPF_RGBA;
+        break;
+    case IMAGE_FORMAT_GRAY8:
+        pixelFormat = TJPF_GRAY;
+        jpegSubsamp = TJSAMP_GRAY;
+        break;
+    default:
         printf("write_image_jpeg: pixel format %d not support\n", image->format);
         return -1;
     }
 
-	// printf("ret=%d jpegBuf=%p jpegSize=%d\n", ret, jpegBuf, jpegSize);
-    if (jpegBuf != NULL && jpegSize > 0) {
-        write_data_to_file(path, (const char*)jpegBuf, jpegSize);
-        tjFree(jpegBuf);
+    tjhandle _handle = handle != NULL ? handle : tjInitCompress();
+    if (_handle == NULL) {
+        printf("write_image_jpeg: tjInitCompress fail\n");
+        return -1;
+    }
+    unsigned char* jpegBuf = NULL;
+    unsigned long jpegSize = 0;
+    int flags = 0;
+    if (jpeg_buf != NULL && jpeg_capacity != NULL) {
+        // 按最坏情况分配一次，之后不再重新分配
+        unsigned long max_size = tjBufSize(image->width, image->height, jpegSubsamp);
+        if (*jpeg_buf == NULL || *jpeg_capacity < max_size) {
+            tjFree(*jpeg_buf);
+            *jpeg_buf = tjAlloc(max_size);
+            *jpeg_capacity = *jpeg_buf != NULL ? max_size : 0;
+        }
+        if (*jpeg_buf != NULL) {
+            jpegBuf = *jpeg_buf;
+            jpegSize = *jpeg_capacity;
+            flags |= TJFLAG_NOREALLOC;
+        }
     }
-    tjDestroy(handle);
 
-	return 0;
+    int ret = tjCompress2(_handle, image->virt_addr, image->width, get_row_bytes(image), image->height, pixelFormat,
+        &jpegBuf, &jpegSize, jpegSubsamp, quality, flags);
+    if (ret < 0) {
+        printf("write_image_jpeg: compress fail, errorStr:%s\n", tjGetErrorStr2(_handle));
+    } else if (jpegBuf != NULL && jpegSize > 0) {
+        ret = write_data_to_file(path, (const char*)jpegBuf, jpegSize);
+    }
+    if (!(flags & TJFLAG_NOREALLOC) && jpegBuf != NULL) {
+        tjFree(jpegBuf);
+    }
+    if (handle == NULL) {
+        tjDestroy(_handle);
+    }
+    return ret < 0 ? -1 : 0;
 }
 
 static int read_image_stb(const char* path, image_buffer_t* image)
@@ -230,6 +875,8 @@ static int read_image_stb(const char* path, image_buffer_t* image)
     }
     image->width = w;
     image->height = h;
+    image->width_stride = w;
+    image->height_stride = h;
     if (c == 4) {
         image->format = IMAGE_FORMAT_RGBA8888;
     } else if (c == 1) {
@@ -257,16 +904,9 @@ int read_image(const char* path, image_buffer_t* image)
     }
 }
 
-int write_image(const char* path, const image_buffer_t* img)
+int read_image_with_option(const char* path, image_buffer_t* image, const image_read_option_t* option,
+                           letterbox_t* letterbox)
 {
-    int ret;
-    int width = img->width;
-    int height = img->height;
-    int channel = 3;
-    void* data = img->virt_addr;
-    printf("write_image path: %s width=%d height=%d channel=%d data=%p\n",
-        path, width, height, channel, data);
-
     const char* _ext = strrchr(path, '.');
     if (!_ext) {
         // missing extension
@@ -274,254 +914,1243 @@ int write_image(const char* path, const image_buffer_t* img)
     }
     if (strcmp(_ext, ".jpg") == 0 || strcmp(_ext, ".jpeg") == 0 || strcmp(_ext, ".JPG") == 0 ||
         strcmp(_ext, ".JPEG") == 0) {
-        int quality = 95;
-        ret = write_image_jpeg(path, quality, img);
-    } else if (strcmp(_ext, ".png") == 0 | strcmp(_ext, ".PNG") == 0) {
-        ret = stbi_write_png(path, width, height, channel, data, 0);
-    } else if (strcmp(_ext, ".data") == 0 | strcmp(_ext, ".DATA") == 0) {
-        int size = get_image_size(img);
-        ret = write_data_to_file(path, data, size);
-    } else {
-        // unknown extension type
+        return read_image_jpeg_with_option(path, image, option, letterbox);
+    }
+    if (option != NULL && option->roi != NULL) {
+        printf("roi decode only support jpeg: %s\n", path);
         return -1;
     }
-    return ret;
+    // 其他格式没有解码时缩放，按原图读取
+    if (letterbox != NULL) {
+        memset(letterbox, 0, sizeof(letterbox_t));
+        letterbox->scale = 1.0f;
+    }
+    return read_image(path, image);
+}
+
+typedef struct {
+    unsigned char* data;
+    size_t capacity;
+    int in_use;
+} decoder_buffer_t;
+
+struct image_decoder {
+    tjhandle handle;
+    unsigned char* input;           // 压缩数据缓冲，只增长
+    size_t input_capacity;
+    unsigned char* scratch;         // 解码临时缓冲，只增长
+    size_t scratch_capacity;
+    int num_buffers;
+    decoder_buffer_t* buffers;      // 输出图像缓冲池
+};
+
+image_decoder_t* image_decoder_create(int num_buffers)
+{
+    if (num_buffers < 1) {
+        num_buffers = 1;
+    }
+    image_decoder_t* decoder = (image_decoder_t*)malloc(sizeof(image_decoder_t));
+    if (decoder == NULL) {
+        return NULL;
+    }
+    memset(decoder, 0, sizeof(image_decoder_t));
+    decoder->buffers = (decoder_buffer_t*)calloc(num_buffers, sizeof(decoder_buffer_t));
+    decoder->num_buffers = num_buffers;
+    // 变换句柄同时支持解码和无损裁剪
+    decoder->handle = tjInitTransform();
+    if (decoder->buffers == NULL || decoder->handle == NULL) {
+        printf("image_decoder_create fail\n");
+        image_decoder_destroy(decoder);
+        return NULL;
+    }
+    return decoder;
+}
+
+void image_decoder_destroy(image_decoder_t* decoder)
+{
+    if (decoder == NULL) {
+        return;
+    }
+    if (decoder->handle != NULL) {
+        tjDestroy(decoder->handle);
+    }
+    if (decoder->buffers != NULL) {
+        for (int i = 0; i < decoder->num_buffers; i++) {
+            free(decoder->buffers[i].data);
+        }
+        free(decoder->buffers);
+    }
+    free(decoder->input);
+    free(decoder->scratch);
+    free(decoder);
+}
+
+// 优先选容量足够的空闲缓冲，否则扩大最大的空闲缓冲
+static unsigned char* image_decoder_acquire(image_decoder_t* decoder, size_t size)
+{
+    decoder_buffer_t* best = NULL;
+    for (int i = 0; i < decoder->num_buffers; i++) {
+        decoder_buffer_t* buffer = &decoder->buffers[i];
+        if (buffer->in_use) {
+            continue;
+        }
+        if (buffer->capacity >= size) {
+            best = buffer;
+            break;
+        }
+        if (best == NULL || buffer->capacity > best->capacity) {
+            best = buffer;
+        }
+    }
+    if (best == NULL) {
+        printf("image_decoder: no free output buffer, release images first\n");
+        return NULL;
+    }
+    if (best->capacity < size) {
+        free(best->data);
+        best->data = (unsigned char*)malloc(size);
+        best->capacity = best->data != NULL ? size : 0;
+        if (best->data == NULL) {
+            printf("malloc size %zu error\n", size);
+            return NULL;
+        }
+    }
+    best->in_use = 1;
+    return best->data;
 }
 
-static int crop_and_scale_image_c(int channel, unsigned char *src, int src_width, int src_height,
-                                    int crop_x, int crop_y, int crop_width, int crop_height,
-                                    unsigned char *dst, int dst_width, int dst_height,
-                                    int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
-    if (dst == NULL) {
-        printf("dst buffer is null\n");
+int image_decoder_release_image(image_decoder_t* decoder, image_buffer_t* image)
+{
+    if (decoder == NULL || image == NULL || image->virt_addr == NULL) {
         return -1;
     }
+    for (int i = 0; i < decoder->num_buffers; i++) {
+        if (decoder->buffers[i].data == image->virt_addr) {
+            decoder->buffers[i].in_use = 0;
+            image->virt_addr = NULL;
+            return 0;
+        }
+    }
+    // 非JPEG图像不在缓冲池中
+    free(image->virt_addr);
+    image->virt_addr = NULL;
+    return 0;
+}
 
-    float x_ratio = (float)crop_width / (float)dst_box_width;
-    float y_ratio = (float)crop_height / (float)dst_box_height;
+int image_decoder_decode(image_decoder_t* decoder, const unsigned char* data, size_t size, image_buffer_t* image,
+                         const image_read_option_t* option, letterbox_t* letterbox)
+{
+    if (decoder == NULL || data == NULL || size == 0 || image == NULL) {
+        return -1;
+    }
+    jpeg_decode_info_t info;
+    if (get_jpeg_decode_info(decoder->handle, data, size, option, &info) != 0) {
+        return -1;
+    }
+    if (decoder->scratch_capacity < info.scratch_size) {
+        free(decoder->scratch);
+        decoder->scratch = (unsigned char*)malloc(info.scratch_size);
+        decoder->scratch_capacity = decoder->scratch != NULL ? info.scratch_size : 0;
+        if (decoder->scratch == NULL) {
+            printf("malloc size %zu error\n", info.scratch_size);
+            return -1;
+        }
+    }
+    unsigned char* out_buf = image_decoder_acquire(decoder, info.out_size);
+    if (out_buf == NULL) {
+        return -1;
+    }
+    memset(image, 0, sizeof(image_buffer_t));
+    int ret = decode_jpeg_with_info(decoder->handle, data, size, &info, out_buf, decoder->scratch, image, letterbox);
+    if (ret != 0) {
+        image->virt_addr = out_buf;
+        image_decoder_release_image(decoder, image);
+        return -1;
+    }
+    return 0;
+}
 
-    // printf("src_width=%d src_height=%d crop_x=%d crop_y=%d crop_width=%d crop_height=%d\n",
-    //     src_width, src_height, crop_x, crop_y, crop_width, crop_height);
-    // printf("dst_width=%d dst_height=%d dst_box_x=%d dst_box_y=%d dst_box_width=%d dst_box_height=%d\n",
-    //     dst_width, dst_height, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
-    // printf("channel=%d x_ratio=%f y_ratio=%f\n", channel, x_ratio, y_ratio);
+int image_decoder_read(image_decoder_t* decoder, const char* path, image_buffer_t* image,
+                       const image_read_option_t* option, letterbox_t* letterbox)
+{
+    if (decoder == NULL || path == NULL || image == NULL) {
+        return -1;
+    }
+    const char* _ext = strrchr(path, '.');
+    if (_ext == NULL || !(strcmp(_ext, ".jpg") == 0 || strcmp(_ext, ".jpeg") == 0 || strcmp(_ext, ".JPG") == 0 ||
+        strcmp(_ext, ".JPEG") == 0)) {
+        memset(image, 0, sizeof(image_buffer_t));
+        return read_image_with_option(path, image, option, letterbox);
+    }
+    unsigned long jpeg_size = 0;
+    if (read_jpeg_file(path, &decoder->input, &decoder->input_capacity, &jpeg_size) != 0) {
+        return -1;
+    }
+    return image_decoder_decode(decoder, decoder->input, jpeg_size, image, option, letterbox);
+}
 
-    // 从原图指定区域取数据，双线性缩放到目标指定区域
-    for (int dst_y = dst_box_y; dst_y < dst_box_y + dst_box_height; dst_y++) {
-        for (int dst_x = dst_box_x; dst_x < dst_box_x + dst_box_width; dst_x++) {
-            int dst_x_offset = dst_x - dst_box_x;
-            int dst_y_offset = dst_y - dst_box_y;
+typedef enum {
+    SOURCE_SLOT_EMPTY,
+    SOURCE_SLOT_READY,
+    SOURCE_SLOT_IN_USE,
+} source_slot_state_t;
 
-            int src_x = (int)(dst_x_offset * x_ratio) + crop_x;
-            int src_y = (int)(dst_y_offset * y_ratio) + crop_y;
+typedef struct {
+    source_slot_state_t state;
+    int index;
+    int ret;
+    image_buffer_t image;
+    letterbox_t letterbox;
+} source_slot_t;
+
+struct image_source {
+    char** paths;
+    int num_paths;
+    int use_option;
+    image_read_option_t option;
+    image_rect_t roi;
+
+    image_decoder_t* decoder;       // 只在解码线程中使用
+    int num_slots;
+    source_slot_t* slots;           // 按帧序号取模的环形缓冲
+    int next_index;                 // 下一个交给调用者的帧
+
+    pthread_t thread;
+    int thread_started;
+    int quit;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
 
-            float x_diff = (dst_x_offset * x_ratio) - (src_x - crop_x);
-            float y_diff = (dst_y_offset * y_ratio) - (src_y - crop_y);
+static int is_image_list_file(const char* path)
+{
+    const char* ext = strrchr(path, '.');
+    return ext != NULL && (strcmp(ext, ".txt") == 0 || strcmp(ext, ".TXT") == 0);
+}
 
-            int index1 = src_y * src_width * channel + src_x * channel;
-            int index2 = index1 + src_width * channel;    // down
-            if (src_y == src_height - 1) {
-                // 如果到图像最下边缘，变成选择上面的像素
-                index2 = index1 - src_width * channel;
+// 目录按文件名排序，列表文件每行一个路径，其他情况作为单张图像
+static int scan_image_paths(const char* path, char*** out_paths)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        printf("image source %s not exist\n", path);
+        return -1;
+    }
+    char** paths = NULL;
+    int count = 0;
+    if (S_ISDIR(st.st_mode)) {
+        struct dirent** namelist = NULL;
+        int n = scandir(path, &namelist, image_file_filter, alphasort);
+        if (n < 0) {
+            printf("scandir %s fail\n", path);
+            return -1;
+        }
+        paths = (char**)malloc((n > 0 ? n : 1) * sizeof(char*));
+        for (int i = 0; i < n; i++) {
+            if (paths != NULL) {
+                size_t len = strlen(path) + strlen(namelist[i]->d_name) + 2;
+                paths[count] = (char*)malloc(len);
+                if (paths[count] != NULL) {
+                    snprintf(paths[count], len, "%s/%s", path, namelist[i]->d_name);
+                    count++;
+                }
             }
-            int index3 = index1 + 1 * channel;            // right
-            int index4 = index2 + 1 * channel;            // down right
-            if (src_x == src_width - 1) {
-                // 如果到图像最右边缘，变成选择左边的像素
-                index3 = index1 - 1 * channel;
-                index4 = index2 - 1 * channel;
+            free(namelist[i]);
+        }
+        free(namelist);
+    } else if (is_image_list_file(path)) {
+        int line_count = 0;
+        char** lines = read_lines_from_file(path, &line_count);
+        if (lines == NULL) {
+            return -1;
+        }
+        paths = (char**)malloc((line_count > 0 ? line_count : 1) * sizeof(char*));
+        for (int i = 0; i < line_count; i++) {
+            if (paths != NULL && lines[i] != NULL && lines[i][strspn(lines[i], " \t\r")] != '\0') {
+                lines[i][strcspn(lines[i], "\r")] = '\0';
+                paths[count++] = lines[i];
+                lines[i] = NULL;
             }
+        }
+        free_lines(lines, line_count);
+    } else {
+        paths = (char**)malloc(sizeof(char*));
+        if (paths != NULL) {
+            paths[0] = strdup(path);
+            count = paths[0] != NULL ? 1 : 0;
+        }
+    }
+    if (paths == NULL) {
+        printf("image source malloc fail\n");
+        return -1;
+    }
+    *out_paths = paths;
+    return count;
+}
 
-            // printf("dst_x=%d dst_y=%d dst_x_offset=%d dst_y_offset=%d src_x=%d src_y=%d x_diff=%f y_diff=%f src index=%d %d %d %d\n",
-            //     dst_x, dst_y, dst_x_offset, dst_y_offset,
-            //     src_x, src_y, x_diff, y_diff,
-            //     index1, index2, index3, index4);
-
-            for (int c = 0; c < channel; c++) {
-                unsigned char A = src[index1+c];
-                unsigned char B = src[index3+c];
-                unsigned char C = src[index2+c];
-                unsigned char D = src[index4+c];
-
-                unsigned char pixel = (unsigned char)(
-                    A * (1 - x_diff) * (1 - y_diff) +
-                    B * x_diff * (1 - y_diff) +
-                    C * y_diff * (1 - x_diff) +
-                    D * x_diff * y_diff
-                );
-
-                dst[(dst_y * dst_width  + dst_x) * channel + c] = pixel;
-            }
+static void* image_source_thread(void* arg)
+{
+    image_source_t* source = (image_source_t*)arg;
+    for (int index = 0; index < source->num_paths; index++) {
+        source_slot_t* slot = &source->slots[index % source->num_slots];
+
+        pthread_mutex_lock(&source->lock);
+        while (!source->quit && slot->state != SOURCE_SLOT_EMPTY) {
+            pthread_cond_wait(&source->cond, &source->lock);
         }
+        int quit = source->quit;
+        pthread_mutex_unlock(&source->lock);
+        if (quit) {
+            break;
+        }
+
+        // 上一轮的图像已经被调用者释放，归还给解码器缓冲池后复用
+        if (slot->image.virt_addr != NULL) {
+            image_decoder_release_image(source->decoder, &slot->image);
+        }
+        memset(&slot->image, 0, sizeof(image_buffer_t));
+        memset(&slot->letterbox, 0, sizeof(letterbox_t));
+        slot->letterbox.scale = 1.0f;
+        int ret = image_decoder_read(source->decoder, source->paths[index], &slot->image,
+            source->use_option ? &source->option : NULL, &slot->letterbox);
+
+        pthread_mutex_lock(&source->lock);
+        slot->index = index;
+        slot->ret = ret;
+        slot->state = SOURCE_SLOT_READY;
+        pthread_cond_broadcast(&source->cond);
+        pthread_mutex_unlock(&source->lock);
     }
+    return NULL;
+}
 
-    return 0;
+image_source_t* image_source_open(const char* path, int num_prefetch, const image_read_option_t* option)
+{
+    if (path == NULL) {
+        return NULL;
+    }
+    image_source_t* source = (image_source_t*)malloc(sizeof(image_source_t));
+    if (source == NULL) {
+        return NULL;
+    }
+    memset(source, 0, sizeof(image_source_t));
+    pthread_mutex_init(&source->lock, NULL);
+    pthread_cond_init(&source->cond, NULL);
+
+    source->num_paths = scan_image_paths(path, &source->paths);
+    if (source->num_paths < 0) {
+        source->num_paths = 0;
+        image_source_close(source);
+        return NULL;
+    }
+    printf("image source %s: %d images\n", path, source->num_paths);
+    if (option != NULL) {
+        source->use_option = 1;
+        source->option = *option;
+        if (option->roi != NULL) {
+            source->roi = *option->roi;
+            source->option.roi = &source->roi;
+        }
+    }
+
+    // 调用者持有一帧的同时后台解码num_prefetch帧
+    source->num_slots = (num_prefetch > 0 ? num_prefetch : 1) + 1;
+    source->slots = (source_slot_t*)calloc(source->num_slots, sizeof(source_slot_t));
+    source->decoder = image_decoder_create(source->num_slots);
+    if (source->slots == NULL || source->decoder == NULL) {
+        printf("image source init fail\n");
+        image_source_close(source);
+        return NULL;
+    }
+    if (pthread_create(&source->thread, NULL, image_source_thread, source) != 0) {
+        printf("image source create thread fail\n");
+        image_source_close(source);
+        return NULL;
+    }
+    source->thread_started = 1;
+    return source;
 }
 
-static int crop_and_scale_image_yuv420sp(unsigned char *src, int src_width, int src_height,
-                                    int crop_x, int crop_y, int crop_width, int crop_height,
-                                    unsigned char *dst, int dst_width, int dst_height,
-                                    int dst_box_x, int dst_box_y, int dst_box_width, int dst_box_height) {
+int image_source_get_count(image_source_t* source)
+{
+    return source != NULL ? source->num_paths : 0;
+}
 
-    unsigned char* src_y = src;
-    unsigned char* src_uv = src + src_width * src_height;
+int image_source_next(image_source_t* source, image_frame_t* frame)
+{
+    if (source == NULL || frame == NULL) {
+        return -1;
+    }
+    memset(frame, 0, sizeof(image_frame_t));
+    if (source->next_index >= source->num_paths) {
+        return 1;
+    }
+    int index = source->next_index++;
+    source_slot_t* slot = &source->slots[index % source->num_slots];
 
-    unsigned char* dst_y = dst;
-    unsigned char* dst_uv = dst + dst_width * dst_height;
+    pthread_mutex_lock(&source->lock);
+    while (!(slot->state == SOURCE_SLOT_READY && slot->index == index)) {
+        pthread_cond_wait(&source->cond, &source->lock);
+    }
+    frame->index = index;
+    frame->path = source->paths[index];
+    int ret = slot->ret;
+    if (ret == 0) {
+        slot->state = SOURCE_SLOT_IN_USE;
+        frame->image = slot->image;
+        frame->letterbox = slot->letterbox;
+    } else {
+        slot->state = SOURCE_SLOT_EMPTY;
+        pthread_cond_broadcast(&source->cond);
+    }
+    pthread_mutex_unlock(&source->lock);
+    return ret == 0 ? 0 : -1;
+}
 
-    crop_and_scale_image_c(1, src_y, src_width, src_height, crop_x, crop_y, crop_width, crop_height,
-        dst_y, dst_width, dst_height, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
-    
-    crop_and_scale_image_c(2, src_uv, src_width / 2, src_height / 2, crop_x / 2, crop_y / 2, crop_width / 2, crop_height / 2,
-        dst_uv, dst_width / 2, dst_height / 2, dst_box_x, dst_box_y, dst_box_width, dst_box_height);
+void image_source_release(image_source_t* source, image_frame_t* frame)
+{
+    if (source == NULL || frame == NULL || frame->image.virt_addr == NULL) {
+        return;
+    }
+    source_slot_t* slot = &source->slots[frame->index % source->num_slots];
+    pthread_mutex_lock(&source->lock);
+    if (slot->state == SOURCE_SLOT_IN_USE && slot->index == frame->index) {
+        slot->state = SOURCE_SLOT_EMPTY;
+        pthread_cond_broadcast(&source->cond);
+    }
+    pthread_mutex_unlock(&source->lock);
+    memset(&frame->image, 0, sizeof(image_buffer_t));
+}
 
-    return 0;
+void image_source_close(image_source_t* source)
+{
+    if (source == NULL) {
+        return;
+    }
+    if (source->thread_started) {
+        pthread_mutex_lock(&source->lock);
+        source->quit = 1;
+        pthread_cond_broadcast(&source->cond);
+        pthread_mutex_unlock(&source->lock);
+        pthread_join(source->thread, NULL);
+    }
+    if (source->slots != NULL) {
+        for (int i = 0; i < source->num_slots; i++) {
+            if (source->slots[i].image.virt_addr != NULL) {
+                image_decoder_release_image(source->decoder, &source->slots[i].image);
+            }
+        }
+        free(source->slots);
+    }
+    image_decoder_destroy(source->decoder);
+    if (source->paths != NULL) {
+        for (int i = 0; i < source->num_paths; i++) {
+            free(source->paths[i]);
+        }
+        free(source->paths);
+    }
+    pthread_cond_destroy(&source->cond);
+    pthread_mutex_destroy(&source->lock);
+    free(source);
 }
 
-static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rect_t *src_box, image_rect_t *dst_box, char color) {
-    int ret;
-    if (dst->virt_addr == NULL) {
-        return -1;
+/*
+ * zlib无压缩格式(stored块)，用于IMAGE_WRITE_PNG_STORE，stb的压缩器没有这个等级
+ */
+static unsigned char* png_zlib_store(const unsigned char* data, int data_len, int* out_len)
+{
+    int num_blocks = data_len / 65535 + 1;
+    unsigned char* out = (unsigned char*)malloc(2 + num_blocks * 5 + data_len + 4);
+    if (out == NULL) {
+        return NULL;
     }
-    if (src->virt_addr == NULL) {
-        return -1;
+    unsigned char* o = out;
+    *o++ = 0x78;
+    *o++ = 0x01;
+    int pos = 0;
+    for (int i = 0; i < num_blocks; i++) {
+        int len = data_len - pos < 65535 ? data_len - pos : 65535;
+        *o++ = (i == num_blocks - 1) ? 1 : 0;
+        *o++ = (unsigned char)(len & 0xff);
+        *o++ = (unsigned char)(len >> 8);
+        *o++ = (unsigned char)(~len & 0xff);
+        *o++ = (unsigned char)((~len >> 8) & 0xff);
+        memcpy(o, data + pos, len);
+        o += len;
+        pos += len;
     }
-    if (src->format != dst->format) {
-        return -1;
+    unsigned int s1 = 1;
+    unsigned int s2 = 0;
+    for (int i = 0; i < data_len; i++) {
+        s1 = (s1 + data[i]) % 65521;
+        s2 = (s2 + s1) % 65521;
     }
+    stbiw__wp32(o, (s2 << 16) | s1);
+    *out_len = (int)(o - out);
+    return out;
+}
 
-    int src_box_x = 0;
-    int src_box_y = 0;
-    int src_box_w = src->width;
-    int src_box_h = src->height;
-    if (src_box != NULL) {
-        src_box_x = src_box->left;
-        src_box_y = src_box->top;
-        src_box_w = src_box->right - src_box->left + 1;
-        src_box_h = src_box->bottom - src_box->top + 1;
+/*
+ * 取自stb_image_write.h v1.15的stbi_write_png_to_mem(公有领域)，只把全局变量stbi_write_png_compression_level
+ * 换成level参数并加上无压缩等级，多个线程可以用不同等级同时编码。滤波选择和chunk格式与stb相同，
+ * 升级stb时需要同步
+ */
+static unsigned char* png_encode_to_mem(const unsigned char* pixels, int stride_bytes, int x, int y, int n,
+                                        int level, int* out_len)
+{
+    static const int ctype[5] = {-1, 0, 4, 2, 6};
+    static const unsigned char sig[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    int row_bytes = x * n;
+    unsigned char* filt = (unsigned char*)malloc((size_t)(row_bytes + 1) * y);
+    signed char* line_buffer = (signed char*)malloc(row_bytes);
+    if (filt == NULL || line_buffer == NULL) {
+        free(filt);
+        free(line_buffer);
+        return NULL;
     }
-    int dst_box_x = 0;
-    int dst_box_y = 0;
-    int dst_box_w = dst->width;
-    int dst_box_h = dst->height;
-    if (dst_box != NULL) {
-        dst_box_x = dst_box->left;
-        dst_box_y = dst_box->top;
-        dst_box_w = dst_box->right - dst_box->left + 1;
-        dst_box_h = dst_box->bottom - dst_box->top + 1;
+    for (int j = 0; j < y; j++) {
+        // 逐行选择绝对值和最小的滤波方式，与stb一致
+        int best_filter = 0;
+        int best_filter_val = 0x7fffffff;
+        int filter_type;
+        for (filter_type = 0; filter_type < 5; filter_type++) {
+            stbiw__encode_png_line((unsigned char*)pixels, stride_bytes, x, y, j, n, filter_type, line_buffer);
+            int est = 0;
+            for (int i = 0; i < row_bytes; i++) {
+                est += abs(line_buffer[i]);
+            }
+            if (est < best_filter_val) {
+                best_filter_val = est;
+                best_filter = filter_type;
+            }
+        }
+        if (filter_type != best_filter) {
+            stbiw__encode_png_line((unsigned char*)pixels, stride_bytes, x, y, j, n, best_filter, line_buffer);
+        }
+        filt[j * (row_bytes + 1)] = (unsigned char)best_filter;
+        memcpy(filt + j * (row_bytes + 1) + 1, line_buffer, row_bytes);
     }
+    free(line_buffer);
 
-    // fill pad color
-    if (dst_box_w != dst->width || dst_box_h != dst->height) {
-        int dst_size = get_image_size(dst);
-        memset(dst->virt_addr, color, dst_size);
-    }
-
-    int need_release_dst_buffer = 0;
-    int reti = 0;
-    if (src->format == IMAGE_FORMAT_RGB888) {
-        reti = crop_and_scale_image_c(3, src->virt_addr, src->width, src->height,
-            src_box_x, src_box_y, src_box_w, src_box_h,
-            dst->virt_addr, dst->width, dst->height,
-            dst_box_x, dst_box_y, dst_box_w, dst_box_h);
-    } else if (src->format == IMAGE_FORMAT_RGBA8888) {
-        reti = crop_and_scale_image_c(4, src->virt_addr, src->width, src->height,
-            src_box_x, src_box_y, src_box_w, src_box_h,
-            dst->virt_addr, dst->width, dst->height,
-            dst_box_x, dst_box_y, dst_box_w, dst_box_h);
-    } else if (src->format == IMAGE_FORMAT_GRAY8) {
-        reti = crop_and_scale_image_c(1, src->virt_addr, src->width, src->height,
-            src_box_x, src_box_y, src_box_w, src_box_h,
-            dst->virt_addr, dst->width, dst->height,
-            dst_box_x, dst_box_y, dst_box_w, dst_box_h);
-    } else if (src->format == IMAGE_FORMAT_YUV420SP_NV12 || src->format == IMAGE_FORMAT_YUV420SP_NV21) {
-        reti = crop_and_scale_image_yuv420sp(src->virt_addr, src->width, src->height,
-            src_box_x, src_box_y, src_box_w, src_box_h,
-            dst->virt_addr, dst->width, dst->height,
-            dst_box_x, dst_box_y, dst_box_w, dst_box_h);
+    int zlen;
+    unsigned char* zlib;
+    if (level == IMAGE_WRITE_PNG_STORE) {
+        zlib = png_zlib_store(filt, y * (row_bytes + 1), &zlen);
     } else {
-        printf("no support format %d\n", src->format);
+        zlib = stbi_zlib_compress(filt, y * (row_bytes + 1), &zlen, level);
     }
-    if (reti != 0) {
-        printf("convert_image_cpu fail %d\n", reti);
-        return -1;
+    free(filt);
+    if (zlib == NULL) {
+        return NULL;
     }
-    printf("finish\n");
-    return 0;
+
+    // 每个chunk有12字节的长度、类型与crc
+    *out_len = 8 + 12 + 13 + 12 + zlen + 12;
+    unsigned char* out = (unsigned char*)malloc(*out_len);
+    if (out == NULL) {
+        free(zlib);
+        return NULL;
+    }
+    unsigned char* o = out;
+    memcpy(o, sig, 8);
+    o += 8;
+    stbiw__wp32(o, 13);
+    stbiw__wptag(o, "IHDR");
+    stbiw__wp32(o, x);
+    stbiw__wp32(o, y);
+    *o++ = 8;
+    *o++ = STBIW_UCHAR(ctype[n]);
+    *o++ = 0;
+    *o++ = 0;
+    *o++ = 0;
+    stbiw__wpcrc(&o, 13);
+
+    stbiw__wp32(o, zlen);
+    stbiw__wptag(o, "IDAT");
+    memcpy(o, zlib, zlen);
+    o += zlen;
+    free(zlib);
+    stbiw__wpcrc(&o, zlen);
+
+    stbiw__wp32(o, 0);
+    stbiw__wptag(o, "IEND");
+    stbiw__wpcrc(&o, 0);
+    return out;
 }
 
-static int get_rga_fmt(image_format_t fmt) {
-    switch (fmt)
-    {
-    case IMAGE_FORMAT_RGB888:
-        return RK_FORMAT_RGB_888;
-    case IMAGE_FORMAT_RGBA8888:
-        return RK_FORMAT_RGBA_8888;
-    case IMAGE_FORMAT_YUV420SP_NV12:
-        return RK_FORMAT_YCbCr_420_SP;
-    case IMAGE_FORMAT_YUV420SP_NV21:
-        return RK_FORMAT_YCrCb_420_SP;
-    default:
+static int write_image_png(const char* path, const image_write_option_t* option, const image_buffer_t* img)
+{
+    int level = option != NULL ? option->png_level : 0;
+    if (level < 0) {
+        level = IMAGE_WRITE_PNG_STORE;
+    } else if (level == 0) {
+        level = 8;
+    } else if (level > 9) {
+        level = 9;
+    }
+    int len = 0;
+    unsigned char* png = png_encode_to_mem((const unsigned char*)img->virt_addr, get_row_bytes(img), img->width,
+                                           img->height, get_format_channel(img->format), level, &len);
+    if (png == NULL) {
+        printf("encode png fail\n");
         return -1;
     }
+    int ret = write_data_to_file(path, (const char*)png, len);
+    free(png);
+    return ret;
 }
 
-int get_image_size(image_buffer_t* image)
+static int write_image_internal(tjhandle handle, unsigned char** jpeg_buf, unsigned long* jpeg_capacity,
+                                const char* path, const image_buffer_t* img, const image_write_option_t* option)
 {
-    if (image == NULL) {
-        return 0;
+    int ret;
+    int width = img->width;
+    int height = img->height;
+    int channel = get_format_channel(img->format);
+    void* data = img->virt_addr;
+    printf("write_image path: %s width=%d height=%d channel=%d data=%p\n",
+        path, width, height, channel, data);
+
+    const char* _ext = strrchr(path, '.');
+    if (!_ext) {
+        // missing extension
+        return -1;
     }
-    switch (image->format)
-    {
-    case IMAGE_FORMAT_GRAY8:
-        return image->width * image->height;
-    case IMAGE_FORMAT_RGB888:
-        return image->width * image->height * 3;    
-    case IMAGE_FORMAT_RGBA8888:
-        return image->width * image->height * 4;
-    case IMAGE_FORMAT_YUV420SP_NV12:
-    case IMAGE_FORMAT_YUV420SP_NV21:
-        return image->width * image->height * 3 / 2;
-    default:
-        break;
+    if (strcmp(_ext, ".jpg") == 0 || strcmp(_ext, ".jpeg") == 0 || strcmp(_ext, ".JPG") == 0 ||
+        strcmp(_ext, ".JPEG") == 0) {
+        ret = write_image_jpeg(handle, jpeg_buf, jpeg_capacity, path, option, img);
+    } else if (strcmp(_ext, ".png") == 0 || strcmp(_ext, ".PNG") == 0) {
+        if (is_yuv420sp(img->format) || channel == 0) {
+            printf("write png: pixel format %d not support\n", img->format);
+            return -1;
+        }
+        ret = write_image_png(path, option, img);
+    } else if (strcmp(_ext, ".data") == 0 || strcmp(_ext, ".DATA") == 0) {
+        raw_image_writer_t* writer = raw_image_writer_open(path);
+        if (writer == NULL) {
+            return -1;
+        }
+        ret = raw_image_writer_append(writer, img);
+        if (raw_image_writer_close(writer) != 0) {
+            ret = -1;
+        }
+    } else {
+        // unknown extension type
+        return -1;
     }
+    return ret;
 }
 
-static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, image_rect_t* src_box, image_rect_t* dst_box, char color)
+int write_image(const char* path, const image_buffer_t* img)
 {
-    int ret = 0;
-
-    int srcWidth = src_img->width;
-    int srcHeight = src_img->height;
-    void *src = src_img->virt_addr;
-    int src_fd = src_img->fd;
-    void *src_phy = NULL;
-    int srcFmt = get_rga_fmt(src_img->format);
+    return write_image_internal(NULL, NULL, NULL, path, img, NULL);
+}
 
-    int dstWidth = dst_img->width;
-    int dstHeight = dst_img->height;
-    void *dst = dst_img->virt_addr;
-    int dst_fd = dst_img->fd;
-    void *dst_phy = NULL;
-    int dstFmt = get_rga_fmt(dst_img->format);
+int write_image_with_option(const char* path, const image_buffer_t* img, const image_write_option_t* option)
+{
+    return write_image_internal(NULL, NULL, NULL, path, img, option);
+}
 
-    int rotate = 0;
+typedef struct {
+    char path[256];
+    image_buffer_t image;
+    unsigned char* buffer;          // 拷贝模式下的帧数据，只增长
+    int capacity;
+    image_writer_release_t release; // 不为NULL时image属于调用者，写完后回调
+    void* user_data;
+} writer_entry_t;
+
+struct image_writer {
+    image_write_option_t option;
+    image_writer_drop_t drop_policy;
+    int queue_size;
+    writer_entry_t* entries;        // 环形队列
+    int head;
+    int count;
+    writer_entry_t current;         // 正在编码的帧，与队列项交换缓冲
+    int busy;
+    int quit;
+    int dropped;
+    int written;
+    pthread_t thread;
+    int thread_started;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
 
-    int use_handle = 0;
-#if defined(LIBRGA_IM2D_HANDLE)
-    use_handle = 1;
-#endif
+static void writer_entry_done(writer_entry_t* entry)
+{
+    if (entry->release != NULL) {
+        entry->release(&entry->image, entry->user_data);
+        entry->release = NULL;
+    }
+    entry->user_data = NULL;
+}
 
-    // printf("src width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d\n",
-    //     srcWidth, srcHeight, srcFmt, src, src_fd);
-    // printf("dst width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d\n",
-    //     dstWidth, dstHeight, dstFmt, dst, dst_fd);
-    // printf("rotate=%d\n", rotate);
+static void* image_writer_thread(void* arg)
+{
+    image_writer_t* writer = (image_writer_t*)arg;
+    tjhandle handle = tjInitCompress();
+    unsigned char* jpeg_buf = NULL;
+    unsigned long jpeg_capacity = 0;
+
+    pthread_mutex_lock(&writer->lock);
+    for (;;) {
+        while (!writer->quit && writer->count == 0) {
+            pthread_cond_wait(&writer->cond, &writer->lock);
+        }
+        if (writer->count == 0) {
+            break;
+        }
+        // 取出队首，交换后队列项拿到上一帧用过的缓冲，提交时可以立即复用
+        writer_entry_t tmp = writer->entries[writer->head];
+        writer->entries[writer->head] = writer->current;
+        writer->current = tmp;
+        writer->head = (writer->head + 1) % writer->queue_size;
+        writer->count--;
+        writer->busy = 1;
+        pthread_cond_broadcast(&writer->cond);
+        pthread_mutex_unlock(&writer->lock);
+
+        write_image_internal(handle, &jpeg_buf, &jpeg_capacity, writer->current.path, &writer->current.image,
+            &writer->option);
+        writer_entry_done(&writer->current);
+
+        pthread_mutex_lock(&writer->lock);
+        writer->busy = 0;
+        writer->written++;
+        pthread_cond_broadcast(&writer->cond);
+    }
+    pthread_mutex_unlock(&writer->lock);
 
-    int usage = 0;
-    IM_STATUS ret_rga = IM_STATUS_NOERROR;
+    if (jpeg_buf != NULL) {
+        tjFree(jpeg_buf);
+    }
+    if (handle != NULL) {
+        tjDestroy(handle);
+    }
+    return NULL;
+}
 
-    // set rga usage
+image_writer_t* image_writer_create(int queue_size, image_writer_drop_t drop_policy, const image_write_option_t* option)
+{
+    image_writer_t* writer = (image_writer_t*)malloc(sizeof(image_writer_t));
+    if (writer == NULL) {
+        return NULL;
+    }
+    memset(writer, 0, sizeof(image_writer_t));
+    writer->queue_size = queue_size > 0 ? queue_size : 1;
+    writer->drop_policy = drop_policy;
+    if (option != NULL) {
+        writer->option = *option;
+    }
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->cond, NULL);
+    writer->entries = (writer_entry_t*)calloc(writer->queue_size, sizeof(writer_entry_t));
+    if (writer->entries == NULL) {
+        image_writer_destroy(writer);
+        return NULL;
+    }
+    if (pthread_create(&writer->thread, NULL, image_writer_thread, writer) != 0) {
+        printf("image_writer: create thread fail\n");
+        image_writer_destroy(writer);
+        return NULL;
+    }
+    writer->thread_started = 1;
+    return writer;
+}
+
+int image_writer_submit(image_writer_t* writer, const char* path, const image_buffer_t* image,
+                        image_writer_release_t release, void* user_data)
+{
+    if (writer == NULL || path == NULL || image == NULL || image->virt_addr == NULL) {
+        return -1;
+    }
+    int size = get_image_size((image_buffer_t*)image);
+    if (size <= 0 || strlen(path) >= sizeof(((writer_entry_t*)0)->path)) {
+        printf("image_writer: invalid image or path too long %s\n", path);
+        return -1;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->count == writer->queue_size) {
+        if (writer->drop_policy == IMAGE_WRITER_DROP_NEWEST) {
+            writer->dropped++;
+            pthread_mutex_unlock(&writer->lock);
+            if (release != NULL) {
+                release((image_buffer_t*)image, user_data);
+            }
+            return 1;
+        } else if (writer->drop_policy == IMAGE_WRITER_DROP_OLDEST) {
+            writer_entry_t* oldest = &writer->entries[writer->head];
+            writer_entry_done(oldest);
+            writer->head = (writer->head + 1) % writer->queue_size;
+            writer->count--;
+            writer->dropped++;
+        } else {
+            pthread_cond_wait(&writer->cond, &writer->lock);
+        }
+    }
+
+    writer_entry_t* entry = &writer->entries[(writer->head + writer->count) % writer->queue_size];
+    strcpy(entry->path, path);
+    entry->image = *image;
+    entry->release = release;
+    entry->user_data = user_data;
+    if (release == NULL) {
+        // 拷贝模式，调用者返回后可以继续修改原图
+        if (entry->capacity < size) {
+            free(entry->buffer);
+            entry->buffer = (unsigned char*)malloc(size);
+            entry->capacity = entry->buffer != NULL ? size : 0;
+        }
+        if (entry->buffer == NULL) {
+            pthread_mutex_unlock(&writer->lock);
+            printf("image_writer: malloc size %d error\n", size);
+            return -1;
+        }
+        memcpy(entry->buffer, image->virt_addr, size);
+        entry->image.virt_addr = entry->buffer;
+        entry->image.fd = 0;
+    }
+    writer->count++;
+    pthread_cond_broadcast(&writer->cond);
+    pthread_mutex_unlock(&writer->lock);
+    return 0;
+}
+
+void image_writer_flush(image_writer_t* writer)
+{
+    if (writer == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&writer->lock);
+    while (writer->count > 0 || writer->busy) {
+        pthread_cond_wait(&writer->cond, &writer->lock);
+    }
+    pthread_mutex_unlock(&writer->lock);
+}
+
+int image_writer_get_dropped(image_writer_t* writer)
+{
+    if (writer == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&writer->lock);
+    int dropped = writer->dropped;
+    pthread_mutex_unlock(&writer->lock);
+    return dropped;
+}
+
+void image_writer_destroy(image_writer_t* writer)
+{
+    if (writer == NULL) {
+        return;
+    }
+    if (writer->thread_started) {
+        // 先写完队列中剩余的帧再退出
+        pthread_mutex_lock(&writer->lock);
+        writer->quit = 1;
+        pthread_cond_broadcast(&writer->cond);
+        pthread_mutex_unlock(&writer->lock);
+        pthread_join(writer->thread, NULL);
+    }
+    if (writer->entries != NULL) {
+        for (int i = 0; i < writer->queue_size; i++) {
+            free(writer->entries[i].buffer);
+        }
+        free(writer->entries);
+    }
+    free(writer->current.buffer);
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer);
+}
+
+typedef enum {
+    BOX_RESIZE_PLANE,               // gray/rgb/rgba to same format, rgba to rgb
+    BOX_RESIZE_YUV420SP,            // yuv420sp to yuv420sp
+    BOX_RESIZE_YUV420SP_TO_RGB,     // yuv420sp to rgb888
+} box_resize_mode_t;
+
+/**
+ * Resize source crop rectangle into a target box, rows of box can be produced in any order
+ */
+typedef struct {
+    box_resize_mode_t mode;
+    int v_first;
+    int box_width;
+    int box_height;
+    bilinear_table_t table;
+    bilinear_table_t uv_table;
+    const unsigned char* src;
+    int src_stride;
+    const unsigned char* src_uv;
+    int src_uv_stride;
+} box_resizer_t;
+
+static void box_resizer_release(box_resizer_t *resizer) {
+    bilinear_table_release(&resizer->table);
+    bilinear_table_release(&resizer->uv_table);
+}
+
+// 绑定源图像数据，表只依赖尺寸和格式，同尺寸的每一帧都可以复用
+static void box_resizer_bind(box_resizer_t *resizer, image_buffer_t *src) {
+    resizer->src = src->virt_addr;
+    resizer->src_stride = get_row_bytes(src);
+    if (is_yuv420sp(src->format)) {
+        resizer->src_uv = get_uv_plane(src);
+        resizer->src_uv_stride = get_width_stride(src);
+    }
+}
+
+// CPU路径支持同格式缩放以及RGBA8888/YUV420SP到RGB888
+static int is_resize_supported(image_format_t src_format, image_format_t dst_format) {
+    return src_format == dst_format ||
+        (dst_format == IMAGE_FORMAT_RGB888 && (src_format == IMAGE_FORMAT_RGBA8888 || is_yuv420sp(src_format)));
+}
+
+static int box_resizer_init(box_resizer_t *resizer, image_buffer_t *src, image_format_t dst_format,
+                            int crop_x, int crop_y, int crop_width, int crop_height,
+                            int box_width, int box_height) {
+    memset(resizer, 0, sizeof(box_resizer_t));
+    if (!is_resize_supported(src->format, dst_format)) {
+        printf("no support convert format %d to %d\n", src->format, dst_format);
+        return -1;
+    }
+    int src_channel = get_format_channel(src->format);
+    if (src_channel == 0) {
+        printf("no support format %d\n", src->format);
+        return -1;
+    }
+    resizer->box_width = box_width;
+    resizer->box_height = box_height;
+    box_resizer_bind(resizer, src);
+
+    int ret;
+    if (!is_yuv420sp(src->format)) {
+        // RGBA -> RGB: 水平插值时直接丢弃alpha通道
+        resizer->mode = BOX_RESIZE_PLANE;
+        ret = bilinear_table_init(&resizer->table, src_channel, get_format_channel(dst_format),
+            src->width, src->height, crop_x, crop_y, crop_width, crop_height, box_width, box_height);
+    } else {
+        resizer->v_first = (src->format == IMAGE_FORMAT_YUV420SP_NV21);
+        ret = bilinear_table_init(&resizer->table, 1, 1, src->width, src->height,
+            crop_x, crop_y, crop_width, crop_height, box_width, box_height);
+        if (ret == 0 && dst_format == IMAGE_FORMAT_RGB888) {
+            // UV在目标图上按全分辨率插值，转换颜色时每个像素都有独立的UV
+            resizer->mode = BOX_RESIZE_YUV420SP_TO_RGB;
+            ret = bilinear_table_init(&resizer->uv_table, 2, 2, src->width / 2, src->height / 2,
+                crop_x / 2.f, crop_y / 2.f, crop_width / 2.f, crop_height / 2.f, box_width, box_height);
+        } else if (ret == 0) {
+            // UV平面为半分辨率，目标区域同样减半
+            resizer->mode = BOX_RESIZE_YUV420SP;
+            ret = bilinear_table_init(&resizer->uv_table, 2, 2, src->width / 2, src->height / 2,
+                crop_x / 2.f, crop_y / 2.f, crop_width / 2.f, crop_height / 2.f, box_width / 2, box_height / 2);
+        }
+    }
+    if (ret != 0) {
+        box_resizer_release(resizer);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Write rows [dy_begin, dy_end) of target box, dst point to the first pixel of row dy_begin in box,
+ * dst_uv (yuv420sp target only) to the first chroma pixel of row dy_begin / 2, dy_begin should be even.
+ */
+static int box_resizer_run(const box_resizer_t *resizer, unsigned char *dst, int dst_stride,
+                           unsigned char *dst_uv, int dst_uv_stride, int dy_begin, int dy_end) {
+    int ret;
+    switch (resizer->mode) {
+    case BOX_RESIZE_PLANE:
+        return bilinear_resize_rows(&resizer->table, resizer->src, resizer->src_stride,
+            dst, dst_stride, dy_begin, dy_end);
+    case BOX_RESIZE_YUV420SP_TO_RGB:
+        return bilinear_resize_yuv420sp_to_rgb_rows(&resizer->table, &resizer->uv_table,
+            resizer->src, resizer->src_stride, resizer->src_uv, resizer->src_uv_stride, resizer->v_first,
+            dst, dst_stride, dy_begin, dy_end);
+    case BOX_RESIZE_YUV420SP: {
+        ret = bilinear_resize_rows(&resizer->table, resizer->src, resizer->src_stride,
+            dst, dst_stride, dy_begin, dy_end);
+        if (ret != 0) {
+            return ret;
+        }
+        int uv_begin = dy_begin / 2;
+        int uv_end = (dy_end >= resizer->box_height) ? resizer->uv_table.dst_height : dy_end / 2;
+        return bilinear_resize_rows(&resizer->uv_table, resizer->src_uv, resizer->src_uv_stride,
+            dst_uv, dst_uv_stride, uv_begin, uv_end);
+    }
+    default:
+        return -1;
+    }
+}
+
+#define CONVERT_BAND_MIN_ROWS 16
+
+// CPU转换使用的常驻线程池，NULL时单线程执行
+static thread_pool_t* g_convert_pool = NULL;
+
+int set_convert_image_threads(int num_threads, const int* core_ids, int num_core_ids)
+{
+    if (g_convert_pool != NULL) {
+        thread_pool_destroy(g_convert_pool);
+        g_convert_pool = NULL;
+    }
+    if (num_threads <= 1 && (core_ids == NULL || num_core_ids <= 0)) {
+        return 0;
+    }
+    g_convert_pool = thread_pool_create(num_threads, core_ids, num_core_ids);
+    if (g_convert_pool == NULL) {
+        printf("set_convert_image_threads: create thread pool fail\n");
+        return -1;
+    }
+    return 0;
+}
+
+// 目标区域按行带切分，每个线程独立缓存源行，行带高度保持偶数以对齐yuv420sp的UV行
+static int get_band_rows(int rows, int num_threads)
+{
+    if (num_threads <= 1) {
+        return rows;
+    }
+    int num_bands = num_threads * 2;
+    int band_rows = (rows + num_bands - 1) / num_bands;
+    if (band_rows < CONVERT_BAND_MIN_ROWS) {
+        band_rows = CONVERT_BAND_MIN_ROWS;
+    }
+    band_rows += band_rows % 2;
+    return band_rows;
+}
+
+typedef struct {
+    const box_resizer_t* resizer;
+    unsigned char* dst;
+    int dst_stride;
+    unsigned char* dst_uv;
+    int dst_uv_stride;
+    int band_rows;
+    volatile int ret;
+} resize_band_job_t;
+
+static void resize_band_task(void* arg, int index)
+{
+    resize_band_job_t* job = (resize_band_job_t*)arg;
+    int begin = index * job->band_rows;
+    int end = begin + job->band_rows;
+    if (end > job->resizer->box_height) {
+        end = job->resizer->box_height;
+    }
+    unsigned char* dst_uv = job->dst_uv != NULL ? job->dst_uv + (size_t)(begin / 2) * job->dst_uv_stride : NULL;
+    int ret = box_resizer_run(job->resizer, job->dst + (size_t)begin * job->dst_stride, job->dst_stride,
+        dst_uv, job->dst_uv_stride, begin, end);
+    if (ret != 0) {
+        job->ret = ret;
+    }
+}
+
+static int box_resizer_run_parallel(const box_resizer_t *resizer, unsigned char *dst, int dst_stride,
+                                    unsigned char *dst_uv, int dst_uv_stride) {
+    resize_band_job_t job;
+    job.resizer = resizer;
+    job.dst = dst;
+    job.dst_stride = dst_stride;
+    job.dst_uv = dst_uv;
+    job.dst_uv_stride = dst_uv_stride;
+    job.band_rows = get_band_rows(resizer->box_height, thread_pool_get_num_threads(g_convert_pool));
+    job.ret = 0;
+    int num_bands = (resizer->box_height + job.band_rows - 1) / job.band_rows;
+    thread_pool_parallel_for(g_convert_pool, num_bands, resize_band_task, &job);
+    return job.ret;
+}
+
+static void fill_pad_plane(unsigned char *plane, int width, int height, int channel, int stride,
+                           int box_x, int box_y, int box_w, int box_h, char color) {
+    for (int y = 0; y < height; y++) {
+        unsigned char* row = plane + (size_t)y * stride;
+        if (y < box_y || y >= box_y + box_h) {
+            memset(row, color, width * channel);
+            continue;
+        }
+        if (box_x > 0) {
+            memset(row, color, box_x * channel);
+        }
+        if (box_x + box_w < width) {
+            memset(row + (box_x + box_w) * channel, color, (width - box_x - box_w) * channel);
+        }
+    }
+}
+
+// 只填充目标区域之外的部分，目标区域由缩放结果直接覆盖
+static void fill_pad_color(image_buffer_t *dst, int box_x, int box_y, int box_w, int box_h, char color) {
+    switch (dst->format) {
+    case IMAGE_FORMAT_GRAY8:
+    case IMAGE_FORMAT_RGB888:
+    case IMAGE_FORMAT_RGBA8888:
+        fill_pad_plane(dst->virt_addr, dst->width, dst->height, get_format_channel(dst->format),
+            get_row_bytes(dst), box_x, box_y, box_w, box_h, color);
+        break;
+    case IMAGE_FORMAT_YUV420SP_NV12:
+    case IMAGE_FORMAT_YUV420SP_NV21:
+        fill_pad_plane(dst->virt_addr, dst->width, dst->height, 1, get_row_bytes(dst),
+            box_x, box_y, box_w, box_h, color);
+        fill_pad_plane(get_uv_plane(dst), dst->width / 2, dst->height / 2, 2, get_width_stride(dst),
+            box_x / 2, box_y / 2, box_w / 2, box_h / 2, color);
+        break;
+    default:
+        break;
+    }
+}
+
+// 填充目标区域之外的部分，再把缩放结果写入(box_x, box_y)开始的目标区域
+static int box_resizer_write(const box_resizer_t *resizer, image_buffer_t *dst, int box_x, int box_y, char color) {
+    int box_w = resizer->box_width;
+    int box_h = resizer->box_height;
+    if (box_w != dst->width || box_h != dst->height) {
+        fill_pad_color(dst, box_x, box_y, box_w, box_h, color);
+    }
+
+    int dst_channel = get_format_channel(dst->format);
+    int dst_stride = get_row_bytes(dst);
+    unsigned char* dst_ptr = dst->virt_addr + (size_t)box_y * dst_stride + box_x * dst_channel;
+    unsigned char* dst_uv_ptr = NULL;
+    int dst_uv_stride = 0;
+    if (is_yuv420sp(dst->format)) {
+        dst_uv_stride = get_width_stride(dst);
+        dst_uv_ptr = get_uv_plane(dst) + (size_t)(box_y / 2) * dst_uv_stride + (box_x / 2) * 2;
+    }
+    return box_resizer_run_parallel(resizer, dst_ptr, dst_stride, dst_uv_ptr, dst_uv_stride);
+}
+
+static int convert_image_cpu(image_buffer_t *src, image_buffer_t *dst, image_rect_t *src_box, image_rect_t *dst_box, char color) {
+    int ret;
+    if (dst->virt_addr == NULL) {
+        return -1;
+    }
+    if (src->virt_addr == NULL) {
+        return -1;
+    }
+
+    int src_box_x = 0;
+    int src_box_y = 0;
+    int src_box_w = src->width;
+    int src_box_h = src->height;
+    if (src_box != NULL) {
+        src_box_x = src_box->left;
+        src_box_y = src_box->top;
+        src_box_w = src_box->right - src_box->left + 1;
+        src_box_h = src_box->bottom - src_box->top + 1;
+    }
+    int dst_box_x = 0;
+    int dst_box_y = 0;
+    int dst_box_w = dst->width;
+    int dst_box_h = dst->height;
+    if (dst_box != NULL) {
+        dst_box_x = dst_box->left;
+        dst_box_y = dst_box->top;
+        dst_box_w = dst_box->right - dst_box->left + 1;
+        dst_box_h = dst_box->bottom - dst_box->top + 1;
+    }
+
+    box_resizer_t resizer;
+    ret = box_resizer_init(&resizer, src, dst->format, src_box_x, src_box_y, src_box_w, src_box_h,
+        dst_box_w, dst_box_h);
+    if (ret != 0) {
+        printf("convert_image_cpu fail %d\n", ret);
+        return -1;
+    }
+
+    ret = box_resizer_write(&resizer, dst, dst_box_x, dst_box_y, color);
+    box_resizer_release(&resizer);
+    if (ret != 0) {
+        printf("convert_image_cpu fail %d\n", ret);
+        return -1;
+    }
+    printf("finish\n");
+    return 0;
+}
+
+static int get_rga_fmt(image_format_t fmt) {
+    switch (fmt)
+    {
+    case IMAGE_FORMAT_RGB888:
+        return RK_FORMAT_RGB_888;
+    case IMAGE_FORMAT_RGBA8888:
+        return RK_FORMAT_RGBA_8888;
+    case IMAGE_FORMAT_YUV420SP_NV12:
+        return RK_FORMAT_YCbCr_420_SP;
+    case IMAGE_FORMAT_YUV420SP_NV21:
+        return RK_FORMAT_YCrCb_420_SP;
+    default:
+        return -1;
+    }
+}
+
+int get_image_size(image_buffer_t* image)
+{
+    if (image == NULL) {
+        return 0;
+    }
+    int width_stride = get_width_stride(image);
+    int height_stride = get_height_stride(image);
+    switch (image->format)
+    {
+    case IMAGE_FORMAT_GRAY8:
+        return width_stride * height_stride;
+    case IMAGE_FORMAT_RGB888:
+        return width_stride * height_stride * 3;    
+    case IMAGE_FORMAT_RGBA8888:
+        return width_stride * height_stride * 4;
+    case IMAGE_FORMAT_YUV420SP_NV12:
+    case IMAGE_FORMAT_YUV420SP_NV21:
+        // UV平面紧跟在height_stride行的Y平面之后，RGA按height_stride/2行UV导入
+        return width_stride * height_stride + width_stride * ((height_stride + 1) / 2);
+    default:
+        break;
+    }
+    return 0;
+}
+
+static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, image_rect_t* src_box, image_rect_t* dst_box, char color)
+{
+    int ret = 0;
+
+    int srcWidth = src_img->width;
+    int srcHeight = src_img->height;
+    int srcWstride = get_width_stride(src_img);
+    int srcHstride = get_height_stride(src_img);
+    void *src = src_img->virt_addr;
+    int src_fd = src_img->fd;
+    void *src_phy = NULL;
+    int srcFmt = get_rga_fmt(src_img->format);
+
+    int dstWidth = dst_img->width;
+    int dstHeight = dst_img->height;
+    int dstWstride = get_width_stride(dst_img);
+    int dstHstride = get_height_stride(dst_img);
+    void *dst = dst_img->virt_addr;
+    int dst_fd = dst_img->fd;
+    void *dst_phy = NULL;
+    int dstFmt = get_rga_fmt(dst_img->format);
+
+    int rotate = 0;
+
+    int use_handle = 0;
+#if defined(LIBRGA_IM2D_HANDLE)
+    use_handle = 1;
+#endif
+
+    // printf("src width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d\n",
+    //     srcWidth, srcHeight, srcFmt, src, src_fd);
+    // printf("dst width=%d height=%d fmt=0x%x virAddr=0x%p fd=%d\n",
+    //     dstWidth, dstHeight, dstFmt, dst, dst_fd);
+    // printf("rotate=%d\n", rotate);
+
+    int usage = 0;
+    IM_STATUS ret_rga = IM_STATUS_NOERROR;
+
+    // set rga usage
     usage |= rotate;
 
     // set rga rect
@@ -563,13 +2192,13 @@ static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, i
     memset(&pat, 0, sizeof(rga_buffer_t));
 
     im_handle_param_t in_param;
-    in_param.width = srcWidth;
-    in_param.height = srcHeight;
+    in_param.width = srcWstride;
+    in_param.height = srcHstride;
     in_param.format = srcFmt;
 
     im_handle_param_t dst_param;
-    dst_param.width = dstWidth;
-    dst_param.height = dstHeight;
+    dst_param.width = dstWstride;
+    dst_param.height = dstHstride;
     dst_param.format = dstFmt;
 
     if (use_handle) {
@@ -585,14 +2214,14 @@ static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, i
             ret = -1;
             goto err;
         }
-        rga_buf_src = wrapbuffer_handle(rga_handle_src, srcWidth, srcHeight, srcFmt, srcWidth, srcHeight);
+        rga_buf_src = wrapbuffer_handle(rga_handle_src, srcWidth, srcHeight, srcFmt, srcWstride, srcHstride);
     } else {
         if (src_phy != NULL) {
-            rga_buf_src = wrapbuffer_physicaladdr(src_phy, srcWidth, srcHeight, srcFmt, srcWidth, srcHeight);
+            rga_buf_src = wrapbuffer_physicaladdr(src_phy, srcWidth, srcHeight, srcFmt, srcWstride, srcHstride);
         } else if (src_fd > 0) {
-            rga_buf_src = wrapbuffer_fd(src_fd, srcWidth, srcHeight, srcFmt, srcWidth, srcHeight);
+            rga_buf_src = wrapbuffer_fd(src_fd, srcWidth, srcHeight, srcFmt, srcWstride, srcHstride);
         } else {
-            rga_buf_src = wrapbuffer_virtualaddr(src, srcWidth, srcHeight, srcFmt, srcWidth, srcHeight);
+            rga_buf_src = wrapbuffer_virtualaddr(src, srcWidth, srcHeight, srcFmt, srcWstride, srcHstride);
         }
     }
 
@@ -609,14 +2238,14 @@ static int convert_image_rga(image_buffer_t* src_img, image_buffer_t* dst_img, i
             ret = -1;
             goto err;
         }
-        rga_buf_dst = wrapbuffer_handle(rga_handle_dst, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+        rga_buf_dst = wrapbuffer_handle(rga_handle_dst, dstWidth, dstHeight, dstFmt, dstWstride, dstHstride);
     } else {
         if (dst_phy != NULL) {
-            rga_buf_dst = wrapbuffer_physicaladdr(dst_phy, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+            rga_buf_dst = wrapbuffer_physicaladdr(dst_phy, dstWidth, dstHeight, dstFmt, dstWstride, dstHstride);
         } else if (dst_fd > 0) {
-            rga_buf_dst = wrapbuffer_fd(dst_fd, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+            rga_buf_dst = wrapbuffer_fd(dst_fd, dstWidth, dstHeight, dstFmt, dstWstride, dstHstride);
         } else {
-            rga_buf_dst = wrapbuffer_virtualaddr(dst, dstWidth, dstHeight, dstFmt, dstWidth, dstHeight);
+            rga_buf_dst = wrapbuffer_virtualaddr(dst, dstWidth, dstHeight, dstFmt, dstWstride, dstHstride);
         }
     }
 
@@ -686,14 +2315,9 @@ int convert_image(image_buffer_t* src_img, image_buffer_t* dst_img, image_rect_t
     return ret;
 }
 
-int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_image, letterbox_t* letterbox, char color)
+static void get_letterbox_box(int src_w, int src_h, int dst_w, int dst_h, image_rect_t* dst_box, letterbox_t* letterbox)
 {
-    int ret = 0;
     int allow_slight_change = 1;
-    int src_w = src_image->width;
-    int src_h = src_image->height;
-    int dst_w = dst_image->width;
-    int dst_h = dst_image->height;
     int resize_w = dst_w;
     int resize_h = dst_h;
 
@@ -704,17 +2328,10 @@ int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_
     int _top_offset = 0;
     float scale = 1.0;
 
-    image_rect_t src_box;
-    src_box.left = 0;
-    src_box.top = 0;
-    src_box.right = src_image->width - 1;
-    src_box.bottom = src_image->height - 1;
-
-    image_rect_t dst_box;
-    dst_box.left = 0;
-    dst_box.top = 0;
-    dst_box.right = dst_image->width - 1;
-    dst_box.bottom = dst_image->height - 1;
+    dst_box->left = 0;
+    dst_box->top = 0;
+    dst_box->right = dst_w - 1;
+    dst_box->bottom = dst_h - 1;
 
     float _scale_w = (float)dst_w / src_w;
     float _scale_h = (float)dst_h / src_h;
@@ -737,28 +2354,28 @@ int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_
     padding_w = dst_w - resize_w;
     // center
     if (_scale_w < _scale_h) {
-        dst_box.top = padding_h / 2;
-        if (dst_box.top % 2 != 0) {
-            dst_box.top -= dst_box.top % 2;
-            if (dst_box.top < 0) {
-                dst_box.top = 0;
+        dst_box->top = padding_h / 2;
+        if (dst_box->top % 2 != 0) {
+            dst_box->top -= dst_box->top % 2;
+            if (dst_box->top < 0) {
+                dst_box->top = 0;
             }
         }
-        dst_box.bottom = dst_box.top + resize_h - 1;
-        _top_offset = dst_box.top;
+        dst_box->bottom = dst_box->top + resize_h - 1;
+        _top_offset = dst_box->top;
     } else {
-        dst_box.left = padding_w / 2;
-        if (dst_box.left % 2 != 0) {
-            dst_box.left -= dst_box.left % 2;
-            if (dst_box.left < 0) {
-                dst_box.left = 0;
+        dst_box->left = padding_w / 2;
+        if (dst_box->left % 2 != 0) {
+            dst_box->left -= dst_box->left % 2;
+            if (dst_box->left < 0) {
+                dst_box->left = 0;
             }
         }
-        dst_box.right = dst_box.left + resize_w - 1;
-        _left_offset = dst_box.left;
+        dst_box->right = dst_box->left + resize_w - 1;
+        _left_offset = dst_box->left;
     }
     printf("scale=%f dst_box=(%d %d %d %d) allow_slight_change=%d _left_offset=%d _top_offset=%d padding_w=%d padding_h=%d\n",
-        scale, dst_box.left, dst_box.top, dst_box.right, dst_box.bottom, allow_slight_change,
+        scale, dst_box->left, dst_box->top, dst_box->right, dst_box->bottom, allow_slight_change,
         _left_offset, _top_offset, padding_w, padding_h);
 
     //set offset and scale
@@ -767,6 +2384,21 @@ int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_
         letterbox->x_pad = _left_offset;
         letterbox->y_pad = _top_offset;
     }
+}
+
+int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_image, letterbox_t* letterbox, char color)
+{
+    int ret = 0;
+
+    image_rect_t src_box;
+    src_box.left = 0;
+    src_box.top = 0;
+    src_box.right = src_image->width - 1;
+    src_box.bottom = src_image->height - 1;
+
+    image_rect_t dst_box;
+    get_letterbox_box(src_image->width, src_image->height, dst_image->width, dst_image->height, &dst_box, letterbox);
+
     // alloc memory buffer for dst image,
     // remember to free
     if (dst_image->virt_addr == NULL && dst_image->fd <= 0) {
@@ -779,4 +2411,836 @@ int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_
     }
     ret = convert_image(src_image, dst_image, &src_box, &dst_box, color);
     return ret;
-}
\ No newline at end of file
+}
+
+struct resize_plan {
+    int src_width;
+    int src_height;
+    image_format_t src_format;
+    int dst_width;
+    int dst_height;
+    image_format_t dst_format;
+    image_rect_t src_box;
+    image_rect_t dst_box;
+    letterbox_t letterbox;
+    int use_cpu;            // RGA失败后不再尝试，直接使用CPU
+    box_resizer_t resizer;
+};
+
+resize_plan_t* resize_plan_create(int src_width, int src_height, image_format_t src_format,
+                                  int dst_width, int dst_height, image_format_t dst_format, int use_letterbox)
+{
+    if (src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0) {
+        printf("resize_plan_create: invalid size src=%dx%d dst=%dx%d\n", src_width, src_height, dst_width, dst_height);
+        return NULL;
+    }
+    resize_plan_t* plan = (resize_plan_t*)malloc(sizeof(resize_plan_t));
+    if (plan == NULL) {
+        return NULL;
+    }
+    memset(plan, 0, sizeof(resize_plan_t));
+    plan->src_width = src_width;
+    plan->src_height = src_height;
+    plan->src_format = src_format;
+    plan->dst_width = dst_width;
+    plan->dst_height = dst_height;
+    plan->dst_format = dst_format;
+
+    plan->src_box.left = 0;
+    plan->src_box.top = 0;
+    plan->src_box.right = src_width - 1;
+    plan->src_box.bottom = src_height - 1;
+    if (use_letterbox) {
+        get_letterbox_box(src_width, src_height, dst_width, dst_height, &plan->dst_box, &plan->letterbox);
+    } else {
+        plan->dst_box.left = 0;
+        plan->dst_box.top = 0;
+        plan->dst_box.right = dst_width - 1;
+        plan->dst_box.bottom = dst_height - 1;
+        plan->letterbox.scale = 1.0f;
+    }
+
+    // 索引和权重表只依赖尺寸，数据在执行时绑定
+    image_buffer_t src;
+    memset(&src, 0, sizeof(image_buffer_t));
+    src.width = src_width;
+    src.height = src_height;
+    src.format = src_format;
+    int ret = box_resizer_init(&plan->resizer, &src, dst_format, 0, 0, src_width, src_height,
+        plan->dst_box.right - plan->dst_box.left + 1, plan->dst_box.bottom - plan->dst_box.top + 1);
+    if (ret != 0) {
+        printf("resize_plan_create fail %d\n", ret);
+        free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void resize_plan_destroy(resize_plan_t* plan)
+{
+    if (plan == NULL) {
+        return;
+    }
+    box_resizer_release(&plan->resizer);
+    free(plan);
+}
+
+int resize_plan_execute(resize_plan_t* plan, image_buffer_t* src_image, image_buffer_t* dst_image,
+                        letterbox_t* letterbox, char color)
+{
+    if (plan == NULL || src_image == NULL || dst_image == NULL || src_image->virt_addr == NULL) {
+        return -1;
+    }
+    if (src_image->width != plan->src_width || src_image->height != plan->src_height ||
+        src_image->format != plan->src_format || dst_image->width != plan->dst_width ||
+        dst_image->height != plan->dst_height || dst_image->format != plan->dst_format) {
+        printf("resize_plan_execute: image geometry not match plan\n");
+        return -1;
+    }
+    if (dst_image->virt_addr == NULL && dst_image->fd <= 0) {
+        int dst_size = get_image_size(dst_image);
+        dst_image->virt_addr = (uint8_t *)malloc(dst_size);
+        if (dst_image->virt_addr == NULL) {
+            printf("malloc size %d error\n", dst_size);
+            return -1;
+        }
+    }
+    if (letterbox != NULL) {
+        *letterbox = plan->letterbox;
+    }
+
+    if (!plan->use_cpu) {
+        if (convert_image_rga(src_image, dst_image, &plan->src_box, &plan->dst_box, color) == 0) {
+            return 0;
+        }
+        printf("resize plan use cpu\n");
+        plan->use_cpu = 1;
+    }
+    if (dst_image->virt_addr == NULL) {
+        return -1;
+    }
+    box_resizer_bind(&plan->resizer, src_image);
+    int ret = box_resizer_write(&plan->resizer, dst_image, plan->dst_box.left, plan->dst_box.top, color);
+    if (ret != 0) {
+        printf("resize_plan_execute fail %d\n", ret);
+        return -1;
+    }
+    return 0;
+}
+
+#define TENSOR_CHUNK_ROWS 16
+
+typedef struct {
+    int elem_size;
+    unsigned char u8[3][256];
+    unsigned short f16[3][256];
+    float f32[3][256];
+} tensor_lut_t;
+
+static unsigned short float_to_half(float value)
+{
+    union { float f; unsigned int u; } v;
+    v.f = value;
+    unsigned int sign = (v.u >> 16) & 0x8000;
+    int exponent = (int)((v.u >> 23) & 0xff) - 127 + 15;
+    unsigned int mantissa = v.u & 0x7fffff;
+
+    if (((v.u >> 23) & 0xff) == 0xff) {
+        return (unsigned short)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31) {
+        return (unsigned short)(sign | 0x7c00);
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return (unsigned short)sign;
+        }
+        mantissa |= 0x800000;
+        unsigned int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1) {
+            half++;
+        }
+        return (unsigned short)(sign | half);
+    }
+    unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) {
+        half++;     // round, carry into exponent is fine
+    }
+    return (unsigned short)half;
+}
+
+static int get_tensor_elem_size(image_tensor_type_t type)
+{
+    switch (type) {
+    case IMAGE_TENSOR_TYPE_FLOAT16:
+        return 2;
+    case IMAGE_TENSOR_TYPE_FLOAT32:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+// 输入像素只有256种取值，归一化和量化预先算成查找表
+static int build_tensor_lut(const image_tensor_t* tensor, tensor_lut_t* lut)
+{
+    int identity = (tensor->type == IMAGE_TENSOR_TYPE_UINT8);
+    float scale = tensor->scale > 0 ? tensor->scale : 1.0f;
+    int zp = tensor->scale > 0 ? tensor->zp : 0;
+    int qmin = tensor->type == IMAGE_TENSOR_TYPE_INT8 ? -128 : 0;
+    int qmax = tensor->type == IMAGE_TENSOR_TYPE_INT8 ? 127 : 255;
+
+    lut->elem_size = get_tensor_elem_size(tensor->type);
+    for (int c = 0; c < tensor->channel; c++) {
+        float std = tensor->std[c] != 0.f ? tensor->std[c] : 1.0f;
+        for (int p = 0; p < 256; p++) {
+            float v = (p - tensor->mean[c]) / std;
+            float q = roundf(v / scale) + zp;
+            int qi = q < qmin ? qmin : (q > qmax ? qmax : (int)q);
+            lut->u8[c][p] = (unsigned char)qi;
+            lut->f16[c][p] = float_to_half(v);
+            lut->f32[c][p] = v;
+            if (qi != p) {
+                identity = 0;
+            }
+        }
+    }
+    return identity;
+}
+
+// 每种元素类型一个行写入函数，逐元素循环中没有类型和填充分支
+#define DEFINE_TENSOR_WRITE_ROW(name, elem_t, table)                                                    \
+    static void name(const image_tensor_t* tensor, const tensor_lut_t* lut, int y, int x, int count,   \
+                     const unsigned char* pixels, unsigned char color)                                 \
+    {                                                                                                   \
+        int C = tensor->channel;                                                                        \
+        size_t w_stride = tensor->w_stride > 0 ? tensor->w_stride : tensor->width;                      \
+        elem_t* dst = (elem_t*)tensor->virt_addr;                                                       \
+        if (tensor->layout == IMAGE_TENSOR_LAYOUT_NHWC) {                                               \
+            elem_t* row = dst + (y * w_stride + x) * C;                                                 \
+            if (pixels == NULL) {                                                                       \
+                for (int i = 0; i < count; i++) {                                                       \
+                    for (int c = 0; c < C; c++) {                                                       \
+                        row[i * C + c] = lut->table[c][color];                                          \
+                    }                                                                                   \
+                }                                                                                       \
+            } else {                                                                                    \
+                for (int i = 0; i < count; i++) {                                                       \
+                    for (int c = 0; c < C; c++) {                                                       \
+                        row[i * C + c] = lut->table[c][pixels[i * C + c]];                              \
+                    }                                                                                   \
+                }                                                                                       \
+            }                                                                                           \
+        } else {                                                                                        \
+            size_t plane = tensor->height * w_stride;                                                   \
+            for (int c = 0; c < C; c++) {                                                               \
+                elem_t* row = dst + c * plane + y * w_stride + x;                                       \
+                const elem_t* map = lut->table[c];                                                      \
+                if (pixels == NULL) {                                                                   \
+                    elem_t value = map[color];                                                          \
+                    for (int i = 0; i < count; i++) {                                                   \
+                        row[i] = value;                                                                 \
+                    }                                                                                   \
+                } else {                                                                                \
+                    for (int i = 0; i < count; i++) {                                                   \
+                        row[i] = map[pixels[i * C + c]];                                                \
+                    }                                                                                   \
+                }                                                                                       \
+            }                                                                                           \
+        }                                                                                               \
+    }
+
+DEFINE_TENSOR_WRITE_ROW(tensor_write_row_u8, unsigned char, u8)
+DEFINE_TENSOR_WRITE_ROW(tensor_write_row_f16, unsigned short, f16)
+DEFINE_TENSOR_WRITE_ROW(tensor_write_row_f32, float, f32)
+
+// 写一行像素[x, x + count)到张量, pixels为NULL时写填充色
+static void tensor_write_row(const image_tensor_t* tensor, const tensor_lut_t* lut, int y, int x, int count,
+                             const unsigned char* pixels, unsigned char color)
+{
+    switch (lut->elem_size) {
+    case 2:
+        tensor_write_row_f16(tensor, lut, y, x, count, pixels, color);
+        break;
+    case 4:
+        tensor_write_row_f32(tensor, lut, y, x, count, pixels, color);
+        break;
+    default:
+        tensor_write_row_u8(tensor, lut, y, x, count, pixels, color);
+        break;
+    }
+}
+
+// 张量内存需要的字节数，超过tensor->size时拒绝写入
+static int check_tensor_size(const image_tensor_t* tensor, int num, const char* caller)
+{
+    size_t w_stride = tensor->w_stride > 0 ? tensor->w_stride : tensor->width;
+    size_t need = w_stride * tensor->height * tensor->channel * get_tensor_elem_size(tensor->type) * num;
+    if (tensor->size <= 0 || (size_t)tensor->size < need) {
+        printf("%s: tensor size %d < %zu\n", caller, tensor->size, need);
+        return -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    const box_resizer_t* resizer;
+    const image_tensor_t* tensor;
+    const tensor_lut_t* lut;
+    int box_x;
+    int box_y;
+    int band_rows;
+    volatile int ret;
+} tensor_band_job_t;
+
+// 分块缩放到小的行缓存，再经查找表写入张量
+static void tensor_band_task(void* arg, int index)
+{
+    tensor_band_job_t* job = (tensor_band_job_t*)arg;
+    int C = job->tensor->channel;
+    int box_w = job->resizer->box_width;
+    int begin = index * job->band_rows;
+    int end = begin + job->band_rows;
+    if (end > job->resizer->box_height) {
+        end = job->resizer->box_height;
+    }
+    unsigned char* rows = (unsigned char*)malloc(box_w * C * TENSOR_CHUNK_ROWS);
+    if (rows == NULL) {
+        job->ret = -1;
+        return;
+    }
+    for (int dy = begin; dy < end; dy += TENSOR_CHUNK_ROWS) {
+        int dy_end = dy + TENSOR_CHUNK_ROWS < end ? dy + TENSOR_CHUNK_ROWS : end;
+        int ret = box_resizer_run(job->resizer, rows, box_w * C, NULL, 0, dy, dy_end);
+        if (ret != 0) {
+            job->ret = ret;
+            break;
+        }
+        for (int i = dy; i < dy_end; i++) {
+            tensor_write_row(job->tensor, job->lut, job->box_y + i, job->box_x, box_w,
+                rows + (size_t)(i - dy) * box_w * C, 0);
+        }
+    }
+    free(rows);
+}
+
+// 张量元素对应的像素格式：3通道为RGB888，1通道只支持GRAY8输入
+static int get_tensor_pixel_format(const image_buffer_t* src_image, const image_tensor_t* tensor,
+                                   image_format_t* pixel_format)
+{
+    if (tensor->virt_addr == NULL || tensor->width <= 0 || tensor->height <= 0 ||
+        (tensor->w_stride != 0 && tensor->w_stride < tensor->width)) {
+        printf("invalid tensor\n");
+        return -1;
+    }
+    if (tensor->channel == 3) {
+        *pixel_format = IMAGE_FORMAT_RGB888;
+    } else if (tensor->channel == 1 && src_image->format == IMAGE_FORMAT_GRAY8) {
+        *pixel_format = IMAGE_FORMAT_GRAY8;
+    } else {
+        printf("no support tensor channel %d for format %d\n", tensor->channel, src_image->format);
+        return -1;
+    }
+    return 0;
+}
+
+int convert_image_to_tensor(image_buffer_t* src_image, image_tensor_t* tensor, letterbox_t* letterbox, char color)
+{
+    int ret = 0;
+    if (src_image == NULL || tensor == NULL || src_image->virt_addr == NULL) {
+        return -1;
+    }
+    image_format_t pixel_format;
+    if (get_tensor_pixel_format(src_image, tensor, &pixel_format) != 0 ||
+        check_tensor_size(tensor, 1, "convert_image_to_tensor") != 0) {
+        return -1;
+    }
+    int w_stride = tensor->w_stride > 0 ? tensor->w_stride : tensor->width;
+
+    image_rect_t dst_box;
+    if (letterbox != NULL) {
+        get_letterbox_box(src_image->width, src_image->height, tensor->width, tensor->height, &dst_box, letterbox);
+    } else {
+        dst_box.left = 0;
+        dst_box.top = 0;
+        dst_box.right = tensor->width - 1;
+        dst_box.bottom = tensor->height - 1;
+    }
+    int box_x = dst_box.left;
+    int box_y = dst_box.top;
+    int box_w = dst_box.right - dst_box.left + 1;
+    int box_h = dst_box.bottom - dst_box.top + 1;
+
+    tensor_lut_t* lut = (tensor_lut_t*)malloc(sizeof(tensor_lut_t));
+    if (lut == NULL) {
+        return -1;
+    }
+    int identity = build_tensor_lut(tensor, lut);
+
+    // 原始像素时张量等同于带行stride的图像，可以交给RGA直接写入张量内存
+    if (identity && tensor->layout == IMAGE_TENSOR_LAYOUT_NHWC) {
+        image_buffer_t dst_img;
+        memset(&dst_img, 0, sizeof(image_buffer_t));
+        dst_img.width = tensor->width;
+        dst_img.height = tensor->height;
+        dst_img.width_stride = w_stride;
+        dst_img.height_stride = tensor->height;
+        dst_img.format = pixel_format;
+        dst_img.virt_addr = (unsigned char*)tensor->virt_addr;
+        dst_img.fd = tensor->fd;
+        dst_img.size = tensor->size;
+        free(lut);
+        return convert_image(src_image, &dst_img, NULL, &dst_box, color);
+    }
+
+    box_resizer_t resizer;
+    ret = box_resizer_init(&resizer, src_image, pixel_format, 0, 0, src_image->width, src_image->height, box_w, box_h);
+    if (ret != 0) {
+        free(lut);
+        return -1;
+    }
+
+    for (int y = 0; y < tensor->height; y++) {
+        if (y < box_y || y >= box_y + box_h) {
+            tensor_write_row(tensor, lut, y, 0, tensor->width, NULL, color);
+        } else {
+            tensor_write_row(tensor, lut, y, 0, box_x, NULL, color);
+            tensor_write_row(tensor, lut, y, box_x + box_w, tensor->width - box_x - box_w, NULL, color);
+        }
+    }
+    tensor_band_job_t job;
+    job.resizer = &resizer;
+    job.tensor = tensor;
+    job.lut = lut;
+    job.box_x = box_x;
+    job.box_y = box_y;
+    job.band_rows = get_band_rows(box_h, thread_pool_get_num_threads(g_convert_pool));
+    job.ret = 0;
+    int num_bands = (box_h + job.band_rows - 1) / job.band_rows;
+    thread_pool_parallel_for(g_convert_pool, num_bands, tensor_band_task, &job);
+    ret = job.ret;
+
+    box_resizer_release(&resizer);
+    free(lut);
+    if (ret != 0) {
+        printf("convert_image_to_tensor fail %d\n", ret);
+        return -1;
+    }
+    return 0;
+}
+
+#define BATCH_TALL_RATIO 1.5f
+
+typedef struct {
+    int empty;                      // 裁剪区域为空，整个槽位填充
+    int use_quad;
+    box_resizer_t resizer;          // 矩形裁剪
+    float h[8];                     // 四边形裁剪：单位正方形到源四边形的透视变换
+    int box_x;
+    int box_y;
+    int box_w;
+    int box_h;
+    image_tensor_t slot;            // 指向该槽位内存的张量描述
+} batch_roi_t;
+
+typedef struct {
+    int roi;
+    int begin;                      // 槽位行范围[begin, end)
+    int end;
+} batch_task_t;
+
+typedef struct {
+    float src_top;
+    int roi;
+} batch_order_t;
+
+typedef struct {
+    const image_buffer_t* src;
+    batch_roi_t* rois;
+    batch_task_t* tasks;
+    const tensor_lut_t* lut;
+    int direct;                     // 原始像素NHWC，直接写入张量
+    unsigned char color;
+    volatile int ret;
+} batch_job_t;
+
+// 单位正方形(0,0)(1,0)(1,1)(0,1)映射到四边形四个角的透视变换
+static int get_quad_transform(const image_quad_t* quad, float* h)
+{
+    const float* x = quad->x;
+    const float* y = quad->y;
+    float sx = x[0] - x[1] + x[2] - x[3];
+    float sy = y[0] - y[1] + y[2] - y[3];
+    float g = 0.f;
+    float k = 0.f;
+    if (fabsf(sx) > 1e-6f || fabsf(sy) > 1e-6f) {
+        float dx1 = x[1] - x[2];
+        float dx2 = x[3] - x[2];
+        float dy1 = y[1] - y[2];
+        float dy2 = y[3] - y[2];
+        float den = dx1 * dy2 - dx2 * dy1;
+        if (fabsf(den) < 1e-6f) {
+            return -1;
+        }
+        g = (sx * dy2 - dx2 * sy) / den;
+        k = (dx1 * sy - sx * dy1) / den;
+    }
+    h[0] = x[1] - x[0] + g * x[1];
+    h[1] = x[3] - x[0] + k * x[3];
+    h[2] = x[0];
+    h[3] = y[1] - y[0] + g * y[1];
+    h[4] = y[3] - y[0] + k * y[3];
+    h[5] = y[0];
+    h[6] = g;
+    h[7] = k;
+    return 0;
+}
+
+static float get_quad_edge(const image_quad_t* quad, int a, int b)
+{
+    float dx = quad->x[a] - quad->x[b];
+    float dy = quad->y[a] - quad->y[b];
+    return sqrtf(dx * dx + dy * dy);
+}
+
+static int is_axis_aligned_quad(const image_quad_t* quad)
+{
+    return quad->y[0] == quad->y[1] && quad->y[2] == quad->y[3] &&
+        quad->x[0] == quad->x[3] && quad->x[1] == quad->x[2] &&
+        quad->x[1] > quad->x[0] && quad->y[3] > quad->y[0];
+}
+
+// 在通道交错的平面上双线性采样，越界按边缘复制
+static inline void sample_bilinear(const unsigned char* plane, int stride, int width, int height, int channel,
+                                   int out_channel, float u, float v, unsigned char* out)
+{
+    u = u < 0.f ? 0.f : (u > width - 1 ? width - 1 : u);
+    v = v < 0.f ? 0.f : (v > height - 1 ? height - 1 : v);
+    int x0 = (int)u;
+    int y0 = (int)v;
+    int x1 = x0 + 1 < width ? x0 + 1 : x0;
+    int y1 = y0 + 1 < height ? y0 + 1 : y0;
+    float fx = u - x0;
+    float fy = v - y0;
+    const unsigned char* p00 = plane + (size_t)y0 * stride + x0 * channel;
+    const unsigned char* p01 = plane + (size_t)y0 * stride + x1 * channel;
+    const unsigned char* p10 = plane + (size_t)y1 * stride + x0 * channel;
+    const unsigned char* p11 = plane + (size_t)y1 * stride + x1 * channel;
+    for (int c = 0; c < out_channel; c++) {
+        float top = p00[c] + (p01[c] - p00[c]) * fx;
+        float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+        out[c] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+    }
+}
+
+// 透视采样box内的行[dy_begin, dy_end)，scratch至少box_w * 3字节(yuv420sp源使用)
+static void quad_sample_rows(const batch_roi_t* roi, const image_buffer_t* src, int dst_channel,
+                             unsigned char* dst, int dst_stride, int dy_begin, int dy_end, unsigned char* scratch)
+{
+    const float* h = roi->h;
+    int src_channel = get_format_channel(src->format);
+    int src_stride = get_row_bytes(src);
+    int yuv = is_yuv420sp(src->format);
+    const unsigned char* src_uv = yuv ? get_uv_plane(src) : NULL;
+    int uv_stride = get_width_stride(src);
+    for (int dy = dy_begin; dy < dy_end; dy++) {
+        unsigned char* row = dst + (size_t)(dy - dy_begin) * dst_stride;
+        float t = (dy + 0.5f) / roi->box_h;
+        for (int dx = 0; dx < roi->box_w; dx++) {
+            float s = (dx + 0.5f) / roi->box_w;
+            float w = 1.f / (h[6] * s + h[7] * t + 1.f);
+            float u = (h[0] * s + h[1] * t + h[2]) * w - 0.5f;
+            float v = (h[3] * s + h[4] * t + h[5]) * w - 0.5f;
+            if (!yuv) {
+                sample_bilinear(src->virt_addr, src_stride, src->width, src->height, src_channel, dst_channel,
+                    u, v, row + dx * dst_channel);
+            } else {
+                sample_bilinear(src->virt_addr, src_stride, src->width, src->height, 1, 1,
+                    u, v, scratch + dx);
+                sample_bilinear(src_uv, uv_stride, src->width / 2, src->height / 2, 2, 2,
+                    (u + 0.5f) * 0.5f - 0.5f, (v + 0.5f) * 0.5f - 0.5f, scratch + roi->box_w + dx * 2);
+            }
+        }
+        if (yuv) {
+            yuv420sp_to_rgb_row(scratch, scratch + roi->box_w, src->format == IMAGE_FORMAT_YUV420SP_NV21,
+                row, roi->box_w);
+        }
+    }
+}
+
+static int batch_roi_run(const batch_roi_t* roi, const image_buffer_t* src, int dst_channel,
+                         unsigned char* dst, int dst_stride, int dy_begin, int dy_end, unsigned char* scratch)
+{
+    if (roi->use_quad) {
+        quad_sample_rows(roi, src, dst_channel, dst, dst_stride, dy_begin, dy_end, scratch);
+        return 0;
+    }
+    return box_resizer_run(&roi->resizer, dst, dst_stride, NULL, 0, dy_begin, dy_end);
+}
+
+static void batch_task_run(void* arg, int index)
+{
+    batch_job_t* job = (batch_job_t*)arg;
+    const batch_task_t* task = &job->tasks[index];
+    const batch_roi_t* roi = &job->rois[task->roi];
+    const image_tensor_t* slot = &roi->slot;
+    int C = slot->channel;
+    int box_begin = task->begin > roi->box_y ? task->begin : roi->box_y;
+    int box_end = task->end < roi->box_y + roi->box_h ? task->end : roi->box_y + roi->box_h;
+    if (roi->empty) {
+        box_begin = box_end = task->end;
+    }
+
+    // 区域外的行和区域左右两侧填充
+    for (int y = task->begin; y < task->end; y++) {
+        if (y < box_begin || y >= box_end) {
+            tensor_write_row(slot, job->lut, y, 0, slot->width, NULL, job->color);
+        } else {
+            tensor_write_row(slot, job->lut, y, 0, roi->box_x, NULL, job->color);
+            tensor_write_row(slot, job->lut, y, roi->box_x + roi->box_w, slot->width - roi->box_x - roi->box_w,
+                NULL, job->color);
+        }
+    }
+    if (box_begin >= box_end) {
+        return;
+    }
+
+    int box_stride = roi->box_w * C;
+    unsigned char* scratch = (unsigned char*)malloc(roi->box_w * 3 + (job->direct ? 0 : box_stride * TENSOR_CHUNK_ROWS));
+    if (scratch == NULL) {
+        job->ret = -1;
+        return;
+    }
+    int dy_begin = box_begin - roi->box_y;
+    int dy_end = box_end - roi->box_y;
+    int ret = 0;
+    if (job->direct) {
+        int w_stride = slot->w_stride > 0 ? slot->w_stride : slot->width;
+        int row_stride = w_stride * C;
+        unsigned char* dst = (unsigned char*)slot->virt_addr + (size_t)box_begin * row_stride + roi->box_x * C;
+        ret = batch_roi_run(roi, job->src, C, dst, row_stride, dy_begin, dy_end, scratch);
+    } else {
+        unsigned char* rows = scratch + roi->box_w * 3;
+        for (int dy = dy_begin; dy < dy_end && ret == 0; dy += TENSOR_CHUNK_ROWS) {
+            int chunk_end = dy + TENSOR_CHUNK_ROWS < dy_end ? dy + TENSOR_CHUNK_ROWS : dy_end;
+            ret = batch_roi_run(roi, job->src, C, rows, box_stride, dy, chunk_end, scratch);
+            for (int i = dy; i < chunk_end && ret == 0; i++) {
+                tensor_write_row(slot, job->lut, roi->box_y + i, roi->box_x, roi->box_w,
+                    rows + (size_t)(i - dy) * box_stride, 0);
+            }
+        }
+    }
+    free(scratch);
+    if (ret != 0) {
+        job->ret = ret;
+    }
+}
+
+static void get_batch_box(int crop_w, int crop_h, int slot_w, int slot_h, image_batch_fit_t fit, batch_roi_t* roi,
+                          letterbox_t* letterbox)
+{
+    float scale = (float)slot_w / crop_w;
+    roi->box_x = 0;
+    roi->box_y = 0;
+    roi->box_w = slot_w;
+    roi->box_h = slot_h;
+    if (fit == IMAGE_BATCH_FIT_LETTERBOX) {
+        float scale_h = (float)slot_h / crop_h;
+        scale = scale < scale_h ? scale : scale_h;
+        roi->box_w = (int)(crop_w * scale + 0.5f);
+        roi->box_h = (int)(crop_h * scale + 0.5f);
+        roi->box_x = (slot_w - roi->box_w) / 2;
+        roi->box_y = (slot_h - roi->box_h) / 2;
+    } else if (fit == IMAGE_BATCH_FIT_LEFT) {
+        // 与PPOCR识别预处理一致：按高度缩放，宽度向上取整且不超过槽位
+        scale = (float)slot_h / crop_h;
+        int box_w = (int)ceilf(crop_w * scale);
+        roi->box_w = box_w < slot_w ? box_w : slot_w;
+    }
+    roi->box_w = roi->box_w > 0 ? roi->box_w : 1;
+    roi->box_h = roi->box_h > 0 ? roi->box_h : 1;
+    if (letterbox != NULL) {
+        letterbox->x_pad = roi->box_x;
+        letterbox->y_pad = roi->box_y;
+        letterbox->scale = scale;
+    }
+}
+
+// 准备一个裁剪区域：确定源区域、槽位内目标区域以及缩放方式
+static int batch_roi_init(batch_roi_t* roi, image_buffer_t* src, image_format_t pixel_format, const image_rect_t* rect,
+                          const image_quad_t* quad, const image_tensor_t* slot, const image_batch_option_t* option,
+                          letterbox_t* letterbox, float* src_top)
+{
+    image_quad_t q;
+    *src_top = 0.f;
+    if (quad != NULL) {
+        q = *quad;
+    } else {
+        int left = rect->left > 0 ? rect->left : 0;
+        int top = rect->top > 0 ? rect->top : 0;
+        int right = rect->right < src->width - 1 ? rect->right : src->width - 1;
+        int bottom = rect->bottom < src->height - 1 ? rect->bottom : src->height - 1;
+        if (right < left || bottom < top) {
+            roi->empty = 1;
+            if (letterbox != NULL) {
+                memset(letterbox, 0, sizeof(letterbox_t));
+            }
+            return 0;
+        }
+        q.x[0] = q.x[3] = left;
+        q.x[1] = q.x[2] = right + 1;
+        q.y[0] = q.y[1] = top;
+        q.y[2] = q.y[3] = bottom + 1;
+    }
+    int crop_w = (int)get_quad_edge(&q, 0, 1);
+    int crop_h = (int)get_quad_edge(&q, 0, 3);
+    crop_w = crop_w > 0 ? crop_w : 1;
+    crop_h = crop_h > 0 ? crop_h : 1;
+    if (option->rotate_tall && crop_h >= crop_w * BATCH_TALL_RATIO) {
+        // 逆时针旋转90度：原右上角成为左上角
+        image_quad_t r;
+        for (int i = 0; i < 4; i++) {
+            r.x[i] = q.x[(i + 1) % 4];
+            r.y[i] = q.y[(i + 1) % 4];
+        }
+        q = r;
+        int t = crop_w;
+        crop_w = crop_h;
+        crop_h = t;
+    }
+    get_batch_box(crop_w, crop_h, slot->width, slot->height, option->fit, roi, letterbox);
+
+    *src_top = q.y[0];
+    for (int i = 1; i < 4; i++) {
+        *src_top = q.y[i] < *src_top ? q.y[i] : *src_top;
+    }
+    if (is_axis_aligned_quad(&q)) {
+        // 轴对齐矩形走可分离的定点缩放
+        return box_resizer_init(&roi->resizer, src, pixel_format, (int)q.x[0], (int)q.y[0],
+            (int)(q.x[1] - q.x[0]), (int)(q.y[3] - q.y[0]), roi->box_w, roi->box_h);
+    }
+    roi->use_quad = 1;
+    if (get_quad_transform(&q, roi->h) != 0) {
+        printf("convert_image_batch: degenerate quad\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_batch_order(const void* a, const void* b)
+{
+    const batch_order_t* oa = (const batch_order_t*)a;
+    const batch_order_t* ob = (const batch_order_t*)b;
+    if (oa->src_top != ob->src_top) {
+        return oa->src_top < ob->src_top ? -1 : 1;
+    }
+    return oa->roi - ob->roi;
+}
+
+int convert_image_batch(image_buffer_t* src_image, const image_rect_t* src_rects, const image_quad_t* src_quads, int num,
+                        image_tensor_t* tensor, const image_batch_option_t* option, letterbox_t* letterboxes)
+{
+    if (src_image == NULL || src_image->virt_addr == NULL || tensor == NULL || num < 0 ||
+        (src_rects == NULL && src_quads == NULL)) {
+        return -1;
+    }
+    if (num == 0) {
+        return 0;
+    }
+    image_format_t pixel_format;
+    if (get_tensor_pixel_format(src_image, tensor, &pixel_format) != 0) {
+        return -1;
+    }
+    if (!is_resize_supported(src_image->format, pixel_format)) {
+        printf("convert_image_batch: no support convert format %d to %d\n", src_image->format, pixel_format);
+        return -1;
+    }
+    image_batch_option_t default_option;
+    if (option == NULL) {
+        memset(&default_option, 0, sizeof(image_batch_option_t));
+        option = &default_option;
+    }
+
+    tensor_lut_t* lut = (tensor_lut_t*)malloc(sizeof(tensor_lut_t));
+    if (lut == NULL) {
+        return -1;
+    }
+    int identity = build_tensor_lut(tensor, lut);
+    int w_stride = tensor->w_stride > 0 ? tensor->w_stride : tensor->width;
+    size_t slot_size = (size_t)w_stride * tensor->height * tensor->channel * lut->elem_size;
+    if (check_tensor_size(tensor, num, "convert_image_batch") != 0) {
+        free(lut);
+        return -1;
+    }
+
+    int ret = 0;
+    batch_roi_t* rois = (batch_roi_t*)calloc(num, sizeof(batch_roi_t));
+    batch_order_t* order = (batch_order_t*)malloc(num * sizeof(batch_order_t));
+    batch_task_t* tasks = NULL;
+    if (rois == NULL || order == NULL) {
+        ret = -1;
+        goto out;
+    }
+    for (int i = 0; i < num; i++) {
+        rois[i].slot = *tensor;
+        rois[i].slot.virt_addr = (unsigned char*)tensor->virt_addr + slot_size * i;
+        ret = batch_roi_init(&rois[i], src_image, pixel_format, src_rects != NULL ? &src_rects[i] : NULL,
+            src_quads != NULL ? &src_quads[i] : NULL, &rois[i].slot, option,
+            letterboxes != NULL ? &letterboxes[i] : NULL, &order[i].src_top);
+        if (ret != 0) {
+            printf("convert_image_batch: init crop %d fail\n", i);
+            goto out;
+        }
+        order[i].roi = i;
+    }
+
+    // 按源图像中的纵向位置排序，同时处理的区域读取相邻的源行
+    qsort(order, num, sizeof(batch_order_t), compare_batch_order);
+
+    // 区域数不少于线程数时每个区域一个任务，否则区域再按行带切分
+    int num_threads = thread_pool_get_num_threads(g_convert_pool);
+    int band_rows = num >= num_threads ? tensor->height : get_band_rows(tensor->height, num_threads);
+    int bands_per_roi = (tensor->height + band_rows - 1) / band_rows;
+    tasks = (batch_task_t*)malloc((size_t)num * bands_per_roi * sizeof(batch_task_t));
+    if (tasks == NULL) {
+        ret = -1;
+        goto out;
+    }
+    int num_tasks = 0;
+    for (int i = 0; i < num; i++) {
+        for (int begin = 0; begin < tensor->height; begin += band_rows) {
+            tasks[num_tasks].roi = order[i].roi;
+            tasks[num_tasks].begin = begin;
+            tasks[num_tasks].end = begin + band_rows < tensor->height ? begin + band_rows : tensor->height;
+            num_tasks++;
+        }
+    }
+
+    batch_job_t job;
+    job.src = src_image;
+    job.rois = rois;
+    job.tasks = tasks;
+    job.lut = lut;
+    job.direct = identity && tensor->layout == IMAGE_TENSOR_LAYOUT_NHWC;
+    job.color = (unsigned char)option->color;
+    job.ret = 0;
+    thread_pool_parallel_for(g_convert_pool, num_tasks, batch_task_run, &job);
+    ret = job.ret;
+
+out:
+    if (rois != NULL) {
+        for (int i = 0; i < num; i++) {
+            box_resizer_release(&rois[i].resizer);
+        }
+    }
+    free(rois);
+    free(order);
+    free(tasks);
+    free(lut);
+    if (ret != 0) {
+        printf("convert_image_batch fail %d\n", ret);
+        return -1;
+    }
+    return 0;
+}
@@ -1,6 +1,10 @@
 #ifndef _RKNN_MODEL_ZOO_IMAGE_UTILS_H_
 #define _RKNN_MODEL_ZOO_IMAGE_UTILS_H_
 
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -18,7 +22,66 @@ typedef struct {
 } letterbox_t;
 
 /**
- * @brief Read image file (support png/jpeg/bmp)
+ * @brief Options of read_image_with_option
+ * 
+ */
+typedef struct {
+    int target_width;       // JPEG is decoded with the smallest 1/2, 1/4, 1/8 scaling not below target, 0: full size
+    int target_height;
+    int keep_ratio;         // 1: target is a letterbox input, only the scaled box must be covered; 0: stretch
+    image_rect_t* roi;      // region of original image to decode (JPEG only), NULL: whole image
+    int to_nv12;            // 1: decode JPEG to IMAGE_FORMAT_YUV420SP_NV12 (even size, 1.5 bytes per pixel)
+} image_read_option_t;
+
+/**
+ * @brief Tensor element type
+ * 
+ */
+typedef enum {
+    IMAGE_TENSOR_TYPE_UINT8,
+    IMAGE_TENSOR_TYPE_INT8,
+    IMAGE_TENSOR_TYPE_FLOAT16,
+    IMAGE_TENSOR_TYPE_FLOAT32,
+} image_tensor_type_t;
+
+/**
+ * @brief Tensor layout
+ * 
+ */
+typedef enum {
+    IMAGE_TENSOR_LAYOUT_NHWC,
+    IMAGE_TENSOR_LAYOUT_NCHW,
+} image_tensor_layout_t;
+
+/**
+ * @brief Model input tensor memory
+ * 
+ * Element value = quantize((pixel - mean[c]) / std[c]), quantize is
+ * round(v / scale) + zp for int8/uint8 when scale > 0.
+ * UINT8 with mean 0, std 1 and scale <= 0 means raw pixel.
+ */
+typedef struct {
+    int width;
+    int height;
+    int channel;                    // 3: RGB888; 1: GRAY8
+    int w_stride;                   // elements along width dimension (0: equal to width)
+    image_tensor_layout_t layout;
+    image_tensor_type_t type;
+    int zp;
+    float scale;
+    float mean[3];
+    float std[3];
+    void* virt_addr;
+    int fd;
+    int size;                       // bytes of tensor memory (with stride)
+} image_tensor_t;
+
+/**
+ * @brief Read image file (support png/jpeg/bmp/data)
+ * 
+ * A .data raw container sets the image geometry from its header and reads the first frame.
+ * A headerless .data file is read as is, width/height/format must be set by the caller.
+ * If image->virt_addr is set the data is read into it, image->size (if > 0) is its capacity.
  * 
  * @param path [in] Image path
  * @param image [out] Read image
@@ -27,7 +90,249 @@ typedef struct {
 int read_image(const char* path, image_buffer_t* image);
 
 /**
- * @brief Write image file (support jpg/png)
+ * @brief Read image, JPEG is decoded at reduced size, only inside roi and/or to NV12
+ * 
+ * Other formats are read at full size in their own pixel format.
+ * 
+ * @param path [in] Image path
+ * @param image [out] Read Image
+ * @param option [in] Decode options, NULL: same as read_image
+ * @param letterbox [out] Map from read image to original image: x_orig = (x - x_pad) / scale, may be NULL
+ * @return int 0: success; -1: error
+ */
+int read_image_with_option(const char* path, image_buffer_t* image, const image_read_option_t* option,
+                           letterbox_t* letterbox);
+
+/**
+ * @brief JPEG decoder reused across images, owns the decode handle, input buffer and a pool of output buffers
+ * 
+ */
+typedef struct image_decoder image_decoder_t;
+
+/**
+ * @brief Create image decoder
+ * 
+ * @param num_buffers [in] Number of output buffers, i.e. decoded images that can be held at the same time
+ * @return image_decoder_t* NULL: error, remember call image_decoder_destroy() after used
+ */
+image_decoder_t* image_decoder_create(int num_buffers);
+
+/**
+ * @brief Destroy image decoder and free all its buffers
+ * 
+ * @param decoder [in] Image decoder
+ */
+void image_decoder_destroy(image_decoder_t* decoder);
+
+/**
+ * @brief Decode image file, JPEG output comes from the buffer pool, other formats are read as read_image_with_option
+ * 
+ * @param decoder [in] Image decoder
+ * @param path [in] Image path
+ * @param image [out] Decoded image, call image_decoder_release_image() when it is not used any more
+ * @param option [in] Decode options, may be NULL
+ * @param letterbox [out] Map from decoded image to original image, may be NULL
+ * @return int 0: success; -1: error
+ */
+int image_decoder_read(image_decoder_t* decoder, const char* path, image_buffer_t* image,
+                       const image_read_option_t* option, letterbox_t* letterbox);
+
+/**
+ * @brief Decode JPEG data in memory
+ * 
+ * @param decoder [in] Image decoder
+ * @param data [in] JPEG data
+ * @param size [in] Bytes of JPEG data
+ * @param image [out] Decoded image, call image_decoder_release_image() when it is not used any more
+ * @param option [in] Decode options, may be NULL
+ * @param letterbox [out] Map from decoded image to original image, may be NULL
+ * @return int 0: success; -1: error
+ */
+int image_decoder_decode(image_decoder_t* decoder, const unsigned char* data, size_t size, image_buffer_t* image,
+                         const image_read_option_t* option, letterbox_t* letterbox);
+
+/**
+ * @brief Give image buffer back to decoder pool (memory not from the pool is freed)
+ * 
+ * @param decoder [in] Image decoder
+ * @param image [in] Image returned by image_decoder_read()/image_decoder_decode()
+ * @return int 0: success; -1: error
+ */
+int image_decoder_release_image(image_decoder_t* decoder, image_buffer_t* image);
+
+/**
+ * @brief Image sequence from a directory, a list file or a single image, decoded ahead on a background thread
+ * 
+ */
+typedef struct image_source image_source_t;
+
+/**
+ * @brief One image of image source
+ * 
+ */
+typedef struct {
+    int index;                  // position in source
+    const char* path;           // image path, valid until image_source_close()
+    image_buffer_t image;       // decoded image, owned by source
+    letterbox_t letterbox;      // map from decoded image to original image (see read_image_with_option)
+} image_frame_t;
+
+/**
+ * @brief Open image source
+ * 
+ * @param path [in] Directory (images sorted by name), list file (.txt, one image path per line) or image path
+ * @param num_prefetch [in] Number of images decoded ahead while the caller holds one
+ * @param option [in] Decode options, NULL: full size RGB
+ * @return image_source_t* NULL: error, remember call image_source_close() after used
+ */
+image_source_t* image_source_open(const char* path, int num_prefetch, const image_read_option_t* option);
+
+/**
+ * @brief Get number of images in source
+ * 
+ * @param source [in] Image source
+ * @return int image number
+ */
+int image_source_get_count(image_source_t* source);
+
+/**
+ * @brief Get next image in order, wait if it is still decoding
+ * 
+ * @param source [in] Image source
+ * @param frame [out] Image, call image_source_release() after used
+ * @return int 0: success; 1: end of source; -1: this image fail to decode (frame->path is set, call again for next)
+ */
+int image_source_next(image_source_t* source, image_frame_t* frame);
+
+/**
+ * @brief Give image back to source so its buffer can be reused for prefetching
+ * 
+ * @param source [in] Image source
+ * @param frame [in] Image returned by image_source_next()
+ */
+void image_source_release(image_source_t* source, image_frame_t* frame);
+
+/**
+ * @brief Stop prefetching and free image source
+ * 
+ * @param source [in] Image source
+ */
+void image_source_close(image_source_t* source);
+
+/*
+ * Raw frame container (.data)
+ *
+ * A raw_image_header_t at offset 0, then frame_count frames of the same geometry.
+ * Frame i starts at data_offset + i * frame_pitch, both multiples of RAW_IMAGE_ALIGN,
+ * so every frame can be mapped and used in place. A frame is laid out as an
+ * image_buffer_t with the stored strides (UV plane after height_stride luma rows).
+ * Fields are in host byte order. Files without the magic are headerless raw pixels.
+ */
+
+#define RAW_IMAGE_MAGIC "RKRAWIMG"
+#define RAW_IMAGE_VERSION 1
+#define RAW_IMAGE_ALIGN 4096
+
+/**
+ * @brief Header of raw frame container, 64 bytes
+ * 
+ */
+typedef struct {
+    char magic[8];              // RAW_IMAGE_MAGIC without terminating zero
+    uint32_t version;           // RAW_IMAGE_VERSION
+    uint32_t header_size;       // sizeof(raw_image_header_t)
+    uint32_t data_offset;       // offset of first frame
+    uint32_t frame_count;       // 0: unknown (recording not closed), count frames by file size
+    uint64_t frame_size;        // bytes of one frame (get_image_size)
+    uint64_t frame_pitch;       // bytes from one frame to the next
+    int32_t width;
+    int32_t height;
+    int32_t width_stride;
+    int32_t height_stride;
+    int32_t format;             // image_format_t
+    uint32_t reserved;
+} raw_image_header_t;
+
+#define RAW_IMAGE_MAP_POPULATE      0x1     // prefault all frames while mapping (MAP_POPULATE)
+#define RAW_IMAGE_MAP_SEQUENTIAL    0x2     // madvise(MADV_SEQUENTIAL), frames are read in order
+
+/**
+ * @brief Memory mapped raw frame container
+ * 
+ */
+typedef struct raw_image_reader raw_image_reader_t;
+
+/**
+ * @brief Map raw frame container
+ * 
+ * @param path [in] Container path
+ * @param flags [in] RAW_IMAGE_MAP_* hints, 0: none
+ * @return raw_image_reader_t* NULL: error or not a container, remember call raw_image_reader_close() after used
+ */
+raw_image_reader_t* raw_image_reader_open(const char* path, int flags);
+
+/**
+ * @brief Get number of frames in container
+ * 
+ * @param reader [in] Container reader
+ * @return int frame number
+ */
+int raw_image_reader_get_count(raw_image_reader_t* reader);
+
+/**
+ * @brief Get frame without copy, image memory points into the mapping
+ * 
+ * The mapping is private copy-on-write: drawing on a frame does not change the file.
+ * 
+ * @param reader [in] Container reader
+ * @param index [in] Frame index
+ * @param image [out] Frame, valid until raw_image_reader_close(), do not free virt_addr
+ * @return int 0: success; -1: error
+ */
+int raw_image_reader_get_frame(raw_image_reader_t* reader, int index, image_buffer_t* image);
+
+/**
+ * @brief Unmap container
+ * 
+ * @param reader [in] Container reader
+ */
+void raw_image_reader_close(raw_image_reader_t* reader);
+
+/**
+ * @brief Raw frame container writer
+ * 
+ */
+typedef struct raw_image_writer raw_image_writer_t;
+
+/**
+ * @brief Create raw frame container, geometry is taken from the first appended frame
+ * 
+ * @param path [in] Container path
+ * @return raw_image_writer_t* NULL: error, remember call raw_image_writer_close() after used
+ */
+raw_image_writer_t* raw_image_writer_open(const char* path);
+
+/**
+ * @brief Append frame, all frames must have the same size, strides and format of the first one
+ * 
+ * @param writer [in] Container writer
+ * @param image [in] Frame
+ * @return int 0: success; -1: error
+ */
+int raw_image_writer_append(raw_image_writer_t* writer, const image_buffer_t* image);
+
+/**
+ * @brief Write frame count into header and close file
+ * 
+ * @param writer [in] Container writer
+ * @return int 0: success; -1: error
+ */
+int raw_image_writer_close(raw_image_writer_t* writer);
+
+/**
+ * @brief Write image file (support jpg/png/data)
+ * 
+ * .data is written as a single frame raw container (see raw_image_header_t).
  * 
  * @param path [in] Image path
  * @param image [in] Image for write (only support IMAGE_FORMAT_RGB888)
@@ -35,9 +340,113 @@ int read_image(const char* path, image_buffer_t* image);
  */
 int write_image(const char* path, const image_buffer_t* image);
 
+/**
+ * @brief Chroma subsampling of written JPEG
+ * 
+ */
+typedef enum {
+    IMAGE_WRITE_SUBSAMP_DEFAULT,    // 4:2:2
+    IMAGE_WRITE_SUBSAMP_444,
+    IMAGE_WRITE_SUBSAMP_422,
+    IMAGE_WRITE_SUBSAMP_420,
+} image_write_subsamp_t;
+
+#define IMAGE_WRITE_PNG_STORE -1             // png_level: no compression (zlib stored blocks)
+
+/**
+ * @brief Options of write_image_with_option, zero value select defaults
+ * 
+ */
+typedef struct {
+    int jpeg_quality;                       // 1~100, 0: 95
+    image_write_subsamp_t jpeg_subsamp;
+    int png_level;                          // deflate level 1~9 (levels below 5 compress as 5), 0: 8, IMAGE_WRITE_PNG_STORE
+} image_write_option_t;
+
+/**
+ * @brief Write image file with encode options (jpg: RGB888/RGBA8888/GRAY8, png: RGB888/RGBA8888/GRAY8)
+ * 
+ * @param path [in] Image path
+ * @param image [in] Image for write
+ * @param option [in] Encode options, NULL: defaults
+ * @return int 0: success; -1: error
+ */
+int write_image_with_option(const char* path, const image_buffer_t* image, const image_write_option_t* option);
+
+/**
+ * @brief Asynchronous image writer, encodes on a worker thread from a bounded queue
+ * 
+ */
+typedef struct image_writer image_writer_t;
+
+/**
+ * @brief What image_writer_submit() does when the queue is full
+ * 
+ */
+typedef enum {
+    IMAGE_WRITER_DROP_NEWEST,       // discard the submitted image
+    IMAGE_WRITER_DROP_OLDEST,       // discard the oldest queued image
+    IMAGE_WRITER_BLOCK,             // wait for a free entry
+} image_writer_drop_t;
+
+/**
+ * @brief Called when the writer is done with a submitted image (written or dropped)
+ * 
+ */
+typedef void (*image_writer_release_t)(image_buffer_t* image, void* user_data);
+
+/**
+ * @brief Create asynchronous image writer
+ * 
+ * @param queue_size [in] Max number of queued images
+ * @param drop_policy [in] Behavior when queue is full
+ * @param option [in] Encode options, NULL: defaults
+ * @return image_writer_t* NULL: error, remember call image_writer_destroy() after used
+ */
+image_writer_t* image_writer_create(int queue_size, image_writer_drop_t drop_policy, const image_write_option_t* option);
+
+/**
+ * @brief Queue image for writing
+ * 
+ * @param writer [in] Image writer
+ * @param path [in] Image path (format select by extension as write_image)
+ * @param image [in] Image for write
+ * @param release [in] NULL: image is copied into a recycled queue buffer; otherwise writer keeps using image memory
+ *                     and calls release(image, user_data) when it is written or dropped
+ * @param user_data [in] Argument of release
+ * @return int 0: queued; 1: dropped; -1: error
+ */
+int image_writer_submit(image_writer_t* writer, const char* path, const image_buffer_t* image,
+                        image_writer_release_t release, void* user_data);
+
+/**
+ * @brief Wait until all queued images are written
+ * 
+ * @param writer [in] Image writer
+ */
+void image_writer_flush(image_writer_t* writer);
+
+/**
+ * @brief Get number of images dropped because the queue was full
+ * 
+ * @param writer [in] Image writer
+ * @return int dropped image number
+ */
+int image_writer_get_dropped(image_writer_t* writer);
+
+/**
+ * @brief Write remaining queued images, stop worker and free writer
+ * 
+ * @param writer [in] Image writer
+ */
+void image_writer_destroy(image_writer_t* writer);
+
 /**
  * @brief Convert image for resize and pixel format change
  * 
+ * Use RGA first, fall back to CPU if RGA fail. The CPU path support same format resize and
+ * IMAGE_FORMAT_RGBA8888/IMAGE_FORMAT_YUV420SP_NV12/IMAGE_FORMAT_YUV420SP_NV21 to IMAGE_FORMAT_RGB888
+ * 
  * @param src_image [in] Source Image
  * @param dst_image [out] Target Image
  * @param src_box [in] Crop rectangle on source image
@@ -47,17 +456,135 @@ int write_image(const char* path, const image_buffer_t* image);
  */
 int convert_image(image_buffer_t* src_image, image_buffer_t* dst_image, image_rect_t* src_box, image_rect_t* dst_box, char color);
 
+/**
+ * @brief Set threads used by the CPU path of convert_image/convert_image_to_tensor/convert_image_batch
+ * 
+ * Target rows are split into bands executed by a persistent worker pool, the calling thread works too.
+ * 
+ * @param num_threads [in] Total thread number (<= 1: single thread)
+ * @param core_ids [in] CPU core ids, core_ids[0] for the calling thread and the rest for workers
+ *                  (see thread_pool_create()), NULL: no binding
+ * @param num_core_ids [in] Size of core_ids
+ * @return int 0: success; -1: error
+ */
+int set_convert_image_threads(int num_threads, const int* core_ids, int num_core_ids);
+
 /**
  * @brief Convert image with letterbox
  * 
  * @param src_image [in] Source Image
- * @param dst_image [out] Target Image
+ * @param dst_image [out] Target Image (format of dst_image select the output pixel format)
  * @param letterbox [out] Letterbox
  * @param color [in] Fill color on target image
  * @return int 
  */
 int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_image, letterbox_t* letterbox, char color);
 
+/**
+ * @brief Cached resize of one source/target geometry, reused for every frame of a stream
+ * 
+ */
+typedef struct resize_plan resize_plan_t;
+
+/**
+ * @brief Create resize plan, letterbox box, pad regions and CPU index/weight tables are computed once
+ * 
+ * @param src_width [in] Source image width
+ * @param src_height [in] Source image height
+ * @param src_format [in] Source image format
+ * @param dst_width [in] Target image width
+ * @param dst_height [in] Target image height
+ * @param dst_format [in] Target image format
+ * @param use_letterbox [in] 1: keep aspect ratio and pad; 0: stretch
+ * @return resize_plan_t* NULL: error, remember call resize_plan_destroy() after used
+ */
+resize_plan_t* resize_plan_create(int src_width, int src_height, image_format_t src_format,
+                                  int dst_width, int dst_height, image_format_t dst_format, int use_letterbox);
+
+/**
+ * @brief Destroy resize plan
+ * 
+ * @param plan [in] Resize plan
+ */
+void resize_plan_destroy(resize_plan_t* plan);
+
+/**
+ * @brief Resize one frame with plan, a plan should not be executed from several threads at once
+ * 
+ * @param plan [in] Resize plan
+ * @param src_image [in] Source Image, size and format must match plan
+ * @param dst_image [out] Target Image, size and format must match plan (memory is allocated if not set)
+ * @param letterbox [out] Letterbox, may be NULL
+ * @param color [in] Fill color on target image
+ * @return int 0: success; -1: error
+ */
+int resize_plan_execute(resize_plan_t* plan, image_buffer_t* src_image, image_buffer_t* dst_image,
+                        letterbox_t* letterbox, char color);
+
+/**
+ * @brief Resize, pad and normalize/quantize image straight into model input tensor memory
+ * 
+ * @param src_image [in] Source Image (RGB888/RGBA8888/YUV420SP for 3 channel tensor, GRAY8 for 1 channel)
+ * @param tensor [in] Target tensor description and memory, size must cover w_stride x height x channel elements
+ * @param letterbox [out] Letterbox, NULL: stretch whole image to tensor size
+ * @param color [in] Fill color of letterbox padding
+ * @return int 0: success; -1: error
+ */
+int convert_image_to_tensor(image_buffer_t* src_image, image_tensor_t* tensor, letterbox_t* letterbox, char color);
+
+/**
+ * @brief Quadrilateral crop on source image
+ * 
+ * Corners in order top-left, top-right, bottom-right, bottom-left of the crop, in pixel edge
+ * coordinates: rectangle (l, t, r, b) is the quad (l, t) (r + 1, t) (r + 1, b + 1) (l, b + 1).
+ */
+typedef struct {
+    float x[4];
+    float y[4];
+} image_quad_t;
+
+/**
+ * @brief How a crop is placed in its batch slot
+ * 
+ */
+typedef enum {
+    IMAGE_BATCH_FIT_STRETCH,        // fill the whole slot
+    IMAGE_BATCH_FIT_LETTERBOX,      // keep aspect ratio, center and pad
+    IMAGE_BATCH_FIT_LEFT,           // keep aspect ratio at full slot height, align left and pad right (text lines)
+} image_batch_fit_t;
+
+/**
+ * @brief Options of convert_image_batch
+ * 
+ */
+typedef struct {
+    image_batch_fit_t fit;
+    char color;                     // raw pixel value of padding, normalized like other pixels
+    int rotate_tall;                // 1: crop with height >= 1.5 * width is rotated 90 degrees counterclockwise
+} image_batch_option_t;
+
+/**
+ * @brief Crop N regions of one image and resize them into N consecutive slots of one tensor
+ * 
+ * Each slot has the layout described by tensor (width, height, w_stride, channel, type, normalization),
+ * slot i starts at byte i * slot size. Rectangle crops use the bilinear resize kernels of convert_image,
+ * quadrilateral crops are rectified with a perspective transform and edge replicate (as cv::warpPerspective).
+ * Regions are processed in source row order and split across the convert_image threads.
+ * A crop size is the rectangle size, or for a quad the length of its top and left edges.
+ * 
+ * @param src_image [in] Source Image (RGB888/RGBA8888/YUV420SP for 3 channel tensor, GRAY8 for 1 channel)
+ * @param src_rects [in] [num] crop rectangles, clipped to image, used when src_quads is NULL
+ * @param src_quads [in] [num] crop quadrilaterals, NULL: use src_rects
+ * @param num [in] Number of crops
+ * @param tensor [in] Slot description, virt_addr holds num slots, size must cover them
+ * @param option [in] Options, NULL: stretch, pad 0, no rotation
+ * @param letterboxes [out] [num] map from slot to rectified crop: x_crop = (x - x_pad) / scale (horizontal scale
+ *                          for IMAGE_BATCH_FIT_STRETCH), may be NULL
+ * @return int 0: success; -1: error
+ */
+int convert_image_batch(image_buffer_t* src_image, const image_rect_t* src_rects, const image_quad_t* src_quads, int num,
+                        image_tensor_t* tensor, const image_batch_option_t* option, letterbox_t* letterboxes);
+
 /**
  * @brief Get the image size
  * 
@@ -66,6 +593,69 @@ int convert_image_with_letterbox(image_buffer_t* src_image, image_buffer_t* dst_
  */
 int get_image_size(image_buffer_t* image);
 
+#if defined(_RKNN_API_H)
+/**
+ * @brief Describe rknn input tensor memory (rknpu2 rknn_api.h must be included before this file)
+ * 
+ * Set attr->type to RKNN_TENSOR_UINT8 before rknn_set_io_mem as the demos do, the npu then
+ * normalizes and quantizes raw pixels. INT8 is only supported with pass_through, where the
+ * pixels are quantized here with the zp/scale of attr; otherwise raw pixels above 127 would
+ * saturate, so it is rejected.
+ * 
+ * @param attr [in] Input tensor attr used for rknn_set_io_mem
+ * @param mem [in] Input tensor memory
+ * @param tensor [out] Tensor description, mean/std default to 0/1, all zero on error
+ * @return int 0: success; -1: error
+ */
+static inline int image_tensor_from_rknn(const rknn_tensor_attr* attr, const rknn_tensor_mem* mem, image_tensor_t* tensor)
+{
+    memset(tensor, 0, sizeof(image_tensor_t));
+    if (attr->type == RKNN_TENSOR_INT8 &&
+        !(attr->pass_through && attr->qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC)) {
+        printf("image_tensor_from_rknn: int8 input needs pass_through with affine quantization, use uint8\n");
+        return -1;
+    }
+    if (attr->fmt == RKNN_TENSOR_NCHW) {
+        tensor->layout = IMAGE_TENSOR_LAYOUT_NCHW;
+        tensor->channel = attr->dims[1];
+        tensor->height = attr->dims[2];
+        tensor->width = attr->dims[3];
+    } else {
+        tensor->layout = IMAGE_TENSOR_LAYOUT_NHWC;
+        tensor->height = attr->dims[1];
+        tensor->width = attr->dims[2];
+        tensor->channel = attr->dims[3];
+    }
+    tensor->w_stride = attr->w_stride;
+    switch (attr->type) {
+    case RKNN_TENSOR_INT8:
+        tensor->type = IMAGE_TENSOR_TYPE_INT8;
+        break;
+    case RKNN_TENSOR_FLOAT16:
+        tensor->type = IMAGE_TENSOR_TYPE_FLOAT16;
+        break;
+    case RKNN_TENSOR_FLOAT32:
+        tensor->type = IMAGE_TENSOR_TYPE_FLOAT32;
+        break;
+    default:
+        tensor->type = IMAGE_TENSOR_TYPE_UINT8;
+        break;
+    }
+    // quantize in outside only when the data pass through to npu
+    if (attr->pass_through && attr->qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC) {
+        tensor->zp = attr->zp;
+        tensor->scale = attr->scale;
+    }
+    for (int c = 0; c < 3; c++) {
+        tensor->std[c] = 1.0f;
+    }
+    tensor->virt_addr = mem->virt_addr;
+    tensor->fd = mem->fd;
+    tensor->size = mem->size;
+    return 0;
+}
+#endif
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -0,0 +1,241 @@
+/*
+ * Unit test of buffer_pool.c.
+ *
+ * - every block, and every heap buffer of a NULL pool, is BUFFER_POOL_ALIGN aligned
+ * - a freed or reset block serves the next request of the same size class,
+ *   a request of another size class gets another block
+ * - frames with the same set of sizes stop allocating from the heap after the
+ *   first frame (frame_heap_allocs == 0), in any allocation order
+ * - a double free is reported and leaves counters and free lists intact
+ *
+ * usage: buffer_pool_test [frames]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer_pool.h"
+
+#define DEFAULT_FRAMES 100
+
+#define CHECK(cond, ...)          \
+    do {                          \
+        if (!(cond)) {            \
+            printf(__VA_ARGS__);  \
+            printf("\n");         \
+            return -1;            \
+        }                         \
+    } while (0)
+
+static int is_aligned(const void* ptr)
+{
+    return ((uintptr_t)ptr % BUFFER_POOL_ALIGN) == 0;
+}
+
+static int test_alignment(void)
+{
+    static const size_t sizes[] = {0, 1, 3, 63, 64, 65, 100, 127, 129, 1000, 4097, 640 * 640 * 3 + 1, 3 << 20};
+    const int num_sizes = (int)(sizeof(sizes) / sizeof(sizes[0]));
+    void* ptrs[sizeof(sizes) / sizeof(sizes[0])];
+
+    buffer_pool_t* pool = buffer_pool_create();
+    CHECK(pool != NULL, "buffer_pool_create fail");
+    for (int i = 0; i < num_sizes; i++) {
+        ptrs[i] = buffer_pool_alloc(pool, sizes[i]);
+        CHECK(ptrs[i] != NULL, "alloc %zu fail", sizes[i]);
+        CHECK(is_aligned(ptrs[i]), "alloc %zu: %p not aligned", sizes[i], ptrs[i]);
+        // 整块可写，不能踩到相邻块的块头
+        memset(ptrs[i], 0x5A, sizes[i]);
+    }
+    for (int i = 0; i < num_sizes; i++) {
+        buffer_pool_free(pool, ptrs[i]);
+    }
+    buffer_pool_stats_t stats;
+    buffer_pool_get_stats(pool, &stats);
+    CHECK(stats.blocks_in_use == 0 && stats.bytes_in_use == 0, "%d blocks in use after free", stats.blocks_in_use);
+    buffer_pool_destroy(pool);
+
+    // 无池时直接走堆，同样对齐
+    for (int i = 0; i < num_sizes; i++) {
+        void* ptr = buffer_pool_alloc(NULL, sizes[i]);
+        CHECK(ptr != NULL, "heap alloc %zu fail", sizes[i]);
+        CHECK(is_aligned(ptr), "heap alloc %zu: %p not aligned", sizes[i], ptr);
+        buffer_pool_free(NULL, ptr);
+    }
+    return 0;
+}
+
+static int test_size_class_reuse(void)
+{
+    buffer_pool_t* pool = buffer_pool_create();
+    CHECK(pool != NULL, "buffer_pool_create fail");
+    buffer_pool_stats_t stats;
+
+    // 1000和1020同属1024档，1100属于1280档
+    void* a = buffer_pool_alloc(pool, 1000);
+    CHECK(a != NULL, "alloc 1000 fail");
+    buffer_pool_free(pool, a);
+    void* b = buffer_pool_alloc(pool, 1020);
+    CHECK(b == a, "same class after free: %p, expected %p", b, a);
+    void* c = buffer_pool_alloc(pool, 1100);
+    CHECK(c != NULL && c != a, "other class got the block in use");
+    buffer_pool_get_stats(pool, &stats);
+    CHECK(stats.heap_allocs == 2 && stats.pool_hits == 1, "heap_allocs %d pool_hits %d, expected 2 1",
+          stats.heap_allocs, stats.pool_hits);
+    CHECK(stats.bytes_reserved == 1024 + 1280, "bytes_reserved %zu, expected %d", stats.bytes_reserved, 1024 + 1280);
+
+    // 不在同一档的空闲块不会被拿来用
+    buffer_pool_free(pool, b);
+    void* d = buffer_pool_alloc(pool, 1300);
+    CHECK(d != NULL && d != a && d != c, "request of 1300 reused a smaller block");
+
+    // reset归还全部块，同样的请求拿回同样的块
+    buffer_pool_reset(pool);
+    buffer_pool_get_stats(pool, &stats);
+    CHECK(stats.blocks_in_use == 0 && stats.bytes_in_use == 0, "%d blocks in use after reset", stats.blocks_in_use);
+    void* e = buffer_pool_alloc(pool, 1100);
+    void* f = buffer_pool_alloc(pool, 1300);
+    void* g = buffer_pool_alloc(pool, 1);
+    CHECK(e == c && f == d, "blocks not reused after reset");
+    buffer_pool_get_stats(pool, &stats);
+    CHECK(stats.frame_heap_allocs == 1 && stats.blocks == 4, "frame_heap_allocs %d blocks %d, expected 1 4",
+          stats.frame_heap_allocs, stats.blocks);
+    CHECK(is_aligned(g), "64 byte class not aligned");
+
+    // calloc拿到复用块时也要清零
+    buffer_pool_reset(pool);
+    memset(a, 0xFF, 1000);
+    unsigned char* z = (unsigned char*)buffer_pool_calloc(pool, 1000);
+    CHECK(z == a, "calloc did not reuse the block");
+    for (int i = 0; i < 1000; i++) {
+        CHECK(z[i] == 0, "calloc byte %d not zero", i);
+    }
+    buffer_pool_destroy(pool);
+    return 0;
+}
+
+// 模拟每帧的申请：固定的一组大小，顺序每帧打乱，部分块帧内提前释放
+static int test_warm_up(int frames)
+{
+    static const size_t sizes[] = {48 * 320 * 3, 48 * 320 * 3 * 4, 640 * 640 * 3, 80 * 80 * 4, 80 * 80 * 4, 160 * 160,
+                                   25200 * 4, 4096, 100, 100};
+    const int num_sizes = (int)(sizeof(sizes) / sizeof(sizes[0]));
+    int order[sizeof(sizes) / sizeof(sizes[0])];
+    void* ptrs[sizeof(sizes) / sizeof(sizes[0])];
+
+    buffer_pool_t* pool = buffer_pool_create();
+    CHECK(pool != NULL, "buffer_pool_create fail");
+    buffer_pool_stats_t stats;
+    int warm_heap_allocs = -1;
+    unsigned int seed = 1;
+    for (int f = 0; f < frames; f++) {
+        buffer_pool_reset(pool);
+        for (int i = 0; i < num_sizes; i++) {
+            order[i] = i;
+        }
+        for (int i = num_sizes - 1; i > 0; i--) {
+            seed = seed * 1103515245u + 12345u;
+            int j = (int)((seed >> 16) % (unsigned int)(i + 1));
+            int t = order[i];
+            order[i] = order[j];
+            order[j] = t;
+        }
+        for (int i = 0; i < num_sizes; i++) {
+            size_t size = sizes[order[i]];
+            ptrs[i] = buffer_pool_alloc(pool, size);
+            CHECK(ptrs[i] != NULL, "frame %d: alloc %zu fail", f, size);
+            CHECK(is_aligned(ptrs[i]), "frame %d: %p not aligned", f, ptrs[i]);
+            memset(ptrs[i], f, size);
+            // 临时缓冲用完即还，后面的申请可以复用
+            if (f % 2 == 1 && i % 3 == 2) {
+                buffer_pool_free(pool, ptrs[i]);
+            }
+        }
+        buffer_pool_get_stats(pool, &stats);
+        if (f == 0) {
+            CHECK(stats.frame_heap_allocs == stats.heap_allocs, "first frame: frame_heap_allocs %d, heap_allocs %d",
+                  stats.frame_heap_allocs, stats.heap_allocs);
+            warm_heap_allocs = stats.heap_allocs;
+        } else {
+            CHECK(stats.frame_heap_allocs == 0, "frame %d: %d heap allocations after warm-up", f,
+                  stats.frame_heap_allocs);
+            CHECK(stats.heap_allocs == warm_heap_allocs, "frame %d: heap_allocs %d, expected %d", f,
+                  stats.heap_allocs, warm_heap_allocs);
+        }
+    }
+    CHECK(stats.blocks == warm_heap_allocs, "blocks %d, expected %d", stats.blocks, warm_heap_allocs);
+    printf("warm-up: %d blocks, %zu bytes reserved, peak %zu bytes in use, %d pool hits in %d frames\n", stats.blocks,
+           stats.bytes_reserved, stats.peak_bytes_in_use, stats.pool_hits, frames);
+    buffer_pool_destroy(pool);
+    return 0;
+}
+
+static int test_double_free(void)
+{
+    buffer_pool_t* pool = buffer_pool_create();
+    CHECK(pool != NULL, "buffer_pool_create fail");
+    buffer_pool_stats_t before;
+    buffer_pool_stats_t after;
+
+    void* a = buffer_pool_alloc(pool, 500);
+    void* b = buffer_pool_alloc(pool, 500);
+    CHECK(a != NULL && b != NULL && a != b, "alloc 500 fail");
+    buffer_pool_free(pool, a);
+    buffer_pool_get_stats(pool, &before);
+    printf("expect a double free report: ");
+    buffer_pool_free(pool, a);
+    buffer_pool_get_stats(pool, &after);
+    CHECK(memcmp(&before, &after, sizeof(buffer_pool_stats_t)) == 0, "double free changed the counters");
+    CHECK(after.blocks_in_use == 1, "blocks_in_use %d, expected 1", after.blocks_in_use);
+
+    // 空闲链表里a只出现一次，连续两次申请不能拿到同一块
+    void* c = buffer_pool_alloc(pool, 500);
+    void* d = buffer_pool_alloc(pool, 500);
+    CHECK(c == a, "freed block not reused");
+    CHECK(d != a && d != b, "block handed out twice after double free");
+
+    // reset之后再释放也算重复释放
+    buffer_pool_reset(pool);
+    buffer_pool_get_stats(pool, &before);
+    printf("expect a double free report: ");
+    buffer_pool_free(pool, b);
+    buffer_pool_get_stats(pool, &after);
+    CHECK(memcmp(&before, &after, sizeof(buffer_pool_stats_t)) == 0, "free after reset changed the counters");
+    CHECK(after.blocks_in_use == 0, "blocks_in_use %d after reset", after.blocks_in_use);
+    buffer_pool_destroy(pool);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : DEFAULT_FRAMES;
+    if (frames < 2) {
+        frames = 2;
+    }
+
+    int failed = 0;
+    if (test_alignment() != 0) {
+        printf("alignment: FAIL\n");
+        failed++;
+    }
+    if (test_size_class_reuse() != 0) {
+        printf("size class reuse: FAIL\n");
+        failed++;
+    }
+    if (test_warm_up(frames) != 0) {
+        printf("warm-up: FAIL\n");
+        failed++;
+    }
+    if (test_double_free() != 0) {
+        printf("double free: FAIL\n");
+        failed++;
+    }
+    if (failed > 0) {
+        printf("FAIL %d tests\n", failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
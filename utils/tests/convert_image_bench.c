@@ -0,0 +1,181 @@
+/*
+ * Thread scaling of the CPU path of convert_image_to_tensor.
+ *
+ * Letterboxes a 1920x1080 frame into 640x640 tensors that RGA cannot write
+ * (NCHW, quantized NHWC, float), so every run takes the banded CPU path, with
+ * set_convert_image_threads() from 1 to max_threads. Prints ms per frame and
+ * the speedup over one thread, and fails if any thread count writes a tensor
+ * that differs from the single thread result.
+ *
+ * usage: convert_image_bench [max_threads] [iterations] [core_id ...]
+ *        core ids are passed to set_convert_image_threads(), core_ids[0] is the calling thread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "image_utils.h"
+
+#define SRC_WIDTH 1920
+#define SRC_HEIGHT 1080
+#define TENSOR_SIZE 640
+#define MAX_CORE_IDS 16
+
+typedef struct {
+    const char* name;
+    image_format_t src_format;
+    image_tensor_layout_t layout;
+    image_tensor_type_t type;
+    int zp;
+    float scale;
+    int normalize;          // 1: mean/std of imagenet
+} bench_workload_t;
+
+static const bench_workload_t g_workloads[] = {
+    {"RGB888 -> NCHW uint8", IMAGE_FORMAT_RGB888, IMAGE_TENSOR_LAYOUT_NCHW, IMAGE_TENSOR_TYPE_UINT8, 0, 0.f, 0},
+    {"NV12 -> NHWC int8", IMAGE_FORMAT_YUV420SP_NV12, IMAGE_TENSOR_LAYOUT_NHWC, IMAGE_TENSOR_TYPE_INT8, -128, 1.f, 0},
+    {"RGBA8888 -> NCHW float32", IMAGE_FORMAT_RGBA8888, IMAGE_TENSOR_LAYOUT_NCHW, IMAGE_TENSOR_TYPE_FLOAT32, 0, 0.f, 1},
+};
+
+#define NUM_WORKLOADS ((int)(sizeof(g_workloads) / sizeof(g_workloads[0])))
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int make_source(image_buffer_t* img, image_format_t format)
+{
+    memset(img, 0, sizeof(image_buffer_t));
+    img->width = SRC_WIDTH;
+    img->height = SRC_HEIGHT;
+    img->format = format;
+    img->fd = -1;
+    img->size = get_image_size(img);
+    img->virt_addr = (unsigned char*)malloc(img->size);
+    if (img->virt_addr == NULL) {
+        return -1;
+    }
+    // 渐变加噪声，避免各行内容相同
+    unsigned int seed = 1;
+    for (int i = 0; i < img->size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        img->virt_addr[i] = (unsigned char)((i % 251) + ((seed >> 16) & 31));
+    }
+    return 0;
+}
+
+static int get_elem_size(image_tensor_type_t type)
+{
+    switch (type) {
+    case IMAGE_TENSOR_TYPE_FLOAT16:
+        return 2;
+    case IMAGE_TENSOR_TYPE_FLOAT32:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+static void make_tensor(image_tensor_t* tensor, const bench_workload_t* w, void* buf, int size)
+{
+    static const float mean[3] = {123.675f, 116.28f, 103.53f};
+    static const float std[3] = {58.395f, 57.12f, 57.375f};
+    memset(tensor, 0, sizeof(image_tensor_t));
+    tensor->width = TENSOR_SIZE;
+    tensor->height = TENSOR_SIZE;
+    tensor->channel = 3;
+    tensor->layout = w->layout;
+    tensor->type = w->type;
+    tensor->zp = w->zp;
+    tensor->scale = w->scale;
+    for (int c = 0; c < 3; c++) {
+        tensor->mean[c] = w->normalize ? mean[c] : 0.f;
+        tensor->std[c] = w->normalize ? std[c] : 1.f;
+    }
+    tensor->virt_addr = buf;
+    tensor->fd = -1;
+    tensor->size = size;
+}
+
+int main(int argc, char** argv)
+{
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = argc > 1 ? atoi(argv[1]) : (num_cpus > 8 ? 8 : (int)num_cpus);
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+    int core_ids[MAX_CORE_IDS];
+    int num_core_ids = 0;
+    for (int i = 3; i < argc && num_core_ids < MAX_CORE_IDS; i++) {
+        core_ids[num_core_ids++] = atoi(argv[i]);
+    }
+    if (max_threads < 1) {
+        max_threads = 1;
+    }
+    if (iterations < 1) {
+        iterations = 1;
+    }
+    printf("online cpus %ld, threads 1..%d, %d iterations, %d core ids\n", num_cpus, max_threads, iterations,
+           num_core_ids);
+    printf("%-28s %8s %10s %8s\n", "workload", "threads", "ms/frame", "speedup");
+
+    int failed = 0;
+    for (int k = 0; k < NUM_WORKLOADS; k++) {
+        const bench_workload_t* w = &g_workloads[k];
+        image_buffer_t src;
+        if (make_source(&src, w->src_format) != 0) {
+            printf("alloc source fail\n");
+            return 1;
+        }
+        int size = TENSOR_SIZE * TENSOR_SIZE * 3 * get_elem_size(w->type);
+        unsigned char* ref = (unsigned char*)malloc(size);
+        unsigned char* out = (unsigned char*)malloc(size);
+        if (ref == NULL || out == NULL) {
+            printf("alloc tensor fail\n");
+            return 1;
+        }
+        double base_ms = 0;
+        for (int t = 1; t <= max_threads; t++) {
+            if (set_convert_image_threads(t, num_core_ids > 0 ? core_ids : NULL, num_core_ids) != 0) {
+                printf("set_convert_image_threads %d fail\n", t);
+                return 1;
+            }
+            image_tensor_t tensor;
+            make_tensor(&tensor, w, t == 1 ? ref : out, size);
+            letterbox_t letterbox;
+            memset(tensor.virt_addr, 0x5a, size);
+            // 第一帧预热，同时用于结果比对
+            if (convert_image_to_tensor(&src, &tensor, &letterbox, 114) != 0) {
+                printf("%s: convert_image_to_tensor fail\n", w->name);
+                return 1;
+            }
+            if (t > 1 && memcmp(ref, out, size) != 0) {
+                printf("%s: %d threads differ from 1 thread\n", w->name, t);
+                failed++;
+            }
+            double start = now_ms();
+            for (int i = 0; i < iterations; i++) {
+                convert_image_to_tensor(&src, &tensor, &letterbox, 114);
+            }
+            double ms = (now_ms() - start) / iterations;
+            if (t == 1) {
+                base_ms = ms;
+            }
+            printf("%-28s %8d %10.3f %7.2fx\n", w->name, t, ms, base_ms / ms);
+        }
+        free(ref);
+        free(out);
+        free(src.virt_addr);
+    }
+    set_convert_image_threads(1, NULL, 0);
+    if (failed > 0) {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,435 @@
+/*
+ * Latency of the detection postprocess at rising object counts.
+ *
+ * Runs decode + finalize_detections() of yolov5 and yolov8 on int8 NCHW
+ * outputs (the RKNPU2 demo path), with the seeded tensors of
+ * detect_pp_cases.h. Each scene adds objects and lowers the box threshold
+ * below more of the background, so candidates per frame grow from tens to
+ * the whole grid. Every scene runs with pre_nms_top_k = top_k and without a
+ * cap (top_k 0), serial, then capped with 2, 4 and 8 decode threads
+ * (detect_workspace_set_threads()) up to max_threads. Prints candidates per
+ * frame, p50/p90/p99/max of the frame latency in microseconds, the p50
+ * speedup over the serial capped run and a log2 histogram of the latency.
+ *
+ * Decode only: the scenes of yolov5, yolov8 and yolox decoded without NMS,
+ * int8 with the dequantize/exp tables of detect_workspace_build_lut() and
+ * without them (each value dequantized and exp() computed in float). Prints
+ * the p50 of both and fails if the candidates differ. The same scenes are
+ * then decoded with the per-cell argmax of detect_pp_bench_per_cell.cc (built
+ * with DETECT_POSTPROCESS_DISABLE_SIMD) against the channel-major sweep of
+ * this build, both with tables, and must give the same candidates.
+ *
+ * NMS sweep: nms_sorted() per-class and class offset against the per-class
+ * loop it replaced (one walk over all candidates per class, class check
+ * fixed), on 100 to 10000 clustered boxes of 80 classes. Prints the median
+ * time of each and fails if the kept boxes differ.
+ *
+ * usage: detect_pp_bench [frames] [top_k] [max_threads]
+ *        max_threads defaults to the online cores, at most 8
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "detect_pp_cases.h"
+#include "detect_pp_bench_decode.h"
+
+#define DEFAULT_FRAMES 200
+#define DEFAULT_TOP_K 1000
+#define MAX_THREADS 8
+#define HIST_BUCKETS 16         // 第k桶为[2^k, 2^(k+1)) us
+#define NMS_SWEEP_THRESHOLD 0.45f
+#define NMS_SWEEP_CLUSTER 8     // 每簇的box数
+
+static const bench_scene_t g_scenes[] = {
+    {"sparse", 6, 40, 0.25f},
+    {"crowded", 100, 40, 0.25f},
+    {"low threshold", 100, 96, 0.125f},
+    {"flood", 200, 255, 0.0625f},
+};
+
+#define NUM_SCENES ((int)(sizeof(g_scenes) / sizeof(g_scenes[0])))
+
+static const char* g_bench_models[] = {"yolov5", "yolov8"};
+
+#define NUM_BENCH_MODELS ((int)(sizeof(g_bench_models) / sizeof(g_bench_models[0])))
+
+// yolox的w/h要exp，yolov8的DFL要softmax，yolov5只有反量化
+static const char* g_decode_models[] = {"yolov5", "yolov8", "yolox"};
+
+#define NUM_DECODE_MODELS ((int)(sizeof(g_decode_models) / sizeof(g_decode_models[0])))
+
+/**
+ * @brief Time frames of one scene, as post_process of the demo
+ *
+ * @param m [in] Model
+ * @param frames [in] Seeded frames, used in turn
+ * @param num_frames [in] Number of timed frames
+ * @param top_k [in] pre_nms_top_k of finalize_detections(), <= 0: no cap
+ * @param num_threads [in] Decode threads, 1: serial decode
+ * @param lat_us [out] Latency of each frame
+ * @param candidates [out] Mean candidates per frame before the cap
+ * @return int 0: success; -1: error
+ */
+static int run_scene(const model_spec_t& m, std::vector<bench_frame_t>& frames, int num_frames, int top_k,
+                     int num_threads, std::vector<double>& lat_us, double* candidates)
+{
+    detect_workspace_t* ws = create_workspace(m, frames[0], num_threads, true);
+    if (ws == NULL) {
+        printf("create workspace with %d threads fail\n", num_threads);
+        return -1;
+    }
+    static test_result_list_t results;
+    long total_candidates = 0;
+    lat_us.clear();
+    // 第一轮不计时，工作区和缓存预热
+    for (int f = -NUM_SEEDS; f < num_frames; f++) {
+        bench_frame_t& frame = frames[(f + NUM_SEEDS) % NUM_SEEDS];
+        double start = now_us();
+        detect_workspace_begin_frame(ws);
+        decode_outputs<int8_t, layout_nchw>(m, frame.tc, frame.outs, frame.bufs, ws);
+        detect_workspace_run_bands(ws);
+        int count = (int)ws->cand.probs.size();
+        finalize_detections(ws, frame.tc.nms_threshold, &frame.tc.letterbox, MODEL_SIZE, MODEL_SIZE, &results, top_k);
+        detect_workspace_end_frame(ws);
+        double end = now_us();
+        if (f >= 0) {
+            lat_us.push_back(end - start);
+            total_candidates += count;
+        }
+    }
+    detect_workspace_destroy(ws);
+    *candidates = (double)total_candidates / num_frames;
+    return 0;
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+static void print_histogram(const std::vector<double>& lat_us)
+{
+    int hist[HIST_BUCKETS] = {0};
+    for (size_t i = 0; i < lat_us.size(); i++) {
+        int k = 0;
+        while (k < HIST_BUCKETS - 1 && lat_us[i] >= (double)(2 << k)) {
+            k++;
+        }
+        hist[k]++;
+    }
+    int first = 0;
+    int last = HIST_BUCKETS - 1;
+    while (first < last && hist[first] == 0) {
+        first++;
+    }
+    while (last > first && hist[last] == 0) {
+        last--;
+    }
+    for (int k = first; k <= last; k++) {
+        printf("    %7d-%-7d us %5d ", k == 0 ? 0 : 1 << k, 2 << k, hist[k]);
+        int bar = (int)(hist[k] * 50 / lat_us.size());
+        for (int i = 0; i < bar; i++) {
+            putchar('#');
+        }
+        putchar('\n');
+    }
+}
+
+/**
+ * @brief Time int8 decode of every scene with and without lookup tables
+ *
+ * @param num_frames [in] Timed frames per scene and mode
+ * @return int 0: both modes give the same candidates; -1: error
+ */
+static int run_decode_lut(int num_frames)
+{
+    printf("decode only, int8 NCHW, tables of detect_workspace_build_lut() vs dequantize and exp() per value\n");
+    int failed = 0;
+    std::vector<double> lat_us;
+    std::vector<bench_frame_t> frames;
+    for (int mi = 0; mi < NUM_DECODE_MODELS; mi++) {
+        const model_spec_t* m = find_model(g_decode_models[mi]);
+        if (m == NULL) {
+            return -1;
+        }
+        for (int s = 0; s < NUM_SCENES; s++) {
+            gen_frames(*m, g_scenes[s], frames);
+            double p50[2];
+            unsigned int digest[2];
+            for (int use_lut = 1; use_lut >= 0; use_lut--) {
+                if (run_decode(*m, frames, num_frames, use_lut != 0, lat_us, &digest[use_lut]) != 0) {
+                    return -1;
+                }
+                std::sort(lat_us.begin(), lat_us.end());
+                p50[use_lut] = percentile(lat_us, 0.5);
+            }
+            printf("%-7s %-13s  lut p50 %8.1f us  float p50 %8.1f us  %5.2fx\n", m->name, g_scenes[s].name, p50[1],
+                   p50[0], p50[0] / p50[1]);
+            if (digest[0] != digest[1]) {
+                printf("%s %s: candidates with and without tables differ\n", m->name, g_scenes[s].name);
+                failed++;
+            }
+        }
+    }
+    return failed > 0 ? -1 : 0;
+}
+
+// detect_pp_bench_per_cell.cc
+int decode_per_cell(const char* model_name, const char* scene_name, int num_objects, int background,
+                    float conf_threshold, int num_frames, std::vector<double>& lat_us, unsigned int* digest);
+
+static int run_decode_argmax(int num_frames)
+{
+#if defined(DETECT_PP_USE_NEON)
+    const char* sweep = "NEON";
+#elif defined(DETECT_PP_USE_SSE2)
+    const char* sweep = "SSE2";
+#else
+    const char* sweep = "scalar";
+#endif
+    printf("decode only, int8 NCHW with tables, per-cell argmax vs channel-major sweep (%s)\n", sweep);
+    int failed = 0;
+    std::vector<double> lat_us;
+    std::vector<bench_frame_t> frames;
+    for (int mi = 0; mi < NUM_DECODE_MODELS; mi++) {
+        const model_spec_t* m = find_model(g_decode_models[mi]);
+        if (m == NULL) {
+            return -1;
+        }
+        for (int s = 0; s < NUM_SCENES; s++) {
+            const bench_scene_t& scene = g_scenes[s];
+            unsigned int cell_digest = 0;
+            unsigned int sweep_digest = 0;
+            if (decode_per_cell(m->name, scene.name, scene.num_objects, scene.background, scene.conf_threshold,
+                                num_frames, lat_us, &cell_digest) != 0) {
+                return -1;
+            }
+            std::sort(lat_us.begin(), lat_us.end());
+            double cell_p50 = percentile(lat_us, 0.5);
+            gen_frames(*m, scene, frames);
+            if (run_decode(*m, frames, num_frames, true, lat_us, &sweep_digest) != 0) {
+                return -1;
+            }
+            std::sort(lat_us.begin(), lat_us.end());
+            double sweep_p50 = percentile(lat_us, 0.5);
+            printf("%-7s %-13s  per-cell p50 %8.1f us  sweep p50 %8.1f us  %5.2fx\n", m->name, scene.name, cell_p50,
+                   sweep_p50, cell_p50 / sweep_p50);
+            if (cell_digest != sweep_digest) {
+                printf("%s %s: candidates of per-cell and channel-major argmax differ\n", m->name, scene.name);
+                failed++;
+            }
+        }
+    }
+    return failed > 0 ? -1 : 0;
+}
+
+static const int g_nms_sizes[] = {100, 300, 1000, 3000, 10000};
+
+#define NUM_NMS_SIZES ((int)(sizeof(g_nms_sizes) / sizeof(g_nms_sizes[0])))
+
+// nms_sorted()之前的实现，修正了类别判断：每个类别一次遍历全部候选，O(类别数 x n^2)
+static float calculate_overlap(float xmin0, float ymin0, float xmax0, float ymax0,
+                               float xmin1, float ymin1, float xmax1, float ymax1)
+{
+    float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);
+    float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);
+    float i = w * h;
+    float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) + (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;
+    return u <= 0.f ? 0.f : (i / u);
+}
+
+static void nms_class_loop(int valid_count, const std::vector<float>& boxes, const std::vector<int>& class_ids,
+                           std::vector<int>& order, float threshold)
+{
+    std::set<int> class_set(class_ids.begin(), class_ids.end());
+    for (std::set<int>::iterator c = class_set.begin(); c != class_set.end(); ++c) {
+        for (int i = 0; i < valid_count; ++i) {
+            int n = order[i];
+            if (n == -1 || class_ids[n] != *c) {
+                continue;
+            }
+            for (int j = i + 1; j < valid_count; ++j) {
+                int m = order[j];
+                if (m == -1 || class_ids[m] != *c) {
+                    continue;
+                }
+                float iou = calculate_overlap(boxes[n * 4 + 0], boxes[n * 4 + 1], boxes[n * 4 + 0] + boxes[n * 4 + 2],
+                                              boxes[n * 4 + 1] + boxes[n * 4 + 3], boxes[m * 4 + 0], boxes[m * 4 + 1],
+                                              boxes[m * 4 + 0] + boxes[m * 4 + 2], boxes[m * 4 + 1] + boxes[m * 4 + 3]);
+                if (iou > threshold) {
+                    order[j] = -1;
+                }
+            }
+        }
+    }
+}
+
+// 成簇的box：同簇同类别，位置和大小在簇中心附近抖动，与检测头输出的重叠程度相近
+static void gen_nms_boxes(int n, std::vector<float>& boxes, std::vector<int>& class_ids, std::vector<float>& probs)
+{
+    g_rand_state = (unsigned int)n;
+    boxes.resize(n * 4);
+    class_ids.resize(n);
+    probs.resize(n);
+    float cx = 0, cy = 0, w = 0, h = 0;
+    int cls = 0;
+    for (int i = 0; i < n; i++) {
+        if (i % NMS_SWEEP_CLUSTER == 0) {
+            cx = (float)rand_int(MODEL_SIZE);
+            cy = (float)rand_int(MODEL_SIZE);
+            w = 16.0f + rand_int(160);
+            h = 16.0f + rand_int(160);
+            cls = rand_int(NUM_CLASS);
+        }
+        float bw = w * (0.8f + rand_level(102));
+        float bh = h * (0.8f + rand_level(102));
+        boxes[i * 4 + 0] = cx + rand_int(17) - 8 - bw / 2;
+        boxes[i * 4 + 1] = cy + rand_int(17) - 8 - bh / 2;
+        boxes[i * 4 + 2] = bw;
+        boxes[i * 4 + 3] = bh;
+        class_ids[i] = cls;
+        probs[i] = rand_level(256);
+    }
+}
+
+typedef enum {
+    NMS_RUN_PER_CLASS,
+    NMS_RUN_CLASS_OFFSET,
+    NMS_RUN_CLASS_LOOP,
+    NMS_RUN_NUM,
+} nms_run_t;
+
+static const char* g_nms_run_names[NMS_RUN_NUM] = {"per-class", "class offset", "per-class loop"};
+
+/**
+ * @brief Time NMS of 100 to 10000 boxes with nms_sorted() and the per-class loop
+ *
+ * @param reps [in] Timed calls per size and mode, the median is printed
+ * @return int 0: all modes keep the same boxes; -1: error
+ */
+static int run_nms_sweep(int reps)
+{
+    printf("nms sweep: %d classes, %d boxes per cluster, IoU %.2f, median of %d calls\n", NUM_CLASS,
+           NMS_SWEEP_CLUSTER, NMS_SWEEP_THRESHOLD, reps);
+    printf("%8s %8s %14s %14s %16s\n", "boxes", "kept", g_nms_run_names[0], g_nms_run_names[1], g_nms_run_names[2]);
+    int failed = 0;
+    std::vector<float> boxes;
+    std::vector<int> class_ids;
+    std::vector<float> probs;
+    std::vector<float> sorted;
+    std::vector<int> sorted_order;
+    std::vector<int> order;
+    std::vector<int> kept[NMS_RUN_NUM];
+    std::vector<double> lat_us(reps);
+    nms_boxes_t nms;
+    for (int s = 0; s < NUM_NMS_SIZES; s++) {
+        int n = g_nms_sizes[s];
+        gen_nms_boxes(n, boxes, class_ids, probs);
+        int valid_count = sort_candidates(probs, sorted_order, 0, sorted);
+        double median_ms[NMS_RUN_NUM];
+        int keep = 0;
+        for (int r = 0; r < NMS_RUN_NUM; r++) {
+            for (int k = 0; k < reps; k++) {
+                order = sorted_order;
+                double start = now_us();
+                if (r == NMS_RUN_CLASS_LOOP) {
+                    nms_class_loop(valid_count, boxes, class_ids, order, NMS_SWEEP_THRESHOLD);
+                } else {
+                    keep = nms_sorted(valid_count, boxes, class_ids, order, NMS_SWEEP_THRESHOLD,
+                                      r == NMS_RUN_PER_CLASS ? DETECT_NMS_PER_CLASS : DETECT_NMS_CLASS_OFFSET, nms);
+                }
+                lat_us[k] = now_us() - start;
+            }
+            std::sort(lat_us.begin(), lat_us.end());
+            median_ms[r] = percentile(lat_us, 0.5) / 1000.0;
+            kept[r] = order;
+        }
+        printf("%8d %8d %11.3f ms %11.3f ms %13.3f ms\n", n, keep, median_ms[NMS_RUN_PER_CLASS],
+               median_ms[NMS_RUN_CLASS_OFFSET], median_ms[NMS_RUN_CLASS_LOOP]);
+        for (int r = 1; r < NMS_RUN_NUM; r++) {
+            if (kept[r] != kept[NMS_RUN_PER_CLASS]) {
+                printf("%d boxes: %s keeps other boxes than %s\n", n, g_nms_run_names[r], g_nms_run_names[0]);
+                failed++;
+            }
+        }
+    }
+    return failed > 0 ? -1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    int num_frames = argc > 1 ? atoi(argv[1]) : DEFAULT_FRAMES;
+    int top_k = argc > 2 ? atoi(argv[2]) : DEFAULT_TOP_K;
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = argc > 3 ? atoi(argv[3]) : (num_cpus > MAX_THREADS ? MAX_THREADS : (int)num_cpus);
+    if (num_frames < 1) {
+        num_frames = 1;
+    }
+    printf("online cpus %ld, %d frames per scene, pre_nms_top_k %d vs no cap, threads up to %d\n", num_cpus,
+           num_frames, top_k, max_threads);
+
+    // 串行时有无上限，之后有上限时2/4/8线程
+    int run_top_k[] = {top_k, 0, top_k, top_k, top_k};
+    int run_threads[] = {1, 1, 2, 4, 8};
+    int num_runs = (int)(sizeof(run_threads) / sizeof(run_threads[0]));
+
+    std::vector<double> lat_us;
+    for (int mi = 0; mi < NUM_BENCH_MODELS; mi++) {
+        const model_spec_t* m = find_model(g_bench_models[mi]);
+        if (m == NULL) {
+            return 1;
+        }
+        for (int s = 0; s < NUM_SCENES; s++) {
+            const bench_scene_t& scene = g_scenes[s];
+            std::vector<bench_frame_t> frames;
+            gen_frames(*m, scene, frames);
+            double base_p50 = 0;
+            for (int r = 0; r < num_runs; r++) {
+                if (run_threads[r] > max_threads) {
+                    continue;
+                }
+                double candidates = 0;
+                if (run_scene(*m, frames, num_frames, run_top_k[r], run_threads[r], lat_us, &candidates) != 0) {
+                    return 1;
+                }
+                std::vector<double> sorted(lat_us);
+                std::sort(sorted.begin(), sorted.end());
+                double p50 = percentile(sorted, 0.5);
+                if (r == 0) {
+                    base_p50 = p50;
+                }
+                printf("%s %-13s top_k %5d  threads %d  candidates %6.0f  p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f us"
+                       "  %5.2fx\n",
+                       m->name, scene.name, run_top_k[r], run_threads[r], candidates, p50, percentile(sorted, 0.9),
+                       percentile(sorted, 0.99), sorted.back(), base_p50 / p50);
+                print_histogram(lat_us);
+            }
+        }
+    }
+
+    if (run_decode_lut(num_frames) != 0) {
+        printf("FAIL\n");
+        return 1;
+    }
+    if (run_decode_argmax(num_frames) != 0) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    // 旧实现在10000个box时每次几十毫秒，次数按帧数缩减
+    int nms_reps = num_frames / 20 > 1 ? num_frames / 20 : 1;
+    if (run_nms_sweep(nms_reps) != 0) {
+        printf("FAIL\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+#ifndef _RKNN_MODEL_ZOO_DETECT_PP_BENCH_DECODE_H_
+#define _RKNN_MODEL_ZOO_DETECT_PP_BENCH_DECODE_H_
+
+/*
+ * Seeded frames and the decode-only timing of detect_pp_bench, included after
+ * detect_pp_cases.h. detect_pp_bench_per_cell.cc includes it once more with
+ * DETECT_POSTPROCESS_DISABLE_SIMD to time the per-cell argmax.
+ */
+
+#include <time.h>
+
+#include <vector>
+
+#define NUM_SEEDS 8             // 轮流使用的不同帧数
+
+typedef struct {
+    const char* name;
+    int num_objects;
+    int background;
+    float conf_threshold;
+} bench_scene_t;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static const model_spec_t* find_model(const char* name)
+{
+    for (int m = 0; m < NUM_MODELS; m++) {
+        if (strcmp(g_models[m].name, name) == 0) {
+            return &g_models[m];
+        }
+    }
+    return NULL;
+}
+
+typedef struct {
+    test_case_t tc;
+    std::vector<logical_tensor_t> outs;
+    std::vector<std::vector<int8_t> > bufs;
+} bench_frame_t;
+
+static void gen_frames(const model_spec_t& m, const bench_scene_t& scene, std::vector<bench_frame_t>& frames)
+{
+    frames.resize(NUM_SEEDS);
+    for (int i = 0; i < NUM_SEEDS; i++) {
+        test_case_t tc = {100u + i, scene.num_objects, scene.background, scene.conf_threshold, 0.45f, {0, 0, 1.0f}};
+        frames[i].tc = tc;
+        gen_outputs(m, tc, frames[i].outs);
+        frames[i].bufs.resize(frames[i].outs.size());
+        for (size_t k = 0; k < frames[i].outs.size(); k++) {
+            make_buffer<int8_t, layout_nchw>(frames[i].outs[k], frames[i].bufs[k]);
+        }
+    }
+}
+
+static detect_workspace_t* create_workspace(const model_spec_t& m, const bench_frame_t& frame, int num_threads,
+                                            bool build_lut)
+{
+    int per_branch = (int)frame.outs.size() / NUM_BRANCHES;
+    int max_candidates = 0;
+    int max_grid_w = 0;
+    for (int b = 0; b < NUM_BRANCHES; b++) {
+        const logical_tensor_t& t = frame.outs[b * per_branch];
+        max_candidates += t.grid_h * t.grid_w * m.num_anchors;
+        max_grid_w = t.grid_w > max_grid_w ? t.grid_w : max_grid_w;
+    }
+    detect_workspace_t* ws = detect_workspace_create(max_candidates, max_grid_w, NUM_CLASS);
+    if (ws == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; build_lut && i < frame.outs.size(); i++) {
+        detect_workspace_build_lut(ws, (int)i, frame.outs[i].zp, frame.outs[i].scale, true);
+    }
+    if (detect_workspace_set_threads(ws, num_threads, NULL, 0) != 0) {
+        detect_workspace_destroy(ws);
+        return NULL;
+    }
+    return ws;
+}
+
+static unsigned int fnv1a(unsigned int hash, const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Time decode of one scene without NMS
+ *
+ * @param m [in] Model
+ * @param frames [in] Seeded frames, used in turn
+ * @param num_frames [in] Number of timed frames
+ * @param use_lut [in] true: tables of detect_workspace_build_lut(); false: dequantize and exp() each value
+ * @param lat_us [out] Decode time of each frame
+ * @param digest [out] FNV-1a of the candidates of all timed frames
+ * @return int 0: success; -1: error
+ */
+static int run_decode(const model_spec_t& m, std::vector<bench_frame_t>& frames, int num_frames, bool use_lut,
+                      std::vector<double>& lat_us, unsigned int* digest)
+{
+    detect_workspace_t* ws = create_workspace(m, frames[0], 1, use_lut);
+    if (ws == NULL) {
+        printf("create workspace fail\n");
+        return -1;
+    }
+    unsigned int hash = 2166136261u;
+    lat_us.clear();
+    for (int f = -NUM_SEEDS; f < num_frames; f++) {
+        bench_frame_t& frame = frames[(f + NUM_SEEDS) % NUM_SEEDS];
+        double start = now_us();
+        detect_workspace_begin_frame(ws);
+        decode_outputs<int8_t, layout_nchw>(m, frame.tc, frame.outs, frame.bufs, ws);
+        double end = now_us();
+        if (f >= 0) {
+            const detect_candidates_t& cand = ws->cand;
+            lat_us.push_back(end - start);
+            hash = fnv1a(hash, cand.probs.data(), cand.probs.size() * sizeof(float));
+            hash = fnv1a(hash, cand.boxes.data(), cand.boxes.size() * sizeof(float));
+            hash = fnv1a(hash, cand.class_ids.data(), cand.class_ids.size() * sizeof(int));
+        }
+        detect_workspace_end_frame(ws);
+    }
+    detect_workspace_destroy(ws);
+    *digest = hash;
+    return 0;
+}
+
+#endif // _RKNN_MODEL_ZOO_DETECT_PP_BENCH_DECODE_H_
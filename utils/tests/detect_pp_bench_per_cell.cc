@@ -0,0 +1,60 @@
+/*
+ * Decode of detect_pp_bench built once more with DETECT_POSTPROCESS_DISABLE_SIMD,
+ * so the class argmax gathers every class per cell instead of sweeping the class
+ * planes channel-major. detect_postprocess.hpp and the bench helpers are put in
+ * namespace per_cell so the templates do not collide with the SIMD build of
+ * detect_pp_bench.cc at link time.
+ */
+
+#if !defined(DETECT_POSTPROCESS_DISABLE_SIMD)
+#error "detect_pp_bench_per_cell.cc must be built with DETECT_POSTPROCESS_DISABLE_SIMD"
+#endif
+
+// 先在全局包含头文件，命名空间内的include不再展开它们
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include "common.h"
+#include "image_utils.h"
+#include "thread_pool.h"
+
+namespace per_cell {
+#include "detect_pp_cases.h"
+#include "detect_pp_bench_decode.h"
+}
+
+/**
+ * @brief Time decode of one scene with the per-cell argmax, see run_decode()
+ *
+ * @param model_name [in] Model of detect_pp_cases.h
+ * @param scene_name [in] Scene name
+ * @param num_objects [in] Objects per frame
+ * @param background [in] Background level of the scene
+ * @param conf_threshold [in] Box threshold
+ * @param num_frames [in] Number of timed frames
+ * @param lat_us [out] Decode time of each frame
+ * @param digest [out] FNV-1a of the candidates of all timed frames
+ * @return int 0: success; -1: error
+ */
+int decode_per_cell(const char* model_name, const char* scene_name, int num_objects, int background,
+                    float conf_threshold, int num_frames, std::vector<double>& lat_us, unsigned int* digest)
+{
+    const per_cell::model_spec_t* m = per_cell::find_model(model_name);
+    if (m == NULL) {
+        printf("model %s not found\n", model_name);
+        return -1;
+    }
+    per_cell::bench_scene_t scene = {scene_name, num_objects, background, conf_threshold};
+    std::vector<per_cell::bench_frame_t> frames;
+    per_cell::gen_frames(*m, scene, frames);
+    return per_cell::run_decode(*m, frames, num_frames, true, lat_us, digest);
+}
@@ -0,0 +1,404 @@
+#ifndef _RKNN_MODEL_ZOO_DETECT_PP_CASES_H_
+#define _RKNN_MODEL_ZOO_DETECT_PP_CASES_H_
+
+/*
+ * Model configurations and seeded output tensors shared by detect_pp_test and
+ * detect_pp_bench, see detect_pp_test.cc for how the tensors are built.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "detect_postprocess.hpp"
+
+using namespace detect_pp;
+
+#define NUM_CLASS 80
+#define MODEL_SIZE 640
+#define NUM_BRANCHES 3
+#define MAX_RESULTS 128
+
+typedef struct {
+    image_rect_t box;
+    float prop;
+    int cls_id;
+} test_result_t;
+
+// 与demo的object_detect_result_list结构相同
+typedef struct {
+    int id;
+    int count;
+    test_result_t results[MAX_RESULTS];
+} test_result_list_t;
+
+typedef enum {
+    HEAD_ANCHOR,        // yolov5/yolov7
+    HEAD_ANCHOR_FREE,   // yolox
+    HEAD_DFL,           // yolov6/yolov8/ppyoloe
+} head_kind_t;
+
+typedef struct {
+    const char* name;
+    head_kind_t head;
+    const int (*anchors)[6];    // 每个分支3个anchor的w/h，anchor free为NULL
+    int num_anchors;
+    int dfl_len;                // DFL每条边的bin数，1: 直接输出ltrb(yolov6)
+    int score_sum;              // DFL是否有score sum输出
+    bool gate_on_score;
+} model_spec_t;
+
+static const int g_yolov5_anchors[3][6] = {{10, 13, 16, 30, 33, 23},
+                                           {30, 61, 62, 45, 59, 119},
+                                           {116, 90, 156, 198, 373, 326}};
+
+static const int g_yolov7_anchors[3][6] = {{12, 16, 19, 36, 40, 28},
+                                           {36, 75, 76, 55, 72, 146},
+                                           {142, 110, 192, 243, 459, 401}};
+
+static const model_spec_t g_models[] = {
+    {"yolov5", HEAD_ANCHOR, g_yolov5_anchors, 3, 0, 0, false},
+    {"yolov5_score_gate", HEAD_ANCHOR, g_yolov5_anchors, 3, 0, 0, true},   // RV1106/RV1103 demo
+    {"yolov6", HEAD_DFL, NULL, 1, 1, 1, false},
+    {"yolov7", HEAD_ANCHOR, g_yolov7_anchors, 3, 0, 0, false},
+    {"yolov8", HEAD_DFL, NULL, 1, 16, 0, false},
+    {"yolox", HEAD_ANCHOR_FREE, NULL, 1, 0, 0, false},
+    {"ppyoloe", HEAD_DFL, NULL, 1, 17, 1, false},
+};
+
+#define NUM_MODELS ((int)(sizeof(g_models) / sizeof(g_models[0])))
+
+typedef struct {
+    unsigned int seed;
+    int num_objects;            // 每个分支的目标数
+    int background;             // 背景分数的最大值，按1/256计
+    float conf_threshold;       // 取1/256的整数倍，量化后与浮点比较一致
+    float nms_threshold;
+    letterbox_t letterbox;
+} test_case_t;
+
+/**
+ * @brief One output tensor as int8 codes [C][H*W], value = (code - zp) * scale
+ *
+ */
+typedef struct {
+    int channels;
+    int grid_h;
+    int grid_w;
+    int32_t zp;
+    float scale;
+    std::vector<int8_t> codes;
+} logical_tensor_t;
+
+static unsigned int g_rand_state;
+
+static inline int rand_int(int n)
+{
+    g_rand_state = g_rand_state * 1103515245u + 12345u;
+    return (int)((g_rand_state >> 8) % (unsigned int)n);
+}
+
+static inline void init_tensor(logical_tensor_t* t, int channels, int grid, int32_t zp, float scale)
+{
+    t->channels = channels;
+    t->grid_h = grid;
+    t->grid_w = grid;
+    t->zp = zp;
+    t->scale = scale;
+    t->codes.assign((size_t)channels * grid * grid, 0);
+}
+
+// 写入离value最近的code
+static inline void set_value(logical_tensor_t* t, int c, int p, float value)
+{
+    int code = (int)floorf(value / t->scale + 0.5f) + t->zp;
+    code = code < -128 ? -128 : (code > 127 ? 127 : code);
+    t->codes[(size_t)c * t->grid_h * t->grid_w + p] = (int8_t)code;
+}
+
+static inline float get_value(const logical_tensor_t* t, int c, int p)
+{
+    return (t->codes[(size_t)c * t->grid_h * t->grid_w + p] - t->zp) * t->scale;
+}
+
+// [0, n)个1/256
+static inline float rand_level(int n) { return rand_int(n) / 256.0f; }
+
+typedef struct {
+    int cx;
+    int cy;
+    int cls;
+    int anchor;
+    float size_w;       // 按模型含义的宽高参数，见各head的生成函数
+    float size_h;
+} object_t;
+
+typedef struct {
+    const object_t* obj;
+    int p;
+    int dx;             // cell相对目标中心cell的偏移
+    int dy;
+} object_cell_t;
+
+// 每个目标占3x3个cell，相邻cell的box指向同一目标，NMS后只留一个
+static inline void place_objects(const test_case_t& tc, int grid, float size_min, float size_range,
+                          std::vector<object_t>& objs, std::vector<object_cell_t>& cells)
+{
+    objs.resize(tc.num_objects);
+    cells.clear();
+    for (int o = 0; o < tc.num_objects; o++) {
+        object_t* obj = &objs[o];
+        obj->cx = rand_int(grid);
+        obj->cy = rand_int(grid);
+        obj->cls = rand_int(NUM_CLASS);
+        obj->anchor = rand_int(3);
+        obj->size_w = size_min + size_range * rand_level(256);
+        obj->size_h = size_min + size_range * rand_level(256);
+    }
+    for (int o = 0; o < tc.num_objects; o++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                int x = objs[o].cx + dx;
+                int y = objs[o].cy + dy;
+                if (x >= 0 && x < grid && y >= 0 && y < grid) {
+                    object_cell_t cell = {&objs[o], y * grid + x, dx, dy};
+                    cells.push_back(cell);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * yolov5/yolov7: 一个tensor，zp -128, scale 1/256，值域[0, 1)
+ *   中心 (2t - 0.5 + col) * stride，指向目标中心cell时 t = (1 - dx) / 2
+ *   宽高 (2t)^2 * anchor，t取目标的size
+ * yolox: zp 0, scale 1/64，值域[-2, 2)
+ *   中心 (t + col) * stride，t = 0.5 - dx；宽高 exp(t) * stride，t取目标的size
+ */
+static inline void gen_objectness_branch(const model_spec_t& m, const test_case_t& tc, int grid, std::vector<logical_tensor_t>& outs)
+{
+    bool anchor_free = m.head == HEAD_ANCHOR_FREE;
+    logical_tensor_t t;
+    int prop_size = 5 + NUM_CLASS;
+    int grid_len = grid * grid;
+    init_tensor(&t, prop_size * m.num_anchors, grid, anchor_free ? 0 : -128, anchor_free ? 1.0f / 64 : 1.0f / 256);
+    for (int c = 0; c < t.channels; c++) {
+        bool is_box = c % prop_size < 4;
+        for (int p = 0; p < grid_len; p++) {
+            set_value(&t, c, p, is_box ? rand_level(256) : rand_level(tc.background + 1));
+        }
+    }
+    std::vector<object_t> objs;
+    std::vector<object_cell_t> cells;
+    place_objects(tc, grid, anchor_free ? 0.f : 0.25f, anchor_free ? 1.5f : 0.5f, objs, cells);
+    for (size_t i = 0; i < cells.size(); i++) {
+        const object_cell_t& cell = cells[i];
+        int base = (cell.obj->anchor % m.num_anchors) * prop_size;
+        float jitter_x = rand_level(9) - 4 / 256.0f;
+        float jitter_y = rand_level(9) - 4 / 256.0f;
+        if (anchor_free) {
+            set_value(&t, base + 0, cell.p, 0.5f - cell.dx + jitter_x);
+            set_value(&t, base + 1, cell.p, 0.5f - cell.dy + jitter_y);
+        } else {
+            set_value(&t, base + 0, cell.p, (1 - cell.dx) * 0.5f + jitter_x);
+            set_value(&t, base + 1, cell.p, (1 - cell.dy) * 0.5f + jitter_y);
+        }
+        set_value(&t, base + 2, cell.p, cell.obj->size_w + rand_level(9) - 4 / 256.0f);
+        set_value(&t, base + 3, cell.p, cell.obj->size_h + rand_level(9) - 4 / 256.0f);
+        set_value(&t, base + 4, cell.p, 0.5f + rand_level(128));
+        set_value(&t, base + 5 + cell.obj->cls, cell.p, 0.5f + rand_level(128));
+    }
+    outs.push_back(t);
+}
+
+/*
+ * yolov6/yolov8/ppyoloe: box tensor为到cell中心的ltrb距离(按grid)，目标半宽高取size
+ *   dfl_len > 1: 每条边dfl_len个logit，zp 0, scale 1/16，值域[-8, 8)，峰值在距离处
+ *   dfl_len == 1: 直接是距离，zp -128, scale 1/16，值域[0, 16)
+ * score为每类分数，score sum比最大类别分数略低，部分类别过阈值的cell会被挡掉
+ */
+static inline void gen_dfl_branch(const model_spec_t& m, const test_case_t& tc, int grid, std::vector<logical_tensor_t>& outs)
+{
+    int grid_len = grid * grid;
+    int dfl_len = m.dfl_len;
+    logical_tensor_t box;
+    init_tensor(&box, 4 * dfl_len, grid, dfl_len > 1 ? 0 : -128, 1.0f / 16);
+    for (int c = 0; c < box.channels; c++) {
+        for (int p = 0; p < grid_len; p++) {
+            set_value(&box, c, p, dfl_len > 1 ? rand_int(128) / 16.0f - 4 : rand_int(96) / 16.0f);
+        }
+    }
+    logical_tensor_t score;
+    init_tensor(&score, NUM_CLASS, grid, -128, 1.0f / 256);
+    for (int c = 0; c < NUM_CLASS; c++) {
+        for (int p = 0; p < grid_len; p++) {
+            set_value(&score, c, p, rand_level(tc.background + 1));
+        }
+    }
+    std::vector<object_t> objs;
+    std::vector<object_cell_t> cells;
+    float max_dist = dfl_len > 1 ? dfl_len - 1 : 6.0f;
+    place_objects(tc, grid, 1.5f, max_dist - 3.0f, objs, cells);
+    for (size_t i = 0; i < cells.size(); i++) {
+        const object_cell_t& cell = cells[i];
+        float dist[4] = {cell.obj->size_w + cell.dx, cell.obj->size_h + cell.dy, cell.obj->size_w - cell.dx,
+                         cell.obj->size_h - cell.dy};
+        for (int b = 0; b < 4; b++) {
+            float d = dist[b] + rand_int(5) / 16.0f - 2 / 16.0f;
+            if (dfl_len == 1) {
+                set_value(&box, b, cell.p, d);
+                continue;
+            }
+            for (int k = 0; k < dfl_len; k++) {
+                set_value(&box, b * dfl_len + k, cell.p, 4.0f - 2.0f * fabsf(k - d));
+            }
+        }
+        set_value(&score, cell.obj->cls, cell.p, 0.5f + rand_level(128));
+    }
+    outs.push_back(box);
+    outs.push_back(score);
+    if (m.score_sum) {
+        logical_tensor_t sum;
+        init_tensor(&sum, 1, grid, -128, 1.0f / 256);
+        for (int p = 0; p < grid_len; p++) {
+            float max_score = 0;
+            for (int c = 0; c < NUM_CLASS; c++) {
+                float s = get_value(&score, c, p);
+                max_score = s > max_score ? s : max_score;
+            }
+            set_value(&sum, 0, p, max_score - rand_level(32));
+        }
+        outs.push_back(sum);
+    }
+}
+
+static inline void gen_outputs(const model_spec_t& m, const test_case_t& tc, std::vector<logical_tensor_t>& outs)
+{
+    g_rand_state = tc.seed;
+    outs.clear();
+    for (int b = 0; b < NUM_BRANCHES; b++) {
+        int grid = MODEL_SIZE / (8 << b);
+        if (m.head == HEAD_DFL) {
+            gen_dfl_branch(m, tc, grid, outs);
+        } else {
+            gen_objectness_branch(m, tc, grid, outs);
+        }
+    }
+}
+
+// 测试数据都能用fp16精确表示(不小于2^-8，有效位不超过8位)，不处理舍入和非规格化数
+static inline uint16_t f32_to_fp16(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    if ((bits & 0x7fffffff) == 0) {
+        return sign;
+    }
+    uint32_t exponent = ((bits >> 23) & 0xff) - 127 + 15;
+    return (uint16_t)(sign | (exponent << 10) | ((bits & 0x7fffff) >> 13));
+}
+
+/**
+ * @brief Encode an int8 code of a logical tensor as element of the tested dtype
+ *
+ */
+template <typename T>
+struct test_dtype;
+
+template <>
+struct test_dtype<int8_t> {
+    static int32_t zp(const logical_tensor_t& t) { return t.zp; }
+    static int8_t encode(int8_t q, const logical_tensor_t& t) { return q; }
+    static const bool is_signed = true;
+};
+
+template <>
+struct test_dtype<uint8_t> {
+    static int32_t zp(const logical_tensor_t& t) { return t.zp + 128; }
+    static uint8_t encode(int8_t q, const logical_tensor_t& t) { return (uint8_t)(q + 128); }
+    static const bool is_signed = false;
+};
+
+template <>
+struct test_dtype<float> {
+    static int32_t zp(const logical_tensor_t& t) { return t.zp; }
+    static float encode(int8_t q, const logical_tensor_t& t) { return (q - t.zp) * t.scale; }
+    static const bool is_signed = true;
+};
+
+template <>
+struct test_dtype<fp16_t> {
+    static int32_t zp(const logical_tensor_t& t) { return t.zp; }
+    static fp16_t encode(int8_t q, const logical_tensor_t& t)
+    {
+        fp16_t h = {f32_to_fp16((q - t.zp) * t.scale)};
+        return h;
+    }
+    static const bool is_signed = true;
+};
+
+// NC1HWC2按C2补齐通道
+template <typename Layout>
+struct layout_channels {
+    static int padded(int channels) { return channels; }
+};
+
+template <int C2>
+struct layout_channels<layout_nc1hwc2<C2> > {
+    static int padded(int channels) { return (channels + C2 - 1) / C2 * C2; }
+};
+
+template <typename T, typename Layout>
+static inline void make_buffer(const logical_tensor_t& t, std::vector<T>& buf)
+{
+    int grid_len = t.grid_h * t.grid_w;
+    // 补齐的通道填最大值，解码读到补齐部分时结果会变
+    buf.assign((size_t)layout_channels<Layout>::padded(t.channels) * grid_len, test_dtype<T>::encode(127, t));
+    for (int c = 0; c < t.channels; c++) {
+        for (int p = 0; p < grid_len; p++) {
+            buf[Layout::offset(c, p, t.channels, grid_len)] = test_dtype<T>::encode(t.codes[(size_t)c * grid_len + p], t);
+        }
+    }
+}
+
+template <typename T, typename Layout>
+static inline void decode_outputs(const model_spec_t& m, const test_case_t& tc, const std::vector<logical_tensor_t>& outs,
+                           const std::vector<std::vector<T> >& bufs, detect_workspace_t* ws)
+{
+    typedef test_dtype<T> dt;
+    int per_branch = (int)outs.size() / NUM_BRANCHES;
+    for (int b = 0; b < NUM_BRANCHES; b++) {
+        int i = b * per_branch;
+        const logical_tensor_t& t = outs[i];
+        int stride = MODEL_SIZE / t.grid_h;
+        if (m.head == HEAD_ANCHOR) {
+            decode_objectness_head<T, Layout, head_anchor>(bufs[i].data(), dt::zp(t), t.scale, detect_workspace_lut(ws, i),
+                                                           m.anchors[b], m.num_anchors, t.grid_h, t.grid_w, stride, NUM_CLASS,
+                                                           tc.conf_threshold, m.gate_on_score, ws);
+        } else if (m.head == HEAD_ANCHOR_FREE) {
+            decode_objectness_head<T, Layout, head_anchor_free>(bufs[i].data(), dt::zp(t), t.scale, detect_workspace_lut(ws, i),
+                                                                NULL, 1, t.grid_h, t.grid_w, stride, NUM_CLASS,
+                                                                tc.conf_threshold, m.gate_on_score, ws);
+        } else {
+            const logical_tensor_t& score = outs[i + 1];
+            const T* sum = NULL;
+            int32_t sum_zp = 0;
+            float sum_scale = 1.0f;
+            if (per_branch == 3) {
+                sum = bufs[i + 2].data();
+                sum_zp = dt::zp(outs[i + 2]);
+                sum_scale = outs[i + 2].scale;
+            }
+            decode_dfl_head<T, Layout>(bufs[i].data(), dt::zp(t), t.scale, detect_workspace_lut(ws, i),
+                                       bufs[i + 1].data(), dt::zp(score), score.scale, sum, sum_zp, sum_scale,
+                                       t.grid_h, t.grid_w, stride, m.dfl_len, NUM_CLASS, tc.conf_threshold, ws);
+        }
+    }
+}
+
+#endif // _RKNN_MODEL_ZOO_DETECT_PP_CASES_H_
@@ -0,0 +1,324 @@
+/*
+ * Regression test of detect_postprocess.hpp for the detection demos.
+ *
+ * Each model entry is configured the way its demo calls the header: head type,
+ * anchors, DFL length, score sum output and gate. For each entry the test
+ * generates seeded output tensors and runs decode + finalize_detections() like
+ * the demo's post_process, for int8, uint8, fp16 and fp32 and for the NCHW,
+ * NHWC and NC1HWC2 layouts. Tensors are int8 codes with power of two scales,
+ * so every dtype holds exactly the same values: int8 as is, uint8 with zp + 128,
+ * fp16 and fp32 dequantized. All dtype and layout variants must give the same
+ * result list, and it must match data/detect_pp_expected.txt. A second frame
+ * on the same workspace must do no heap allocation. Every variant runs again
+ * with 2, 4 and 8 decode threads (detect_workspace_set_threads()) and must give
+ * exactly the serial results, whatever the number of cores of the host, and
+ * once more with DETECT_NMS_CLASS_OFFSET, which must give the results of the
+ * default per-class NMS.
+ *
+ * The tensors are synthetic. Objects are 3x3 blocks of high scores on random
+ * cells and classes, on a background of low scores. One case per model keeps
+ * far more than PRE_NMS_TOP_K candidates, so top-k selection and NMS of
+ * crowded frames are covered too. Boxes are compared within 1 pixel,
+ * because libm exp() of another target may differ in the last bit.
+ *
+ * usage: detect_pp_test expected_file [-w]
+ *        -w writes expected_file from the current implementation instead of comparing
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "detect_pp_cases.h"
+
+#define PRE_NMS_TOP_K 1000
+
+static const test_case_t g_cases[] = {
+    {1, 6, 40, 0.25f, 0.45f, {0, 80, 0.5f}},
+    // 背景超过阈值，候选数远多于PRE_NMS_TOP_K
+    {2, 40, 60, 0.125f, 0.6f, {16, 0, 1.0f}},
+};
+
+#define NUM_CASES ((int)(sizeof(g_cases) / sizeof(g_cases[0])))
+
+static const int g_thread_counts[] = {2, 4, 8};
+
+#define NUM_THREAD_COUNTS ((int)(sizeof(g_thread_counts) / sizeof(g_thread_counts[0])))
+
+/**
+ * @brief Run two frames of one model and case with a dtype and layout, as post_process of the demo
+ *
+ * @param m [in] Model
+ * @param tc [in] Case
+ * @param outs [in] Logical output tensors from gen_outputs()
+ * @param num_threads [in] Decode threads, 1: serial decode
+ * @param nms_mode [in] NMS mode of finalize_detections()
+ * @param results [out] Results of the second frame
+ * @return int 0: both frames give the same results and the second does not allocate; -1: error
+ */
+template <typename T, typename Layout>
+static int run_variant(const model_spec_t& m, const test_case_t& tc, const std::vector<logical_tensor_t>& outs,
+                       int num_threads, detect_nms_mode_t nms_mode, test_result_list_t* results)
+{
+    std::vector<std::vector<T> > bufs(outs.size());
+    for (size_t i = 0; i < outs.size(); i++) {
+        make_buffer<T, Layout>(outs[i], bufs[i]);
+    }
+    int per_branch = (int)outs.size() / NUM_BRANCHES;
+    int max_candidates = 0;
+    int max_grid_w = 0;
+    for (int b = 0; b < NUM_BRANCHES; b++) {
+        const logical_tensor_t& t = outs[b * per_branch];
+        max_candidates += t.grid_h * t.grid_w * m.num_anchors;
+        max_grid_w = t.grid_w > max_grid_w ? t.grid_w : max_grid_w;
+    }
+    detect_workspace_t* ws = detect_workspace_create(max_candidates, max_grid_w, NUM_CLASS);
+    if (ws == NULL) {
+        printf("detect_workspace_create fail\n");
+        return -1;
+    }
+    if (dtype_traits<T>::quantized) {
+        for (size_t i = 0; i < outs.size(); i++) {
+            detect_workspace_build_lut(ws, (int)i, test_dtype<T>::zp(outs[i]), outs[i].scale, test_dtype<T>::is_signed);
+        }
+    }
+    if (detect_workspace_set_threads(ws, num_threads, NULL, 0) != 0) {
+        detect_workspace_destroy(ws);
+        return -1;
+    }
+
+    static test_result_list_t first;
+    int ret = 0;
+    for (int frame = 0; frame < 2; frame++) {
+        test_result_list_t* list = frame == 0 ? &first : results;
+        memset(list, 0, sizeof(test_result_list_t));
+        detect_workspace_begin_frame(ws);
+        decode_outputs<T, Layout>(m, tc, outs, bufs, ws);
+        finalize_detections(ws, tc.nms_threshold, &tc.letterbox, MODEL_SIZE, MODEL_SIZE, list, PRE_NMS_TOP_K, nms_mode);
+        detect_workspace_end_frame(ws);
+    }
+    detect_workspace_stats_t stats;
+    detect_workspace_get_stats(ws, &stats);
+    if (stats.frame_heap_allocs != 0) {
+        printf("second frame did %d heap allocations\n", stats.frame_heap_allocs);
+        ret = -1;
+    }
+    if (memcmp(&first, results, sizeof(test_result_list_t)) != 0) {
+        printf("second frame differs from first frame\n");
+        ret = -1;
+    }
+    detect_workspace_destroy(ws);
+    return ret;
+}
+
+typedef int (*run_variant_fn)(const model_spec_t& m, const test_case_t& tc, const std::vector<logical_tensor_t>& outs,
+                              int num_threads, detect_nms_mode_t nms_mode, test_result_list_t* results);
+
+typedef struct {
+    const char* name;
+    run_variant_fn run;
+    bool anchor_major;      // 多anchor时NHWC按cell访问，同分候选的先后不同，NMS可能保留另一个
+} variant_t;
+
+// NC1HWC2的C2与RKNPU2原生输出一致: 8位16，16位以上8
+static const variant_t g_variants[] = {
+    {"int8 NCHW", run_variant<int8_t, layout_nchw>, layout_nchw::anchor_major},
+    {"int8 NHWC", run_variant<int8_t, layout_nhwc>, layout_nhwc::anchor_major},
+    {"int8 NC1HWC2", run_variant<int8_t, layout_nc1hwc2<16> >, layout_nc1hwc2<16>::anchor_major},
+    {"uint8 NCHW", run_variant<uint8_t, layout_nchw>, layout_nchw::anchor_major},
+    {"uint8 NHWC", run_variant<uint8_t, layout_nhwc>, layout_nhwc::anchor_major},
+    {"uint8 NC1HWC2", run_variant<uint8_t, layout_nc1hwc2<16> >, layout_nc1hwc2<16>::anchor_major},
+    {"fp16 NCHW", run_variant<fp16_t, layout_nchw>, layout_nchw::anchor_major},
+    {"fp16 NHWC", run_variant<fp16_t, layout_nhwc>, layout_nhwc::anchor_major},
+    {"fp16 NC1HWC2", run_variant<fp16_t, layout_nc1hwc2<8> >, layout_nc1hwc2<8>::anchor_major},
+    {"fp32 NCHW", run_variant<float, layout_nchw>, layout_nchw::anchor_major},
+    {"fp32 NHWC", run_variant<float, layout_nhwc>, layout_nhwc::anchor_major},
+    {"fp32 NC1HWC2", run_variant<float, layout_nc1hwc2<8> >, layout_nc1hwc2<8>::anchor_major},
+};
+
+#define NUM_VARIANTS ((int)(sizeof(g_variants) / sizeof(g_variants[0])))
+
+static void print_result(FILE* fp, const test_result_t* r)
+{
+    fprintf(fp, "%d %d %d %d %.9g %d\n", r->box.left, r->box.top, r->box.right, r->box.bottom, r->prop, r->cls_id);
+}
+
+static void print_first_diff(const test_result_list_t* a, const test_result_list_t* b)
+{
+    printf("  count %d vs %d\n", a->count, b->count);
+    for (int i = 0; i < a->count && i < b->count; i++) {
+        if (memcmp(&a->results[i], &b->results[i], sizeof(test_result_t)) != 0) {
+            printf("  result %d: ", i);
+            print_result(stdout, &a->results[i]);
+            printf("       vs %d: ", i);
+            print_result(stdout, &b->results[i]);
+            break;
+        }
+    }
+}
+
+// 读取下一条用例的期望结果，格式见write_expected()
+static int read_expected(FILE* fp, const char* model, int case_index, const char* order, test_result_list_t* list)
+{
+    char line[256];
+    char name[64];
+    char order_name[64];
+    int index = 0;
+    int count = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (sscanf(line, "%63s %d %63s %d", name, &index, order_name, &count) != 4 || strcmp(name, model) != 0 ||
+            index != case_index || strcmp(order_name, order) != 0 || count < 0 || count > MAX_RESULTS) {
+            printf("expected file: want \"%s %d %s <count>\", got %s", model, case_index, order, line);
+            return -1;
+        }
+        memset(list, 0, sizeof(test_result_list_t));
+        list->count = count;
+        for (int i = 0; i < count; i++) {
+            test_result_t* r = &list->results[i];
+            if (fgets(line, sizeof(line), fp) == NULL ||
+                sscanf(line, "%d %d %d %d %f %d", &r->box.left, &r->box.top, &r->box.right, &r->box.bottom, &r->prop,
+                       &r->cls_id) != 6) {
+                printf("expected file: bad result %d of %s %d\n", i, model, case_index);
+                return -1;
+            }
+        }
+        return 0;
+    }
+    printf("expected file: missing %s %d\n", model, case_index);
+    return -1;
+}
+
+static void write_expected(FILE* fp, const char* model, int case_index, const char* order, const test_result_list_t* list)
+{
+    fprintf(fp, "%s %d %s %d\n", model, case_index, order, list->count);
+    for (int i = 0; i < list->count; i++) {
+        print_result(fp, &list->results[i]);
+    }
+}
+
+static int near(int a, int b) { return a - b <= 1 && b - a <= 1; }
+
+static int match_expected(const test_result_list_t* expected, const test_result_list_t* list)
+{
+    if (expected->count != list->count) {
+        return 0;
+    }
+    for (int i = 0; i < list->count; i++) {
+        const test_result_t* e = &expected->results[i];
+        const test_result_t* r = &list->results[i];
+        if (e->cls_id != r->cls_id || e->prop != r->prop || !near(e->box.left, r->box.left) ||
+            !near(e->box.top, r->box.top) || !near(e->box.right, r->box.right) || !near(e->box.bottom, r->box.bottom)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printf("usage: %s expected_file [-w]\n", argv[0]);
+        return 1;
+    }
+    int write_mode = argc > 2 && strcmp(argv[2], "-w") == 0;
+    FILE* fp = fopen(argv[1], write_mode ? "w" : "r");
+    if (fp == NULL) {
+        printf("open %s fail\n", argv[1]);
+        return 1;
+    }
+    if (write_mode) {
+        fprintf(fp, "# written by detect_pp_test -w: \"model case order count\", then \"left top right bottom prop cls_id\" per result\n");
+    }
+
+    // 按访问顺序分组，组内第一个变体作为参考，与同组其他变体及期望结果比较
+    static const char* order_names[2] = {"anchor_major", "cell_major"};
+    static test_result_list_t reference[2];
+    static test_result_list_t results;
+    static test_result_list_t threaded;
+    static test_result_list_t expected;
+    std::vector<logical_tensor_t> outs;
+    int failed = 0;
+    for (int m = 0; m < NUM_MODELS; m++) {
+        for (int c = 0; c < NUM_CASES; c++) {
+            const model_spec_t& model = g_models[m];
+            gen_outputs(model, g_cases[c], outs);
+            int case_failed = 0;
+            int ref_variant[2] = {-1, -1};
+            for (int v = 0; v < NUM_VARIANTS; v++) {
+                int order = (g_variants[v].anchor_major || model.num_anchors == 1) ? 0 : 1;
+                bool is_ref = ref_variant[order] < 0;
+                test_result_list_t* list = is_ref ? &reference[order] : &results;
+                if (g_variants[v].run(model, g_cases[c], outs, 1, DETECT_NMS_PER_CLASS, list) != 0) {
+                    printf("%s case %d %s: run fail\n", model.name, c, g_variants[v].name);
+                    case_failed = 1;
+                    continue;
+                }
+                for (int t = 0; t < NUM_THREAD_COUNTS; t++) {
+                    if (g_variants[v].run(model, g_cases[c], outs, g_thread_counts[t], DETECT_NMS_PER_CLASS,
+                                          &threaded) != 0) {
+                        printf("%s case %d %s: run with %d threads fail\n", model.name, c, g_variants[v].name,
+                               g_thread_counts[t]);
+                        case_failed = 1;
+                    } else if (memcmp(list, &threaded, sizeof(test_result_list_t)) != 0) {
+                        printf("%s case %d %s: %d threads differ from serial\n", model.name, c, g_variants[v].name,
+                               g_thread_counts[t]);
+                        print_first_diff(list, &threaded);
+                        case_failed = 1;
+                    }
+                }
+                // 按类别平移后整体NMS，以按类别分桶的结果为准
+                if (g_variants[v].run(model, g_cases[c], outs, 1, DETECT_NMS_CLASS_OFFSET, &threaded) != 0) {
+                    printf("%s case %d %s: run with class offset NMS fail\n", model.name, c, g_variants[v].name);
+                    case_failed = 1;
+                } else if (memcmp(list, &threaded, sizeof(test_result_list_t)) != 0) {
+                    printf("%s case %d %s: class offset NMS differs from per-class NMS\n", model.name, c,
+                           g_variants[v].name);
+                    print_first_diff(list, &threaded);
+                    case_failed = 1;
+                }
+                if (is_ref) {
+                    ref_variant[order] = v;
+                } else if (memcmp(&reference[order], &results, sizeof(test_result_list_t)) != 0) {
+                    printf("%s case %d: %s differs from %s\n", model.name, c, g_variants[v].name,
+                           g_variants[ref_variant[order]].name);
+                    print_first_diff(&reference[order], &results);
+                    case_failed = 1;
+                }
+            }
+            for (int order = 0; order < 2; order++) {
+                if (ref_variant[order] < 0) {
+                    continue;
+                }
+                if (write_mode) {
+                    write_expected(fp, model.name, c, order_names[order], &reference[order]);
+                } else if (read_expected(fp, model.name, c, order_names[order], &expected) != 0) {
+                    fclose(fp);
+                    return 1;
+                } else if (!match_expected(&expected, &reference[order])) {
+                    printf("%s case %d %s: results differ from expected file\n", model.name, c, order_names[order]);
+                    print_first_diff(&expected, &reference[order]);
+                    case_failed = 1;
+                }
+            }
+            printf("%s case %d: %d results, %d variants x %d thread counts + class offset NMS %s\n", model.name, c,
+                   reference[0].count, NUM_VARIANTS, NUM_THREAD_COUNTS + 1, case_failed ? "FAIL" : "ok");
+            failed += case_failed;
+        }
+    }
+    fclose(fp);
+    if (failed > 0) {
+        printf("FAIL %d cases\n", failed);
+        return 1;
+    }
+    if (write_mode) {
+        printf("written %s\n", argv[1]);
+    } else {
+        printf("PASS\n");
+    }
+    return 0;
+}
@@ -0,0 +1,393 @@
+/*
+ * Stride test of image_utils.c and image_drawing.c.
+ *
+ * RGB888, RGBA8888 and NV12 images with width_stride != width and an odd
+ * height_stride != height are filled with the same pixels as packed copies.
+ * - get_image_size() must cover every plane at its stride, the NV12 UV plane
+ *   with (height_stride + 1) / 2 rows as RGA imports it.
+ * - convert_image() and convert_image_with_letterbox() from and to strided
+ *   images must give the pixels of the packed conversion.
+ * - every draw_* call must give the pixels of the same call on the packed copy.
+ * Row padding, rows between height and height_stride and a guard after
+ * get_image_size() bytes must stay untouched.
+ *
+ * On the host convert_image() always falls back to the CPU path. On a target
+ * RGA may take some of the conversions, then both sides of a comparison must
+ * still agree.
+ *
+ * usage: image_stride_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "image_utils.h"
+#include "image_drawing.h"
+
+#define PAD_VALUE 0xA5
+#define GUARD_SIZE 256
+
+#define SRC_WIDTH 202
+#define SRC_HEIGHT 118
+#define DST_WIDTH 160
+#define DST_HEIGHT 96
+#define EXTRA_COLUMNS 13
+#define EXTRA_ROWS 5
+
+static const image_format_t g_formats[] = {
+    IMAGE_FORMAT_RGB888,
+    IMAGE_FORMAT_RGBA8888,
+    IMAGE_FORMAT_YUV420SP_NV12,
+};
+
+#define NUM_FORMATS ((int)(sizeof(g_formats) / sizeof(g_formats[0])))
+
+typedef struct {
+    image_format_t src_format;
+    image_format_t dst_format;
+} convert_case_t;
+
+static const convert_case_t g_convert_cases[] = {
+    {IMAGE_FORMAT_RGB888, IMAGE_FORMAT_RGB888},
+    {IMAGE_FORMAT_RGBA8888, IMAGE_FORMAT_RGBA8888},
+    {IMAGE_FORMAT_RGBA8888, IMAGE_FORMAT_RGB888},
+    {IMAGE_FORMAT_YUV420SP_NV12, IMAGE_FORMAT_YUV420SP_NV12},
+    {IMAGE_FORMAT_YUV420SP_NV12, IMAGE_FORMAT_RGB888},
+};
+
+#define NUM_CONVERT_CASES ((int)(sizeof(g_convert_cases) / sizeof(g_convert_cases[0])))
+
+static const char* get_format_name(image_format_t format)
+{
+    switch (format) {
+    case IMAGE_FORMAT_RGB888:
+        return "RGB888";
+    case IMAGE_FORMAT_RGBA8888:
+        return "RGBA8888";
+    case IMAGE_FORMAT_YUV420SP_NV12:
+        return "NV12";
+    default:
+        return "?";
+    }
+}
+
+static int get_pixel_bytes(image_format_t format)
+{
+    switch (format) {
+    case IMAGE_FORMAT_RGB888:
+        return 3;
+    case IMAGE_FORMAT_RGBA8888:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+static int is_yuv420sp(image_format_t format)
+{
+    return format == IMAGE_FORMAT_YUV420SP_NV12 || format == IMAGE_FORMAT_YUV420SP_NV21;
+}
+
+static int get_expected_size(image_format_t format, int width_stride, int height_stride)
+{
+    if (is_yuv420sp(format)) {
+        return width_stride * height_stride + width_stride * ((height_stride + 1) / 2);
+    }
+    return width_stride * height_stride * get_pixel_bytes(format);
+}
+
+// 图像内容所在的字节，其余为行尾填充、height之后的行和UV平面之后的部分
+static int is_active_byte(const image_buffer_t* image, int offset)
+{
+    int pixel_bytes = get_pixel_bytes(image->format);
+    int row_stride = image->width_stride * pixel_bytes;
+    int y_plane_size = row_stride * image->height_stride;
+    if (offset < y_plane_size) {
+        return offset / row_stride < image->height && offset % row_stride < image->width * pixel_bytes;
+    }
+    if (!is_yuv420sp(image->format)) {
+        return 0;
+    }
+    offset -= y_plane_size;
+    return offset / row_stride < image->height / 2 && offset % row_stride < image->width;
+}
+
+// 申请get_image_size()字节加保护区，全部填为PAD_VALUE
+static int alloc_image(image_buffer_t* image, image_format_t format, int width, int height, int width_stride,
+                       int height_stride)
+{
+    memset(image, 0, sizeof(image_buffer_t));
+    image->format = format;
+    image->width = width;
+    image->height = height;
+    image->width_stride = width_stride;
+    image->height_stride = height_stride;
+    image->size = get_image_size(image);
+    int expected = get_expected_size(format, width_stride, height_stride);
+    if (image->size != expected) {
+        printf("%s %dx%d stride %dx%d: get_image_size %d, expected %d\n", get_format_name(format), width, height,
+               width_stride, height_stride, image->size, expected);
+        return -1;
+    }
+    image->virt_addr = (unsigned char*)malloc(image->size + GUARD_SIZE);
+    if (image->virt_addr == NULL) {
+        return -1;
+    }
+    memset(image->virt_addr, PAD_VALUE, image->size + GUARD_SIZE);
+    return 0;
+}
+
+static void free_image(image_buffer_t* image)
+{
+    free(image->virt_addr);
+    image->virt_addr = NULL;
+}
+
+static void fill_random(image_buffer_t* image, unsigned int seed)
+{
+    for (int i = 0; i < image->size; i++) {
+        if (is_active_byte(image, i)) {
+            seed = seed * 1103515245u + 12345u;
+            image->virt_addr[i] = (unsigned char)(seed >> 16);
+        }
+    }
+}
+
+// 按行拷贝内容，两幅图像几何相同，步长可以不同
+static void copy_active(image_buffer_t* dst, const image_buffer_t* src)
+{
+    int j = 0;
+    for (int i = 0; i < src->size; i++) {
+        if (!is_active_byte(src, i)) {
+            continue;
+        }
+        while (!is_active_byte(dst, j)) {
+            j++;
+        }
+        dst->virt_addr[j++] = src->virt_addr[i];
+    }
+}
+
+static int compare_active(const image_buffer_t* strided, const image_buffer_t* packed, const char* name)
+{
+    int j = 0;
+    for (int i = 0; i < strided->size; i++) {
+        if (!is_active_byte(strided, i)) {
+            if (strided->virt_addr[i] != PAD_VALUE) {
+                printf("%s: padding byte %d changed\n", name, i);
+                return -1;
+            }
+            continue;
+        }
+        while (!is_active_byte(packed, j)) {
+            j++;
+        }
+        if (strided->virt_addr[i] != packed->virt_addr[j]) {
+            printf("%s: byte %d is %d, packed byte %d is %d\n", name, i, strided->virt_addr[i], j,
+                   packed->virt_addr[j]);
+            return -1;
+        }
+        j++;
+    }
+    for (int i = 0; i < GUARD_SIZE; i++) {
+        if (strided->virt_addr[strided->size + i] != PAD_VALUE) {
+            printf("%s: %d bytes written after get_image_size()\n", name, i + 1);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int test_image_size(void)
+{
+    static const image_format_t formats[] = {IMAGE_FORMAT_GRAY8, IMAGE_FORMAT_RGB888, IMAGE_FORMAT_RGBA8888,
+                                             IMAGE_FORMAT_YUV420SP_NV12, IMAGE_FORMAT_YUV420SP_NV21};
+    for (int f = 0; f < (int)(sizeof(formats) / sizeof(formats[0])); f++) {
+        for (int extra_rows = 0; extra_rows <= EXTRA_ROWS; extra_rows++) {
+            image_buffer_t image;
+            memset(&image, 0, sizeof(image_buffer_t));
+            image.format = formats[f];
+            image.width = SRC_WIDTH;
+            image.height = SRC_HEIGHT;
+            image.width_stride = SRC_WIDTH + EXTRA_COLUMNS;
+            image.height_stride = SRC_HEIGHT + extra_rows;
+            int size = get_image_size(&image);
+            int expected = get_expected_size(formats[f], image.width_stride, image.height_stride);
+            if (size != expected) {
+                printf("format %d stride %dx%d: get_image_size %d, expected %d\n", formats[f], image.width_stride,
+                       image.height_stride, size, expected);
+                return -1;
+            }
+        }
+        // 步长为0时按宽高计算
+        image_buffer_t packed;
+        memset(&packed, 0, sizeof(image_buffer_t));
+        packed.format = formats[f];
+        packed.width = SRC_WIDTH;
+        packed.height = SRC_HEIGHT;
+        if (get_image_size(&packed) != get_expected_size(formats[f], SRC_WIDTH, SRC_HEIGHT)) {
+            printf("format %d: get_image_size without strides %d\n", formats[f], get_image_size(&packed));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int test_convert(const convert_case_t* c, int letterbox)
+{
+    char name[128];
+    snprintf(name, sizeof(name), "%s %s -> %s", letterbox ? "letterbox" : "convert", get_format_name(c->src_format),
+             get_format_name(c->dst_format));
+
+    image_buffer_t src;
+    image_buffer_t src_packed;
+    image_buffer_t dst;
+    image_buffer_t dst_packed;
+    memset(&src, 0, sizeof(image_buffer_t));
+    memset(&src_packed, 0, sizeof(image_buffer_t));
+    memset(&dst, 0, sizeof(image_buffer_t));
+    memset(&dst_packed, 0, sizeof(image_buffer_t));
+    int ret = -1;
+    if (alloc_image(&src, c->src_format, SRC_WIDTH, SRC_HEIGHT, SRC_WIDTH + EXTRA_COLUMNS,
+                    SRC_HEIGHT + EXTRA_ROWS) != 0 ||
+        alloc_image(&src_packed, c->src_format, SRC_WIDTH, SRC_HEIGHT, SRC_WIDTH, SRC_HEIGHT) != 0 ||
+        alloc_image(&dst, c->dst_format, DST_WIDTH, DST_HEIGHT, DST_WIDTH + 7, DST_HEIGHT + 3) != 0 ||
+        alloc_image(&dst_packed, c->dst_format, DST_WIDTH, DST_HEIGHT, DST_WIDTH, DST_HEIGHT) != 0) {
+        goto out;
+    }
+    fill_random(&src, 1);
+    copy_active(&src_packed, &src);
+
+    if (letterbox) {
+        // 目标缓冲由convert_image_with_letterbox按get_image_size()申请
+        letterbox_t lb;
+        letterbox_t lb_packed;
+        free(dst.virt_addr);
+        dst.virt_addr = NULL;
+        if (convert_image_with_letterbox(&src, &dst, &lb, 114) != 0 ||
+            convert_image_with_letterbox(&src_packed, &dst_packed, &lb_packed, 114) != 0) {
+            printf("%s: fail\n", name);
+            goto out;
+        }
+        // 内部申请的缓冲没有填充值和保护区，只比较内容
+        unsigned char* buf = (unsigned char*)malloc(dst.size + GUARD_SIZE);
+        if (buf == NULL) {
+            goto out;
+        }
+        memset(buf, PAD_VALUE, dst.size + GUARD_SIZE);
+        for (int i = 0; i < dst.size; i++) {
+            if (is_active_byte(&dst, i)) {
+                buf[i] = dst.virt_addr[i];
+            }
+        }
+        free(dst.virt_addr);
+        dst.virt_addr = buf;
+        if (lb.x_pad != lb_packed.x_pad || lb.y_pad != lb_packed.y_pad || lb.scale != lb_packed.scale) {
+            printf("%s: letterbox differs\n", name);
+            goto out;
+        }
+    } else {
+        // 目标框之外填充颜色，框内缩放
+        image_rect_t dst_box = {16, 8, DST_WIDTH - 17, DST_HEIGHT - 9};
+        if (convert_image(&src, &dst, NULL, &dst_box, 114) != 0 ||
+            convert_image(&src_packed, &dst_packed, NULL, &dst_box, 114) != 0) {
+            printf("%s: fail\n", name);
+            goto out;
+        }
+    }
+    ret = compare_active(&dst, &dst_packed, name);
+
+out:
+    free_image(&src);
+    free_image(&src_packed);
+    free_image(&dst);
+    free_image(&dst_packed);
+    return ret;
+}
+
+static void draw_all(image_buffer_t* image, const unsigned char* patch)
+{
+    int w = image->width;
+    int h = image->height;
+    draw_rectangle(image, 10, 12, 80, 50, 0x00FF8040, 3);
+    // 超出右下边界的部分必须按width/height裁掉，不能写进行尾填充
+    draw_rectangle(image, w - 20, h - 10, 60, 40, 0x0040FF80, 4);
+    draw_rectangle(image, 120, 20, 30, 20, 0x00202020, -1);
+    draw_line(image, 0, 0, w + 10, h + 10, 0x00FFFFFF, 2);
+    draw_line(image, w - 1, 0, 0, h - 1, 0x00808000, 1);
+    draw_circle(image, w - 15, h / 2, 30, 0x000000FF, 2);
+    draw_text(image, "stride 0123", w - 60, h - 12, 0x00FFFF00, 12);
+    int points[] = {30, 70, 90, 60, w + 5, h - 4, 50, h + 3};
+    draw_polygon(image, points, 4, 0x00FF00FF, -1);
+    draw_image(image, (unsigned char*)patch, 40, 30, 32, 20);
+
+    unsigned char labels[12 * 16];
+    for (int i = 0; i < (int)sizeof(labels); i++) {
+        labels[i] = (unsigned char)(i % 3);
+    }
+    static const unsigned int palette[] = {0x00000000, 0x8000FF00, 0x80FF0000};
+    overlay_mask_t mask = {labels, 16, 12, palette, 3};
+    overlay_box_t boxes[] = {
+        {{4, 4, 60, 40}, 0x00FF0000, 2, "person", 4, 4, 0x00FFFFFF},
+        {{w - 40, h - 30, w + 20, h + 20}, 0x0000FF00, 3, "car", w - 40, h - 30, 0x00000000},
+    };
+    draw_overlay(image, &mask, boxes, 2, 10);
+}
+
+static int test_drawing(image_format_t format)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "drawing %s", get_format_name(format));
+
+    image_buffer_t image;
+    image_buffer_t packed;
+    memset(&image, 0, sizeof(image_buffer_t));
+    memset(&packed, 0, sizeof(image_buffer_t));
+    int ret = -1;
+    unsigned char patch[32 * 20 * 4];
+    for (int i = 0; i < (int)sizeof(patch); i++) {
+        patch[i] = (unsigned char)(i * 7);
+    }
+    if (alloc_image(&image, format, SRC_WIDTH, SRC_HEIGHT, SRC_WIDTH + EXTRA_COLUMNS, SRC_HEIGHT + EXTRA_ROWS) != 0 ||
+        alloc_image(&packed, format, SRC_WIDTH, SRC_HEIGHT, SRC_WIDTH, SRC_HEIGHT) != 0) {
+        goto out;
+    }
+    fill_random(&image, 2);
+    copy_active(&packed, &image);
+    draw_all(&image, patch);
+    draw_all(&packed, patch);
+    ret = compare_active(&image, &packed, name);
+
+out:
+    free_image(&image);
+    free_image(&packed);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    int failed = 0;
+    if (test_image_size() != 0) {
+        printf("get_image_size: FAIL\n");
+        failed++;
+    }
+    for (int c = 0; c < NUM_CONVERT_CASES; c++) {
+        for (int letterbox = 0; letterbox <= 1; letterbox++) {
+            if (test_convert(&g_convert_cases[c], letterbox) != 0) {
+                failed++;
+            }
+        }
+    }
+    for (int f = 0; f < NUM_FORMATS; f++) {
+        if (test_drawing(g_formats[f]) != 0) {
+            failed++;
+        }
+    }
+    if (failed > 0) {
+        printf("FAIL %d tests\n", failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * Startup cost of loading a model with read_data_from_file() (heap copy) versus
+ * load_model_mapped() with and without MODEL_MAP_POPULATE.
+ *
+ * Each run is a forked child, so VmHWM (peak resident set) belongs to that
+ * run only. The child loads the file, then touches every byte once and
+ * copies it into a new heap buffer, as rknn_init does with the model, and
+ * reports the load time, the time until the copy is done, VmHWM and the
+ * anonymous / file backed parts of the resident set at that point. Runs are
+ * done with a cold page cache (posix_fadvise DONTNEED on the file) and a
+ * warm one. Every run must see the same checksum.
+ *
+ * usage: model_load_bench [model_file | size_mb] [runs]
+ *        without a file, a file of size_mb (default 64) random bytes is written to the current directory
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "file_utils.h"
+
+#define DEFAULT_SIZE_MB 64
+#define TEMP_MODEL_FILE "model_load_bench.tmp"
+
+typedef enum {
+    LOAD_HEAP,
+    LOAD_MAPPED,
+} load_kind_t;
+
+typedef struct {
+    const char* name;
+    load_kind_t kind;
+    int flags;
+} load_mode_t;
+
+static const load_mode_t g_modes[] = {
+    {"read (heap)", LOAD_HEAP, 0},
+    {"mapped", LOAD_MAPPED, 0},
+    {"mapped SEQUENTIAL", LOAD_MAPPED, MODEL_MAP_SEQUENTIAL},
+    {"mapped POPULATE", LOAD_MAPPED, MODEL_MAP_POPULATE},
+};
+
+#define NUM_MODES ((int)(sizeof(g_modes) / sizeof(g_modes[0])))
+
+typedef struct {
+    double load_ms;
+    double init_ms;         // 加载加上整份拷贝的时间
+    long hwm_kb;
+    long anon_kb;
+    long file_kb;
+    unsigned int checksum;
+} load_result_t;
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static long read_status_kb(const char* key)
+{
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (fp == NULL) {
+        return -1;
+    }
+    char line[256];
+    long value = -1;
+    size_t len = strlen(key);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (strncmp(line, key, len) == 0 && line[len] == ':') {
+            value = atol(line + len + 1);
+            break;
+        }
+    }
+    fclose(fp);
+    return value;
+}
+
+static int drop_file_cache(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    fdatasync(fd);
+    int ret = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return ret;
+}
+
+static int write_temp_model(const char* path, int size_mb)
+{
+    size_t size = (size_t)size_mb << 20;
+    char* data = (char*)malloc(size);
+    if (data == NULL) {
+        return -1;
+    }
+    unsigned int seed = 1;
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (char)(seed >> 16);
+    }
+    int ret = write_data_to_file(path, data, (unsigned int)size);
+    free(data);
+    return ret;
+}
+
+// 子进程中运行，结果经管道写回
+static int run_load(const char* path, const load_mode_t* mode, load_result_t* result)
+{
+    double start = now_ms();
+    char* model = NULL;
+    int size = 0;
+    if (mode->kind == LOAD_HEAP) {
+        size = read_data_from_file(path, &model);
+    } else {
+        size = load_model_mapped(path, &model, mode->flags);
+    }
+    if (model == NULL || size <= 0) {
+        return -1;
+    }
+    result->load_ms = now_ms() - start;
+
+    // 按rknn_init的方式把模型完整读一遍并复制到运行时自己的内存
+    char* copy = (char*)malloc(size);
+    if (copy == NULL) {
+        return -1;
+    }
+    memcpy(copy, model, size);
+    result->init_ms = now_ms() - start;
+    unsigned int checksum = 0;
+    for (int i = 0; i < size; i += 4096) {
+        checksum = checksum * 31 + (unsigned char)copy[i];
+    }
+    result->checksum = checksum;
+    result->anon_kb = read_status_kb("RssAnon");
+    result->file_kb = read_status_kb("RssFile");
+    result->hwm_kb = read_status_kb("VmHWM");
+
+    if (mode->kind == LOAD_HEAP) {
+        free(model);
+    } else {
+        unload_model_mapped(model, size);
+    }
+    free(copy);
+    return 0;
+}
+
+static int run_in_child(const char* path, const load_mode_t* mode, load_result_t* result)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        load_result_t r;
+        memset(&r, 0, sizeof(r));
+        int ret = run_load(path, mode, &r);
+        if (ret == 0 && write(fds[1], &r, sizeof(r)) != sizeof(r)) {
+            ret = -1;
+        }
+        close(fds[1]);
+        _exit(ret == 0 ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t n = read(fds[0], result, sizeof(load_result_t));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (n != sizeof(load_result_t) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = TEMP_MODEL_FILE;
+    int size_mb = DEFAULT_SIZE_MB;
+    int temp_file = 1;
+    if (argc > 1) {
+        char* end = NULL;
+        long value = strtol(argv[1], &end, 10);
+        if (*end == '\0' && value > 0) {
+            size_mb = (int)value;
+        } else {
+            path = argv[1];
+            temp_file = 0;
+        }
+    }
+    int runs = argc > 2 ? atoi(argv[2]) : 3;
+    if (runs < 1) {
+        runs = 1;
+    }
+    if (temp_file && write_temp_model(path, size_mb) != 0) {
+        printf("write %s fail\n", path);
+        return 1;
+    }
+
+    printf("%s, best of %d runs per mode\n", path, runs);
+    printf("%-20s %6s %9s %9s %10s %10s %10s\n", "mode", "cache", "load ms", "init ms", "VmHWM KB", "anon KB",
+           "file KB");
+    int failed = 0;
+    int have_checksum = 0;
+    unsigned int checksum = 0;
+    for (int cold = 1; cold >= 0; cold--) {
+        for (int m = 0; m < NUM_MODES; m++) {
+            load_result_t best;
+            memset(&best, 0, sizeof(best));
+            for (int r = 0; r < runs; r++) {
+                load_result_t result;
+                if (cold) {
+                    drop_file_cache(path);
+                }
+                if (run_in_child(path, &g_modes[m], &result) != 0) {
+                    printf("%s: load fail\n", g_modes[m].name);
+                    failed++;
+                    break;
+                }
+                if (!have_checksum) {
+                    checksum = result.checksum;
+                    have_checksum = 1;
+                } else if (result.checksum != checksum) {
+                    printf("%s: checksum differs\n", g_modes[m].name);
+                    failed++;
+                }
+                if (r == 0 || result.init_ms < best.init_ms) {
+                    best = result;
+                }
+            }
+            printf("%-20s %6s %9.2f %9.2f %10ld %10ld %10ld\n", g_modes[m].name, cold ? "cold" : "warm", best.load_ms,
+                   best.init_ms, best.hwm_kb, best.anon_kb, best.file_kb);
+        }
+    }
+    if (temp_file) {
+        unlink(path);
+    }
+    if (failed > 0) {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef _RKNN_MODEL_ZOO_RESIZE_KERNELS_H_
+#define _RKNN_MODEL_ZOO_RESIZE_KERNELS_H_
+
+#include "image_resize.h"
+
+/**
+ * @brief One build of image_resize.c, the native one or a variant with other SIMD settings
+ *
+ */
+typedef struct {
+    const char* name;
+    int (*table_init)(bilinear_table_t* table, int src_channel, int dst_channel, int src_width, int src_height,
+                      float crop_x, float crop_y, float crop_width, float crop_height, int dst_width, int dst_height);
+    void (*table_release)(bilinear_table_t* table);
+    int (*resize_rows)(const bilinear_table_t* table, const unsigned char* src, int src_stride,
+                       unsigned char* dst, int dst_stride, int dy_begin, int dy_end);
+    int (*resize_yuv420sp_to_rgb_rows)(const bilinear_table_t* y_table, const bilinear_table_t* uv_table,
+                                       const unsigned char* src_y, int y_stride,
+                                       const unsigned char* src_uv, int uv_stride, int v_first,
+                                       unsigned char* dst, int dst_stride, int dy_begin, int dy_end);
+} resize_kernels_t;
+
+// 标量参考实现，所有目标平台都编译
+extern const resize_kernels_t resize_kernels_scalar;
+
+#if defined(RESIZE_TEST_SSE2)
+extern const resize_kernels_t resize_kernels_sse2;
+#endif
+
+#if defined(RESIZE_TEST_AVX2)
+extern const resize_kernels_t resize_kernels_avx2;
+#endif
+
+#endif // _RKNN_MODEL_ZOO_RESIZE_KERNELS_H_
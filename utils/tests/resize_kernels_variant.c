@@ -0,0 +1,35 @@
+/*
+ * image_resize.c built once more with the SIMD settings of this target, public
+ * functions renamed with the RESIZE_VARIANT suffix so the build links next to
+ * the native image_resize.c in resize_test.
+ *
+ *   RESIZE_VARIANT=scalar  with IMAGE_UTILS_DISABLE_SIMD
+ *   RESIZE_VARIANT=sse2    with -mno-avx2 (x86)
+ *   RESIZE_VARIANT=avx2    with -mavx2 (x86)
+ */
+
+#define RESIZE_VARIANT_CAT2(name, variant) name##_##variant
+#define RESIZE_VARIANT_CAT(name, variant) RESIZE_VARIANT_CAT2(name, variant)
+#define RESIZE_VARIANT_SYMBOL(name) RESIZE_VARIANT_CAT(name, RESIZE_VARIANT)
+#define RESIZE_VARIANT_STR2(variant) #variant
+#define RESIZE_VARIANT_STR(variant) RESIZE_VARIANT_STR2(variant)
+
+#define bilinear_table_init RESIZE_VARIANT_SYMBOL(bilinear_table_init)
+#define bilinear_table_release RESIZE_VARIANT_SYMBOL(bilinear_table_release)
+#define bilinear_resize_rows RESIZE_VARIANT_SYMBOL(bilinear_resize_rows)
+#define bilinear_hresize_row RESIZE_VARIANT_SYMBOL(bilinear_hresize_row)
+#define bilinear_vresize_row RESIZE_VARIANT_SYMBOL(bilinear_vresize_row)
+#define yuv420sp_to_rgb_row RESIZE_VARIANT_SYMBOL(yuv420sp_to_rgb_row)
+#define bilinear_resize_yuv420sp_to_rgb_rows RESIZE_VARIANT_SYMBOL(bilinear_resize_yuv420sp_to_rgb_rows)
+
+#include "image_resize.c"
+
+#include "resize_kernels.h"
+
+const resize_kernels_t RESIZE_VARIANT_SYMBOL(resize_kernels) = {
+    RESIZE_VARIANT_STR(RESIZE_VARIANT),
+    bilinear_table_init,
+    bilinear_table_release,
+    bilinear_resize_rows,
+    bilinear_resize_yuv420sp_to_rgb_rows,
+};
@@ -0,0 +1,332 @@
+/*
+ * Bit-exactness test of the fixed-point bilinear resize in image_resize.c.
+ *
+ * Every resize mode of the CPU convert_image path runs on random sizes, crops
+ * and strides with the native build of image_resize.c (NEON on arm, SSE2 or
+ * AVX2 on x86) and with each variant of resize_kernels.h. The outputs must be
+ * byte-identical to the scalar reference, rows produced in two bands must be
+ * identical to one pass, and row padding of the target must stay untouched.
+ *
+ * The FNV-1a digest of all outputs of a mode is also compared with the values
+ * recorded below, so a change of letterbox output on any target shows up even
+ * when all kernels of that target agree with each other.
+ *
+ * usage: resize_test [cases_per_mode]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "image_resize.h"
+#include "resize_kernels.h"
+
+#define PAD_VALUE 0xA5
+#define DEFAULT_CASES 100
+
+typedef enum {
+    MODE_GRAY8,
+    MODE_RGB888,
+    MODE_RGBA8888,
+    MODE_RGBA8888_TO_RGB888,
+    MODE_NV12,
+    MODE_NV12_TO_RGB888,
+    MODE_NV21_TO_RGB888,
+    MODE_NUM,
+} resize_mode_t;
+
+typedef struct {
+    const char* name;
+    int src_channel;
+    int dst_channel;
+    int yuv;                // 0: packed plane; 1: yuv420sp target; 2: yuv420sp to rgb888
+    int v_first;
+    unsigned int digest;    // 默认用例数下全部输出的FNV-1a
+} mode_info_t;
+
+static const mode_info_t g_modes[MODE_NUM] = {
+    {"GRAY8", 1, 1, 0, 0, 0xf23ae924u},
+    {"RGB888", 3, 3, 0, 0, 0x370b7dbdu},
+    {"RGBA8888", 4, 4, 0, 0, 0x8fc78964u},
+    {"RGBA8888->RGB888", 4, 3, 0, 0, 0x296c4086u},
+    {"NV12", 1, 1, 1, 0, 0x1bf35c88u},
+    {"NV12->RGB888", 1, 3, 2, 0, 0x2d41deb6u},
+    {"NV21->RGB888", 1, 3, 2, 1, 0xb836c493u},
+};
+
+static const resize_kernels_t g_native = {
+    "native",
+    bilinear_table_init,
+    bilinear_table_release,
+    bilinear_resize_rows,
+    bilinear_resize_yuv420sp_to_rgb_rows,
+};
+
+#define MAX_VARIANTS 4
+
+static const resize_kernels_t* g_variants[MAX_VARIANTS];
+static int g_num_variants = 0;
+
+// AVX2变体只在CPU支持时运行
+static void collect_variants(void)
+{
+    g_variants[g_num_variants++] = &resize_kernels_scalar;
+    g_variants[g_num_variants++] = &g_native;
+#if defined(RESIZE_TEST_SSE2)
+    g_variants[g_num_variants++] = &resize_kernels_sse2;
+#endif
+#if defined(RESIZE_TEST_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        g_variants[g_num_variants++] = &resize_kernels_avx2;
+    }
+#endif
+}
+
+static unsigned int g_seed = 1;
+
+static unsigned int rand_u32(void)
+{
+    g_seed = g_seed * 1103515245u + 12345u;
+    return (g_seed >> 8) & 0xffffff;
+}
+
+static int rand_range(int min, int max)
+{
+    return min + (int)(rand_u32() % (unsigned int)(max - min + 1));
+}
+
+static unsigned int fnv1a(unsigned int hash, const unsigned char* data, int size)
+{
+    for (int i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Source image and crop of one case, target box and strides
+ *
+ */
+typedef struct {
+    int src_width;
+    int src_height;
+    int src_stride;
+    unsigned char* src;
+    unsigned char* src_uv;
+    int crop_x;
+    int crop_y;
+    int crop_width;
+    int crop_height;
+    int dst_width;
+    int dst_height;
+    int dst_stride;
+    int dst_uv_stride;
+    int dst_size;           // 目标Y/RGB平面 + UV平面
+} resize_case_t;
+
+// yuv420sp的宽高和裁剪需为偶数
+static void make_case(resize_case_t* c, const mode_info_t* mode, int index)
+{
+    int align = mode->yuv ? 2 : 1;
+    if (index == 0) {
+        // 典型的1080p letterbox
+        c->src_width = 1920;
+        c->src_height = 1080;
+        c->crop_x = 0;
+        c->crop_y = 0;
+        c->crop_width = 1920;
+        c->crop_height = 1080;
+        c->dst_width = 640;
+        c->dst_height = 360;
+    } else {
+        c->src_width = rand_range(1, 320 / align) * align;
+        c->src_height = rand_range(1, 240 / align) * align;
+        c->crop_x = rand_range(0, (c->src_width - align) / align) * align;
+        c->crop_y = rand_range(0, (c->src_height - align) / align) * align;
+        c->crop_width = rand_range(1, (c->src_width - c->crop_x) / align) * align;
+        c->crop_height = rand_range(1, (c->src_height - c->crop_y) / align) * align;
+        // 缩小和放大都覆盖
+        c->dst_width = rand_range(1, 400 / align) * align;
+        c->dst_height = rand_range(1, 300 / align) * align;
+    }
+    int src_pad = rand_range(0, 40);
+    c->src_stride = c->src_width * mode->src_channel + src_pad;
+    int src_size = c->src_stride * c->src_height;
+    if (mode->yuv) {
+        src_size += c->src_stride * c->src_height / 2;
+    }
+    c->src = (unsigned char*)malloc(src_size);
+    for (int i = 0; i < src_size; i++) {
+        c->src[i] = (unsigned char)rand_u32();
+    }
+    c->src_uv = mode->yuv ? c->src + c->src_stride * c->src_height : NULL;
+
+    int dst_pad = rand_range(0, 40);
+    c->dst_stride = c->dst_width * mode->dst_channel + dst_pad;
+    c->dst_uv_stride = c->dst_width + dst_pad;
+    c->dst_size = c->dst_stride * c->dst_height;
+    if (mode->yuv == 1) {
+        c->dst_size += c->dst_uv_stride * (c->dst_height / 2);
+    }
+}
+
+static void release_case(resize_case_t* c)
+{
+    free(c->src);
+}
+
+// 与image_utils.c中box_resizer的建表和调用方式一致，band_end之前和之后的行分两次生成
+static int run_case(const resize_kernels_t* k, const mode_info_t* mode, const resize_case_t* c, int band_end,
+                    unsigned char* dst)
+{
+    bilinear_table_t table;
+    bilinear_table_t uv_table;
+    memset(&uv_table, 0, sizeof(uv_table));
+    int ret = k->table_init(&table, mode->src_channel, mode->yuv ? 1 : mode->dst_channel, c->src_width, c->src_height,
+                            c->crop_x, c->crop_y, c->crop_width, c->crop_height, c->dst_width, c->dst_height);
+    if (ret != 0) {
+        return -1;
+    }
+    if (mode->yuv == 1) {
+        ret = k->table_init(&uv_table, 2, 2, c->src_width / 2, c->src_height / 2, c->crop_x / 2.f, c->crop_y / 2.f,
+                            c->crop_width / 2.f, c->crop_height / 2.f, c->dst_width / 2, c->dst_height / 2);
+    } else if (mode->yuv == 2) {
+        ret = k->table_init(&uv_table, 2, 2, c->src_width / 2, c->src_height / 2, c->crop_x / 2.f, c->crop_y / 2.f,
+                            c->crop_width / 2.f, c->crop_height / 2.f, c->dst_width, c->dst_height);
+    }
+
+    int bands[3] = {0, band_end, c->dst_height};
+    for (int b = 0; b < 2 && ret == 0; b++) {
+        int dy_begin = bands[b];
+        int dy_end = bands[b + 1];
+        if (dy_begin >= dy_end) {
+            continue;
+        }
+        unsigned char* dst_row = dst + (size_t)dy_begin * c->dst_stride;
+        if (mode->yuv == 2) {
+            ret = k->resize_yuv420sp_to_rgb_rows(&table, &uv_table, c->src, c->src_stride, c->src_uv, c->src_stride,
+                                                 mode->v_first, dst_row, c->dst_stride, dy_begin, dy_end);
+            continue;
+        }
+        ret = k->resize_rows(&table, c->src, c->src_stride, dst_row, c->dst_stride, dy_begin, dy_end);
+        if (ret == 0 && mode->yuv == 1) {
+            unsigned char* dst_uv = dst + c->dst_stride * c->dst_height;
+            int uv_begin = dy_begin / 2;
+            int uv_end = dy_end >= c->dst_height ? uv_table.dst_height : dy_end / 2;
+            ret = k->resize_rows(&uv_table, c->src_uv, c->src_stride, dst_uv + (size_t)uv_begin * c->dst_uv_stride,
+                                 c->dst_uv_stride, uv_begin, uv_end);
+        }
+    }
+    k->table_release(&table);
+    k->table_release(&uv_table);
+    return ret;
+}
+
+// 每行有效字节之后的填充不能被写
+static int check_padding(const mode_info_t* mode, const resize_case_t* c, const unsigned char* dst)
+{
+    int row_bytes = c->dst_width * mode->dst_channel;
+    for (int y = 0; y < c->dst_height; y++) {
+        for (int x = row_bytes; x < c->dst_stride; x++) {
+            if (dst[(size_t)y * c->dst_stride + x] != PAD_VALUE) {
+                return -1;
+            }
+        }
+    }
+    if (mode->yuv == 1) {
+        const unsigned char* dst_uv = dst + c->dst_stride * c->dst_height;
+        for (int y = 0; y < c->dst_height / 2; y++) {
+            for (int x = (c->dst_width / 2) * 2; x < c->dst_uv_stride; x++) {
+                if (dst_uv[(size_t)y * c->dst_uv_stride + x] != PAD_VALUE) {
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static void print_case(const resize_case_t* c)
+{
+    printf("  src %dx%d stride %d crop (%d %d %d %d) dst %dx%d stride %d\n", c->src_width, c->src_height,
+           c->src_stride, c->crop_x, c->crop_y, c->crop_width, c->crop_height, c->dst_width, c->dst_height,
+           c->dst_stride);
+}
+
+static int test_mode(resize_mode_t mode_id, int cases, unsigned int* digest)
+{
+    const mode_info_t* mode = &g_modes[mode_id];
+    unsigned int hash = 2166136261u;
+    g_seed = 1000 + mode_id * 7919;
+    for (int i = 0; i < cases; i++) {
+        resize_case_t c;
+        make_case(&c, mode, i);
+        unsigned char* ref = (unsigned char*)malloc(c.dst_size);
+        unsigned char* out = (unsigned char*)malloc(c.dst_size);
+        memset(ref, PAD_VALUE, c.dst_size);
+        if (run_case(&resize_kernels_scalar, mode, &c, c.dst_height, ref) != 0 || check_padding(mode, &c, ref) != 0) {
+            printf("%s case %d: scalar reference fail\n", mode->name, i);
+            print_case(&c);
+            return -1;
+        }
+        // 行带起点需为偶数，与yuv420sp目标的分带方式一致
+        int band_end = (rand_range(0, c.dst_height) / 2) * 2;
+        for (int v = 0; v < g_num_variants; v++) {
+            for (int split = 0; split < 2; split++) {
+                memset(out, PAD_VALUE, c.dst_size);
+                int ret = run_case(g_variants[v], mode, &c, split ? band_end : c.dst_height, out);
+                if (ret != 0 || memcmp(ref, out, c.dst_size) != 0) {
+                    int first = 0;
+                    while (first < c.dst_size && ref[first] == out[first]) {
+                        first++;
+                    }
+                    printf("%s case %d: %s%s differs from scalar at byte %d\n", mode->name, i, g_variants[v]->name,
+                           split ? " (two bands)" : "", first);
+                    print_case(&c);
+                    return -1;
+                }
+            }
+        }
+        hash = fnv1a(hash, ref, c.dst_size);
+        free(ref);
+        free(out);
+        release_case(&c);
+    }
+    *digest = hash;
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int cases = argc > 1 ? atoi(argv[1]) : DEFAULT_CASES;
+    if (cases < 1) {
+        cases = 1;
+    }
+    collect_variants();
+    printf("kernels:");
+    for (int v = 0; v < g_num_variants; v++) {
+        printf(" %s", g_variants[v]->name);
+    }
+    printf("\n");
+
+    int failed = 0;
+    for (int m = 0; m < MODE_NUM; m++) {
+        unsigned int digest = 0;
+        if (test_mode((resize_mode_t)m, cases, &digest) != 0) {
+            failed++;
+            continue;
+        }
+        if (cases == DEFAULT_CASES && digest != g_modes[m].digest) {
+            printf("%s: digest 0x%08x, expected 0x%08x\n", g_modes[m].name, digest, g_modes[m].digest);
+            failed++;
+            continue;
+        }
+        printf("%s: %d cases ok, digest 0x%08x\n", g_modes[m].name, cases, digest);
+    }
+    if (failed > 0) {
+        printf("FAIL %d modes\n", failed);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
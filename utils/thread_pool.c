@@ -0,0 +1,247 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "thread_pool.h"
+
+struct thread_pool {
+    int num_threads;
+    pthread_t* workers;
+    int* worker_cores;
+    int caller_core;                // core of calling thread during parallel_for, -1: no binding
+
+    pthread_mutex_t run_lock;       // serialize parallel_for callers
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+
+    unsigned int generation;        // increase for every parallel_for
+    int quit;
+
+    thread_pool_task_t task;
+    void* arg;
+    int num_tasks;
+    int next_task;
+    int finished_tasks;
+    int active_workers;
+};
+
+static void bind_current_thread(int core_id)
+{
+    if (core_id < 0) {
+        return;
+    }
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(core_id, &mask);
+    if (sched_setaffinity(0, sizeof(mask), &mask) != 0) {
+        printf("thread_pool: bind core %d fail\n", core_id);
+    }
+}
+
+// 取任务直到没有剩余，返回本线程完成的任务数
+static int run_tasks(thread_pool_t* pool)
+{
+    int done = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        int index = pool->next_task < pool->num_tasks ? pool->next_task++ : -1;
+        pthread_mutex_unlock(&pool->lock);
+        if (index < 0) {
+            break;
+        }
+        pool->task(pool->arg, index);
+        done++;
+    }
+    return done;
+}
+
+static void* worker_main(void* arg)
+{
+    thread_pool_t* pool = (thread_pool_t*)arg;
+    int worker_index = -1;
+
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < pool->num_threads - 1; i++) {
+        if (pthread_equal(pool->workers[i], pthread_self())) {
+            worker_index = i;
+            break;
+        }
+    }
+    unsigned int seen = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (worker_index >= 0 && pool->worker_cores != NULL) {
+        bind_current_thread(pool->worker_cores[worker_index]);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->quit && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        if (pool->quit) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        pool->active_workers++;
+        pthread_mutex_unlock(&pool->lock);
+
+        int done = run_tasks(pool);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->finished_tasks += done;
+        pool->active_workers--;
+        if (pool->finished_tasks == pool->num_tasks && pool->active_workers == 0) {
+            pthread_cond_signal(&pool->done_cond);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+thread_pool_t* thread_pool_create(int num_threads, const int* core_ids, int num_core_ids)
+{
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    thread_pool_t* pool = (thread_pool_t*)malloc(sizeof(thread_pool_t));
+    if (pool == NULL) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(thread_pool_t));
+    pool->num_threads = num_threads;
+    pool->caller_core = core_ids != NULL && num_core_ids > 0 ? core_ids[0] : -1;
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    int num_workers = num_threads - 1;
+    if (num_workers == 0) {
+        return pool;
+    }
+    pool->workers = (pthread_t*)malloc(num_workers * sizeof(pthread_t));
+    if (pool->workers == NULL) {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+    if (core_ids != NULL && num_core_ids > 1) {
+        // 第一个核留给调用线程，其余核轮流分给工作线程；只给一个核时工作线程不绑定
+        pool->worker_cores = (int*)malloc(num_workers * sizeof(int));
+        if (pool->worker_cores == NULL) {
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+        for (int i = 0; i < num_workers; i++) {
+            pool->worker_cores[i] = core_ids[1 + i % (num_core_ids - 1)];
+        }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&pool->workers[i], NULL, worker_main, pool) != 0) {
+            printf("thread_pool: create worker %d fail\n", i);
+            pool->num_threads = i + 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return pool;
+}
+
+void thread_pool_destroy(thread_pool_t* pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    if (pool->workers != NULL) {
+        pthread_mutex_lock(&pool->lock);
+        pool->quit = 1;
+        pthread_cond_broadcast(&pool->work_cond);
+        pthread_mutex_unlock(&pool->lock);
+        for (int i = 0; i < pool->num_threads - 1; i++) {
+            pthread_join(pool->workers[i], NULL);
+        }
+        free(pool->workers);
+    }
+    free(pool->worker_cores);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run_lock);
+    free(pool);
+}
+
+int thread_pool_get_num_threads(thread_pool_t* pool)
+{
+    return pool != NULL ? pool->num_threads : 1;
+}
+
+static void run_tasks_inline(int num_tasks, thread_pool_task_t task, void* arg)
+{
+    for (int i = 0; i < num_tasks; i++) {
+        task(arg, i);
+    }
+}
+
+static void run_parallel(thread_pool_t* pool, int num_tasks, thread_pool_task_t task, void* arg)
+{
+    pthread_mutex_lock(&pool->run_lock);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->num_tasks = num_tasks;
+    pool->next_task = 0;
+    pool->finished_tasks = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    int done = run_tasks(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->finished_tasks += done;
+    while (pool->finished_tasks < pool->num_tasks || pool->active_workers > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pool->task = NULL;
+    pool->arg = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_mutex_unlock(&pool->run_lock);
+}
+
+int thread_pool_parallel_for(thread_pool_t* pool, int num_tasks, thread_pool_task_t task, void* arg)
+{
+    if (task == NULL || num_tasks < 0) {
+        return -1;
+    }
+    if (pool == NULL) {
+        run_tasks_inline(num_tasks, task, arg);
+        return 0;
+    }
+
+    // 调用线程执行期间绑定到core_ids[0]，返回前恢复原来的亲和性
+    cpu_set_t saved_mask;
+    int rebind = pool->caller_core >= 0 && sched_getaffinity(0, sizeof(saved_mask), &saved_mask) == 0;
+    if (rebind) {
+        bind_current_thread(pool->caller_core);
+    }
+    if (pool->num_threads <= 1 || num_tasks <= 1) {
+        run_tasks_inline(num_tasks, task, arg);
+    } else {
+        run_parallel(pool, num_tasks, task, arg);
+    }
+    if (rebind && sched_setaffinity(0, sizeof(saved_mask), &saved_mask) != 0) {
+        printf("thread_pool: restore affinity fail\n");
+    }
+    return 0;
+}
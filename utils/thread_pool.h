@@ -0,0 +1,71 @@
+#ifndef _RKNN_MODEL_ZOO_THREAD_POOL_H_
+#define _RKNN_MODEL_ZOO_THREAD_POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Persistent worker threads for data parallel loops
+ *
+ */
+typedef struct thread_pool thread_pool_t;
+
+/**
+ * @brief Task of parallel for
+ *
+ * @param arg [in] User argument
+ * @param index [in] Task index in [0, num_tasks)
+ */
+typedef void (*thread_pool_task_t)(void* arg, int index);
+
+/**
+ * @brief Create thread pool
+ *
+ * core_ids[0] is the core of the calling thread while it runs thread_pool_parallel_for(),
+ * workers are bound to core_ids[1..num_core_ids-1] round robin. With one core id only the
+ * calling thread is bound and workers may run on any core.
+ *
+ * @param num_threads [in] Total thread number including the calling thread (worker number = num_threads - 1)
+ * @param core_ids [in] CPU core ids, NULL: no binding
+ * @param num_core_ids [in] Size of core_ids
+ * @return thread_pool_t* NULL: error
+ */
+thread_pool_t* thread_pool_create(int num_threads, const int* core_ids, int num_core_ids);
+
+/**
+ * @brief Stop and join all workers
+ *
+ * @param pool [in] Thread pool
+ */
+void thread_pool_destroy(thread_pool_t* pool);
+
+/**
+ * @brief Get total thread number of pool
+ *
+ * @param pool [in] Thread pool
+ * @return int thread number, 1 if pool is NULL
+ */
+int thread_pool_get_num_threads(thread_pool_t* pool);
+
+/**
+ * @brief Run task(arg, i) for every i in [0, num_tasks), the calling thread works too
+ *
+ * Return after all tasks finish. Calls from different threads are serialized.
+ * If pool is NULL tasks run on the calling thread. If the pool was created with core ids,
+ * the calling thread is bound to core_ids[0] during the call and its affinity is restored
+ * before returning.
+ *
+ * @param pool [in] Thread pool
+ * @param num_tasks [in] Task number
+ * @param task [in] Task function
+ * @param arg [in] User argument
+ * @return int 0: success; -1: error
+ */
+int thread_pool_parallel_for(thread_pool_t* pool, int num_tasks, thread_pool_task_t task, void* arg);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif // _RKNN_MODEL_ZOO_THREAD_POOL_H_